@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "async_cmd.h"
+
+#include "base_cmd.h"
+
+namespace pikiwidb {
+
+AsyncCmdPool& AsyncCmdPool::Instance() {
+  static AsyncCmdPool pool;
+  return pool;
+}
+
+void AsyncCmdPool::Start(size_t threads) { pool_ = std::make_unique<pstd::WorkStealingPool>(threads); }
+
+void AsyncCmdPool::Stop() {
+  if (pool_) {
+    pool_->Stop();
+  }
+}
+
+AsyncCmdPool::Class AsyncCmdPool::Classify(const BaseCmd& cmd) {
+  if (cmd.AclCategory() & kAclCategoryKeyspace) {
+    return kKeyspace;
+  }
+  return cmd.HasFlag(kCmdFlagsMultiKey) ? kMultiKey : kCollection;
+}
+
+const char* AsyncCmdPool::ClassName(Class cls) {
+  switch (cls) {
+    case kKeyspace:
+      return "keyspace";
+    case kMultiKey:
+      return "multikey";
+    default:
+      return "collection";
+  }
+}
+
+void AsyncCmdPool::submit(Class cls, std::function<void()> fn) {
+  auto& stats = stats_[cls];
+  stats.queued.fetch_add(1, std::memory_order_relaxed);
+  const auto queued = CmdStatsNow();
+  pool_->Submit([&stats, queued, fn = std::move(fn)]() {
+    const auto start = CmdStatsNow();
+    stats.queued.fetch_sub(1, std::memory_order_relaxed);
+    const auto wait = start - queued;
+    stats.wait_ns.fetch_add(wait, std::memory_order_relaxed);
+    auto max = stats.max_wait_ns.load(std::memory_order_relaxed);
+    while (wait > max && !stats.max_wait_ns.compare_exchange_weak(max, wait, std::memory_order_relaxed)) {
+    }
+
+    fn();
+    stats.run_ns.fetch_add(CmdStatsNow() - start, std::memory_order_relaxed);
+    stats.calls.fetch_add(1, std::memory_order_relaxed);
+  });
+}
+
+AsyncCmdPool::ClassSnapshot AsyncCmdPool::Collect(Class cls) const {
+  const auto& stats = stats_[cls];
+  ClassSnapshot snapshot;
+  snapshot.queued = stats.queued.load(std::memory_order_relaxed);
+  snapshot.calls = stats.calls.load(std::memory_order_relaxed);
+  snapshot.wait_ns = stats.wait_ns.load(std::memory_order_relaxed);
+  snapshot.max_wait_ns = stats.max_wait_ns.load(std::memory_order_relaxed);
+  snapshot.run_ns = stats.run_ns.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+}  // namespace pikiwidb
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+
+#include "cmd_stats.h"
+#include "net/event_loop.h"
+#include "pstd/work_stealing_pool.h"
+
+namespace pikiwidb {
+
+class BaseCmd;
+
+// coroutine of a command which left its loop, started at once and freed when done, nobody awaits it
+struct CmdTask {
+  struct promise_type {
+    CmdTask get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+/**
+ * @brief Work-stealing threads running the heavy commands
+ * A command flagged kCmdFlagsAsync suspends its coroutine in the worker loop, runs on
+ * this pool and resumes in the loop to send the reply. Other connections of the loop
+ * go on meanwhile; its own connection reads no input until then, so the replies of
+ * a pipeline keep their order.
+ * The commands are accounted by class, for the queue depth and the time they waited.
+ */
+class AsyncCmdPool {
+ public:
+  enum Class {
+    kKeyspace,    // scans the whole DB, like KEYS
+    kMultiKey,    // combines several keys, like SUNION
+    kCollection,  // reads one whole collection, like HGETALL
+    kClassCount,
+  };
+
+  struct ClassSnapshot {
+    int64_t queued = 0;
+    uint64_t calls = 0;
+    uint64_t wait_ns = 0;
+    uint64_t max_wait_ns = 0;
+    uint64_t run_ns = 0;
+  };
+
+  static AsyncCmdPool& Instance();
+
+  AsyncCmdPool(const AsyncCmdPool&) = delete;
+  void operator=(const AsyncCmdPool&) = delete;
+
+  void Start(size_t threads);
+  void Stop();
+  bool IsRunning() const { return pool_ != nullptr; }
+
+  static Class Classify(const BaseCmd& cmd);
+  static const char* ClassName(Class cls);
+
+  // co_await it in a loop: fn runs on the pool, then the coroutine resumes in the loop
+  auto Run(EventLoop* loop, Class cls, std::function<void()> fn) {
+    struct Awaiter {
+      AsyncCmdPool* self;
+      EventLoop* loop;
+      Class cls;
+      std::function<void()> fn;
+
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> h) {
+        // the loop first finishes the input at hand, the replies before this one are sent then
+        loop->Post([this, h]() {
+          self->submit(cls, [this, h]() {
+            fn();
+            loop->Post([h]() { h.resume(); });
+          });
+        });
+      }
+      void await_resume() const noexcept {}
+    };
+    return Awaiter{this, loop, cls, std::move(fn)};
+  }
+
+  ClassSnapshot Collect(Class cls) const;
+  size_t Threads() const { return pool_ ? pool_->Size() : 0; }
+  uint64_t Steals() const { return pool_ ? pool_->Steals() : 0; }
+
+ private:
+  AsyncCmdPool() = default;
+
+  struct ClassStats {
+    std::atomic<int64_t> queued{0};
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> wait_ns{0};
+    std::atomic<uint64_t> max_wait_ns{0};
+    std::atomic<uint64_t> run_ns{0};
+  };
+
+  void submit(Class cls, std::function<void()> fn);
+
+  std::unique_ptr<pstd::WorkStealingPool> pool_;
+  std::array<ClassStats, kClassCount> stats_;
+};
+
+}  // namespace pikiwidb
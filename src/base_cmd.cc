@@ -6,8 +6,15 @@
  */
 
 #include "base_cmd.h"
+#include "blocking.h"
+#include "cmd_stats.h"
 #include "common.h"
+#include "config.h"
+#include "multi.h"
 #include "pikiwidb.h"
+#include "pstd/pstd_defer.h"
+#include "pstd/pstd_string.h"
+#include "slow_log.h"
 
 namespace pikiwidb {
 
@@ -28,19 +35,134 @@ bool BaseCmd::CheckArg(size_t num) const {
 
 std::vector<std::string> BaseCmd::CurrentKey(PClient* client) const { return std::vector<std::string>{client->Key()}; }
 
+// called with the DB lock still held, only when the threshold is hit
+void BaseCmd::recordSlowLog(PClient* client, uint64_t used_ns, const SlowLogPerf& perf) const {
+  // bound the memory of an entry, like redis
+  constexpr size_t kMaxArgc = 32;
+  constexpr size_t kMaxArgLen = 128;
+
+  SlowLogItem item;
+  item.timestamp = ::time(nullptr);
+  item.used = used_ns / 1000;
+  const auto argc = std::min(client->argv_.size(), kMaxArgc);
+  item.cmds.reserve(argc);
+  for (size_t i = 0; i < argc; ++i) {
+    const auto& arg = client->argv_[i];
+    if (i == kMaxArgc - 1 && client->argv_.size() > kMaxArgc) {
+      item.cmds.push_back("... (" + std::to_string(client->argv_.size() - kMaxArgc + 1) + " more arguments)");
+    } else if (arg.size() > kMaxArgLen) {
+      item.cmds.push_back(arg.substr(0, kMaxArgLen) + "... (" + std::to_string(arg.size() - kMaxArgLen) +
+                          " more bytes)");
+    } else {
+      item.cmds.push_back(arg);
+    }
+  }
+  item.client_addr = client->PeerIP() + ":" + std::to_string(client->PeerPort());
+  item.client_name = client->GetName();
+  item.db = client->GetCurrentDB();
+  if (isSingleKey() && client->argv_.size() > 1) {
+    auto inst_id = PSTORE.GetBackend(item.db)->GetStorage()->GetDBInstanceID(client->argv_[1]);
+    item.instance = static_cast<int>(inst_id);
+  }
+  item.perf = perf;
+
+  PSlowLog::Instance().Record(std::move(item));
+}
+
 void BaseCmd::Execute(PClient* client) {
+  const std::span<std::string> argv = client->argv_;
+  const uint64_t parse_ns = client->ParseNanos();
+  execute(
+      client, {&argv, 1}, {&parse_ns, 1}, [this, client] { return DoInitial(client); },
+      [this, client](std::vector<uint64_t>* reply_bytes) {
+        const auto replyStart = client->Message().size();
+        DoCmd(client);
+        (*reply_bytes)[0] = client->Message().size() - replyStart;
+      });
+}
+
+void BaseCmd::ExecuteMerged(PClient* client, std::span<std::vector<std::string>> calls,
+                            std::span<const uint64_t> parse_ns,
+                            const std::function<void(std::vector<uint64_t>* reply_bytes)>& run) {
+  const std::vector<std::span<std::string>> argvs(calls.begin(), calls.end());
+  execute(client, argvs, parse_ns, nullptr, run);
+}
+
+void BaseCmd::execute(PClient* client, std::span<const std::span<std::string>> calls,
+                      std::span<const uint64_t> parse_ns, const std::function<bool()>& initial,
+                      const std::function<void(std::vector<uint64_t>*)>& run) {
+  const auto start = CmdStatsNow();
+
+  // an exclusive command may replace the storage of any DB, it waits until no command uses the storage of one
   auto dbIndex = client->GetCurrentDB();
-  if (!isExclusive()) {
-    PSTORE.GetBackend(dbIndex)->LockShared();
+  auto& db = PSTORE.GetBackend(dbIndex);
+  const bool exclusive = isExclusive();
+  if (exclusive) {
+    PSTORE.LockAll();
+  } else {
+    db->LockShared();
   }
+  DEFER {
+    if (exclusive) {
+      PSTORE.UnLockAll();
+    } else {
+      db->UnLockShared();
+    }
+  };
+  const auto locked = CmdStatsNow();
 
-  if (!DoInitial(client)) {
+  if (initial && !initial()) {
     return;
   }
-  DoCmd(client);
 
-  if (!isExclusive()) {
-    PSTORE.GetBackend(dbIndex)->UnLockShared();
+  // touchWatchedKeys and recordSlowLog read the call from argv_
+  const auto argv = client->argv_;
+  DEFER { client->argv_ = argv; };
+
+  // the keys are bumped before the write, so an EXEC checking the versions under its key locks can't miss it, and
+  // after it, so a WATCH which read the version and then the old value in between fails its EXEC
+  const bool touches = HasFlag(kCmdFlagsWrite);
+  if (touches && PMulti::Instance().Active()) {
+    for (const auto& call : calls) {
+      client->argv_ = call;
+      touchWatchedKeys(client);
+    }
+  }
+
+  // the perf context is per thread, so it is switched on where DoCmd runs
+  auto& slowlog = PSlowLog::Instance();
+  const bool samplePerf = slowlog.SamplePerf();
+  SlowLogPerf perf;
+  std::vector<uint64_t> reply_bytes(calls.size());
+  {
+    PSlowLog::PerfScope scope(samplePerf, &perf);
+    run(&reply_bytes);
+  }
+  // a queued write is visible once EXEC commits, which bumps its keys again then
+  if (touches && !client->IsFlagOn(kClientFlagMulti) && PMulti::Instance().Active()) {
+    for (const auto& call : calls) {
+      client->argv_ = call;
+      touchWatchedKeys(client);
+    }
+  }
+  // pushes inside a transaction wake the blocked clients once EXEC committed them
+  if (!client->IsFlagOn(kClientFlagMulti)) {
+    PBlocking::Instance().ServeReady();
+  }
+  const auto done = CmdStatsNow();
+
+  for (size_t i = 0; i < calls.size(); ++i) {
+    CmdSample sample;
+    sample.parse_ns = parse_ns[i];
+    sample.lock_ns = (locked - start) / calls.size();
+    sample.storage_ns = (done - locked) / calls.size();
+    sample.total_ns = (done - start) / calls.size();
+    sample.reply_bytes = reply_bytes[i];
+    if (slowlog.IsSlow(sample.total_ns) && !HasFlag(kCmdFlagsSkipSlowlog)) {
+      client->argv_ = calls[i];
+      recordSlowLog(client, sample.total_ns, perf);
+    }
+    CmdStats::Instance().Record(cmdId_, sample);
   }
 }
 
@@ -54,35 +176,82 @@ bool BaseCmd::HasFlag(uint32_t flag) const { return flag_ & flag; }
 void BaseCmd::SetFlag(uint32_t flag) { flag_ |= flag; }
 void BaseCmd::ResetFlag(uint32_t flag) { flag_ &= ~flag; }
 bool BaseCmd::HasSubCommand() const { return false; }
-BaseCmd* BaseCmd::GetSubCmd(const std::string& cmdName) { return nullptr; }
+BaseCmd* BaseCmd::GetSubCmd(std::string_view cmdName) { return nullptr; }
 uint32_t BaseCmd::AclCategory() const { return aclCategory_; }
 void BaseCmd::AddAclCategory(uint32_t aclCategory) { aclCategory_ |= aclCategory; }
-std::string BaseCmd::Name() const { return name_; }
+const std::string& BaseCmd::Name() const { return name_; }
 // CmdRes& BaseCommand::Res() { return res_; }
 // void BaseCommand::SetResp(const std::shared_ptr<std::string>& resp) { resp_ = resp; }
 // std::shared_ptr<std::string> BaseCommand::GetResp() { return resp_.lock(); }
 uint32_t BaseCmd::GetCmdId() const { return cmdId_; }
 
+// every argument may be a key, a spurious bump only fails an EXEC while a missed one breaks it
+void BaseCmd::touchWatchedKeys(PClient* client) const {
+  auto& multi = PMulti::Instance();
+  if (HasFlag(kCmdFlagsExclusive)) {
+    multi.NotifyDirtyAll(-1);
+    return;
+  }
+  for (size_t i = 1; i < client->argv_.size(); ++i) {
+    multi.NotifyDirty(client->GetCurrentDB(), client->argv_[i]);
+  }
+}
+
+bool BaseCmd::IsHeavy(PClient* client) {
+  const auto min = g_config.async_min_elements;
+  if (min == 0 || client->argv_.size() < 2) {
+    return true;
+  }
+  auto& db = PSTORE.GetBackend(client->GetCurrentDB());
+  db->LockShared();
+  const auto size = collectionSize(client, db->GetStorage().get());
+  db->UnLockShared();
+  return size < 0 || size >= min;
+}
+
+int64_t BaseCmd::indexRangeLen(const std::string& start, const std::string& stop) {
+  int64_t first = 0;
+  int64_t last = 0;
+  if (pstd::String2int(start, &first) == 0 || pstd::String2int(stop, &last) == 0 || first < 0 || last < 0) {
+    return -1;
+  }
+  return last < first ? 0 : last - first + 1;
+}
+
+bool BaseCmd::isSingleKey() const {
+  return HasFlag(kCmdFlagsWrite | kCmdFlagsReadonly) &&
+         !HasFlag(kCmdFlagsAdmin | kCmdFlagsExclusive | kCmdFlagsMultiKey | kCmdFlagsBlocking);
+}
+
 // BaseCmdGroup
 BaseCmdGroup::BaseCmdGroup(const std::string& name, uint32_t flag) : BaseCmdGroup(name, -2, flag) {}
 BaseCmdGroup::BaseCmdGroup(const std::string& name, int16_t arity, uint32_t flag) : BaseCmd(name, arity, flag, 0) {}
 
 void BaseCmdGroup::AddSubCmd(std::unique_ptr<BaseCmd> cmd) { subCmds_[cmd->Name()] = std::move(cmd); }
 
-BaseCmd* BaseCmdGroup::GetSubCmd(const std::string& cmdName) {
-  auto subCmd = subCmds_.find(cmdName);
-  if (subCmd == subCmds_.end()) {
-    return nullptr;
+void BaseCmdGroup::BuildSubCmdIndex() {
+  std::vector<std::pair<std::string_view, BaseCmd*>> entries;
+  entries.reserve(subCmds_.size());
+  for (const auto& [name, subCmd] : subCmds_) {
+    entries.emplace_back(name, subCmd.get());
+  }
+  if (!subCmdIndex_.Build(entries)) {
+    ERROR("build sub command index of {} failed, {} sub commands", Name(), entries.size());
   }
-  return subCmd->second.get();
+}
+
+BaseCmd* BaseCmdGroup::GetSubCmd(std::string_view cmdName) {
+  auto subCmd = subCmdIndex_.Find(cmdName);
+  return subCmd ? *subCmd : nullptr;
 }
 
 bool BaseCmdGroup::DoInitial(PClient* client) {
-  client->SetSubCmdName(client->argv_[1]);
-  if (!subCmds_.contains(client->SubCmdName())) {
-    client->SetRes(CmdRes::kSyntaxErr, client->argv_[0] + " unknown subcommand for '" + client->SubCmdName() + "'");
+  auto subCmd = GetSubCmd(client->argv_[1]);
+  if (!subCmd) {
+    client->SetRes(CmdRes::kSyntaxErr, client->argv_[0] + " unknown subcommand for '" + client->argv_[1] + "'");
     return false;
   }
+  client->SetSubCmdName(subCmd->Name());
   return true;
 }
 
@@ -8,18 +8,23 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 #include "client.h"
+#include "pstd/perfect_hash_map.h"
 #include "store.h"
 
 namespace pikiwidb {
 
+struct SlowLogPerf;
+
 // command definition
 
 // key cmd
@@ -68,6 +73,10 @@ const std::string kCmdNameFlushdb = "flushdb";
 const std::string kCmdNameFlushall = "flushall";
 const std::string kCmdNameAuth = "auth";
 const std::string kCmdNameSelect = "select";
+const std::string kCmdNameInfo = "info";
+const std::string kCmdNameLatency = "latency";
+const std::string kCmdNameSlowlog = "slowlog";
+const std::string kCmdNameMonitor = "monitor";
 
 // hash cmd
 const std::string kCmdNameHSet = "hset";
@@ -116,6 +125,10 @@ const std::string kCmdNameLSet = "lset";
 const std::string kCmdNameLInsert = "linsert";
 const std::string kCmdNameLIndex = "lindex";
 const std::string kCmdNameLLen = "llen";
+const std::string kCmdNameBLPop = "blpop";
+const std::string kCmdNameBRPop = "brpop";
+const std::string kCmdNameBRPoplpush = "brpoplpush";
+const std::string kCmdNameBLMove = "blmove";
 
 // zset cmd
 const std::string kCmdNameZAdd = "zadd";
@@ -147,6 +160,8 @@ enum CmdFlags {
   kCmdFlagsModuleNoCluster = (1 << 13),  // No cluster mode support
   kCmdFlagsNoMulti = (1 << 14),          // Cannot be pipelined
   kCmdFlagsExclusive = (1 << 15),        // May change Storage pointer, like pika's kCmdFlagsSuspend
+  kCmdFlagsMultiKey = (1 << 16),         // Touches keys other than argv[1], may span storage instances
+  kCmdFlagsAsync = (1 << 17),            // May read much data, runs off the event loop when async-read-threads is set
 };
 
 enum AclCategory {
@@ -206,16 +221,7 @@ class BaseCmd : public std::enable_shared_from_this<BaseCmd> {
   //    std::vector<int> hints;
   //  };
 
-  //  struct CommandStatistics {
-  //    CommandStatistics() = default;
-  //    CommandStatistics(const CommandStatistics& other) {
-  //      cmd_time_consuming.store(other.cmd_time_consuming.load());
-  //      cmd_count.store(other.cmd_count.load());
-  //    }
-  //    std::atomic<int32_t> cmd_count = {0};
-  //    std::atomic<int32_t> cmd_time_consuming = {0};
-  //  };
-  //  CommandStatistics state;
+  // call counts and latencies are kept per cmdId_ in CmdStats, see Execute
 
   /**
    * @brief Construct a new Base Cmd object
@@ -238,6 +244,10 @@ class BaseCmd : public std::enable_shared_from_this<BaseCmd> {
   // 后续如果需要拓展，在这个函数里面拓展
   // 对外部调用者来说，只暴露这个函数，其他的都是内部实现
   void Execute(PClient* client);
+  // runs calls of this command the client merged into one storage call as Execute runs each one: run does their
+  // storage work and replies them in order, with the bytes of each reply. Each call is accounted a share of the time
+  void ExecuteMerged(PClient* client, std::span<std::vector<std::string>> calls, std::span<const uint64_t> parse_ns,
+                     const std::function<void(std::vector<uint64_t>* reply_bytes)>& run);
 
   // binlog 相关的函数，我对这块不熟悉，就没有移植，后面binlog应该可以在Execute里面调用
   virtual std::string ToBinlog(uint32_t exec_time, uint32_t term_id, uint64_t logic_id, uint32_t filenum,
@@ -264,11 +274,11 @@ class BaseCmd : public std::enable_shared_from_this<BaseCmd> {
   // If it is a subcommand, you need to implement these functions
   // e.g: CmdConfig is a subcommand, and the subcommand is set and get
   virtual bool HasSubCommand() const;  // The command is there a sub command
-  virtual BaseCmd* GetSubCmd(const std::string& cmdName);
+  virtual BaseCmd* GetSubCmd(std::string_view cmdName);
 
   uint32_t AclCategory() const;
   void AddAclCategory(uint32_t aclCategory);
-  std::string Name() const;
+  const std::string& Name() const;
   //  CmdRes& Res();
   //  std::string db_name() const;
   //  BinlogOffset binlog_offset() const;
@@ -284,7 +294,23 @@ class BaseCmd : public std::enable_shared_from_this<BaseCmd> {
 
   bool isExclusive() { return static_cast<bool>(flag_ & kCmdFlagsExclusive); }
 
+  // only touches the key in argv[1], so it can run on the thread owning that key's instance
+  bool isSingleKey() const;
+
+  // bump the WATCH versions of the keys this write may touch
+  void touchWatchedKeys(PClient* client) const;
+
+  // whether a call of a kCmdFlagsAsync command is worth leaving the loop, a collection
+  // smaller than async-min-elements is read in place. Called before DoInitial
+  bool IsHeavy(PClient* client);
+
  protected:
+  // elements the call reads from the collection in argv[1], from the arguments or the meta cache alone since the
+  // caller holds no lock, -1 when unknown
+  virtual int64_t collectionSize(PClient* client, storage::Storage* storage) const { return -1; }
+  // elements in the index range [start, stop], -1 unless both are non negative
+  static int64_t indexRangeLen(const std::string& start, const std::string& stop);
+
   // Execute a specific command
   virtual void DoCmd(PClient* client) = 0;
 
@@ -307,6 +333,12 @@ class BaseCmd : public std::enable_shared_from_this<BaseCmd> {
   // If this function returns false, then Do Cmd will not be executed
   virtual bool DoInitial(PClient* client) = 0;
 
+  void recordSlowLog(PClient* client, uint64_t used_ns, const SlowLogPerf& perf) const;
+  // what Execute and ExecuteMerged run around the storage work: the DB lock, the watched keys of the calls bumped
+  // before and after run, the blocked clients served, the slowlog and CmdStats. Nothing runs if initial refuses
+  void execute(PClient* client, std::span<const std::span<std::string>> calls, std::span<const uint64_t> parse_ns,
+               const std::function<bool()>& initial, const std::function<void(std::vector<uint64_t>*)>& run);
+
   //  virtual void Clear(){};
   //  BaseCmd& operator=(const BaseCmd&);
 };
@@ -319,7 +351,11 @@ class BaseCmdGroup : public BaseCmd {
   ~BaseCmdGroup() override = default;
 
   void AddSubCmd(std::unique_ptr<BaseCmd> cmd);
-  BaseCmd* GetSubCmd(const std::string& cmdName) override;
+  // indexes the sub commands once they are all added, before any lookup
+  void BuildSubCmdIndex();
+  // cmdName is matched ignoring case
+  BaseCmd* GetSubCmd(std::string_view cmdName) override;
+  const std::map<std::string, std::unique_ptr<BaseCmd>>& SubCmds() const { return subCmds_; }
 
   // group cmd this function will not be called
   void DoCmd(PClient* client) override{};
@@ -329,5 +365,7 @@ class BaseCmdGroup : public BaseCmd {
 
  private:
   std::map<std::string, std::unique_ptr<BaseCmd>> subCmds_;
+  // over the names in subCmds_
+  pstd::PerfectHashMap<BaseCmd*> subCmdIndex_;
 };
 }  // namespace pikiwidb
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+// CPU spent to hand list elements to idle consumers, busy polling LPOP against BLPOP.
+// A producer pushes at a fixed rate to one list while the consumers pop, the CPU time
+// of the server (from /proc, when its pid is given) and of the consumers is compared
+// for the same number of elements delivered.
+//
+// usage: blocking_pop_bench [host] [port] [server pid] [seconds per mode] [consumers] [pushes/s]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// just enough RESP for the commands below
+class Conn {
+ public:
+  bool Connect(const char* host, int port) {
+    fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (fd_ < 0 || ::inet_pton(AF_INET, host, &addr.sin_addr) != 1 ||
+        ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) {
+      return false;
+    }
+    int one = 1;
+    ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    return true;
+  }
+
+  ~Conn() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  // sends the command and returns the first bulk string of the reply, empty for nil
+  bool Call(const std::vector<std::string>& argv, std::string* value) {
+    std::string req = "*" + std::to_string(argv.size()) + "\r\n";
+    for (const auto& arg : argv) {
+      req.append("$").append(std::to_string(arg.size())).append("\r\n").append(arg).append("\r\n");
+    }
+    if (::write(fd_, req.data(), req.size()) != static_cast<ssize_t>(req.size())) {
+      return false;
+    }
+    value->clear();
+    return readReply(value);
+  }
+
+ private:
+  bool readLine(std::string* line) {
+    while (true) {
+      auto pos = buf_.find("\r\n");
+      if (pos != std::string::npos) {
+        *line = buf_.substr(0, pos);
+        buf_.erase(0, pos + 2);
+        return true;
+      }
+      if (!fill()) {
+        return false;
+      }
+    }
+  }
+
+  bool fill() {
+    char tmp[4096];
+    auto n = ::read(fd_, tmp, sizeof tmp);
+    if (n <= 0) {
+      return false;
+    }
+    buf_.append(tmp, static_cast<size_t>(n));
+    return true;
+  }
+
+  bool readReply(std::string* value) {
+    std::string line;
+    if (!readLine(&line) || line.empty()) {
+      return false;
+    }
+    const long n = std::atol(line.c_str() + 1);
+    switch (line[0]) {
+      case '$':
+        if (n < 0) {
+          return true;
+        }
+        while (buf_.size() < static_cast<size_t>(n) + 2) {
+          if (!fill()) {
+            return false;
+          }
+        }
+        if (value->empty()) {
+          value->assign(buf_, 0, static_cast<size_t>(n));
+        }
+        buf_.erase(0, static_cast<size_t>(n) + 2);
+        return true;
+      case '*': {
+        // BLPOP replies [key, element], keep the element
+        std::string element;
+        for (long i = 0; i < n; ++i) {
+          element.clear();
+          if (!readReply(&element)) {
+            return false;
+          }
+        }
+        *value = element;
+        return true;
+      }
+      case '-':
+        std::fprintf(stderr, "error: %s\n", line.c_str());
+        return false;
+      default:
+        return true;
+    }
+  }
+
+  int fd_ = -1;
+  std::string buf_;
+};
+
+double ProcessCpuSeconds(int pid) {
+  std::ifstream in("/proc/" + std::to_string(pid) + "/stat");
+  std::string stat((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  // the fields after the command name, which may contain spaces
+  auto pos = stat.rfind(')');
+  if (pos == std::string::npos) {
+    return 0;
+  }
+  std::istringstream fields(stat.substr(pos + 2));
+  std::string field;
+  unsigned long long utime = 0;
+  unsigned long long stime = 0;
+  for (int i = 3; i <= 15 && fields >> field; ++i) {
+    if (i == 14) {
+      utime = std::stoull(field);
+    } else if (i == 15) {
+      stime = std::stoull(field);
+    }
+  }
+  return static_cast<double>(utime + stime) / static_cast<double>(::sysconf(_SC_CLK_TCK));
+}
+
+double SelfCpuSeconds() {
+  rusage usage{};
+  ::getrusage(RUSAGE_SELF, &usage);
+  auto sec = [](const timeval& tv) { return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1e6; };
+  return sec(usage.ru_utime) + sec(usage.ru_stime);
+}
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Result {
+  uint64_t delivered = 0;
+  double server_cpu = 0;
+  double client_cpu = 0;
+  double latency_us = 0;
+};
+
+Result Run(const char* host, int port, int pid, int seconds, int consumers, int rate, bool blocking) {
+  const std::string key = "blocking_pop_bench";
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> delivered{0};
+  std::atomic<uint64_t> latency_sum{0};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < consumers; ++i) {
+    threads.emplace_back([&]() {
+      Conn conn;
+      if (!conn.Connect(host, port)) {
+        std::fprintf(stderr, "connect failed\n");
+        return;
+      }
+      std::string value;
+      while (!stop.load(std::memory_order_relaxed)) {
+        // a short BLPOP timeout lets the thread see stop
+        bool ok = blocking ? conn.Call({"blpop", key, "0.1"}, &value) : conn.Call({"lpop", key}, &value);
+        if (!ok) {
+          return;
+        }
+        if (!value.empty()) {
+          latency_sum.fetch_add(static_cast<uint64_t>(NowUs() - std::atoll(value.c_str())), std::memory_order_relaxed);
+          delivered.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+
+  const double server_start = pid > 0 ? ProcessCpuSeconds(pid) : 0;
+  const double client_start = SelfCpuSeconds();
+
+  Conn producer;
+  if (!producer.Connect(host, port)) {
+    std::fprintf(stderr, "connect failed\n");
+    std::exit(1);
+  }
+  std::string reply;
+  const auto interval = std::chrono::microseconds(1000000 / rate);
+  auto next = std::chrono::steady_clock::now();
+  const auto end = next + std::chrono::seconds(seconds);
+  while (next < end) {
+    std::this_thread::sleep_until(next);
+    producer.Call({"rpush", key, std::to_string(NowUs())}, &reply);
+    next += interval;
+  }
+  // let the consumers drain what is left
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  Result r;
+  r.server_cpu = pid > 0 ? ProcessCpuSeconds(pid) - server_start : 0;
+  r.client_cpu = SelfCpuSeconds() - client_start;
+  stop = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+  producer.Call({"del", key}, &reply);
+
+  r.delivered = delivered.load();
+  r.latency_us = r.delivered ? static_cast<double>(latency_sum.load()) / static_cast<double>(r.delivered) : 0;
+  return r;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const char* host = argc > 1 ? argv[1] : "127.0.0.1";
+  const int port = argc > 2 ? std::atoi(argv[2]) : 9221;
+  const int pid = argc > 3 ? std::atoi(argv[3]) : 0;
+  const int seconds = argc > 4 ? std::atoi(argv[4]) : 5;
+  const int consumers = argc > 5 ? std::atoi(argv[5]) : 16;
+  const int rate = argc > 6 ? std::atoi(argv[6]) : 1000;
+
+  std::printf("%d consumers, %d pushes/s for %ds%s\n", consumers, rate, seconds,
+              pid > 0 ? "" : ", pass the server pid to measure its CPU");
+  std::printf("%-10s %12s %14s %14s %16s\n", "mode", "delivered", "server cpu s", "client cpu s", "avg latency us");
+  for (bool blocking : {false, true}) {
+    auto r = Run(host, port, pid, seconds, consumers, rate, blocking);
+    std::printf("%-10s %12llu %14.2f %14.2f %16.1f\n", blocking ? "blpop" : "lpop poll",
+                static_cast<unsigned long long>(r.delivered), r.server_cpu, r.client_cpu, r.latency_us);
+  }
+  return 0;
+}
@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "blocking.h"
+
+#include <algorithm>
+#include <climits>
+
+#include "client.h"
+#include "multi.h"
+#include "store.h"
+
+namespace pikiwidb {
+
+thread_local std::vector<std::pair<int, std::string>> PBlocking::ready_;
+
+PBlocking& PBlocking::Instance() {
+  static PBlocking blocking;
+  return blocking;
+}
+
+static void AppendBulk(std::string& out, const std::string& value) {
+  out.append("$").append(std::to_string(value.size())).append("\r\n");
+  out.append(value).append("\r\n");
+}
+
+void PBlocking::Block(const std::shared_ptr<PClient>& client, int dbno, Request req, int64_t timeout_ms) {
+  auto waiter = std::make_shared<Waiter>();
+  waiter->client = client;
+  waiter->owner = client.get();
+  waiter->dbno = dbno;
+  waiter->req = std::move(req);
+  waiter->loop = EventLoop::Self();
+
+  auto& keys = waiter->req.keys;
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  // fires in this loop, so not before the waiter is registered
+  if (timeout_ms > 0) {
+    std::weak_ptr<Waiter> weak = waiter;
+    const auto delay = static_cast<int>(std::min<int64_t>(timeout_ms, INT_MAX));
+    waiter->timer = waiter->loop->ScheduleLater(delay, [this, weak]() {
+      if (auto w = weak.lock(); w) {
+        timeout(w);
+      }
+    });
+  }
+
+  client->SetFlag(kClientFlagBlocked);
+  {
+    std::lock_guard guard(mutex_);
+    for (const auto& key : keys) {
+      queues_[dbno][key].push_back(waiter);
+    }
+    waiters_[waiter->owner] = waiter;
+    blocked_.fetch_add(1, std::memory_order_seq_cst);
+  }
+
+  // a push between the caller's pop and the registration signaled nobody
+  for (const auto& key : keys) {
+    ready_.emplace_back(dbno, key);
+  }
+}
+
+void PBlocking::Unblock(PClient* client) {
+  std::lock_guard guard(mutex_);
+  if (auto it = waiters_.find(client); it != waiters_.end()) {
+    remove(it->second);
+  }
+}
+
+void PBlocking::serveReady() {
+  std::vector<Reply> replies;
+  // serving a move readies its target, so the list may grow meanwhile
+  for (size_t i = 0; i < ready_.size(); ++i) {
+    auto [dbno, key] = ready_[i];
+    serveKey(dbno, key, replies);
+  }
+  ready_.clear();
+
+  for (auto& reply : replies) {
+    deliver(reply);
+  }
+}
+
+static std::string ReplyOf(const std::string& key, const std::string& element, bool move) {
+  std::string reply;
+  if (!move) {
+    reply.append("*2\r\n");
+    AppendBulk(reply, key);
+  }
+  AppendBulk(reply, element);
+  return reply;
+}
+
+static const char* TimeoutReplyOf(bool move) { return move ? "$-1\r\n" : "*-1\r\n"; }
+
+void PBlocking::serveKey(int dbno, const std::string& key, std::vector<Reply>& replies) {
+  while (true) {
+    std::shared_ptr<Waiter> waiter;
+    std::shared_ptr<PClient> client;
+    {
+      std::lock_guard guard(mutex_);
+      waiter = claim(dbno, key);
+      if (!waiter) {
+        return;
+      }
+      client = waiter->client.lock();
+      if (!client) {
+        waiter->serving = false;
+        remove(waiter);
+        continue;
+      }
+    }
+
+    std::string element;
+    const bool served = tryServe(*waiter, key, element);
+
+    std::unique_lock guard(mutex_);
+    waiter->serving = false;
+    auto it = waiters_.find(waiter->owner);
+    const bool registered = it != waiters_.end() && it->second == waiter;
+    if (!served) {
+      if (waiter->expired && registered) {
+        remove(waiter);
+        std::string reply = TimeoutReplyOf(waiter->req.move);
+        replies.push_back({std::move(waiter), std::move(client), std::move(reply)});
+        continue;
+      }
+      // a push to any of its keys may have skipped the waiter while it was claimed, they are served again
+      if (std::exchange(waiter->missed, false) && registered) {
+        for (const auto& ready : waiter->req.keys) {
+          ready_.emplace_back(dbno, ready);
+        }
+      }
+      return;
+    }
+    if (!registered) {
+      guard.unlock();
+      giveBack(*waiter, key, element);
+      continue;
+    }
+    remove(waiter);
+    std::string reply = ReplyOf(key, element, waiter->req.move);
+    replies.push_back({std::move(waiter), std::move(client), std::move(reply)});
+  }
+}
+
+std::shared_ptr<PBlocking::Waiter> PBlocking::claim(int dbno, const std::string& key) {
+  auto db = queues_.find(dbno);
+  if (db == queues_.end()) {
+    return nullptr;
+  }
+  auto queue = db->second.find(key);
+  if (queue == db->second.end()) {
+    return nullptr;
+  }
+  for (const auto& waiter : queue->second) {
+    if (!waiter->serving) {
+      waiter->serving = true;
+      return waiter;
+    }
+    waiter->missed = true;
+  }
+  return nullptr;
+}
+
+bool PBlocking::tryServe(const Waiter& waiter, const std::string& key, std::string& element) {
+  auto& storage = PSTORE.GetBackend(waiter.dbno)->GetStorage();
+  const auto& req = waiter.req;
+  // like any write, before and after it
+  auto touch = [&]() {
+    if (PMulti::Instance().Active()) {
+      PMulti::Instance().NotifyDirty(waiter.dbno, key);
+      if (req.move) {
+        PMulti::Instance().NotifyDirty(waiter.dbno, req.target);
+      }
+    }
+  };
+  touch();
+  if (req.move) {
+    if (!storage->LMove(key, req.target, req.from_left, req.to_left, &element).ok()) {
+      return false;
+    }
+    touch();
+    Signal(waiter.dbno, req.target);
+    return true;
+  }
+
+  std::vector<std::string> elements;
+  auto s = req.from_left ? storage->LPop(key, 1, &elements) : storage->RPop(key, 1, &elements);
+  if (!s.ok() || elements.empty()) {
+    return false;
+  }
+  touch();
+  element = std::move(elements.front());
+  return true;
+}
+
+void PBlocking::giveBack(const Waiter& waiter, const std::string& key, const std::string& element) {
+  // a moved element is in its target already
+  if (waiter.req.move) {
+    return;
+  }
+  auto& storage = PSTORE.GetBackend(waiter.dbno)->GetStorage();
+  uint64_t len = 0;
+  std::vector<std::string> values{element};
+  if (waiter.req.from_left) {
+    storage->LPush(key, values, &len);
+  } else {
+    storage->RPush(key, values, &len);
+  }
+}
+
+void PBlocking::remove(const std::shared_ptr<Waiter>& waiter) {
+  auto it = waiters_.find(waiter->owner);
+  if (it == waiters_.end() || it->second != waiter) {
+    return;
+  }
+  waiters_.erase(it);
+  blocked_.fetch_sub(1, std::memory_order_relaxed);
+
+  auto db = queues_.find(waiter->dbno);
+  for (const auto& key : waiter->req.keys) {
+    auto queue = db->second.find(key);
+    std::erase(queue->second, waiter);
+    if (queue->second.empty()) {
+      db->second.erase(queue);
+    }
+  }
+  if (db->second.empty()) {
+    queues_.erase(db);
+  }
+}
+
+void PBlocking::timeout(const std::shared_ptr<Waiter>& waiter) {
+  {
+    std::lock_guard guard(mutex_);
+    auto it = waiters_.find(waiter->owner);
+    if (it == waiters_.end() || it->second != waiter) {
+      return;  // served meanwhile
+    }
+    waiter->timer = -1;
+    if (waiter->serving) {
+      waiter->expired = true;
+      return;
+    }
+    remove(waiter);
+  }
+
+  if (auto client = waiter->client.lock(); client) {
+    client->OnUnblocked(TimeoutReplyOf(waiter->req.move));
+  }
+}
+
+void PBlocking::deliver(Reply& reply) {
+  auto& waiter = reply.waiter;
+  if (waiter->timer != -1) {
+    waiter->loop->Cancel(waiter->timer);
+  }
+  // never inline, the serving thread may be in the middle of another client's command
+  waiter->loop->Post([client = std::move(reply.client), content = std::move(reply.content)]() {
+    client->OnUnblocked(content);
+  });
+}
+
+}  // namespace pikiwidb
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "net/event_loop.h"
+
+namespace pikiwidb {
+
+class PClient;
+
+/**
+ * @brief Clients blocked on list keys, for BLPOP, BRPOP, BRPOPLPUSH and BLMOVE
+ * A blocked client waits in a FIFO queue per key. A push marks its key ready on
+ * the pushing thread and once the command is done that thread pops for the waiters
+ * in arrival order, as long as the list has elements, then hands each reply to the
+ * waiter's loop. Nothing polls, and while no client is blocked a push only loads
+ * one atomic.
+ * The mutex only guards the queues: a serving thread claims a waiter under it and
+ * pops out of it, other threads skip the waiters being served.
+ * Timeouts are timers of the waiter's loop.
+ */
+class PBlocking {
+ public:
+  static PBlocking& Instance();
+
+  PBlocking(const PBlocking&) = delete;
+  void operator=(const PBlocking&) = delete;
+
+  // what a blocked client does with the first element it gets
+  struct Request {
+    std::vector<std::string> keys;
+    bool from_left = true;
+    // BRPOPLPUSH and BLMOVE push the element to target and reply it alone
+    bool move = false;
+    std::string target;
+    bool to_left = true;
+  };
+
+  bool Active() const { return blocked_.load(std::memory_order_seq_cst) > 0; }
+
+  // the list key got elements, its waiters are served by ServeReady
+  void Signal(int dbno, const std::string& key) {
+    if (Active()) {
+      ready_.emplace_back(dbno, key);
+    }
+  }
+
+  // serve the waiters of the keys signaled by this thread, called when the
+  // command is done with its keys and still holds its DB
+  void ServeReady() {
+    if (!ready_.empty()) {
+      serveReady();
+    }
+  }
+
+  // park the client until a key of the request has an element, or for timeout_ms,
+  // 0 waits forever. Must be called in the client's loop
+  void Block(const std::shared_ptr<PClient>& client, int dbno, Request req, int64_t timeout_ms);
+  // the client is gone
+  void Unblock(PClient* client);
+
+ private:
+  PBlocking() = default;
+
+  struct Waiter {
+    std::weak_ptr<PClient> client;
+    PClient* owner = nullptr;
+    int dbno = 0;
+    Request req;
+    EventLoop* loop = nullptr;
+    TimerId timer = -1;
+    // claimed by a thread popping for it
+    bool serving = false;
+    // another thread found it claimed while its key had elements, an empty pop is tried again
+    bool missed = false;
+    // timed out while claimed, its server replies the timeout
+    bool expired = false;
+  };
+
+  struct Reply {
+    std::shared_ptr<Waiter> waiter;
+    std::shared_ptr<PClient> client;
+    std::string content;
+  };
+
+  void serveReady();
+  // pop for the waiters of the key in FIFO order while the list has elements
+  void serveKey(int dbno, const std::string& key, std::vector<Reply>& replies);
+  // the first waiter of the key nobody serves, claimed, nullptr if none
+  std::shared_ptr<Waiter> claim(int dbno, const std::string& key);
+  // pops or moves the element of the waiter, out of the mutex
+  bool tryServe(const Waiter& waiter, const std::string& key, std::string& element);
+  // puts back the element of a waiter gone while it was popped
+  void giveBack(const Waiter& waiter, const std::string& key, const std::string& element);
+  void remove(const std::shared_ptr<Waiter>& waiter);
+  void timeout(const std::shared_ptr<Waiter>& waiter);
+  static void deliver(Reply& reply);
+
+  static thread_local std::vector<std::pair<int, std::string>> ready_;
+
+  std::atomic<int64_t> blocked_{0};
+  std::mutex mutex_;  // guards the members below and the waiters, taken only while clients are blocked
+  std::map<int, std::unordered_map<std::string, std::deque<std::shared_ptr<Waiter>>>> queues_;
+  std::unordered_map<PClient*, std::shared_ptr<Waiter>> waiters_;
+};
+
+}  // namespace pikiwidb
@@ -5,12 +5,17 @@
  * of patent rights can be found in the PATENTS file in the same directory.
  */
 
-#include <algorithm>
 #include <memory>
 
+#include "blocking.h"
 #include "client.h"
+#include "cmd_scheduler.h"
+#include "cmd_stats.h"
 #include "config.h"
+#include "instance_executor.h"
 #include "log.h"
+#include "monitor.h"
+#include "multi.h"
 #include "pikiwidb.h"
 #include "pstd_string.h"
 #include "slow_log.h"
@@ -138,13 +143,7 @@ CmdRes::~CmdRes() { message_.clear(); }
 
 thread_local PClient* PClient::s_current = nullptr;
 
-std::mutex monitors_mutex;
-std::set<std::weak_ptr<PClient>, std::owner_less<std::weak_ptr<PClient> > > monitors;
-
-void PClient::SetSubCmdName(const std::string& name) {
-  subCmdName_ = name;
-  std::transform(subCmdName_.begin(), subCmdName_.end(), subCmdName_.begin(), ::tolower);
-}
+void PClient::SetSubCmdName(const std::string& name) { subCmdName_ = name; }
 
 std::string PClient::FullCmdName() const {
   if (subCmdName_.empty()) {
@@ -268,6 +267,7 @@ int PClient::handlePacket(const char* start, int bytes) {
     }
   }
 
+  const auto parseStart = CmdStatsNow();
   auto parseRet = parser_.ParseRequest(ptr, end);
   if (parseRet == PParseResult::kError) {
     if (!parser_.IsInitialState()) {
@@ -302,9 +302,17 @@ int PClient::handlePacket(const char* start, int bytes) {
     return static_cast<int>(ptr - start);
   }
 
+  parse_ns_ = CmdStatsNow() - parseStart;
   argv_ = params_;
-  cmdName_ = params_[0];
-  pstd::StringToLower(cmdName_);
+  takeCmdName(params_[0]);
+
+  // a command which can't join the pending batch flushes it first,
+  // so the replies keep the pipeline order
+  const auto kind = auth_ ? batchKind() : BatchKind::kNone;
+  if (kind != batch_kind_) {
+    flushBatch(true);
+  }
+  BeginReply();
 
   if (!auth_) {
     if (cmdName_ == kCmdNameAuth) {
@@ -326,6 +334,12 @@ int PClient::handlePacket(const char* start, int bytes) {
 
   FeedMonitors(params_);
 
+  if (kind != BatchKind::kNone) {
+    CmdScheduler::Local().NoteFast();
+    appendToBatch(kind);
+    return static_cast<int>(ptr - start);
+  }
+
   //  const PCommandInfo* info = PCommandTable::GetCommandInfo(cmdName_);
 
   //  if (!info) {  // 如果这个命令不存在，那么就走新的命令处理流程
@@ -376,7 +390,7 @@ int PClient::handlePacket(const char* start, int bytes) {
 // 为了兼容老的命令处理流程，新的命令处理流程在这里
 // 后面可以把client这个类重构，完整的支持新的命令处理流程
 void PClient::executeCommand() {
-  auto [cmdPtr, ret] = g_pikiwidb->GetCmdTableManager().GetCommand(CmdName(), this);
+  auto [cmdPtr, ret] = g_pikiwidb->GetCmdTableManager().GetCommand(argv_[0], this);
 
   if (!cmdPtr) {
     if (ret == CmdRes::kInvalidParameter) {
@@ -384,16 +398,251 @@ void PClient::executeCommand() {
     } else {
       SetRes(CmdRes::kSyntaxErr, "unknown command '" + CmdName() + "'");
     }
+    FlagExecWrong();
     return;
   }
 
-  if (!cmdPtr->CheckArg(params_.size())) {
+  if (!cmdPtr->CheckArg(argv_.size())) {
     SetRes(CmdRes::kWrongNum, CmdName());
+    FlagExecWrong();
+    return;
+  }
+
+  // inside MULTI everything but the transaction commands waits for EXEC
+  if (IsFlagOn(kClientFlagMulti) && cmdName_ != kCmdNameMulti && cmdName_ != kCmdNameExec &&
+      cmdName_ != kCmdNameDiscard && cmdName_ != kCmdNameWatch) {
+    if (cmdPtr->HasFlag(kCmdFlagsNoMulti | kCmdFlagsExclusive)) {
+      SetRes(CmdRes::kErrOther, "Command not allowed inside a transaction");
+      FlagExecWrong();
+      return;
+    }
+    QueueCmd();
+    SetLineString("+QUEUED");
+    return;
+  }
+
+  auto& scheduler = CmdScheduler::Local();
+  if (cmdPtr->HasFlag(kCmdFlagsFast)) {
+    scheduler.NoteFast();
+    dispatchCommand(cmdPtr);
+    return;
+  }
+
+  // a slow command waits for its turn while the loop is busy with fast ones, unless it is an admin command or touches
+  // no data, like INFO or CONFIG
+  const bool scheduled = cmdPtr->HasFlag(kCmdFlagsWrite | kCmdFlagsReadonly) && !cmdPtr->HasFlag(kCmdFlagsAdmin);
+  if (scheduled && !IsFlagOn(kClientFlagMaster) && !scheduler.Admit(this)) {
+    deferred_argv_.assign(argv_.begin(), argv_.end());
+    SetFlag(kClientFlagDeferred);
+    return;
+  }
+  executeSlow(cmdPtr);
+}
+
+void PClient::executeSlow(BaseCmd* cmd) {
+  const auto start = CmdStatsNow();
+  dispatchCommand(cmd);
+  CmdScheduler::Local().Charge(CmdStatsNow() - start);
+}
+
+void PClient::dispatchCommand(BaseCmd* cmd) {
+  // a transaction runs its queued commands in place, it holds their key locks
+  if (cmd->HasFlag(kCmdFlagsAsync) && AsyncCmdPool::Instance().IsRunning() && !IsFlagOn(kClientFlagMulti) &&
+      cmd->IsHeavy(this)) {
+    executeAsync(cmd);
+    return;
+  }
+
+  // a single-key command runs on the thread owning its instance, unless the input at hand waits for its reply
+  auto& executor = InstanceExecutor::Instance();
+  if (executor.IsRunning() && cmd->isSingleKey() && argv_.size() > 1 && !IsFlagOn(kClientFlagMulti) &&
+      !run_in_place_) {
+    auto& db = PSTORE.GetBackend(dbno_);
+    db->LockShared();
+    const auto inst_id = db->GetStorage()->GetDBInstanceID(argv_[1]);
+    db->UnLockShared();
+    executeOnOwner(cmd, inst_id);
     return;
   }
 
   // execute a specific command
-  cmdPtr->Execute(this);
+  cmd->Execute(this);
+}
+
+void PClient::RunDeferred() {
+  ClearFlag(kClientFlagDeferred);
+  auto conn = getTcpConnection();
+  if (!conn) {
+    return;
+  }
+
+  s_current = this;
+  argv_ = deferred_argv_;
+  takeCmdName(argv_[0]);
+  BeginReply();
+  // found and checked when it was deferred
+  auto [cmdPtr, ret] = g_pikiwidb->GetCmdTableManager().GetCommand(argv_[0], this);
+  executeSlow(cmdPtr);
+  argv_ = params_;
+  s_current = nullptr;
+
+  // an async or a blocking command replies later
+  if (IsFlagOn(kClientFlagWaiting)) {
+    return;
+  }
+  conn->SendPacket(Message());
+  Clear();
+  // commands pipelined after this one are still buffered
+  conn->ProcessInput();
+}
+
+CmdTask PClient::executeAsync(BaseCmd* cmd) {
+  // the frame keeps the client and its detached copy, params_ is reused by the next parse
+  auto self = std::static_pointer_cast<PClient>(shared_from_this());
+  std::unique_ptr<PClient> detached(new PClient(*this, DetachedTag{}));
+  auto loop = EventLoop::Self();
+  SetFlag(kClientFlagAsync);
+
+  co_await AsyncCmdPool::Instance().Run(loop, AsyncCmdPool::Classify(*cmd),
+                                        [cmd, client = detached.get()]() { cmd->Execute(client); });
+  takeReply(*detached);
+}
+
+CmdTask PClient::executeOnOwner(BaseCmd* cmd, size_t inst_id) {
+  auto self = std::static_pointer_cast<PClient>(shared_from_this());
+  std::unique_ptr<PClient> detached(new PClient(*this, DetachedTag{}));
+  auto loop = EventLoop::Self();
+  SetFlag(kClientFlagAsync);
+
+  co_await InstanceExecutor::Instance().Run(loop, inst_id,
+                                            [cmd, client = detached.get()]() { cmd->Execute(client); });
+  takeReply(*detached);
+}
+
+void PClient::takeReply(const PClient& detached) {
+  // back in the loop, the client takes the reply
+  AppendStringRaw(detached.Message());
+  ClearFlag(kClientFlagAsync);
+  auto conn = getTcpConnection();
+  if (!conn) {
+    return;
+  }
+  conn->SendPacket(Message());
+  Clear();
+  // commands pipelined after this one are still buffered
+  conn->ProcessInput();
+}
+
+void PClient::takeCmdName(const std::string& sent) {
+  // the lookup ignores case, so the name comes lowercase from the table rather than lowercased here; the buffer of
+  // the last name is reused
+  auto name = g_pikiwidb->GetCmdTableManager().RegisteredName(sent);
+  cmdName_.assign(name ? *name : sent);
+}
+
+PClient::BatchKind PClient::batchKind() const {
+  // with shared nothing each command goes to the thread owning its key, see dispatchCommand
+  if ((flag_ & kClientFlagMulti) || InstanceExecutor::Instance().IsRunning()) {
+    return BatchKind::kNone;
+  }
+  if (params_.size() == 2 && cmdName_ == kCmdNameGet) {
+    return BatchKind::kRead;
+  }
+  if (params_.size() == 3 && cmdName_ == kCmdNameSet) {
+    return BatchKind::kWrite;
+  }
+  return BatchKind::kNone;
+}
+
+void PClient::appendToBatch(BatchKind kind) {
+  batch_kind_ = kind;
+  if (batch_cmds_.size() <= batch_size_) {
+    batch_cmds_.resize(batch_size_ + 1);
+    batch_parse_ns_.resize(batch_size_ + 1);
+  }
+  batch_parse_ns_[batch_size_] = parse_ns_;
+  // swap rather than copy, params_ gets back a recycled vector
+  std::swap(batch_cmds_[batch_size_++], params_);
+  argv_ = params_;
+}
+
+void PClient::flushBatch(bool inPlace) {
+  if (batch_size_ == 0) {
+    return;
+  }
+
+  const auto kind = batch_kind_;
+  const auto count = batch_size_;
+  batch_kind_ = BatchKind::kNone;
+  batch_size_ = 0;
+
+  if (count == 1) {
+    // nothing to merge, run it through the command table as usual
+    auto cmd_name = std::move(cmdName_);
+    argv_ = batch_cmds_[0];
+    parse_ns_ = batch_parse_ns_[0];
+    cmdName_ = kind == BatchKind::kRead ? kCmdNameGet : kCmdNameSet;
+    BeginReply();
+    run_in_place_ = inPlace;
+    executeCommand();
+    run_in_place_ = false;
+    argv_ = params_;
+    cmdName_ = std::move(cmd_name);
+    return;
+  }
+
+  // one storage call for the batch, in the frame the command runs in, see BaseCmd::ExecuteMerged
+  const auto& name = kind == BatchKind::kRead ? kCmdNameGet : kCmdNameSet;
+  auto cmd = g_pikiwidb->GetCmdTableManager().GetCommand(name, this).first;
+  const std::span<std::vector<std::string>> calls(batch_cmds_.data(), count);
+  const std::span<const uint64_t> parse_ns(batch_parse_ns_.data(), count);
+  CmdScheduler::Local().NoteFast();
+  if (kind == BatchKind::kRead) {
+    cmd->ExecuteMerged(this, calls, parse_ns, [this, &calls](std::vector<uint64_t>* replyBytes) {
+      auto& db_storage = PSTORE.GetBackend(dbno_)->GetStorage();
+      std::vector<std::string> keys;
+      keys.reserve(calls.size());
+      for (const auto& call : calls) {
+        keys.push_back(call[1]);
+      }
+      // the status of each key is that of its instance when the instance fails
+      std::vector<storage::ValueStatus> vss;
+      db_storage->MGet(keys, &vss);
+      for (size_t i = 0; i < calls.size(); ++i) {
+        BeginReply();
+        if (vss[i].status.ok()) {
+          AppendString(vss[i].value);
+        } else if (vss[i].status.IsNotFound()) {
+          AppendString("");
+        } else {
+          SetRes(CmdRes::kSyntaxErr, "get key error");
+        }
+        (*replyBytes)[i] = Message().size() - ReplyStart();
+      }
+    });
+    return;
+  }
+
+  cmd->ExecuteMerged(this, calls, parse_ns, [this, &calls](std::vector<uint64_t>* replyBytes) {
+    auto& db_storage = PSTORE.GetBackend(dbno_)->GetStorage();
+    std::vector<storage::KeyValue> kvs;
+    kvs.reserve(calls.size());
+    for (const auto& call : calls) {
+      kvs.push_back({call[1], call[2]});
+    }
+    // each instance commits its keys on its own
+    std::vector<storage::Status> statuses;
+    db_storage->MSet(kvs, &statuses);
+    for (size_t i = 0; i < calls.size(); ++i) {
+      BeginReply();
+      if (statuses[i].ok()) {
+        SetRes(CmdRes::kOK);
+      } else {
+        SetRes(CmdRes::kErrOther, statuses[i].ToString());
+      }
+      (*replyBytes)[i] = Message().size() - ReplyStart();
+    }
+  });
 }
 
 PClient* PClient::Current() { return s_current; }
@@ -408,10 +657,37 @@ PClient::PClient(TcpConnection* obj)
   reset();
 }
 
+PClient::PClient(const PClient& origin, DetachedTag)
+    : tcp_connection_(origin.tcp_connection_),
+      dbno_(origin.dbno_),
+      flag_(0),
+      name_(origin.name_),
+      subCmdName_(origin.subCmdName_),
+      cmdName_(origin.cmdName_),
+      params_(origin.argv_.begin(), origin.argv_.end()),
+      parse_ns_(origin.parse_ns_),
+      parser_(params_) {
+  auth_ = origin.auth_;
+  argv_ = params_;
+}
+
+PClient::~PClient() {
+  ClearWatch();
+  if (IsFlagOn(kClientFlagBlocked)) {
+    PBlocking::Instance().Unblock(this);
+  }
+}
+
 int PClient::HandlePackets(pikiwidb::TcpConnection* obj, const char* start, int size) {
   int total = 0;
+  // an async command owns the reply buffer until it is resumed
+  if (IsFlagOn(kClientFlagWaiting)) {
+    obj->PauseInput();
+    return 0;
+  }
 
-  while (total < size) {
+  // commands after a blocking one stay in the input buffer until it is served
+  while (total < size && !IsFlagOn(kClientFlagWaiting)) {
     auto processed = handlePacket(start + total, size - total);
     if (processed <= 0) {
       break;
@@ -420,6 +696,14 @@ int PClient::HandlePackets(pikiwidb::TcpConnection* obj, const char* start, int
     total += processed;
   }
 
+  flushBatch();
+
+  // let the connection wait for a large bulk string as a whole
+  obj->SetReadHint(parser_.PendingBytes());
+  // the rest waits until the client is resumed, see ProcessInput
+  if (IsFlagOn(kClientFlagWaiting)) {
+    obj->PauseInput();
+  }
   obj->SendPacket(Message());
   Clear();
   //  reply_.Clear();
@@ -492,6 +776,14 @@ bool PClient::SendPacket(const evbuffer_iovec* iovecs, size_t nvecs) {
   return false;
 }
 
+bool PClient::SendPacket(std::shared_ptr<const std::string> buf) {
+  if (auto c = getTcpConnection(); c) {
+    return c->SendPacket(std::move(buf));
+  }
+
+  return false;
+}
+
 void PClient::Close() {
   if (auto c = getTcpConnection(); c) {
     c->ActiveClose();
@@ -519,55 +811,24 @@ int PClient::uniqueID() const {
 
 bool PClient::Watch(int dbno, const std::string& key) {
   DEBUG("Client {} watch {}, db {}", name_, key, dbno);
-  return watch_keys_[dbno].insert(key).second;
-}
-
-bool PClient::NotifyDirty(int dbno, const std::string& key) {
-  if (IsFlagOn(kClientFlagDirty)) {
-    INFO("client is already dirty {}", uniqueID());
-    return true;
-  }
-
-  if (watch_keys_[dbno].contains(key)) {
-    INFO("{} client become dirty because key {} in db {}", uniqueID(), key, dbno);
-    SetFlag(kClientFlagDirty);
-    return true;
-  } else {
-    INFO("Dirty key is not exist: {}, because client unwatch before dirty", key);
-  }
-
-  return false;
-}
-
-bool PClient::Exec() {
-  DEFER {
-    this->ClearMulti();
-    this->ClearWatch();
-  };
-
-  if (IsFlagOn(kClientFlagWrongExec)) {
+  auto& keys = watch_keys_[dbno];
+  if (keys.contains(key)) {
     return false;
   }
+  keys.emplace(key, PMulti::Instance().Watch(dbno, key));
+  return true;
+}
 
-  if (IsFlagOn(kClientFlagDirty)) {
-    //    FormatNullArray(&reply_);
-    AppendString("");
-    return true;
+bool PClient::WatchedKeysChanged() const {
+  auto& multi = PMulti::Instance();
+  for (const auto& [dbno, keys] : watch_keys_) {
+    for (const auto& [key, version] : keys) {
+      if (multi.Version(dbno, key) != version) {
+        return true;
+      }
+    }
   }
-
-  //  PreFormatMultiBulk(queue_cmds_.size(), &reply_);
-  //  for (const auto& cmd : queue_cmds_) {
-  //    DEBUG("EXEC {}, for client {}", cmd[0], UniqueId());
-  //    const PCommandInfo* info = PCommandTable::GetCommandInfo(cmd[0]);
-  //    PError err = PCommandTable::ExecuteCmd(cmd, info, &reply_);
-
-  // may dirty clients;
-  //    if (err == PError_ok && (info->attr & PAttr_write)) {
-  //      Propagate(cmd);
-  //    }
-  //  }
-
-  return true;
+  return false;
 }
 
 void PClient::ClearMulti() {
@@ -577,24 +838,26 @@ void PClient::ClearMulti() {
 }
 
 void PClient::ClearWatch() {
+  int64_t n = 0;
+  for (const auto& [dbno, keys] : watch_keys_) {
+    n += static_cast<int64_t>(keys.size());
+  }
+  if (n > 0) {
+    PMulti::Instance().Unwatch(n);
+  }
   watch_keys_.clear();
   ClearFlag(kClientFlagDirty);
 }
 
-bool PClient::WaitFor(const std::string& key, const std::string* target) {
-  bool succ = waiting_keys_.insert(key).second;
-
-  if (succ && target) {
-    if (!target_.empty()) {
-      ERROR("Wait failed for key {}, because old target {}", key, target_);
-      waiting_keys_.erase(key);
-      return false;
-    }
-
-    target_ = *target;
+void PClient::OnUnblocked(const std::string& reply) {
+  ClearFlag(kClientFlagBlocked);
+  auto conn = getTcpConnection();
+  if (!conn) {
+    return;
   }
-
-  return succ;
+  conn->SendPacket(reply);
+  // commands pipelined after the blocking one are still buffered
+  conn->ProcessInput();
 }
 
 void PClient::SetSlaveInfo() { slave_info_ = std::make_unique<PSlaveInfo>(); }
@@ -627,52 +890,19 @@ void PClient::TransferToSlaveThreads() {
 }
 
 void PClient::AddCurrentToMonitor() {
-  std::unique_lock<std::mutex> guard(monitors_mutex);
-  monitors.insert(std::static_pointer_cast<PClient>(s_current->shared_from_this()));
+  PMonitor::Instance().AddMonitor(std::static_pointer_cast<PClient>(s_current->shared_from_this()));
 }
 
 void PClient::FeedMonitors(const std::vector<std::string>& params) {
   assert(!params.empty());
 
-  {
-    std::unique_lock<std::mutex> guard(monitors_mutex);
-    if (monitors.empty()) {
-      return;
-    }
-  }
-
-  char buf[512];
-  int n = snprintf(buf, sizeof buf, "+[db%d %s:%d]: \"", s_current->GetCurrentDB(), s_current->PeerIP().c_str(),
-                   s_current->PeerPort());
-
-  assert(n > 0);
-
-  for (const auto& e : params) {
-    if (n < static_cast<int>(sizeof buf)) {
-      n += snprintf(buf + n, sizeof buf - n, "%s ", e.data());
-    } else {
-      break;
-    }
-  }
-
-  --n;  // no space follow last param
-
-  {
-    std::unique_lock<std::mutex> guard(monitors_mutex);
-
-    for (auto it(monitors.begin()); it != monitors.end();) {
-      auto m = it->lock();
-      if (m) {
-        m->SendPacket(buf, n);
-        m->SendPacket("\"" CRLF, 3);
-
-        ++it;
-      } else {
-        monitors.erase(it++);
-      }
-    }
+  auto& monitor = PMonitor::Instance();
+  if (!monitor.Active()) {
+    return;
   }
+  monitor.Feed(s_current->GetCurrentDB(), s_current->PeerIP(), s_current->PeerPort(), params);
 }
+
 void PClient::SetKey(std::vector<std::string>& names) {
   keys_ = std::move(names);  // use std::move clear copy expense
 }
@@ -12,6 +12,7 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "async_cmd.h"
 #include "common.h"
 #include "proto_parser.h"
 #include "replication.h"
@@ -59,10 +60,21 @@ class CmdRes {
 
   void Clear() {
     message_.clear();
+    reply_start_ = 0;
     ret_ = kNone;
   }
 
+  // replies of pipelined commands are accumulated in order, mark where the
+  // reply of the next command starts so a status line only replaces its own
+  void BeginReply() {
+    reply_start_ = message_.size();
+    ret_ = kNone;
+  }
+  // back to the reply of a command which ran others inside, like EXEC
+  void ResumeReply(size_t start) { reply_start_ = start; }
+
   inline const std::string& Message() const { return message_; };
+  size_t ReplyStart() const { return reply_start_; }
 
   // Inline functions for Create Redis protocol
   inline void AppendStringLen(int64_t ori) { RedisAppendLen(message_, ori, "$"); }
@@ -72,7 +84,10 @@ class CmdRes {
   inline void AppendInteger(int64_t ori) { RedisAppendLen(message_, ori, ":"); }
   inline void AppendContent(const std::string& value) { RedisAppendContent(message_, value); }
   inline void AppendStringRaw(const std::string& value) { message_.append(value); }
-  inline void SetLineString(const std::string& value) { message_ = value + CRLF; }
+  inline void SetLineString(const std::string& value) {
+    message_.resize(reply_start_);
+    message_.append(value).append(CRLF);
+  }
 
   void AppendString(const std::string& value);
   void AppendStringVector(const std::vector<std::string>& strArray);
@@ -91,6 +106,7 @@ class CmdRes {
 
  private:
   std::string message_;
+  size_t reply_start_ = 0;
   CmdRet ret_ = kNone;
 };
 
@@ -99,8 +115,14 @@ enum ClientFlag {
   kClientFlagDirty = (1 << 1),
   kClientFlagWrongExec = (1 << 2),
   kClientFlagMaster = (1 << 3),
+  kClientFlagBlocked = (1 << 4),   // waits in a blocking command for a list element
+  kClientFlagAsync = (1 << 5),     // its command runs on AsyncCmdPool
+  kClientFlagDeferred = (1 << 6),  // its slow command waits for its turn in CmdScheduler
+  // the command of the client replies later, the input is not read meanwhile
+  kClientFlagWaiting = kClientFlagBlocked | kClientFlagAsync | kClientFlagDeferred,
 };
 
+class BaseCmd;
 class DB;
 struct PSlaveInfo;
 
@@ -108,6 +130,7 @@ class PClient : public std::enable_shared_from_this<PClient>, public CmdRes {
  public:
   PClient() = delete;
   explicit PClient(TcpConnection* obj);
+  ~PClient() override;
 
   int HandlePackets(pikiwidb::TcpConnection*, const char*, int);
 
@@ -120,8 +143,10 @@ class PClient : public std::enable_shared_from_this<PClient>, public CmdRes {
   bool SendPacket(const void* data, size_t size);
   bool SendPacket(UnboundedBuffer& data);
   bool SendPacket(const evbuffer_iovec* iovecs, size_t nvecs);
+  bool SendPacket(std::shared_ptr<const std::string> buf);
 
   void Close();
+  std::shared_ptr<TcpConnection> GetTcpConnection() const { return getTcpConnection(); }
 
   // dbno
   void SetCurrentDB(int dbno) { dbno_ = dbno; }
@@ -141,8 +166,11 @@ class PClient : public std::enable_shared_from_this<PClient>, public CmdRes {
   }
 
   bool Watch(int dbno, const std::string& key);
-  bool NotifyDirty(int dbno, const std::string& key);
-  bool Exec();
+  // whether a watched key was written since WATCH
+  bool WatchedKeysChanged() const;
+  // between MULTI and EXEC commands are queued instead of executed
+  void QueueCmd() { queue_cmds_.emplace_back(argv_.begin(), argv_.end()); }
+  std::vector<std::vector<std::string>>& QueuedCmds() { return queue_cmds_; }
   void ClearMulti();
   void ClearWatch();
 
@@ -160,11 +188,10 @@ class PClient : public std::enable_shared_from_this<PClient>, public CmdRes {
   std::size_t ChannelCount() const { return channels_.size(); }
   std::size_t PatternChannelCount() const { return pattern_channels_.size(); }
 
-  bool WaitFor(const std::string& key, const std::string* target = nullptr);
-
-  std::unordered_set<std::string> WaitingKeys() const { return waiting_keys_; }
-  void ClearWaitingKeys() { waiting_keys_.clear(), target_.clear(); }
-  const std::string& GetTarget() const { return target_; }
+  // a blocking command got its reply, called in the client's loop
+  void OnUnblocked(const std::string& reply);
+  // the slow command deferred by CmdScheduler got its turn
+  void RunDeferred();
 
   void SetName(const std::string& name) { name_ = name; }
   const std::string& GetName() const { return name_; }
@@ -173,6 +200,7 @@ class PClient : public std::enable_shared_from_this<PClient>, public CmdRes {
   void SetSubCmdName(const std::string& name);
   const std::string& SubCmdName() const { return subCmdName_; }
   std::string FullCmdName() const;  // the full name of the command, such as config set|get|rewrite
+  uint64_t ParseNanos() const { return parse_ns_; }  // time spent parsing the current command
   void SetKey(const std::string& name) {
     keys_.clear();
     keys_.emplace_back(name);
@@ -204,6 +232,27 @@ class PClient : public std::enable_shared_from_this<PClient>, public CmdRes {
   std::shared_ptr<TcpConnection> getTcpConnection() const { return tcp_connection_.lock(); }
   int handlePacket(const char*, int);
   void executeCommand();
+  void executeSlow(BaseCmd* cmd);
+  void dispatchCommand(BaseCmd* cmd);
+  // runs the command on AsyncCmdPool, the reply is sent once the loop resumes it
+  CmdTask executeAsync(BaseCmd* cmd);
+  // runs the command on the executor thread owning the instance, see InstanceExecutor
+  CmdTask executeOnOwner(BaseCmd* cmd, size_t inst_id);
+  // appends the reply of the detached copy and sends it, then goes on with the input
+  void takeReply(const PClient& detached);
+  // a copy of the command at hand and of the state the commands read, run away from the loop: the pool thread
+  // writes the reply to the copy and never touches the client
+  struct DetachedTag {};
+  PClient(const PClient& origin, DetachedTag);
+  // pipeline batching: consecutive GETs are merged into one MultiGet and
+  // consecutive SETs into one WriteBatch per instance
+  enum class BatchKind { kNone, kRead, kWrite };
+  // the name of the command sent as sent, as it is registered when it is known
+  void takeCmdName(const std::string& sent);
+  BatchKind batchKind() const;
+  void appendToBatch(BatchKind kind);
+  // inPlace when the input at hand goes on after it, the command left alone then replies before returning
+  void flushBatch(bool inPlace = false);
   int processInlineCmd(const char*, size_t, std::vector<std::string>&);
   void reset();
   bool isPeerMaster() const;
@@ -220,12 +269,10 @@ class PClient : public std::enable_shared_from_this<PClient>, public CmdRes {
   std::unordered_set<std::string> pattern_channels_;
 
   uint32_t flag_;
-  std::unordered_map<int32_t, std::unordered_set<std::string> > watch_keys_;
+  // the version of each watched key when it was watched
+  std::unordered_map<int32_t, std::unordered_map<std::string, uint64_t> > watch_keys_;
   std::vector<std::vector<std::string> > queue_cmds_;
 
-  // blocked list
-  std::unordered_set<std::string> waiting_keys_;
-  std::string target_;
 
   // slave info from master view
   std::unique_ptr<PSlaveInfo> slave_info_;
@@ -241,6 +288,19 @@ class PClient : public std::enable_shared_from_this<PClient>, public CmdRes {
   // All parameters of this command (including the command itself)
   // e.g：["set","key","value"]
   std::vector<std::string> params_;
+  // the slow command waiting for its turn in CmdScheduler
+  std::vector<std::string> deferred_argv_;
+
+  // pending commands of the current pipeline batch, entries are recycled
+  BatchKind batch_kind_ = BatchKind::kNone;
+  size_t batch_size_ = 0;
+  std::vector<std::vector<std::string>> batch_cmds_;
+  std::vector<uint64_t> batch_parse_ns_;
+
+  uint64_t parse_ns_ = 0;
+  // the command at hand must reply before returning, it stays on the loop
+  bool run_in_place_ = false;
+
   // auth
   bool auth_ = false;
   time_t last_auth_ = 0;
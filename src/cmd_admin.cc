@@ -6,6 +6,20 @@
  */
 
 #include "cmd_admin.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <map>
+
+#include "async_cmd.h"
+#include "cmd_scheduler.h"
+#include "cmd_stats.h"
+#include "monitor.h"
+#include "pikiwidb.h"
+#include "pstd/lock_mgr.h"
+#include "pstd/pstd_string.h"
+#include "slow_log.h"
 #include "store.h"
 
 namespace pikiwidb {
@@ -29,42 +43,31 @@ bool CmdConfigSet::DoInitial(PClient* client) { return true; }
 void CmdConfigSet::DoCmd(PClient* client) { client->AppendString("config cmd in development"); }
 
 FlushdbCmd::FlushdbCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsAdmin | kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryAdmin) {}
+    : BaseCmd(name, arity, kCmdFlagsAdmin | kCmdFlagsWrite | kCmdFlagsExclusive,
+              kAclCategoryWrite | kAclCategoryAdmin) {}
 
 bool FlushdbCmd::DoInitial(PClient* client) { return true; }
 
 void FlushdbCmd::DoCmd(PClient* client) {
-  //  PSTORE.dirty_ += PSTORE.DBSize();
-  //  PSTORE.ClearCurrentDB();
-  //  Propagate(PSTORE.GetDB(), std::vector<PString>{"flushdb"});
-  client->AppendString("flushdb cmd in development");
+  PSTORE.GetBackend(client->GetCurrentDB())->Flush();
+  client->SetRes(CmdRes::kOK);
 }
 
 FlushallCmd::FlushallCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsAdmin | kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryAdmin) {}
+    : BaseCmd(name, arity, kCmdFlagsAdmin | kCmdFlagsWrite | kCmdFlagsExclusive,
+              kAclCategoryWrite | kAclCategoryAdmin) {}
 
 bool FlushallCmd::DoInitial(PClient* client) { return true; }
 
 void FlushallCmd::DoCmd(PClient* client) {
-  //  int currentDB = PSTORE.GetDB();
-  //  std::vector<PString> param{"flushall"};
-  //  DEFER {
-  //    PSTORE.SelectDB(currentDB);
-  //    Propagate(-1, param);
-  //    PSTORE.ResetDB();
-  //  };
-  //
-  //  for (int dbno = 0; true; ++dbno) {
-  //    if (PSTORE.SelectDB(dbno) == -1) {
-  //      break;
-  //    }
-  //    PSTORE.dirty_ += PSTORE.DBSize();
-  //  }
-  client->AppendString("flushall' cmd in development");
+  for (int dbno = 0; dbno < g_config.databases; ++dbno) {
+    PSTORE.GetBackend(dbno)->Flush();
+  }
+  client->SetRes(CmdRes::kOK);
 }
 
 SelectCmd::SelectCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsAdmin | kCmdFlagsReadonly, kAclCategoryAdmin) {}
+    : BaseCmd(name, arity, kCmdFlagsAdmin | kCmdFlagsReadonly | kCmdFlagsNoMulti | kCmdFlagsFast, kAclCategoryAdmin) {}
 
 bool SelectCmd::DoInitial(PClient* client) { return true; }
 
@@ -78,4 +81,324 @@ void SelectCmd::DoCmd(PClient* client) {
   client->SetRes(CmdRes::kOK);
 }
 
-}  // namespace pikiwidb
\ No newline at end of file
+// INFO sections, each appends "# Title" and its "field:value" lines
+static void InfoThreads(std::string& info) {
+  auto counts = g_pikiwidb->GetWorkerThreads().GetAcceptCounts();
+  uint64_t total = 0;
+  for (const auto& [name, accepted] : counts) {
+    total += accepted;
+  }
+
+  info.append("# Threads\r\n");
+  info.append("reuse_port:").append(g_config.reuse_port ? "yes" : "no").append("\r\n");
+  info.append("total_connections_accepted:").append(std::to_string(total)).append("\r\n");
+  for (size_t i = 0; i < counts.size(); ++i) {
+    info.append("thread_").append(std::to_string(i)).append(":name=").append(counts[i].first);
+    info.append(",accepted=").append(std::to_string(counts[i].second)).append("\r\n");
+  }
+}
+
+// nanoseconds as microseconds with 3 decimals, like redis latencystats
+static std::string Usec(uint64_t ns) {
+  char buf[32];
+  snprintf(buf, sizeof buf, "%.3f", static_cast<double>(ns) / 1000.0);
+  return buf;
+}
+
+// ids of the commands called so far with their merged stats, ordered by name
+static std::vector<std::pair<std::string, CmdStats::Snapshot>> CollectCmdStats() {
+  auto& stats = CmdStats::Instance();
+  const auto& names = stats.Names();
+  std::vector<std::pair<std::string, CmdStats::Snapshot>> result;
+  for (uint32_t id = 0; id < names.size(); ++id) {
+    CmdStats::Snapshot snapshot;
+    if (stats.Collect(id, &snapshot)) {
+      result.emplace_back(names[id], std::move(snapshot));
+    }
+  }
+  std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+  return result;
+}
+
+static void InfoCommandStats(std::string& info) {
+  info.append("# Commandstats\r\n");
+  for (const auto& [name, s] : CollectCmdStats()) {
+    info.append("cmdstat_").append(name).append(":calls=").append(std::to_string(s.total.Count()));
+    info.append(",usec=").append(std::to_string(s.total.Sum() / 1000));
+    info.append(",usec_per_call=").append(Usec(static_cast<uint64_t>(s.total.Mean())));
+    info.append(",parse_usec=").append(std::to_string(s.parse.Sum() / 1000));
+    info.append(",lock_usec=").append(std::to_string(s.lock.Sum() / 1000));
+    info.append(",storage_usec=").append(std::to_string(s.storage.Sum() / 1000));
+    info.append(",reply_bytes=").append(std::to_string(s.reply.Sum())).append("\r\n");
+  }
+}
+
+// the stage percentiles tell whether a tail comes from the storage or from the loop
+static void InfoLatencyStats(std::string& info) {
+  info.append("# Latencystats\r\n");
+  for (const auto& [name, s] : CollectCmdStats()) {
+    info.append("latency_percentiles_usec_").append(name);
+    info.append(":p50=").append(Usec(s.total.Percentile(50)));
+    info.append(",p99=").append(Usec(s.total.Percentile(99)));
+    info.append(",p99.9=").append(Usec(s.total.Percentile(99.9)));
+    info.append(",parse_p99=").append(Usec(s.parse.Percentile(99)));
+    info.append(",lock_p99=").append(Usec(s.lock.Percentile(99)));
+    info.append(",storage_p99=").append(Usec(s.storage.Percentile(99)));
+    info.append(",reply_bytes_p99=").append(std::to_string(s.reply.Percentile(99))).append("\r\n");
+  }
+}
+
+static void InfoKeyLock(std::string& info) {
+  const auto stats = pstd::lock::LockMgr::GetStats();
+  info.append("# Keylock\r\n");
+  info.append("key_locks:").append(std::to_string(stats.locks)).append("\r\n");
+  info.append("key_lock_contended:").append(std::to_string(stats.contended)).append("\r\n");
+  info.append("key_lock_parked:").append(std::to_string(stats.parked)).append("\r\n");
+  info.append("key_lock_wait_usec:").append(std::to_string(stats.wait_ns / 1000)).append("\r\n");
+  info.append("key_lock_wait_usec_per_contended:")
+      .append(Usec(stats.contended ? stats.wait_ns / stats.contended : 0))
+      .append("\r\n");
+  // hold times are measured on a sample of the acquisitions
+  info.append("key_lock_hold_usec_avg:")
+      .append(Usec(stats.hold_samples ? stats.hold_ns / stats.hold_samples : 0))
+      .append("\r\n");
+  info.append("key_lock_hold_usec_max:").append(Usec(stats.max_hold_ns)).append("\r\n");
+}
+
+// heavy commands offloaded from the event loops, by class
+static void InfoAsyncPool(std::string& info) {
+  auto& pool = AsyncCmdPool::Instance();
+  info.append("# Asyncpool\r\n");
+  info.append("async_threads:").append(std::to_string(pool.Threads())).append("\r\n");
+  info.append("async_min_elements:").append(std::to_string(g_config.async_min_elements)).append("\r\n");
+  info.append("async_steals:").append(std::to_string(pool.Steals())).append("\r\n");
+  for (int i = 0; i < AsyncCmdPool::kClassCount; ++i) {
+    const auto cls = static_cast<AsyncCmdPool::Class>(i);
+    const auto s = pool.Collect(cls);
+    info.append("async_class_").append(AsyncCmdPool::ClassName(cls));
+    info.append(":queued=").append(std::to_string(s.queued));
+    info.append(",calls=").append(std::to_string(s.calls));
+    info.append(",wait_usec=").append(std::to_string(s.wait_ns / 1000));
+    info.append(",wait_usec_per_call=").append(Usec(s.calls ? s.wait_ns / s.calls : 0));
+    info.append(",max_wait_usec=").append(Usec(s.max_wait_ns));
+    info.append(",run_usec=").append(std::to_string(s.run_ns / 1000)).append("\r\n");
+  }
+}
+
+static void InfoScheduler(std::string& info) {
+  const auto stats = CmdScheduler::Collect();
+  info.append("# Scheduler\r\n");
+  info.append("slow_cmd_cpu_share:").append(std::to_string(g_config.slow_cmd_cpu_share)).append("\r\n");
+  info.append("slow_cmd_deferred:").append(std::to_string(stats.deferred)).append("\r\n");
+  info.append("slow_cmd_queued:").append(std::to_string(stats.queued)).append("\r\n");
+  info.append("slow_cmd_wait_usec:").append(std::to_string(stats.wait_ns / 1000)).append("\r\n");
+  info.append("slow_cmd_wait_usec_per_deferred:")
+      .append(Usec(stats.deferred ? stats.wait_ns / stats.deferred : 0))
+      .append("\r\n");
+}
+
+static void AppendCacheStats(std::string& info, const std::string& prefix, const storage::ValueCacheStats& stats) {
+  char hit_ratio[32];
+  const auto lookups = stats.hits + stats.misses;
+  snprintf(hit_ratio, sizeof hit_ratio, "%.4f", lookups ? static_cast<double>(stats.hits) / lookups : 0.0);
+
+  info.append(prefix).append("_capacity:").append(std::to_string(stats.capacity)).append("\r\n");
+  info.append(prefix).append("_used_memory:").append(std::to_string(stats.used_memory)).append("\r\n");
+  info.append(prefix).append("_entries:").append(std::to_string(stats.entries)).append("\r\n");
+  info.append(prefix).append("_hits:").append(std::to_string(stats.hits)).append("\r\n");
+  info.append(prefix).append("_misses:").append(std::to_string(stats.misses)).append("\r\n");
+  info.append(prefix).append("_hit_ratio:").append(hit_ratio).append("\r\n");
+  info.append(prefix).append("_inserts:").append(std::to_string(stats.inserts)).append("\r\n");
+  // kept out by the admission filter, or too large
+  info.append(prefix).append("_rejects:").append(std::to_string(stats.rejects)).append("\r\n");
+  info.append(prefix).append("_evictions:").append(std::to_string(stats.evictions)).append("\r\n");
+  info.append(prefix).append("_invalidations:").append(std::to_string(stats.invalidations)).append("\r\n");
+}
+
+// the value and meta caches of every database, summed
+static void InfoValueCache(std::string& info) {
+  storage::ValueCacheStats values;
+  storage::ValueCacheStats metas;
+  for (int i = 0; i < g_config.databases; ++i) {
+    const auto& storage = PSTORE.GetBackend(i)->GetStorage();
+    values += storage->GetValueCacheStats();
+    metas += storage->GetMetaCacheStats();
+  }
+  info.append("# Valuecache\r\n");
+  AppendCacheStats(info, "value_cache", values);
+  AppendCacheStats(info, "meta_cache", metas);
+}
+
+struct InfoSection {
+  std::string name;
+  void (*collect)(std::string&);
+  bool in_default;  // "all" and "everything" print every section, no section name prints the default ones
+};
+
+static const std::vector<InfoSection> kInfoSections = {
+    {"threads", &InfoThreads, true},
+    {"commandstats", &InfoCommandStats, false},
+    {"latencystats", &InfoLatencyStats, false},
+    {"keylock", &InfoKeyLock, false},
+    {"asyncpool", &InfoAsyncPool, false},
+    {"scheduler", &InfoScheduler, false},
+    {"valuecache", &InfoValueCache, false},
+};
+
+InfoCmd::InfoCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsAdmin | kCmdFlagsReadonly, kAclCategoryAdmin) {}
+
+bool InfoCmd::DoInitial(PClient* client) { return true; }
+
+void InfoCmd::DoCmd(PClient* client) {
+  std::string section = client->argv_.size() > 1 ? client->argv_[1] : "default";
+  pstd::StringToLower(section);
+  const bool all = section == "all" || section == "everything";
+
+  std::string info;
+  for (const auto& [name, collect, in_default] : kInfoSections) {
+    if (all || (in_default && section == "default") || section == name) {
+      if (!info.empty()) {
+        info.append("\r\n");
+      }
+      collect(info);
+    }
+  }
+
+  client->AppendString(info);
+}
+
+CmdLatency::CmdLatency(const std::string& name, int16_t arity)
+    : BaseCmdGroup(name, arity, kCmdFlagsAdmin | kCmdFlagsReadonly) {}
+
+bool CmdLatency::HasSubCommand() const { return true; }
+
+CmdLatencyHistogram::CmdLatencyHistogram(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsAdmin | kCmdFlagsReadonly, kAclCategoryAdmin) {}
+
+bool CmdLatencyHistogram::DoInitial(PClient* client) { return true; }
+
+// LATENCY HISTOGRAM [command ...]
+// like redis, every command maps to ["calls", n, "histogram_usec", [bucket, count, ...]]
+// with power of two buckets and cumulative counts
+void CmdLatencyHistogram::DoCmd(PClient* client) {
+  auto all = CollectCmdStats();
+  std::vector<const std::pair<std::string, CmdStats::Snapshot>*> selected;
+  for (const auto& cmd : all) {
+    if (client->argv_.size() <= 2) {
+      selected.push_back(&cmd);
+      continue;
+    }
+    for (size_t i = 2; i < client->argv_.size(); ++i) {
+      if (pstd::PerfectHashMap<int>::EqualsIgnoreCase(cmd.first, client->argv_[i])) {
+        selected.push_back(&cmd);
+        break;
+      }
+    }
+  }
+
+  client->AppendArrayLenUint64(selected.size() * 2);
+  for (const auto* cmd : selected) {
+    const auto& total = cmd->second.total;
+    std::map<uint64_t, uint64_t> buckets;
+    for (int i = 0; i < pstd::HistogramBuckets::kCount; ++i) {
+      if (auto count = total.BucketCount(i); count != 0) {
+        auto usec = std::max<uint64_t>(1, (pstd::HistogramBuckets::UpperBound(i) + 999) / 1000);
+        buckets[std::bit_ceil(usec)] += count;
+      }
+    }
+
+    client->AppendString(cmd->first);
+    client->AppendArrayLen(4);
+    client->AppendString("calls");
+    client->AppendInteger(static_cast<int64_t>(total.Count()));
+    client->AppendString("histogram_usec");
+    client->AppendArrayLenUint64(buckets.size() * 2);
+    uint64_t cumulative = 0;
+    for (const auto& [usec, count] : buckets) {
+      cumulative += count;
+      client->AppendInteger(static_cast<int64_t>(usec));
+      client->AppendInteger(static_cast<int64_t>(cumulative));
+    }
+  }
+}
+
+CmdSlowlog::CmdSlowlog(const std::string& name, int16_t arity)
+    : BaseCmdGroup(name, arity, kCmdFlagsAdmin | kCmdFlagsReadonly | kCmdFlagsSkipSlowlog) {}
+
+bool CmdSlowlog::HasSubCommand() const { return true; }
+
+CmdSlowlogGet::CmdSlowlogGet(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsAdmin | kCmdFlagsReadonly | kCmdFlagsSkipSlowlog, kAclCategoryAdmin) {}
+
+bool CmdSlowlogGet::DoInitial(PClient* client) { return true; }
+
+// SLOWLOG GET [count]
+// every entry is [id, timestamp, usec, [args], client addr, client name, details],
+// the first six fields are the ones of redis, details has the db, the storage instance
+// and the rocksdb perf counters when the command was sampled
+void CmdSlowlogGet::DoCmd(PClient* client) {
+  int64_t count = 10;
+  if (client->argv_.size() > 2) {
+    if (pstd::String2int(client->argv_[2].data(), client->argv_[2].size(), &count) == 0 || count < -1) {
+      client->SetRes(CmdRes::kInvalidInt);
+      return;
+    }
+  }
+
+  auto items = PSlowLog::Instance().GetLogs(count < 0 ? SIZE_MAX : static_cast<size_t>(count));
+  client->AppendArrayLenUint64(items.size());
+  for (const auto& item : items) {
+    client->AppendArrayLen(7);
+    client->AppendInteger(static_cast<int64_t>(item.id));
+    client->AppendInteger(item.timestamp);
+    client->AppendInteger(static_cast<int64_t>(item.used));
+    client->AppendStringVector(item.cmds);
+    client->AppendString(item.client_addr);
+    client->AppendString(item.client_name);
+
+    std::string details = "db=" + std::to_string(item.db) + " instance=" + std::to_string(item.instance);
+    if (item.perf.valid) {
+      details.append(" block_cache_hit_count=").append(std::to_string(item.perf.block_cache_hit_count));
+      details.append(" block_read_count=").append(std::to_string(item.perf.block_read_count));
+      details.append(" block_read_byte=").append(std::to_string(item.perf.block_read_byte));
+      details.append(" get_from_memtable_count=").append(std::to_string(item.perf.get_from_memtable_count));
+      details.append(" internal_key_skipped_count=").append(std::to_string(item.perf.internal_key_skipped_count));
+      details.append(" internal_delete_skipped_count=")
+          .append(std::to_string(item.perf.internal_delete_skipped_count));
+    }
+    client->AppendString(details);
+  }
+}
+
+CmdSlowlogLen::CmdSlowlogLen(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsAdmin | kCmdFlagsReadonly | kCmdFlagsSkipSlowlog, kAclCategoryAdmin) {}
+
+bool CmdSlowlogLen::DoInitial(PClient* client) { return true; }
+
+void CmdSlowlogLen::DoCmd(PClient* client) {
+  client->AppendInteger(static_cast<int64_t>(PSlowLog::Instance().GetLogsCount()));
+}
+
+CmdSlowlogReset::CmdSlowlogReset(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsAdmin | kCmdFlagsWrite | kCmdFlagsSkipSlowlog, kAclCategoryAdmin) {}
+
+bool CmdSlowlogReset::DoInitial(PClient* client) { return true; }
+
+void CmdSlowlogReset::DoCmd(PClient* client) {
+  PSlowLog::Instance().ClearLogs();
+  client->SetRes(CmdRes::kOK);
+}
+
+MonitorCmd::MonitorCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsAdmin | kCmdFlagsReadonly | kCmdFlagsSkipSlowlog | kCmdFlagsNoMulti,
+              kAclCategoryAdmin) {}
+
+bool MonitorCmd::DoInitial(PClient* client) { return true; }
+
+void MonitorCmd::DoCmd(PClient* client) {
+  PMonitor::Instance().AddMonitor(std::static_pointer_cast<PClient>(client->shared_from_this()));
+  client->SetRes(CmdRes::kOK);
+}
+
+}  // namespace pikiwidb
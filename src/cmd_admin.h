@@ -84,4 +84,96 @@ class SelectCmd : public BaseCmd {
   void DoCmd(PClient* client) override;
 };
 
+class InfoCmd : public BaseCmd {
+ public:
+  InfoCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+class CmdLatency : public BaseCmdGroup {
+ public:
+  CmdLatency(const std::string& name, int16_t arity);
+
+  bool HasSubCommand() const override;
+
+ protected:
+  bool DoInitial(PClient* client) override { return true; };
+
+ private:
+  void DoCmd(PClient* client) override{};
+};
+
+class CmdLatencyHistogram : public BaseCmd {
+ public:
+  CmdLatencyHistogram(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+class CmdSlowlog : public BaseCmdGroup {
+ public:
+  CmdSlowlog(const std::string& name, int16_t arity);
+
+  bool HasSubCommand() const override;
+
+ protected:
+  bool DoInitial(PClient* client) override { return true; };
+
+ private:
+  void DoCmd(PClient* client) override{};
+};
+
+class CmdSlowlogGet : public BaseCmd {
+ public:
+  CmdSlowlogGet(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+class CmdSlowlogLen : public BaseCmd {
+ public:
+  CmdSlowlogLen(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+class CmdSlowlogReset : public BaseCmd {
+ public:
+  CmdSlowlogReset(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+class MonitorCmd : public BaseCmd {
+ public:
+  MonitorCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
 }  // namespace pikiwidb
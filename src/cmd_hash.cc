@@ -15,7 +15,7 @@
 namespace pikiwidb {
 
 HSetCmd::HSetCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryHash) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryHash) {}
 
 bool HSetCmd::DoInitial(PClient* client) {
   if (client->argv_.size() % 2 != 0) {
@@ -51,7 +51,7 @@ void HSetCmd::DoCmd(PClient* client) {
 }
 
 HGetCmd::HGetCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryHash) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategoryHash) {}
 
 bool HGetCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -72,7 +72,7 @@ void HGetCmd::DoCmd(PClient* client) {
 }
 
 HDelCmd::HDelCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryHash) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryHash) {}
 
 bool HDelCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -91,7 +91,7 @@ void HDelCmd::DoCmd(PClient* client) {
 }
 
 HMSetCmd::HMSetCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryHash) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryHash) {}
 
 bool HMSetCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -113,7 +113,7 @@ void HMSetCmd::DoCmd(PClient* client) {
 }
 
 HMGetCmd::HMGetCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryHash) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategoryHash) {}
 
 bool HMGetCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -141,7 +141,11 @@ void HMGetCmd::DoCmd(PClient* client) {
 }
 
 HGetAllCmd::HGetAllCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryHash) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsAsync, kAclCategoryRead | kAclCategoryHash) {}
+
+int64_t HGetAllCmd::collectionSize(PClient* client, storage::Storage* storage) const {
+  return storage->CachedLen(storage::DataType::kHashes, client->argv_[1]);
+}
 
 bool HGetAllCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -191,7 +195,11 @@ void HGetAllCmd::DoCmd(PClient* client) {
 }
 
 HKeysCmd::HKeysCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryHash) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsAsync, kAclCategoryRead | kAclCategoryHash) {}
+
+int64_t HKeysCmd::collectionSize(PClient* client, storage::Storage* storage) const {
+  return storage->CachedLen(storage::DataType::kHashes, client->argv_[1]);
+}
 
 bool HKeysCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -215,7 +223,7 @@ void HKeysCmd::DoCmd(PClient* client) {
 }
 
 HLenCmd::HLenCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryHash) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategoryHash) {}
 
 bool HLenCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -233,7 +241,7 @@ void HLenCmd::DoCmd(PClient* client) {
 }
 
 HStrLenCmd::HStrLenCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryHash) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategoryHash) {}
 
 bool HStrLenCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -308,7 +316,11 @@ void HScanCmd::DoCmd(PClient* client) {
 }
 
 HValsCmd::HValsCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryHash) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsAsync, kAclCategoryRead | kAclCategoryHash) {}
+
+int64_t HValsCmd::collectionSize(PClient* client, storage::Storage* storage) const {
+  return storage->CachedLen(storage::DataType::kHashes, client->argv_[1]);
+}
 
 bool HValsCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -326,7 +338,7 @@ void HValsCmd::DoCmd(PClient* client) {
 }
 
 HIncrbyFloatCmd::HIncrbyFloatCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryHash) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryHash) {}
 
 bool HIncrbyFloatCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -356,7 +368,7 @@ void HIncrbyFloatCmd::DoCmd(PClient* client) {
 }
 
 HSetNXCmd::HSetNXCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryHash) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryHash) {}
 
 bool HSetNXCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -378,7 +390,7 @@ void HSetNXCmd::DoCmd(PClient* client) {
 }
 
 HIncrbyCmd::HIncrbyCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryHash) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryHash) {}
 
 bool HIncrbyCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -73,6 +73,7 @@ class HGetAllCmd : public BaseCmd {
 
  protected:
   bool DoInitial(PClient *client) override;
+  int64_t collectionSize(PClient *client, storage::Storage *storage) const override;
 
  private:
   void DoCmd(PClient *client) override;
@@ -84,6 +85,7 @@ class HKeysCmd : public BaseCmd {
 
  protected:
   bool DoInitial(PClient *client) override;
+  int64_t collectionSize(PClient *client, storage::Storage *storage) const override;
 
  private:
   void DoCmd(PClient *client) override;
@@ -131,6 +133,7 @@ class HValsCmd : public BaseCmd {
 
  protected:
   bool DoInitial(PClient *client) override;
+  int64_t collectionSize(PClient *client, storage::Storage *storage) const override;
 
  private:
   void DoCmd(PClient *client) override;
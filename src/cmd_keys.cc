@@ -14,7 +14,7 @@
 namespace pikiwidb {
 
 DelCmd::DelCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryKeyspace) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsMultiKey, kAclCategoryWrite | kAclCategoryKeyspace) {}
 
 bool DelCmd::DoInitial(PClient* client) {
   std::vector<std::string> keys(client->argv_.begin() + 1, client->argv_.end());
@@ -32,7 +32,7 @@ void DelCmd::DoCmd(PClient* client) {
 }
 
 ExistsCmd::ExistsCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryKeyspace) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsMultiKey, kAclCategoryRead | kAclCategoryKeyspace) {}
 
 bool ExistsCmd::DoInitial(PClient* client) {
   std::vector<std::string> keys(client->argv_.begin() + 1, client->argv_.end());
@@ -55,7 +55,7 @@ void ExistsCmd::DoCmd(PClient* client) {
 }
 
 PExpireCmd::PExpireCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryKeyspace) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryKeyspace) {}
 
 bool PExpireCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -77,7 +77,7 @@ void PExpireCmd::DoCmd(PClient* client) {
 }
 
 ExpireatCmd::ExpireatCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryKeyspace) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryKeyspace) {}
 
 bool ExpireatCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -99,7 +99,7 @@ void ExpireatCmd::DoCmd(PClient* client) {
 }
 
 PExpireatCmd::PExpireatCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryKeyspace) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryKeyspace) {}
 
 bool PExpireatCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -122,7 +122,7 @@ void PExpireatCmd::DoCmd(PClient* client) {
 }
 
 PersistCmd::PersistCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryKeyspace) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryKeyspace) {}
 
 bool PersistCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -147,7 +147,8 @@ void PersistCmd::DoCmd(PClient* client) {
 }
 
 KeysCmd::KeysCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryKeyspace) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsAsync | kCmdFlagsMultiKey,
+              kAclCategoryRead | kAclCategoryKeyspace) {}
 
 bool KeysCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -168,7 +169,7 @@ void KeysCmd::DoCmd(PClient* client) {
 }
 
 PttlCmd::PttlCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryKeyspace) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategoryKeyspace) {}
 
 bool PttlCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -14,7 +14,7 @@
 namespace pikiwidb {
 
 GetCmd::GetCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategoryString) {}
 
 bool GetCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -35,7 +35,7 @@ void GetCmd::DoCmd(PClient* client) {
 }
 
 SetCmd::SetCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryString) {}
 
 bool SetCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -52,7 +52,7 @@ void SetCmd::DoCmd(PClient* client) {
 }
 
 AppendCmd::AppendCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryString) {}
 
 bool AppendCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -71,7 +71,7 @@ void AppendCmd::DoCmd(PClient* client) {
 }
 
 GetSetCmd::GetSetCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryString) {}
 
 bool GetSetCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -95,7 +95,7 @@ void GetSetCmd::DoCmd(PClient* client) {
 }
 
 MGetCmd::MGetCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsMultiKey, kAclCategoryRead | kAclCategoryString) {}
 
 bool MGetCmd::DoInitial(PClient* client) {
   std::vector<std::string> keys(client->argv_.begin(), client->argv_.end());
@@ -124,7 +124,7 @@ void MGetCmd::DoCmd(PClient* client) {
 }
 
 MSetCmd::MSetCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsMultiKey, kAclCategoryWrite | kAclCategoryString) {}
 
 bool MSetCmd::DoInitial(PClient* client) {
   size_t argcSize = client->argv_.size();
@@ -193,7 +193,7 @@ void BitCountCmd::DoCmd(PClient* client) {
 }
 
 DecrCmd::DecrCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategoryString) {}
 
 bool DecrCmd::DoInitial(pikiwidb::PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -215,7 +215,7 @@ void DecrCmd::DoCmd(pikiwidb::PClient* client) {
 }
 
 IncrCmd::IncrCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategoryString) {}
 
 bool IncrCmd::DoInitial(pikiwidb::PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -237,7 +237,7 @@ void IncrCmd::DoCmd(pikiwidb::PClient* client) {
 }
 
 BitOpCmd::BitOpCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsMultiKey, kAclCategoryWrite | kAclCategoryString) {}
 
 bool BitOpCmd::DoInitial(PClient* client) {
   if (!(pstd::StringEqualCaseInsensitive(client->argv_[1], "and") ||
@@ -297,7 +297,7 @@ void BitOpCmd::DoCmd(PClient* client) {
 }
 
 StrlenCmd::StrlenCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategoryString) {}
 
 bool StrlenCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -315,7 +315,7 @@ void StrlenCmd::DoCmd(PClient* client) {
 }
 
 SetExCmd::SetExCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryString) {}
 
 bool SetExCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -340,7 +340,7 @@ void SetExCmd::DoCmd(PClient* client) {
 }
 
 PSetExCmd::PSetExCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryString) {}
 
 bool PSetExCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -366,7 +366,7 @@ void PSetExCmd::DoCmd(PClient* client) {
 }
 
 IncrbyCmd::IncrbyCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryString) {}
 
 bool IncrbyCmd::DoInitial(PClient* client) {
   int64_t by_ = 0;
@@ -395,7 +395,7 @@ void IncrbyCmd::DoCmd(PClient* client) {
 }
 
 DecrbyCmd::DecrbyCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryString) {}
 
 bool DecrbyCmd::DoInitial(PClient* client) {
   int64_t by = 0;
@@ -427,7 +427,7 @@ void DecrbyCmd::DoCmd(PClient* client) {
 }
 
 IncrbyFloatCmd::IncrbyFloatCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryString) {}
 
 bool IncrbyFloatCmd::DoInitial(PClient* client) {
   long double by_ = 0.00f;
@@ -456,7 +456,7 @@ void IncrbyFloatCmd::DoCmd(PClient* client) {
 }
 
 SetNXCmd::SetNXCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryString) {}
 
 bool SetNXCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -475,7 +475,7 @@ void SetNXCmd::DoCmd(PClient* client) {
 }
 
 GetBitCmd::GetBitCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryString) {}
 
 bool GetBitCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -533,7 +533,7 @@ void GetRangeCmd::DoCmd(PClient* client) {
 }
 
 SetBitCmd::SetBitCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryString) {}
 
 bool SetBitCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
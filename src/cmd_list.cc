@@ -6,12 +6,13 @@
  */
 
 #include "cmd_list.h"
+#include "blocking.h"
 #include "pstd_string.h"
 #include "store.h"
 
 namespace pikiwidb {
 LPushCmd::LPushCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryList) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryList) {}
 
 bool LPushCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -25,13 +26,14 @@ void LPushCmd::DoCmd(PClient* client) {
       PSTORE.GetBackend(client->GetCurrentDB())->GetStorage()->LPush(client->Key(), list_values, &reply_num);
   if (s.ok()) {
     client->AppendInteger(reply_num);
+    PBlocking::Instance().Signal(client->GetCurrentDB(), client->Key());
   } else {
     client->SetRes(CmdRes::kSyntaxErr, "lpush cmd error");
   }
 }
 
 LPushxCmd::LPushxCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryList) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryList) {}
 
 bool LPushxCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -43,7 +45,10 @@ void LPushxCmd::DoCmd(PClient* client) {
   uint64_t reply_num = 0;
   storage::Status s =
       PSTORE.GetBackend(client->GetCurrentDB())->GetStorage()->LPushx(client->Key(), list_values, &reply_num);
-  if (s.ok() || s.IsNotFound()) {
+  if (s.ok()) {
+    client->AppendInteger(reply_num);
+    PBlocking::Instance().Signal(client->GetCurrentDB(), client->Key());
+  } else if (s.IsNotFound()) {
     client->AppendInteger(reply_num);
   } else {
     client->SetRes(CmdRes::kErrOther, s.ToString());
@@ -51,7 +56,7 @@ void LPushxCmd::DoCmd(PClient* client) {
 }
 
 RPushCmd::RPushCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryList) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryList) {}
 
 bool RPushCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -65,13 +70,14 @@ void RPushCmd::DoCmd(PClient* client) {
       PSTORE.GetBackend(client->GetCurrentDB())->GetStorage()->RPush(client->Key(), list_values, &reply_num);
   if (s.ok()) {
     client->AppendInteger(reply_num);
+    PBlocking::Instance().Signal(client->GetCurrentDB(), client->Key());
   } else {
     client->SetRes(CmdRes::kSyntaxErr, "rpush cmd error");
   }
 }
 
 RPushxCmd::RPushxCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryList) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryList) {}
 
 bool RPushxCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -83,7 +89,10 @@ void RPushxCmd::DoCmd(PClient* client) {
   uint64_t reply_num = 0;
   storage::Status s =
       PSTORE.GetBackend(client->GetCurrentDB())->GetStorage()->RPushx(client->Key(), list_values, &reply_num);
-  if (s.ok() || s.IsNotFound()) {
+  if (s.ok()) {
+    client->AppendInteger(reply_num);
+    PBlocking::Instance().Signal(client->GetCurrentDB(), client->Key());
+  } else if (s.IsNotFound()) {
     client->AppendInteger(reply_num);
   } else {
     client->SetRes(CmdRes::kErrOther, s.ToString());
@@ -91,7 +100,7 @@ void RPushxCmd::DoCmd(PClient* client) {
 }
 
 LPopCmd::LPopCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryList) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryList) {}
 
 bool LPopCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -111,7 +120,7 @@ void LPopCmd::DoCmd(PClient* client) {
 }
 
 RPopCmd::RPopCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryList) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategoryList) {}
 
 bool RPopCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -131,7 +140,12 @@ void RPopCmd::DoCmd(PClient* client) {
 }
 
 LRangeCmd::LRangeCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryList) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsAsync, kAclCategoryRead | kAclCategoryList) {}
+
+int64_t LRangeCmd::collectionSize(PClient* client, storage::Storage* storage) const {
+  const auto len = indexRangeLen(client->argv_[2], client->argv_[3]);
+  return len >= 0 ? len : storage->CachedLen(storage::DataType::kLists, client->argv_[1]);
+}
 
 bool LRangeCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -270,7 +284,7 @@ void LInsertCmd::DoCmd(PClient* client) {
 }
 
 LIndexCmd::LIndexCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryList) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategoryList) {}
 
 bool LIndexCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -297,7 +311,7 @@ void LIndexCmd::DoCmd(PClient* client) {
 }
 
 LLenCmd::LLenCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryList) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategoryList) {}
 
 bool LLenCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -313,4 +327,166 @@ void LLenCmd::DoCmd(PClient* client) {
     client->SetRes(CmdRes::kErrOther, s.ToString());
   }
 }
+
+// the timeout of the blocking commands is in seconds, 0 waits forever
+static bool ParseBlockTimeout(PClient* client, const std::string& arg, int64_t* timeout_ms) {
+  double seconds = 0;
+  if (pstd::String2d(arg, &seconds) == 0 || seconds * 1000 > static_cast<double>(INT64_MAX)) {
+    client->SetRes(CmdRes::kErrOther, "timeout is not a float or out of range");
+    return false;
+  }
+  if (seconds < 0) {
+    client->SetRes(CmdRes::kErrOther, "timeout is negative");
+    return false;
+  }
+  *timeout_ms = static_cast<int64_t>(seconds * 1000);
+  if (seconds > 0 && *timeout_ms == 0) {
+    *timeout_ms = 1;
+  }
+  return true;
+}
+
+static bool ParseWhere(PClient* client, const std::string& arg, bool* left) {
+  if (strcasecmp(arg.c_str(), "left") == 0) {
+    *left = true;
+  } else if (strcasecmp(arg.c_str(), "right") == 0) {
+    *left = false;
+  } else {
+    client->SetRes(CmdRes::kSyntaxErr);
+    return false;
+  }
+  return true;
+}
+
+// take from the first key holding an element, else wait for one
+static void BlockingPop(PClient* client, PBlocking::Request req, int64_t timeout_ms) {
+  const auto dbno = client->GetCurrentDB();
+  auto& storage = PSTORE.GetBackend(dbno)->GetStorage();
+  for (const auto& key : req.keys) {
+    storage::Status s;
+    if (req.move) {
+      std::string element;
+      s = storage->LMove(key, req.target, req.from_left, req.to_left, &element);
+      if (s.ok()) {
+        client->AppendString(element);
+        PBlocking::Instance().Signal(dbno, req.target);
+        return;
+      }
+    } else {
+      std::vector<std::string> elements;
+      s = req.from_left ? storage->LPop(key, 1, &elements) : storage->RPop(key, 1, &elements);
+      if (s.ok()) {
+        client->AppendArrayLen(2);
+        client->AppendString(key);
+        client->AppendString(elements[0]);
+        return;
+      }
+    }
+    if (!s.IsNotFound()) {
+      client->SetRes(CmdRes::kErrOther, s.ToString());
+      return;
+    }
+  }
+
+  // a transaction can't wait, it is answered like a timeout
+  if (client->IsFlagOn(kClientFlagMulti)) {
+    if (req.move) {
+      client->AppendStringLen(-1);
+    } else {
+      client->AppendArrayLen(-1);
+    }
+    return;
+  }
+  PBlocking::Instance().Block(std::static_pointer_cast<PClient>(client->shared_from_this()), dbno, std::move(req),
+                              timeout_ms);
+}
+
+BLPopCmd::BLPopCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsBlocking | kCmdFlagsMultiKey,
+              kAclCategoryWrite | kAclCategoryList | kAclCategoryBlocking) {}
+
+bool BLPopCmd::DoInitial(PClient* client) {
+  std::vector<std::string> keys(client->argv_.begin() + 1, client->argv_.end() - 1);
+  client->SetKey(keys);
+  return true;
+}
+
+void BLPopCmd::DoCmd(PClient* client) {
+  int64_t timeout_ms = 0;
+  if (!ParseBlockTimeout(client, client->argv_.back(), &timeout_ms)) {
+    return;
+  }
+  PBlocking::Request req;
+  req.keys = client->Keys();
+  req.from_left = true;
+  BlockingPop(client, std::move(req), timeout_ms);
+}
+
+BRPopCmd::BRPopCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsBlocking | kCmdFlagsMultiKey,
+              kAclCategoryWrite | kAclCategoryList | kAclCategoryBlocking) {}
+
+bool BRPopCmd::DoInitial(PClient* client) {
+  std::vector<std::string> keys(client->argv_.begin() + 1, client->argv_.end() - 1);
+  client->SetKey(keys);
+  return true;
+}
+
+void BRPopCmd::DoCmd(PClient* client) {
+  int64_t timeout_ms = 0;
+  if (!ParseBlockTimeout(client, client->argv_.back(), &timeout_ms)) {
+    return;
+  }
+  PBlocking::Request req;
+  req.keys = client->Keys();
+  req.from_left = false;
+  BlockingPop(client, std::move(req), timeout_ms);
+}
+
+BRPoplpushCmd::BRPoplpushCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsBlocking | kCmdFlagsMultiKey,
+              kAclCategoryWrite | kAclCategoryList | kAclCategoryBlocking) {}
+
+bool BRPoplpushCmd::DoInitial(PClient* client) {
+  std::vector<std::string> keys(client->argv_.begin() + 1, client->argv_.begin() + 3);
+  client->SetKey(keys);
+  return true;
+}
+
+void BRPoplpushCmd::DoCmd(PClient* client) {
+  int64_t timeout_ms = 0;
+  if (!ParseBlockTimeout(client, client->argv_[3], &timeout_ms)) {
+    return;
+  }
+  PBlocking::Request req;
+  req.keys = {client->argv_[1]};
+  req.from_left = false;
+  req.move = true;
+  req.target = client->argv_[2];
+  req.to_left = true;
+  BlockingPop(client, std::move(req), timeout_ms);
+}
+
+BLMoveCmd::BLMoveCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsBlocking | kCmdFlagsMultiKey,
+              kAclCategoryWrite | kAclCategoryList | kAclCategoryBlocking) {}
+
+bool BLMoveCmd::DoInitial(PClient* client) {
+  std::vector<std::string> keys(client->argv_.begin() + 1, client->argv_.begin() + 3);
+  client->SetKey(keys);
+  return true;
+}
+
+void BLMoveCmd::DoCmd(PClient* client) {
+  PBlocking::Request req;
+  int64_t timeout_ms = 0;
+  if (!ParseWhere(client, client->argv_[3], &req.from_left) || !ParseWhere(client, client->argv_[4], &req.to_left) ||
+      !ParseBlockTimeout(client, client->argv_[5], &timeout_ms)) {
+    return;
+  }
+  req.keys = {client->argv_[1]};
+  req.move = true;
+  req.target = client->argv_[2];
+  BlockingPop(client, std::move(req), timeout_ms);
+}
 }  // namespace pikiwidb
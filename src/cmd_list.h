@@ -47,6 +47,7 @@ class LRangeCmd : public BaseCmd {
 
  protected:
   bool DoInitial(PClient* client) override;
+  int64_t collectionSize(PClient* client, storage::Storage* storage) const override;
 
  private:
   void DoCmd(PClient* client) override;
@@ -150,4 +151,49 @@ class LLenCmd : public BaseCmd {
  private:
   void DoCmd(PClient* client) override;
 };
+
+// the blocking commands pop at once if they can, or park the client, see PBlocking
+class BLPopCmd : public BaseCmd {
+ public:
+  BLPopCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+class BRPopCmd : public BaseCmd {
+ public:
+  BRPopCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+class BRPoplpushCmd : public BaseCmd {
+ public:
+  BRPoplpushCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+class BLMoveCmd : public BaseCmd {
+ public:
+  BLMoveCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
 }  // namespace pikiwidb
\ No newline at end of file
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "cmd_multi.h"
+
+#include "multi.h"
+#include "pikiwidb.h"
+#include "pstd/pstd_defer.h"
+#include "pstd/pstd_string.h"
+#include "store.h"
+
+namespace pikiwidb {
+
+MultiCmd::MultiCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsFast, kAclCategoryFast | kAclCategoryTransaction) {}
+
+bool MultiCmd::DoInitial(PClient* client) { return true; }
+
+void MultiCmd::DoCmd(PClient* client) {
+  if (client->IsFlagOn(kClientFlagMulti)) {
+    client->SetRes(CmdRes::kErrOther, "MULTI calls can not be nested");
+    return;
+  }
+  client->SetFlag(kClientFlagMulti);
+  client->SetRes(CmdRes::kOK);
+}
+
+ExecCmd::ExecCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsSkipSlowlog, kAclCategorySlow | kAclCategoryTransaction) {}
+
+bool ExecCmd::DoInitial(PClient* client) {
+  if (!client->IsFlagOn(kClientFlagMulti)) {
+    client->SetRes(CmdRes::kErrOther, "EXEC without MULTI");
+    return false;
+  }
+  return true;
+}
+
+void ExecCmd::DoCmd(PClient* client) {
+  DEFER {
+    client->ClearMulti();
+    client->ClearWatch();
+  };
+
+  if (client->IsFlagOn(kClientFlagWrongExec)) {
+    client->SetLineString("-EXECABORT Transaction discarded because of previous errors.");
+    return;
+  }
+
+  // every argument may be a key, latching a few more is cheaper than missing one
+  auto& queued = client->QueuedCmds();
+  std::vector<std::string> keys;
+  for (const auto& argv : queued) {
+    keys.insert(keys.end(), argv.begin() + 1, argv.end());
+  }
+  auto& storage = PSTORE.GetBackend(client->GetCurrentDB())->GetStorage();
+  storage->BeginTransaction(keys);
+
+  if (client->WatchedKeysChanged()) {
+    storage->RollbackTransaction();
+    client->AppendArrayLen(-1);
+    return;
+  }
+
+  const auto replyStart = client->ReplyStart();
+  const auto argv = client->argv_;
+  const auto cmdName = client->CmdName();
+  client->AppendArrayLen(static_cast<int64_t>(queued.size()));
+  std::vector<std::string> written;
+  for (auto& cmd : queued) {
+    client->argv_ = cmd;
+    auto name = cmd[0];
+    client->SetCmdName(pstd::StringToLower(name));
+    client->BeginReply();
+    // looked up and checked when queued
+    auto [cmdPtr, ret] = g_pikiwidb->GetCmdTableManager().GetCommand(cmd[0], client);
+    cmdPtr->Execute(client);
+    if (cmdPtr->HasFlag(kCmdFlagsWrite)) {
+      written.insert(written.end(), cmd.begin() + 1, cmd.end());
+    }
+  }
+  client->argv_ = argv;
+  client->SetCmdName(cmdName);
+  client->ResumeReply(replyStart);
+
+  auto s = storage->CommitTransaction();
+  // the queued writes bumped their keys before the commit made them visible, a WATCH in between must fail too
+  auto& multi = PMulti::Instance();
+  if (multi.Active()) {
+    for (const auto& key : written) {
+      multi.NotifyDirty(client->GetCurrentDB(), key);
+    }
+  }
+  if (!s.ok()) {
+    // none of the queued writes is visible, the error replaces the array of their replies
+    client->SetLineString("-ERR " + s.ToString());
+  }
+}
+
+DiscardCmd::DiscardCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsFast, kAclCategoryFast | kAclCategoryTransaction) {}
+
+bool DiscardCmd::DoInitial(PClient* client) {
+  if (!client->IsFlagOn(kClientFlagMulti)) {
+    client->SetRes(CmdRes::kErrOther, "DISCARD without MULTI");
+    return false;
+  }
+  return true;
+}
+
+void DiscardCmd::DoCmd(PClient* client) {
+  client->ClearMulti();
+  client->ClearWatch();
+  client->SetRes(CmdRes::kOK);
+}
+
+WatchCmd::WatchCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsFast, kAclCategoryFast | kAclCategoryTransaction) {}
+
+bool WatchCmd::DoInitial(PClient* client) {
+  if (client->IsFlagOn(kClientFlagMulti)) {
+    client->SetRes(CmdRes::kErrOther, "WATCH inside MULTI is not allowed");
+    return false;
+  }
+  return true;
+}
+
+void WatchCmd::DoCmd(PClient* client) {
+  for (size_t i = 1; i < client->argv_.size(); ++i) {
+    client->Watch(client->GetCurrentDB(), client->argv_[i]);
+  }
+  client->SetRes(CmdRes::kOK);
+}
+
+UnwatchCmd::UnwatchCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsFast, kAclCategoryFast | kAclCategoryTransaction) {}
+
+bool UnwatchCmd::DoInitial(PClient* client) { return true; }
+
+void UnwatchCmd::DoCmd(PClient* client) {
+  client->ClearWatch();
+  client->SetRes(CmdRes::kOK);
+}
+
+}  // namespace pikiwidb
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include "base_cmd.h"
+
+namespace pikiwidb {
+
+class MultiCmd : public BaseCmd {
+ public:
+  MultiCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+/**
+ * EXEC runs the queued commands inside a storage transaction: it latches every
+ * argument of them, then checks the watched versions, so no write slips in between.
+ * The commands read their own writes under one snapshot and all writes are
+ * committed together at the end.
+ */
+class ExecCmd : public BaseCmd {
+ public:
+  ExecCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+class DiscardCmd : public BaseCmd {
+ public:
+  DiscardCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+class WatchCmd : public BaseCmd {
+ public:
+  WatchCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+class UnwatchCmd : public BaseCmd {
+ public:
+  UnwatchCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+}  // namespace pikiwidb
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "cmd_scheduler.h"
+
+#include <algorithm>
+
+#include "client.h"
+#include "config.h"
+
+namespace pikiwidb {
+
+// the credit never exceeds the share of one window, a burst of slow commands can't
+// take the loop for longer than that
+static constexpr int64_t kWindowNs = 10 * 1000 * 1000;
+
+std::atomic<uint64_t> CmdScheduler::deferred_{0};
+std::atomic<uint64_t> CmdScheduler::wait_ns_{0};
+std::atomic<int64_t> CmdScheduler::queued_{0};
+
+CmdScheduler& CmdScheduler::Local() {
+  static thread_local CmdScheduler scheduler;
+  return scheduler;
+}
+
+CmdScheduler::Stats CmdScheduler::Collect() {
+  Stats stats;
+  stats.deferred = deferred_.load(std::memory_order_relaxed);
+  stats.wait_ns = wait_ns_.load(std::memory_order_relaxed);
+  stats.queued = queued_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+bool CmdScheduler::Admit(PClient* client) {
+  const int share = g_config.slow_cmd_cpu_share;
+  if (share >= 100) {
+    return true;
+  }
+
+  const auto now = CmdStatsNow();
+  refill(now);
+  // the waiting clients go first, so a client can't take every turn
+  if (queue_.empty() && (credit_ns_ > 0 || !contended(now))) {
+    return true;
+  }
+
+  queue_.push_back({std::static_pointer_cast<PClient>(client->shared_from_this()), now});
+  queued_.fetch_add(1, std::memory_order_relaxed);
+  deferred_.fetch_add(1, std::memory_order_relaxed);
+  arm(share);
+  return false;
+}
+
+void CmdScheduler::Charge(uint64_t ns) {
+  if (g_config.slow_cmd_cpu_share < 100 && contended(CmdStatsNow())) {
+    credit_ns_ -= static_cast<int64_t>(ns);
+  }
+}
+
+bool CmdScheduler::contended(uint64_t now) const { return now - last_fast_ns_ <= kWindowNs; }
+
+void CmdScheduler::refill(uint64_t now) {
+  const int64_t burst = kWindowNs * g_config.slow_cmd_cpu_share / 100;
+  if (last_refill_ns_ == 0) {
+    credit_ns_ = burst;
+  } else {
+    credit_ns_ += static_cast<int64_t>(now - last_refill_ns_) * g_config.slow_cmd_cpu_share / 100;
+  }
+  credit_ns_ = std::min(credit_ns_, burst);
+  last_refill_ns_ = now;
+}
+
+void CmdScheduler::arm(int share) {
+  if (timer_ != -1) {
+    return;
+  }
+  // until the credit is back, at least the next tick
+  const int64_t deficit_ns = credit_ns_ < 0 ? -credit_ns_ * 100 / std::max(share, 1) : 0;
+  const auto delay = static_cast<int>(std::max<int64_t>(1, (deficit_ns + 999999) / 1000000));
+  timer_ = EventLoop::Self()->ScheduleLater(delay, [this]() {
+    timer_ = -1;
+    drain();
+  });
+}
+
+void CmdScheduler::drain() {
+  while (!queue_.empty()) {
+    const auto now = CmdStatsNow();
+    refill(now);
+    if (credit_ns_ <= 0 && contended(now)) {
+      break;
+    }
+
+    auto waiting = std::move(queue_.front());
+    queue_.pop_front();
+    queued_.fetch_sub(1, std::memory_order_relaxed);
+    if (auto client = waiting.client.lock(); client) {
+      wait_ns_.fetch_add(now - waiting.since, std::memory_order_relaxed);
+      // may queue the client again for the next slow command in its input
+      client->RunDeferred();
+    }
+  }
+
+  if (!queue_.empty()) {
+    arm(g_config.slow_cmd_cpu_share);
+  }
+}
+
+}  // namespace pikiwidb
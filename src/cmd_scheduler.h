@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+#include "cmd_stats.h"
+#include "net/event_loop.h"
+
+namespace pikiwidb {
+
+class PClient;
+
+/**
+ * @brief Admission of the slow commands of one event loop
+ * Commands flagged kCmdFlagsFast always run at once, and so do the admin commands and those
+ * flagged neither kCmdFlagsWrite nor kCmdFlagsReadonly. The others may use slow-cmd-cpu-share
+ * percent of the loop while fast commands compete for it: their loop time is charged to a
+ * credit refilled at that rate. Once it is spent, a client sending a slow command stops
+ * being read and waits in a FIFO queue, each client with one command, so the waiting
+ * clients take turns. A loop with no fast command in the last window runs them freely.
+ */
+class CmdScheduler {
+ public:
+  struct Stats {
+    uint64_t deferred = 0;
+    uint64_t wait_ns = 0;
+    int64_t queued = 0;
+  };
+
+  // the scheduler of the calling loop
+  static CmdScheduler& Local();
+  // summed over the loops
+  static Stats Collect();
+
+  CmdScheduler(const CmdScheduler&) = delete;
+  void operator=(const CmdScheduler&) = delete;
+
+  // whether a slow command of the client runs now, if not the client is queued and
+  // the loop calls PClient::RunDeferred in its turn
+  bool Admit(PClient* client);
+  // loop time used by an admitted slow command
+  void Charge(uint64_t ns);
+  void NoteFast() { last_fast_ns_ = CmdStatsNow(); }
+
+ private:
+  CmdScheduler() = default;
+
+  struct Waiting {
+    std::weak_ptr<PClient> client;
+    uint64_t since = 0;
+  };
+
+  bool contended(uint64_t now) const;
+  void refill(uint64_t now);
+  void arm(int share);
+  void drain();
+
+  std::deque<Waiting> queue_;
+  int64_t credit_ns_ = 0;
+  uint64_t last_refill_ns_ = 0;
+  uint64_t last_fast_ns_ = 0;
+  TimerId timer_ = -1;
+
+  static std::atomic<uint64_t> deferred_;
+  static std::atomic<uint64_t> wait_ns_;
+  static std::atomic<int64_t> queued_;
+};
+
+}  // namespace pikiwidb
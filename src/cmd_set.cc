@@ -14,7 +14,7 @@
 namespace pikiwidb {
 
 SIsMemberCmd::SIsMemberCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategorySet) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategorySet) {}
 
 bool SIsMemberCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -28,7 +28,7 @@ void SIsMemberCmd::DoCmd(PClient* client) {
 }
 
 SAddCmd::SAddCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategorySet) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategorySet) {}
 
 bool SAddCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -48,7 +48,8 @@ void SAddCmd::DoCmd(PClient* client) {
 }
 
 SUnionStoreCmd::SUnionStoreCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategorySet) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsAsync | kCmdFlagsMultiKey,
+              kAclCategoryWrite | kAclCategorySet) {}
 
 bool SUnionStoreCmd::DoInitial(PClient* client) {
   std::vector<std::string> keys(client->argv_.begin() + 1, client->argv_.end());
@@ -69,7 +70,8 @@ void SUnionStoreCmd::DoCmd(PClient* client) {
   client->AppendInteger(ret);
 }
 SInterCmd::SInterCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategorySet) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsAsync | kCmdFlagsMultiKey,
+              kAclCategoryRead | kAclCategorySet) {}
 
 bool SInterCmd::DoInitial(PClient* client) {
   std::vector keys(client->argv_.begin() + 1, client->argv_.end());
@@ -89,7 +91,7 @@ void SInterCmd::DoCmd(PClient* client) {
 }
 
 SRemCmd::SRemCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategorySet) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategorySet) {}
 
 bool SRemCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -108,7 +110,8 @@ void SRemCmd::DoCmd(PClient* client) {
 }
 
 SUnionCmd::SUnionCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategorySet) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsAsync | kCmdFlagsMultiKey,
+              kAclCategoryRead | kAclCategorySet) {}
 
 bool SUnionCmd::DoInitial(PClient* client) {
   std::vector<std::string> keys(client->argv_.begin() + 1, client->argv_.end());
@@ -126,7 +129,8 @@ void SUnionCmd::DoCmd(PClient* client) {
 }
 
 SInterStoreCmd::SInterStoreCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategorySet) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsAsync | kCmdFlagsMultiKey,
+              kAclCategoryWrite | kAclCategorySet) {}
 
 bool SInterStoreCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -149,7 +153,7 @@ void SInterStoreCmd::DoCmd(PClient* client) {
 }
 
 SCardCmd::SCardCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategorySet) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategorySet) {}
 
 bool SCardCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -166,7 +170,7 @@ void SCardCmd::DoCmd(PClient* client) {
 }
 
 SMoveCmd::SMoveCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategorySet) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsMultiKey | kCmdFlagsFast, kAclCategoryWrite | kAclCategorySet) {}
 
 bool SMoveCmd::DoInitial(PClient* client) { return true; }
 
@@ -259,7 +263,11 @@ void SPopCmd::DoCmd(PClient* client) {
 }
 
 SMembersCmd::SMembersCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategorySet) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsAsync, kAclCategoryRead | kAclCategorySet) {}
+
+int64_t SMembersCmd::collectionSize(PClient* client, storage::Storage* storage) const {
+  return storage->CachedLen(storage::DataType::kSets, client->argv_[1]);
+}
 
 bool SMembersCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -277,7 +285,8 @@ void SMembersCmd::DoCmd(PClient* client) {
 }
 
 SDiffCmd::SDiffCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategorySet) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsAsync | kCmdFlagsMultiKey,
+              kAclCategoryRead | kAclCategorySet) {}
 
 bool SDiffCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -296,7 +305,8 @@ void SDiffCmd::DoCmd(PClient* client) {
 }
 
 SDiffstoreCmd::SDiffstoreCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategorySet) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsAsync | kCmdFlagsMultiKey,
+              kAclCategoryWrite | kAclCategorySet) {}
 
 bool SDiffstoreCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -138,6 +138,7 @@ class SMembersCmd : public BaseCmd {
 
  protected:
   bool DoInitial(PClient *client) override;
+  int64_t collectionSize(PClient *client, storage::Storage *storage) const override;
 
  private:
   void DoCmd(PClient *client) override;
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "cmd_stats.h"
+
+namespace pikiwidb {
+
+CmdStats& CmdStats::Instance() {
+  static CmdStats stats;
+  return stats;
+}
+
+CmdStats::ThreadStats::~ThreadStats() {
+  for (size_t i = 0; i < size; ++i) {
+    delete cmds[i].load(std::memory_order_relaxed);
+  }
+}
+
+void CmdStats::Init(std::vector<std::string> names) { names_ = std::move(names); }
+
+CmdStats::ThreadStats* CmdStats::local() {
+  thread_local ThreadStats* stats = nullptr;
+  if (!stats) {
+    // owned by the registry, the histograms outlive the thread so INFO keeps them
+    auto owned = std::make_unique<ThreadStats>(names_.size());
+    stats = owned.get();
+    std::lock_guard guard(mutex_);
+    threads_.push_back(std::move(owned));
+  }
+  return stats;
+}
+
+void CmdStats::Record(uint32_t cmd_id, const CmdSample& sample) {
+  if (cmd_id >= names_.size()) {
+    return;
+  }
+
+  auto& slot = local()->cmds[cmd_id];
+  auto hist = slot.load(std::memory_order_relaxed);
+  if (!hist) {
+    hist = new CmdHistograms;
+    slot.store(hist, std::memory_order_release);
+  }
+
+  hist->total.Record(sample.total_ns);
+  hist->parse.Record(sample.parse_ns);
+  hist->lock.Record(sample.lock_ns);
+  hist->storage.Record(sample.storage_ns);
+  hist->reply.Record(sample.reply_bytes);
+}
+
+bool CmdStats::Collect(uint32_t cmd_id, Snapshot* snapshot) const {
+  if (cmd_id >= names_.size()) {
+    return false;
+  }
+
+  bool found = false;
+  std::lock_guard guard(mutex_);
+  for (const auto& t : threads_) {
+    auto hist = t->cmds[cmd_id].load(std::memory_order_acquire);
+    if (!hist) {
+      continue;
+    }
+    found = true;
+    hist->total.MergeTo(&snapshot->total);
+    hist->parse.MergeTo(&snapshot->parse);
+    hist->lock.MergeTo(&snapshot->lock);
+    hist->storage.MergeTo(&snapshot->storage);
+    hist->reply.MergeTo(&snapshot->reply);
+  }
+  return found && snapshot->total.Count() > 0;
+}
+
+}  // namespace pikiwidb
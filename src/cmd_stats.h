@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "pstd/hdr_histogram.h"
+
+namespace pikiwidb {
+
+// where the time of one command went, times in nanoseconds
+struct CmdSample {
+  uint64_t parse_ns = 0;    // protocol parsing of the request
+  uint64_t lock_ns = 0;     // waiting for the DB lock
+  uint64_t storage_ns = 0;  // running the command against the storage
+  uint64_t total_ns = 0;    // from dispatch until the reply is built, parsing excluded
+  uint64_t reply_bytes = 0;
+};
+
+inline uint64_t CmdStatsNow() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+/**
+ * @brief Per command latency histograms
+ * Every thread running commands records into its own histograms, allocated the first time it
+ * runs a command id, so recording is a few relaxed stores with no lock and no shared cache line.
+ * Readers merge all threads into snapshots without stopping the writers.
+ */
+class CmdStats {
+ public:
+  struct Snapshot {
+    pstd::HistogramSnapshot total;
+    pstd::HistogramSnapshot parse;
+    pstd::HistogramSnapshot lock;
+    pstd::HistogramSnapshot storage;
+    pstd::HistogramSnapshot reply;
+  };
+
+  static CmdStats& Instance();
+
+  CmdStats(const CmdStats&) = delete;
+  void operator=(const CmdStats&) = delete;
+
+  // names[id] is the full name of command id, like "get" or "config|get".
+  // called once the command table is built, before any command runs
+  void Init(std::vector<std::string> names);
+
+  void Record(uint32_t cmd_id, const CmdSample& sample);
+
+  // merge the histograms of cmd_id from all threads, return false if it was never called
+  bool Collect(uint32_t cmd_id, Snapshot* snapshot) const;
+
+  const std::vector<std::string>& Names() const { return names_; }
+
+ private:
+  CmdStats() = default;
+
+  struct CmdHistograms {
+    pstd::Histogram total;
+    pstd::Histogram parse;
+    pstd::Histogram lock;
+    pstd::Histogram storage;
+    pstd::Histogram reply;
+  };
+
+  struct ThreadStats {
+    explicit ThreadStats(size_t n) : size(n), cmds(new std::atomic<CmdHistograms*>[n]()) {}
+    ~ThreadStats();
+
+    const size_t size;
+    std::unique_ptr<std::atomic<CmdHistograms*>[]> cmds;
+  };
+
+  ThreadStats* local();
+
+  std::vector<std::string> names_;
+
+  // guards the list only, never taken by Record once a thread is registered
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<ThreadStats>> threads_;
+};
+
+}  // namespace pikiwidb
@@ -12,9 +12,12 @@
 #include "cmd_keys.h"
 #include "cmd_kv.h"
 #include "cmd_list.h"
+#include "cmd_multi.h"
 #include "cmd_set.h"
+#include "cmd_stats.h"
 #include "cmd_table_manager.h"
 #include "cmd_zset.h"
+#include "pstd/log.h"
 
 namespace pikiwidb {
 
@@ -30,18 +33,35 @@ CmdTableManager::CmdTableManager() {
 }
 
 void CmdTableManager::InitCmdTable() {
-  std::unique_lock wl(mutex_);
-
   // admin
   auto configPtr = std::make_unique<CmdConfig>(kCmdNameConfig, -2);
   configPtr->AddSubCmd(std::make_unique<CmdConfigGet>("get", -3));
   configPtr->AddSubCmd(std::make_unique<CmdConfigSet>("set", -4));
   cmds_->insert(std::make_pair(kCmdNameConfig, std::move(configPtr)));
 
+  auto latencyPtr = std::make_unique<CmdLatency>(kCmdNameLatency, -2);
+  latencyPtr->AddSubCmd(std::make_unique<CmdLatencyHistogram>("histogram", -2));
+  cmds_->insert(std::make_pair(kCmdNameLatency, std::move(latencyPtr)));
+
+  auto slowlogPtr = std::make_unique<CmdSlowlog>(kCmdNameSlowlog, -2);
+  slowlogPtr->AddSubCmd(std::make_unique<CmdSlowlogGet>("get", -2));
+  slowlogPtr->AddSubCmd(std::make_unique<CmdSlowlogLen>("len", 2));
+  slowlogPtr->AddSubCmd(std::make_unique<CmdSlowlogReset>("reset", 2));
+  cmds_->insert(std::make_pair(kCmdNameSlowlog, std::move(slowlogPtr)));
+
   // server
   ADD_COMMAND(Flushdb, 1);
   ADD_COMMAND(Flushall, 1);
   ADD_COMMAND(Select, 2);
+  ADD_COMMAND(Info, -1);
+  ADD_COMMAND(Monitor, 1);
+
+  // transaction
+  ADD_COMMAND(Multi, 1);
+  ADD_COMMAND(Exec, 1);
+  ADD_COMMAND(Discard, 1);
+  ADD_COMMAND(Watch, -2);
+  ADD_COMMAND(Unwatch, 1);
 
   // keyspace
   ADD_COMMAND(Del, -2);
@@ -123,6 +143,10 @@ void CmdTableManager::InitCmdTable() {
   ADD_COMMAND(LPop, 2);
   ADD_COMMAND(LIndex, 3);
   ADD_COMMAND(LLen, 2);
+  ADD_COMMAND(BLPop, -3);
+  ADD_COMMAND(BRPop, -3);
+  ADD_COMMAND(BRPoplpush, 4);
+  ADD_COMMAND(BLMove, 6);
 
   // zset
   ADD_COMMAND(ZAdd, -4);
@@ -136,29 +160,53 @@ void CmdTableManager::InitCmdTable() {
   ADD_COMMAND(ZRange, -4);
   ADD_COMMAND(ZRangebylex, -3);
   ADD_COMMAND(ZRevrangebylex, -3);
-}
 
-std::pair<BaseCmd*, CmdRes::CmdRet> CmdTableManager::GetCommand(const std::string& cmdName, PClient* client) {
-  std::shared_lock rl(mutex_);
+  std::vector<std::pair<std::string_view, BaseCmd*>> entries;
+  entries.reserve(cmds_->size());
+  for (const auto& [name, cmd] : *cmds_) {
+    entries.emplace_back(name, cmd.get());
+    if (auto group = dynamic_cast<BaseCmdGroup*>(cmd.get()); group) {
+      group->BuildSubCmdIndex();
+    }
+  }
+  if (!index_.Build(entries)) {
+    ERROR("build command index failed, {} commands", entries.size());
+  }
+
+  // ids are handed out from 1 by GetCmdId
+  std::vector<std::string> names(cmdId_ + 1);
+  for (const auto& [name, cmd] : *cmds_) {
+    names[cmd->GetCmdId()] = name;
+    if (auto group = dynamic_cast<BaseCmdGroup*>(cmd.get()); group) {
+      for (const auto& [subName, subCmd] : group->SubCmds()) {
+        names[subCmd->GetCmdId()] = name + "|" + subName;
+      }
+    }
+  }
+  CmdStats::Instance().Init(std::move(names));
+}
 
-  auto cmd = cmds_->find(cmdName);
+std::pair<BaseCmd*, CmdRes::CmdRet> CmdTableManager::GetCommand(std::string_view cmdName, PClient* client) const {
+  auto cmd = index_.Find(cmdName);
 
-  if (cmd == cmds_->end()) {
+  if (!cmd) {
     return std::pair(nullptr, CmdRes::kSyntaxErr);
   }
 
-  if (cmd->second->HasSubCommand()) {
+  if ((*cmd)->HasSubCommand()) {
     if (client->argv_.size() < 2) {
       return std::pair(nullptr, CmdRes::kInvalidParameter);
     }
-    return std::pair(cmd->second->GetSubCmd(client->argv_[1]), CmdRes::kSyntaxErr);
+    return std::pair((*cmd)->GetSubCmd(client->argv_[1]), CmdRes::kSyntaxErr);
   }
-  return std::pair(cmd->second.get(), CmdRes::kSyntaxErr);
+  return std::pair(*cmd, CmdRes::kSyntaxErr);
 }
 
-bool CmdTableManager::CmdExist(const std::string& cmd) const {
-  std::shared_lock rl(mutex_);
-  return cmds_->find(cmd) != cmds_->end();
+bool CmdTableManager::CmdExist(std::string_view cmd) const { return index_.Find(cmd) != nullptr; }
+
+const std::string* CmdTableManager::RegisteredName(std::string_view cmdName) const {
+  auto cmd = index_.Find(cmdName);
+  return cmd ? &(*cmd)->Name() : nullptr;
 }
 
 uint32_t CmdTableManager::GetCmdId() { return ++cmdId_; }
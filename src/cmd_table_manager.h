@@ -8,10 +8,8 @@
 #pragma once
 
 #include <memory>
-#include <mutex>
-#include <shared_mutex>
 #include <string>
-#include <thread>
+#include <string_view>
 #include <unordered_map>
 
 #include "base_cmd.h"
@@ -26,18 +24,22 @@ class CmdTableManager {
   ~CmdTableManager() = default;
 
  public:
+  // must be called before any lookup, the table is frozen afterwards
   void InitCmdTable();
-  std::pair<BaseCmd*, CmdRes::CmdRet> GetCommand(const std::string& cmdName, PClient* client);
+  // cmdName is matched ignoring case, so the raw argv bytes can be passed in
+  std::pair<BaseCmd*, CmdRes::CmdRet> GetCommand(std::string_view cmdName, PClient* client) const;
   //  uint32_t DistributeKey(const std::string& key, uint32_t slot_num);
-  bool CmdExist(const std::string& cmd) const;
+  bool CmdExist(std::string_view cmd) const;
+  // the name cmdName is registered with, lowercase, nullptr for an unknown command
+  const std::string* RegisteredName(std::string_view cmdName) const;
   uint32_t GetCmdId();
 
  private:
   std::unique_ptr<CmdTable> cmds_;
+  // lock free index over cmds_, built by InitCmdTable
+  pstd::PerfectHashMap<BaseCmd*> index_;
 
   uint32_t cmdId_ = 0;
-
-  mutable std::shared_mutex mutex_;
 };
 
 }  // namespace pikiwidb
@@ -83,7 +83,7 @@ static int32_t DoMemberRange(const std::string& raw_min_member, const std::strin
 }
 
 ZAddCmd::ZAddCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategorySortedSet) {}
+    : BaseCmd(name, arity, kCmdFlagsWrite | kCmdFlagsFast, kAclCategoryWrite | kAclCategorySortedSet) {}
 
 bool ZAddCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -118,7 +118,12 @@ void ZAddCmd::DoCmd(PClient* client) {
 }
 
 ZRevrangeCmd::ZRevrangeCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategorySortedSet) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsAsync, kAclCategoryRead | kAclCategorySortedSet) {}
+
+int64_t ZRevrangeCmd::collectionSize(PClient* client, storage::Storage* storage) const {
+  const auto len = indexRangeLen(client->argv_[2], client->argv_[3]);
+  return len >= 0 ? len : storage->CachedLen(storage::DataType::kZSets, client->argv_[1]);
+}
 
 bool ZRevrangeCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -174,7 +179,11 @@ void ZRevrangeCmd::DoCmd(PClient* client) {
 }
 
 ZRangebyscoreCmd::ZRangebyscoreCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategorySortedSet) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsAsync, kAclCategoryRead | kAclCategorySortedSet) {}
+
+int64_t ZRangebyscoreCmd::collectionSize(PClient* client, storage::Storage* storage) const {
+  return storage->CachedLen(storage::DataType::kZSets, client->argv_[1]);
+}
 
 bool ZRangebyscoreCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -255,7 +264,7 @@ void ZRangebyscoreCmd::DoCmd(PClient* client) {
 }
 
 ZCardCmd::ZCardCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategorySortedSet) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategorySortedSet) {}
 
 bool ZCardCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -304,7 +313,11 @@ void ZRemrangebyrankCmd::DoCmd(PClient* client) {
 }
 
 ZRangeCmd::ZRangeCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategorySortedSet) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsAsync, kAclCategoryRead | kAclCategorySortedSet) {}
+
+int64_t ZRangeCmd::collectionSize(PClient* client, storage::Storage* storage) const {
+  return storage->CachedLen(storage::DataType::kZSets, client->argv_[1]);
+}
 
 bool ZRangeCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -447,7 +460,7 @@ void ZRangeCmd::DoCmd(PClient* client) {
 }
 
 ZScoreCmd::ZScoreCmd(const std::string& name, int16_t arity)
-    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryString) {}
+    : BaseCmd(name, arity, kCmdFlagsReadonly | kCmdFlagsFast, kAclCategoryRead | kAclCategoryString) {}
 
 bool ZScoreCmd::DoInitial(PClient* client) {
   client->SetKey(client->argv_[1]);
@@ -29,6 +29,7 @@ class ZRevrangeCmd : public BaseCmd {
 
  protected:
   bool DoInitial(PClient *client) override;
+  int64_t collectionSize(PClient *client, storage::Storage *storage) const override;
 
  private:
   void DoCmd(PClient *client) override;
@@ -40,6 +41,7 @@ class ZRangebyscoreCmd : public BaseCmd {
 
  protected:
   bool DoInitial(PClient *client) override;
+  int64_t collectionSize(PClient *client, storage::Storage *storage) const override;
 
  private:
   void DoCmd(PClient *client) override;
@@ -84,6 +86,7 @@ class ZRangeCmd : public BaseCmd {
 
  protected:
   bool DoInitial(PClient *client) override;
+  int64_t collectionSize(PClient *client, storage::Storage *storage) const override;
 
  private:
   void DoCmd(PClient *client) override;
@@ -160,13 +160,6 @@ PCommandHandler psubscribe;
 PCommandHandler punsubscribe;
 PCommandHandler pubsub;
 
-// multi
-PCommandHandler watch;
-PCommandHandler unwatch;
-PCommandHandler multi;
-PCommandHandler exec;
-PCommandHandler discard;
-
 // replication
 PCommandHandler sync;
 PCommandHandler slaveof;
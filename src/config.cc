@@ -52,8 +52,9 @@ PConfig::PConfig() {
   maxclients = 10000;
 
   // slow log
-  slowlogtime = 0;
+  slowlogtime = 10000;
   slowlogmaxlen = 128;
+  slowlogperfsample = 16;
 
   hz = 10;
 
@@ -69,7 +70,16 @@ PConfig::PConfig() {
 
   max_client_response_size = 1073741824;
 
+  reactor_type = "libevent";
+  reuse_port = false;
+
   db_instance_num = 3;
+  shared_nothing = false;
+  async_read_threads = 0;
+  async_min_elements = 128;
+  slow_cmd_cpu_share = 50;
+  value_cache_size = 0;
+  meta_cache_size = 0;
 
   rocksdb_ttl_second = 0;
   rocksdb_periodic_second = 0;
@@ -144,8 +154,9 @@ bool LoadPikiwiDBConfig(const char* cfgFile, PConfig& cfg) {
 
   cfg.maxclients = parser.GetData<int>("maxclients", 10000);
 
-  cfg.slowlogtime = parser.GetData<int>("slowlog-log-slower-than", 0);
+  cfg.slowlogtime = parser.GetData<int>("slowlog-log-slower-than", cfg.slowlogtime);
   cfg.slowlogmaxlen = parser.GetData<int>("slowlog-max-len", cfg.slowlogmaxlen);
+  cfg.slowlogperfsample = parser.GetData<int>("slowlog-perf-sample", cfg.slowlogperfsample);
 
   cfg.hz = parser.GetData<int>("hz", 10);
 
@@ -173,6 +184,9 @@ bool LoadPikiwiDBConfig(const char* cfgFile, PConfig& cfg) {
   // slave threads
   cfg.slave_threads_num = parser.GetData<int>("slave-threads", 1);
 
+  cfg.reactor_type = parser.GetData<PString>("reactor-type", cfg.reactor_type);
+  cfg.reuse_port = (parser.GetData<PString>("reuse-port", "no") == "yes");
+
   // backend
   cfg.backend = parser.GetData<int>("backend", kBackEndNone);
   cfg.backendPath = parser.GetData<PString>("backendpath", cfg.backendPath);
@@ -182,6 +196,12 @@ bool LoadPikiwiDBConfig(const char* cfgFile, PConfig& cfg) {
   cfg.max_client_response_size = parser.GetData<int64_t>("max-client-response-size", 1073741824);
 
   cfg.db_instance_num = parser.GetData<int>("db-instance-num", 3);
+  cfg.shared_nothing = (parser.GetData<PString>("shared-nothing", "no") == "yes");
+  cfg.async_read_threads = parser.GetData<int>("async-read-threads", 0);
+  cfg.async_min_elements = parser.GetData<int64_t>("async-min-elements", 128);
+  cfg.slow_cmd_cpu_share = parser.GetData<int>("slow-cmd-cpu-share", 50);
+  cfg.value_cache_size = parser.GetData<int64_t>("value-cache-size", 0);
+  cfg.meta_cache_size = parser.GetData<int64_t>("meta-cache-size", 0);
   cfg.rocksdb_ttl_second = parser.GetData<uint64_t>("rocksdb-ttl-second");
   cfg.rocksdb_periodic_second = parser.GetData<uint64_t>("rocksdb-periodic-second");
 
@@ -199,12 +219,20 @@ bool PConfig::CheckArgs() const {
   RETURN_IF_FAIL(databases > 0);
   RETURN_IF_FAIL(maxclients > 0);
   RETURN_IF_FAIL(hz > 0 && hz < 500);
+  RETURN_IF_FAIL(slowlogmaxlen >= 0);
+  RETURN_IF_FAIL(slowlogperfsample >= 0);
   RETURN_IF_FAIL(maxmemory >= 512 * 1024 * 1024UL);
   RETURN_IF_FAIL(maxmemorySamples > 0 && maxmemorySamples < 10);
   RETURN_IF_FAIL(worker_threads_num > 0 && worker_threads_num < 129);  // as redis
+  RETURN_IF_FAIL(reactor_type == "libevent" || reactor_type == "io_uring");
   RETURN_IF_FAIL(backend >= kBackEndNone && backend < kBackEndMax);
   RETURN_IF_FAIL(backendHz >= 1 && backendHz <= 50);
   RETURN_IF_FAIL(db_instance_num >= 1);
+  RETURN_IF_FAIL(async_read_threads >= 0 && async_read_threads <= 256);
+  RETURN_IF_FAIL(async_min_elements >= 0);
+  RETURN_IF_FAIL(slow_cmd_cpu_share > 0 && slow_cmd_cpu_share <= 100);
+  RETURN_IF_FAIL(value_cache_size >= 0);
+  RETURN_IF_FAIL(meta_cache_size >= 0);
   RETURN_IF_FAIL(rocksdb_ttl_second > 0);
   RETURN_IF_FAIL(rocksdb_periodic_second > 0);
   RETURN_IF_FAIL(max_client_response_size > 0);
@@ -52,8 +52,9 @@ struct PConfig {
 
   int maxclients;  // 10000
 
-  int slowlogtime;    // 1000 microseconds
-  int slowlogmaxlen;  // 128
+  int slowlogtime;        // 10000 microseconds
+  int slowlogmaxlen;      // 128
+  int slowlogperfsample;  // 16, one in N commands collects rocksdb perf counters
 
   int hz;  // 10  [1,500]
 
@@ -78,6 +79,11 @@ struct PConfig {
   // THREADED SLAVE
   int slave_threads_num;
 
+  // network backend, libevent or io_uring
+  PString reactor_type;
+  // every worker thread accepts connections by itself
+  bool reuse_port;
+
   int backend;  // enum BackEndType
   PString backendPath;
   int backendHz;  // the frequency of dump to backend
@@ -85,6 +91,18 @@ struct PConfig {
   int64_t max_client_response_size;
 
   int db_instance_num;
+  // each storage instance is served by its own executor thread
+  bool shared_nothing;
+  // threads reading for the commands which may scan much data, 0 keeps them in the event loops
+  int async_read_threads;
+  // a collection with fewer elements is read in the event loop, 0 offloads every call
+  int64_t async_min_elements;
+  // percent of a loop left to the commands not flagged fast while fast ones wait, 100 never defers them
+  int slow_cmd_cpu_share;
+  // bytes of hot decoded values cached in front of rocksdb per database, 0 disables the cache
+  int64_t value_cache_size;
+  // bytes of collection meta values cached per database, 0 disables the cache
+  int64_t meta_cache_size;
   uint64_t rocksdb_ttl_second;
   uint64_t rocksdb_periodic_second;
   PConfig();
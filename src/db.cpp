@@ -6,17 +6,29 @@
  */
 
 #include "db.h"
+
+#include <thread>
+
 #include "config.h"
+#include "instance_executor.h"
+#include "pstd/env.h"
 
 extern pikiwidb::PConfig g_config;
 
 namespace pikiwidb {
 
 DB::DB(int db_id, const std::string &db_path) : db_id_(db_id), db_path_(db_path + std::to_string(db_id) + '/') {
+  open();
+  INFO("Open DB{} success!", db_id);
+}
+
+void DB::open() {
   storage::StorageOptions storage_options;
   storage_options.options.create_if_missing = true;
   storage_options.db_instance_num = g_config.db_instance_num;
-  storage_options.db_id = db_id;
+  storage_options.db_id = db_id_;
+  storage_options.value_cache_size = g_config.value_cache_size;
+  storage_options.meta_cache_size = g_config.meta_cache_size;
 
   // options for CF
   storage_options.options.ttl = g_config.rocksdb_ttl_second;
@@ -27,6 +39,34 @@ DB::DB(int db_id, const std::string &db_path) : db_id_(db_id), db_path_(db_path
     abort();
   }
   opened_ = true;
-  INFO("Open DB{} success!", db_id);
+}
+
+void DB::Flush() {
+  storage_.reset();
+  opened_ = false;
+
+  auto deleting = db_path_;
+  deleting.back() = '_';
+  deleting += "deleting/";
+  pstd::DeleteDirIfExist(deleting);
+  if (pstd::RenameFile(db_path_, deleting) != 0) {
+    ERROR("Flush DB{}: can't move {} aside", db_id_, db_path_);
+    abort();
+  }
+  open();
+  std::thread([deleting]() { pstd::DeleteDir(deleting); }).detach();
+
+  // the owner threads of the instances own those of the new storage as well
+  auto &executor = InstanceExecutor::Instance();
+  if (executor.IsRunning()) {
+    for (size_t i = 0; i < static_cast<size_t>(g_config.db_instance_num); ++i) {
+      executor.Post(i, [this, i]() {
+        LockShared();
+        storage_->OwnInstance(i);
+        UnLockShared();
+      });
+    }
+  }
+  INFO("Flush DB{} success!", db_id_);
 }
 }  // namespace pikiwidb
@@ -11,6 +11,7 @@
 #include <string>
 
 #include "log.h"
+#include "pstd/epoch_lock.h"
 #include "pstd/noncopyable.h"
 #include "storage/storage.h"
 
@@ -28,7 +29,13 @@ class DB {
 
   void UnLockShared() { storage_mutex_.unlock_shared(); }
 
+  // drops every key: the storage is closed and its files moved aside, to be deleted in the background, then a new
+  // one opens at the same path. The caller holds the lock
+  void Flush();
+
  private:
+  void open();
+
   const int db_id_;
   const std::string db_path_;
 
@@ -37,8 +44,10 @@ class DB {
    * you must first acquire a mutex lock.
    * If you only want to access the pointer,
    * you just need to obtain a shared lock.
+   * The shared lock only touches a cache line of the calling thread,
+   * the mutex lock waits until every thread left its shared section.
    */
-  std::shared_mutex storage_mutex_;
+  pstd::EpochLock storage_mutex_;
   std::unique_ptr<storage::Storage> storage_;
   bool opened_ = false;
 
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "instance_executor.h"
+
+#include <cassert>
+
+#include "log.h"
+
+namespace pikiwidb {
+
+InstanceExecutor& InstanceExecutor::Instance() {
+  static InstanceExecutor executor;
+  return executor;
+}
+
+void InstanceExecutor::Start(size_t inst_num, std::function<void(size_t)> on_start) {
+  assert(workers_.empty());
+
+  for (size_t i = 0; i < inst_num; ++i) {
+    auto worker = std::make_unique<Worker>();
+    worker->thread = std::thread([w = worker.get(), i, on_start]() {
+      on_start(i);
+      w->Run();
+    });
+    workers_.push_back(std::move(worker));
+  }
+  INFO("shared-nothing mode, {} instance executors started", inst_num);
+}
+
+void InstanceExecutor::Stop() {
+  for (auto& worker : workers_) {
+    worker->stop.store(true);
+    worker->seq.fetch_add(1);
+    worker->seq.notify_one();
+  }
+  for (auto& worker : workers_) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+  workers_.clear();
+}
+
+void InstanceExecutor::Post(size_t inst_id, std::function<void()> task) {
+  workers_[inst_id % workers_.size()]->Push(std::move(task));
+}
+
+void InstanceExecutor::Worker::Push(std::function<void()> task) {
+  queue.Push(std::move(task));
+  seq.fetch_add(1);
+  seq.notify_one();
+}
+
+void InstanceExecutor::Worker::Run() {
+  std::function<void()> task;
+  while (true) {
+    if (queue.TryPop(task)) {
+      task();
+      continue;
+    }
+
+    if (stop.load()) {
+      break;
+    }
+
+    // a push after this load changes seq, so wait() returns at once
+    const auto s = seq.load();
+    if (queue.Empty()) {
+      seq.wait(s);
+    }
+  }
+}
+
+}  // namespace pikiwidb
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "net/event_loop.h"
+#include "pstd/mpsc_queue.h"
+
+namespace pikiwidb {
+
+/**
+ * @brief Executor threads for the shared-nothing mode
+ * Every storage::Redis instance index (see SlotIndexer::GetInstanceID) is owned by
+ * exactly one executor thread, across all DBs. A client hands a single-key command
+ * to the owner through a lock-free queue and its loop goes on with other connections,
+ * the owner posts the reply back to the loop. The owner takes the key locks of its
+ * instances without the latches while no other thread locks them, see LockMgr::SetOwner.
+ */
+class InstanceExecutor {
+ public:
+  static InstanceExecutor& Instance();
+
+  InstanceExecutor(const InstanceExecutor&) = delete;
+  void operator=(const InstanceExecutor&) = delete;
+
+  // start one executor thread per storage instance, on_start(inst_id) runs first on each
+  void Start(size_t inst_num, std::function<void(size_t)> on_start);
+  void Stop();
+  bool IsRunning() const { return !workers_.empty(); }
+
+  // run task on the thread owning the instance, without waiting for it
+  void Post(size_t inst_id, std::function<void()> task);
+
+  // co_await it in a loop: fn runs on the owner of the instance, then the coroutine resumes in the loop
+  auto Run(EventLoop* loop, size_t inst_id, std::function<void()> fn) {
+    struct Awaiter {
+      InstanceExecutor* self;
+      EventLoop* loop;
+      size_t inst_id;
+      std::function<void()> fn;
+
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> h) {
+        // the resume is posted, so the replies of the input at hand are sent first
+        self->Post(inst_id, [this, h]() {
+          fn();
+          loop->Post([h]() { h.resume(); });
+        });
+      }
+      void await_resume() const noexcept {}
+    };
+    return Awaiter{this, loop, inst_id, std::move(fn)};
+  }
+
+ private:
+  InstanceExecutor() = default;
+
+  struct Worker {
+    void Run();
+    void Push(std::function<void()> task);
+
+    pstd::MPSCQueue<std::function<void()>> queue;
+    std::atomic<uint64_t> seq{0};  // bumped on every push, the worker parks on it
+    std::atomic<bool> stop{false};
+    std::thread thread;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+}  // namespace pikiwidb
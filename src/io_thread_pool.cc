@@ -6,6 +6,7 @@
  */
 
 #include <cassert>
+#include <future>
 
 #include "io_thread_pool.h"
 #include "pstd/log.h"
@@ -38,25 +39,39 @@ bool IOThreadPool::SetWorkerNum(size_t num) {
 }
 
 bool IOThreadPool::Init(const char* ip, int port, const NewTcpConnectionCallback& cb) {
-  auto f = [this] { return ChooseNextWorkerEventLoop(); };
-
   base_.Init();
   INFO("base loop {} {}, g_baseLoop {}", base_.GetName(), static_cast<void*>(&base_),
        static_cast<void*>(pikiwidb::EventLoop::Self()));
+
+  listen_ip_ = ip;
+  listen_port_ = port;
+  new_conn_cb_ = cb;
+  if (reuse_port_ && worker_num_ > 1) {
+    // the kernel spreads the connections over the sockets of the workers, the base loop doesn't accept
+    if (!StartWorkers(true)) {
+      ERROR("can not bind socket on addr {}:{} in every worker loop", ip, port);
+      StopWorkers();
+      return false;
+    }
+    return true;
+  }
+
+  auto f = [this] { return ChooseNextWorkerEventLoop(); };
   if (!base_.Listen(ip, port, cb, f)) {
     ERROR("can not bind socket on addr {}:{}", ip, port);
     return false;
   }
-
   return true;
 }
 
 void IOThreadPool::Run(int ac, char* av[]) {
-  assert(state_ == State::kNone);
   INFO("Process {} starting...", name_);
 
-  // start loops in thread pool
-  StartWorkers();
+  // start loops in thread pool, unless Init did to listen in them
+  if (state_ == State::kNone) {
+    StartWorkers(false);
+  }
+  run_.set_value();
   base_.Run();
 
   for (auto& w : worker_threads_) {
@@ -91,7 +106,7 @@ EventLoop* IOThreadPool::ChooseNextWorkerEventLoop() {
   return loop.get();
 }
 
-void IOThreadPool::StartWorkers() {
+bool IOThreadPool::StartWorkers(bool listen) {
   // only called by main thread
   assert(state_ == State::kNone);
 
@@ -105,10 +120,23 @@ void IOThreadPool::StartWorkers() {
     worker_loops_.push_back(std::move(loop));
   }
 
+  std::vector<std::future<bool>> bound;
+  auto run = run_.get_future().share();
   for (index = 0; index < worker_loops_.size(); ++index) {
     EventLoop* loop = worker_loops_[index].get();
-    std::thread t([loop]() {
+    auto listened = std::make_shared<std::promise<bool>>();
+    bound.push_back(listened->get_future());
+    std::thread t([this, loop, listen, listened, run]() {
       loop->Init();
+      // connections accepted here stay in this loop
+      bool ok = !listen ||
+                loop->Listen(listen_ip_.c_str(), listen_port_, new_conn_cb_, [loop]() { return loop; }, true);
+      if (!ok) {
+        ERROR("loop {} can not bind socket on addr {}:{}", loop->GetName(), listen_ip_, listen_port_);
+      }
+      listened->set_value(ok);
+      // the loops run once the server is ready, see Run
+      run.wait();
       loop->Run();
     });
     INFO("thread {}, thread loop {}, loop name {}", index, static_cast<void*>(loop), loop->GetName().c_str());
@@ -116,10 +144,40 @@ void IOThreadPool::StartWorkers() {
   }
 
   state_ = State::kStarted;
+  bool ok = true;
+  for (auto& f : bound) {
+    ok = f.get() && ok;
+  }
+  return ok;
+}
+
+void IOThreadPool::StopWorkers() {
+  for (const auto& loop : worker_loops_) {
+    loop->Stop();
+  }
+  run_.set_value();
+  for (auto& w : worker_threads_) {
+    w.join();
+  }
+  worker_threads_.clear();
+  worker_loops_.clear();
+  state_ = State::kNone;
 }
 
 void IOThreadPool::SetName(const std::string& name) { name_ = name; }
 
+std::vector<std::pair<std::string, uint64_t>> IOThreadPool::GetAcceptCounts() const {
+  std::vector<std::pair<std::string, uint64_t>> counts;
+  counts.emplace_back(name_, base_.GetAcceptCount());
+  if (state_ == State::kStarted) {
+    for (const auto& loop : worker_loops_) {
+      counts.emplace_back(loop->GetName(), loop->GetAcceptCount());
+    }
+  }
+
+  return counts;
+}
+
 bool IOThreadPool::Listen(const char* ip, int port, const NewTcpConnectionCallback& ccb) {
   auto f = [this] { return ChooseNextWorkerEventLoop(); };
   auto loop = BaseLoop();
@@ -165,6 +223,7 @@ std::shared_ptr<HttpClient> IOThreadPool::ConnectHTTP(const char* ip, int port,
 
 void IOThreadPool::Reset() {
   state_ = State::kNone;
+  run_ = std::promise<void>();
   BaseLoop()->Reset();
 }
 
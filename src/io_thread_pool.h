@@ -9,6 +9,7 @@
 
 #include <atomic>
 #include <functional>
+#include <future>
 #include <memory>
 #include <thread>
 
@@ -40,6 +41,14 @@ class IOThreadPool {
   // app name, for top command
   void SetName(const std::string& name);
 
+  // if set before Init, every worker loop listens on the address with SO_REUSEPORT and serves
+  // the connections it accepts, the base loop doesn't listen; Init fails if a worker can't bind.
+  // Needs SetWorkerNum before Init
+  void SetReusePort(bool reuse_port) { reuse_port_ = reuse_port; }
+
+  // connections accepted per loop, base loop first
+  std::vector<std::pair<std::string, uint64_t>> GetAcceptCounts() const;
+
   // TCP server
   bool Listen(const char* ip, int port, const NewTcpConnectionCallback& ccb);
 
@@ -58,7 +67,10 @@ class IOThreadPool {
   void Reset();
 
  private:
-  void StartWorkers();
+  // starts the worker threads, listening in each when listen; false if a worker couldn't bind
+  bool StartWorkers(bool listen);
+  // stops and joins the workers StartWorkers started, before Run
+  void StopWorkers();
 
   static const size_t kMaxWorkers;
 
@@ -66,12 +78,14 @@ class IOThreadPool {
   std::string listen_ip_;
   int listen_port_{0};
   NewTcpConnectionCallback new_conn_cb_;
+  bool reuse_port_{false};
 
   EventLoop base_;
 
   std::atomic<size_t> worker_num_{0};
   std::vector<std::thread> worker_threads_;
   std::vector<std::unique_ptr<EventLoop>> worker_loops_;
+  std::promise<void> run_;  // set by Run, the workers wait for it before running their loop
   mutable std::atomic<size_t> current_worker_loop_{0};
 
   enum class State {
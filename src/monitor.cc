@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+
+#include "client.h"
+#include "event_loop.h"
+#include "monitor.h"
+
+namespace pikiwidb {
+
+PMonitor& PMonitor::Instance() {
+  static PMonitor monitor;
+  return monitor;
+}
+
+PMonitor::~PMonitor() {
+  {
+    std::lock_guard guard(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void PMonitor::AddMonitor(const std::shared_ptr<PClient>& client) {
+  auto m = std::make_shared<Monitor>();
+  m->client = client;
+
+  {
+    std::lock_guard guard(mutex_);
+    monitors_.push_back(std::move(m));
+    monitorsNum_.store(static_cast<int>(monitors_.size()), std::memory_order_relaxed);
+    if (!thread_.joinable()) {
+      thread_ = std::thread([this]() { run(); });
+    }
+  }
+  cond_.notify_all();
+}
+
+PMonitor::Ring* PMonitor::local() {
+  thread_local Ring* ring = nullptr;
+  if (!ring) {
+    auto owned = std::make_unique<Ring>();
+    ring = owned.get();
+    std::lock_guard guard(mutex_);
+    rings_.push_back(std::move(owned));
+  }
+  return ring;
+}
+
+void PMonitor::Feed(int db, const std::string& ip, int port, const std::vector<std::string>& params) {
+  auto ring = local();
+  const auto tail = ring->tail.load(std::memory_order_relaxed);
+  if (tail - ring->head.load(std::memory_order_acquire) == kRingSize) {
+    ringDropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // the slot keeps its buffers, so a busy ring doesn't allocate
+  auto& r = ring->slots[tail & (kRingSize - 1)];
+  r.timeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+                 .count();
+  r.db = db;
+  r.ip.assign(ip);
+  r.port = port;
+  if (r.args.size() < params.size()) {
+    r.args.resize(params.size());
+  }
+  for (size_t i = 0; i < params.size(); ++i) {
+    r.args[i].assign(params[i]);
+  }
+  r.argc = params.size();
+
+  ring->tail.store(tail + 1, std::memory_order_release);
+}
+
+// like redis sdscatrepr
+static void AppendRepr(std::string& out, const std::string& arg) {
+  out.push_back('"');
+  for (auto c : arg) {
+    switch (c) {
+      case '\\':
+      case '"':
+        out.push_back('\\');
+        out.push_back(c);
+        break;
+      case '\n':
+        out.append("\\n");
+        break;
+      case '\r':
+        out.append("\\r");
+        break;
+      case '\t':
+        out.append("\\t");
+        break;
+      case '\a':
+        out.append("\\a");
+        break;
+      case '\b':
+        out.append("\\b");
+        break;
+      default:
+        if (isprint(static_cast<unsigned char>(c))) {
+          out.push_back(c);
+        } else {
+          char buf[8];
+          snprintf(buf, sizeof buf, "\\x%02x", static_cast<unsigned char>(c));
+          out.append(buf);
+        }
+        break;
+    }
+  }
+  out.push_back('"');
+}
+
+size_t PMonitor::drain(std::string& out) {
+  std::vector<Ring*> rings;
+  {
+    std::lock_guard guard(mutex_);
+    rings.reserve(rings_.size());
+    for (const auto& r : rings_) {
+      rings.push_back(r.get());
+    }
+  }
+
+  size_t lines = 0;
+  for (auto ring : rings) {
+    const auto head = ring->head.load(std::memory_order_relaxed);
+    const auto tail = ring->tail.load(std::memory_order_acquire);
+    for (auto i = head; i != tail; ++i) {
+      const auto& r = ring->slots[i & (kRingSize - 1)];
+      // +1339518083.107412 [0 127.0.0.1:60866] "keys" "*"
+      char buf[96];
+      snprintf(buf, sizeof buf, "+%lld.%06lld [%d ", static_cast<long long>(r.timeUs / 1000000),
+               static_cast<long long>(r.timeUs % 1000000), r.db);
+      out.append(buf).append(r.ip).append(":").append(std::to_string(r.port)).append("]");
+      for (size_t k = 0; k < r.argc; ++k) {
+        out.push_back(' ');
+        AppendRepr(out, r.args[k]);
+      }
+      out.append("\r\n");
+    }
+    ring->head.store(tail, std::memory_order_release);
+    lines += tail - head;
+  }
+
+  const auto dropped = ringDropped_.load(std::memory_order_relaxed);
+  if (dropped != ringDroppedReported_) {
+    out.append("+dropped ").append(std::to_string(dropped - ringDroppedReported_));
+    out.append(" commands, monitor ring is full\r\n");
+    ringDroppedReported_ = dropped;
+  }
+  return lines;
+}
+
+void PMonitor::send(std::shared_ptr<const std::string> msg, size_t lines) {
+  std::lock_guard guard(mutex_);
+  for (auto it = monitors_.begin(); it != monitors_.end();) {
+    auto client = (*it)->client.lock();
+    auto conn = client ? client->GetTcpConnection() : nullptr;
+    if (!conn) {
+      it = monitors_.erase(it);
+      continue;
+    }
+
+    // the backlog can only be read in the connection's loop, so decide there
+    std::weak_ptr<TcpConnection> weakConn = conn;
+    conn->GetEventLoop()->Execute([weakConn, m = *it, msg, lines]() {
+      auto c = weakConn.lock();
+      if (!c) {
+        return;
+      }
+      if (c->OutputBytes() > kMaxBacklog) {
+        m->dropped += lines;
+        return;
+      }
+      if (m->dropped > 0) {
+        auto notice = "+dropped " + std::to_string(m->dropped) + " commands, monitor is too slow\r\n";
+        c->SendPacket(notice);
+        m->dropped = 0;
+      }
+      c->SendPacket(msg->data(), msg->size());
+    });
+    ++it;
+  }
+  monitorsNum_.store(static_cast<int>(monitors_.size()), std::memory_order_relaxed);
+}
+
+void PMonitor::run() {
+  std::string out;
+  while (true) {
+    bool idle = false;
+    {
+      std::lock_guard guard(mutex_);
+      if (stop_) {
+        break;
+      }
+      idle = monitors_.empty();
+    }
+
+    out.clear();
+    auto lines = drain(out);
+    if (idle) {
+      // the last monitor left, what was drained is discarded
+      std::unique_lock lock(mutex_);
+      cond_.wait(lock, [this]() { return stop_ || !monitors_.empty(); });
+      continue;
+    }
+    if (lines == 0 && out.empty()) {
+      // nothing to send, poll again soon, feeders never wake this thread
+      std::unique_lock lock(mutex_);
+      cond_.wait_for(lock, std::chrono::milliseconds(1), [this]() { return stop_; });
+      continue;
+    }
+    send(std::make_shared<const std::string>(out), lines);
+  }
+}
+
+}  // namespace pikiwidb
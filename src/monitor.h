@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pikiwidb {
+
+class PClient;
+
+/**
+ * @brief MONITOR fan-out
+ * While nobody monitors, the cost for a command is one relaxed atomic load.
+ * Otherwise the executing thread copies the arguments into its own bounded
+ * single-producer ring and goes on, a fan-out thread drains the rings, formats
+ * the lines once and hands the same buffer to every monitor's loop.
+ * A monitor with more than kMaxBacklog bytes unsent skips lines until it catches
+ * up and is then told how many it missed; a full ring drops lines the same way.
+ */
+class PMonitor {
+ public:
+  static PMonitor& Instance();
+
+  PMonitor(const PMonitor&) = delete;
+  void operator=(const PMonitor&) = delete;
+
+  bool Active() const { return monitorsNum_.load(std::memory_order_relaxed) > 0; }
+
+  void AddMonitor(const std::shared_ptr<PClient>& client);
+
+  // called by the thread executing the command
+  void Feed(int db, const std::string& ip, int port, const std::vector<std::string>& params);
+
+ private:
+  PMonitor() = default;
+  ~PMonitor();
+
+  static constexpr size_t kRingSize = 4096;  // power of 2
+  static constexpr size_t kMaxBacklog = 16 * 1024 * 1024;
+
+  struct Record {
+    int64_t timeUs = 0;
+    int db = 0;
+    std::string ip;
+    int port = 0;
+    std::vector<std::string> args;
+    size_t argc = 0;  // args is reused, only the first argc are valid
+  };
+
+  struct Ring {
+    std::vector<Record> slots = std::vector<Record>(kRingSize);
+    alignas(64) std::atomic<size_t> head{0};  // advanced by the fan-out thread
+    alignas(64) std::atomic<size_t> tail{0};  // advanced by the owner thread
+  };
+
+  struct Monitor {
+    std::weak_ptr<PClient> client;
+    uint64_t dropped = 0;  // only touched in the monitor's loop
+  };
+
+  Ring* local();
+  void run();
+  // format all pending records into out, return the number of lines
+  size_t drain(std::string& out);
+  void send(std::shared_ptr<const std::string> msg, size_t lines);
+
+  std::atomic<int> monitorsNum_{0};
+  std::atomic<uint64_t> ringDropped_{0};
+  uint64_t ringDroppedReported_ = 0;
+
+  std::mutex mutex_;  // guards the members below, never taken by Feed once its ring is registered
+  std::condition_variable cond_;
+  std::vector<std::shared_ptr<Monitor>> monitors_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+  std::thread thread_;
+  bool stop_ = false;
+};
+
+}  // namespace pikiwidb
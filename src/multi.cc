@@ -6,9 +6,8 @@
  */
 
 #include "multi.h"
-#include "client.h"
-#include "log.h"
-#include "store.h"
+
+#include <functional>
 
 namespace pikiwidb {
 
@@ -17,147 +16,17 @@ PMulti& PMulti::Instance() {
   return mt;
 }
 
-void PMulti::Watch(PClient* client, int dbno, const PString& key) {
-  if (client->Watch(dbno, key)) {
-    Clients& cls = clients_[dbno][key];
-    cls.push_back(std::static_pointer_cast<PClient>(client->shared_from_this()));
-  }
-}
-
-bool PMulti::Multi(PClient* client) {
-  if (client->IsFlagOn(kClientFlagMulti)) {
-    return false;
-  }
-
-  client->ClearMulti();
-  client->SetFlag(kClientFlagMulti);
-  return true;
-}
-
-bool PMulti::Exec(PClient* client) { return client->Exec(); }
-
-void PMulti::Discard(PClient* client) {
-  client->ClearMulti();
-  client->ClearWatch();
-}
-
-void PMulti::NotifyDirty(int dbno, const PString& key) {
-  auto tmpDBIter = clients_.find(dbno);
-  if (tmpDBIter == clients_.end()) {
-    return;
-  }
-
-  auto& dbWatchedKeys = tmpDBIter->second;
-  auto it = dbWatchedKeys.find(key);
-  if (it == dbWatchedKeys.end()) {
-    return;
-  }
-
-  Clients& cls = it->second;
-  for (auto itCli(cls.begin()); itCli != cls.end();) {
-    auto client(itCli->lock());
-    if (!client) {
-      WARN("Erase not exist client when notify dirty key[{}]", key);
-      itCli = cls.erase(itCli);
-    } else {
-      if (client.get() != PClient::Current() && client->NotifyDirty(dbno, key)) {
-        WARN("Erase dirty client {} when notify dirty key[{}]", client->GetName(), key);
-        itCli = cls.erase(itCli);
-        itCli = cls.erase(itCli);
-      } else {
-        ++itCli;
-      }
-    }
-  }
-
-  if (cls.empty()) {
-    dbWatchedKeys.erase(it);
-  }
-}
+PMulti::PMulti() : slots_(std::make_unique<std::atomic<uint64_t>[]>(kSlots)) {}
 
-void PMulti::NotifyDirtyAll(int dbno) {
-  if (dbno == -1) {
-    for (auto& db_set : clients_) {
-      for (auto& key_clients : db_set.second) {
-        std::for_each(key_clients.second.begin(), key_clients.second.end(), [&](const std::weak_ptr<PClient>& wcli) {
-          auto scli = wcli.lock();
-          if (scli) {
-            scli->SetFlag(kClientFlagDirty);
-          }
-        });
-      }
-    }
-  } else {
-    auto it = clients_.find(dbno);
-    if (it != clients_.end()) {
-      for (auto& key_clients : it->second) {
-        std::for_each(key_clients.second.begin(), key_clients.second.end(), [&](const std::weak_ptr<PClient>& wcli) {
-          auto scli = wcli.lock();
-          if (scli) {
-            scli->SetFlag(kClientFlagDirty);
-          }
-        });
-      }
-    }
-  }
+size_t PMulti::slotOf(int dbno, std::string_view key) {
+  auto h = std::hash<std::string_view>{}(key) ^ (static_cast<size_t>(dbno) * 0x9E3779B97F4A7C15ULL);
+  return (h ^ (h >> 29)) & (kSlots - 1);
 }
 
-// multi commands
-PError watch(const std::vector<PString>& params, UnboundedBuffer* reply) {
-  PClient* client = PClient::Current();
-  if (client->IsFlagOn(kClientFlagMulti)) {
-    ReplyError(kPErrorWatch, reply);
-    return kPErrorWatch;
-  }
-
-  std::for_each(++params.begin(), params.end(),
-                [client](const PString& s) { PMulti::Instance().Watch(client, client->GetCurrentDB(), s); });
-
-  FormatOK(reply);
-  return kPErrorOK;
-}
-
-PError unwatch(const std::vector<PString>& params, UnboundedBuffer* reply) {
-  PClient* client = PClient::Current();
-  client->ClearWatch();
-  FormatOK(reply);
-  return kPErrorOK;
-}
-
-PError multi(const std::vector<PString>& params, UnboundedBuffer* reply) {
-  PClient* client = PClient::Current();
-  if (PMulti::Instance().Multi(client)) {
-    FormatOK(reply);
-  } else {
-    reply->PushData("-ERR MULTI calls can not be nested\r\n");
-  }
-
-  return kPErrorOK;
-}
-
-PError exec(const std::vector<PString>& params, UnboundedBuffer* reply) {
-  PClient* client = PClient::Current();
-  if (!client->IsFlagOn(kClientFlagMulti)) {
-    ReplyError(kPErrorNoMulti, reply);
-    return kPErrorNoMulti;
-  }
-  if (!PMulti::Instance().Exec(client)) {
-    ReplyError(kPErrorDirtyExec, reply);
-    return kPErrorDirtyExec;
-  }
-  return kPErrorOK;
-}
-
-PError discard(const std::vector<PString>& params, UnboundedBuffer* reply) {
-  PClient* client = PClient::Current();
-  if (!client->IsFlagOn(kClientFlagMulti)) {
-    reply->PushData("-ERR DISCARD without MULTI\r\n");
-  } else {
-    PMulti::Instance().Discard(client);
-    FormatOK(reply);
-  }
-
-  return kPErrorOK;
+uint64_t PMulti::Watch(int dbno, std::string_view key) {
+  // counted before reading, a write which missed the count ran concurrently with this WATCH
+  watchers_.fetch_add(1, std::memory_order_seq_cst);
+  return Version(dbno, key);
 }
 
 }  // namespace pikiwidb
@@ -7,16 +7,21 @@
 
 #pragma once
 
-#include <map>
+#include <atomic>
+#include <cstdint>
 #include <memory>
-#include <string>
-#include <vector>
-
-#include "common.h"
+#include <string_view>
 
 namespace pikiwidb {
 
-class PClient;
+/**
+ * @brief Versions of the watched keys
+ * A fixed table of modification counters indexed by the hash of (db, key). A write
+ * bumps the counter of its key, WATCH remembers the counter and EXEC fails if it moved.
+ * Keys sharing a counter only cause a spurious EXEC failure, never a missed one.
+ * Writes are one atomic add and never look at who watches; while no client watches at
+ * all they skip even that, which costs them a fence.
+ */
 class PMulti {
  public:
   static PMulti& Instance();
@@ -24,21 +29,39 @@ class PMulti {
   PMulti(const PMulti&) = delete;
   void operator=(const PMulti&) = delete;
 
-  void Watch(PClient* client, int dbno, const PString& key);
-  bool Multi(PClient* client);
-  bool Exec(PClient* client);
-  void Discard(PClient* client);
+  // whether a write has to bump its keys, called once the write is done or about to start. The fence orders the
+  // write before the load, as Watch orders its count before reading, so at least one of them sees the other: either
+  // the write bumps, or the WATCH reads the version and the value after it
+  bool Active() const {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return watchers_.load(std::memory_order_seq_cst) > 0;
+  }
+
+  // returns the current version of the key
+  uint64_t Watch(int dbno, std::string_view key);
+  // a client drops n watched keys
+  void Unwatch(int64_t n) { watchers_.fetch_sub(n, std::memory_order_relaxed); }
+  uint64_t Version(int dbno, std::string_view key) const {
+    return slots_[slotOf(dbno, key)].load(std::memory_order_acquire) + epoch_.load(std::memory_order_acquire);
+  }
+
+  void NotifyDirty(int dbno, std::string_view key) {
+    slots_[slotOf(dbno, key)].fetch_add(1, std::memory_order_acq_rel);
+  }
+  // every watched key of dbno, or of all DBs for -1; it is rare, so it changes all of them
+  void NotifyDirtyAll(int dbno) { epoch_.fetch_add(1, std::memory_order_acq_rel); }
 
-  void NotifyDirty(int dbno, const PString& key);
-  void NotifyDirtyAll(int dbno);
+  static constexpr size_t kSlots = 1 << 16;  // power of 2
 
  private:
-  PMulti() {}
+  PMulti();
 
-  using Clients = std::vector<std::weak_ptr<PClient> >;
-  using WatchedClients = std::map<int, std::map<PString, Clients> >;
+  static size_t slotOf(int dbno, std::string_view key);
 
-  WatchedClients clients_;
+  std::atomic<int64_t> watchers_{0};
+  // a counter and the epoch only grow, so their sum changes when either does
+  std::atomic<uint64_t> epoch_{0};
+  std::unique_ptr<std::atomic<uint64_t>[]> slots_;
 };
 
 }  // namespace pikiwidb
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+// Throughput of cross-thread EventLoop::Execute, tasks/s with 1 to 64 producer threads.
+// The bare task queue is measured too, against the mutex + vector queue it replaced.
+//
+// usage: execute_bench [total tasks]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "event_loop.h"
+#include "log.h"
+#include "mpsc_queue.h"
+
+using namespace pikiwidb;
+
+static const int kProducers[] = {1, 2, 4, 8, 16, 32, 64};
+
+// the queue EventLoop used before
+class LockedQueue {
+ public:
+  void Push(std::function<void()> f) {
+    std::unique_lock<std::mutex> guard(mutex_);
+    tasks_.push_back(std::move(f));
+  }
+
+  size_t Drain() {
+    std::vector<std::function<void()>> funcs;
+    {
+      std::unique_lock<std::mutex> guard(mutex_);
+      funcs.swap(tasks_);
+    }
+    for (const auto& f : funcs) {
+      f();
+    }
+    return funcs.size();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::function<void()>> tasks_;
+};
+
+class LockFreeQueue {
+ public:
+  void Push(std::function<void()> f) { tasks_.Push(std::move(f)); }
+
+  size_t Drain() {
+    size_t n = 0;
+    std::function<void()> f;
+    while (tasks_.TryPop(f)) {
+      f();
+      ++n;
+    }
+    return n;
+  }
+
+ private:
+  pstd::MPSCQueue<std::function<void()>> tasks_;
+};
+
+template <typename Queue>
+static double BenchQueue(int producers, int total) {
+  Queue queue;
+  const int per_producer = total / producers;
+  const size_t expected = static_cast<size_t>(per_producer) * producers;
+  uint64_t sum = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&queue, &sum, per_producer]() {
+      for (int i = 0; i < per_producer; ++i) {
+        queue.Push([&sum]() { ++sum; });
+      }
+    });
+  }
+
+  size_t done = 0;
+  while (done < expected) {
+    done += queue.Drain();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  for (auto& t : threads) {
+    t.join();
+  }
+  return static_cast<double>(expected) / elapsed;
+}
+
+static double BenchExecute(EventLoop* loop, int producers, int total) {
+  const int per_producer = total / producers;
+  const uint64_t expected = static_cast<uint64_t>(per_producer) * producers;
+  std::atomic<uint64_t> executed{0};
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([loop, &executed, per_producer]() {
+      for (int i = 0; i < per_producer; ++i) {
+        loop->Execute([&executed]() { executed.fetch_add(1, std::memory_order_relaxed); });
+      }
+    });
+  }
+
+  while (executed.load(std::memory_order_relaxed) < expected) {
+    std::this_thread::yield();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  for (auto& t : threads) {
+    t.join();
+  }
+  return static_cast<double>(expected) / elapsed;
+}
+
+int main(int ac, char* av[]) {
+  logger::Init("logs/execute_bench.log");
+
+  const int total = ac > 1 ? std::max(64, atoi(av[1])) : 2000000;
+
+  EventLoop loop;
+  std::atomic<bool> ready{false};
+  std::thread loop_thread([&loop, &ready]() {
+    loop.Init();
+    ready = true;
+    loop.Run();
+  });
+  while (!ready) {
+    std::this_thread::yield();
+  }
+
+  printf("%9s %16s %16s %16s\n", "producers", "mutex queue/s", "mpsc queue/s", "Execute/s");
+  for (auto producers : kProducers) {
+    auto locked = BenchQueue<LockedQueue>(producers, total);
+    auto lock_free = BenchQueue<LockFreeQueue>(producers, total);
+    auto execute = BenchExecute(&loop, producers, total);
+    printf("%9d %16.0f %16.0f %16.0f\n", producers, locked, lock_free, execute);
+  }
+
+  loop.Stop();
+  loop_thread.join();
+  return 0;
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+// Side-by-side benchmark of the reactor backends.
+// A PING/PONG server is built on EventLoop/TcpConnection exactly like pikiwidb does,
+// clients are raw epoll threads keeping a fixed number of requests in flight per connection.
+//
+// usage: reactor_bench [libevent|io_uring|both] [connections] [pipeline] [seconds] [server threads]
+
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_loop.h"
+#include "log.h"
+
+using namespace pikiwidb;
+
+static const char kPing[] = "PING\r\n";
+static const char kPong[] = "+PONG\r\n";
+static constexpr size_t kPingLen = sizeof kPing - 1;
+static constexpr size_t kPongLen = sizeof kPong - 1;
+static constexpr int kClientThreads = 4;
+
+struct Options {
+  int connections = 256;
+  int pipeline = 1;
+  int seconds = 5;
+  int server_threads = 2;
+  int port = 16379;
+};
+
+static double ThreadCpuSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+// reply a PONG for each complete PING, like the command handler does per request
+static int OnMessage(TcpConnection* conn, const char* data, int len) {
+  int n = len / static_cast<int>(kPingLen);
+  if (n == 0) {
+    return 0;
+  }
+
+  for (int i = 0; i < n; ++i) {
+    conn->SendPacket(kPong, kPongLen);
+  }
+  return n * static_cast<int>(kPingLen);
+}
+
+class Server {
+ public:
+  explicit Server(const Options& opt) : opt_(opt), workers_(opt.server_threads) {}
+
+  bool Start() {
+    std::atomic<int> ready{0};
+    for (int i = 0; i < opt_.server_threads; ++i) {
+      threads_.emplace_back([this, i, &ready]() {
+        workers_[i].Init();
+        ++ready;
+        workers_[i].Run();
+        cpu_.fetch_add(static_cast<int64_t>(ThreadCpuSeconds() * 1e6));
+      });
+    }
+    while (ready.load() < opt_.server_threads) {
+      std::this_thread::yield();
+    }
+
+    std::atomic<int> listening{0};
+    threads_.emplace_back([this, &listening]() {
+      base_.Init();
+      auto on_new_conn = [](TcpConnection* conn) {
+        conn->SetNodelay(true);
+        conn->SetMessageCallback(&OnMessage);
+      };
+      auto selector = [this]() { return &workers_[next_++ % workers_.size()]; };
+      if (!base_.Listen("127.0.0.1", opt_.port, on_new_conn, selector)) {
+        listening = -1;
+        return;
+      }
+      listening = 1;
+      base_.Run();
+      cpu_.fetch_add(static_cast<int64_t>(ThreadCpuSeconds() * 1e6));
+    });
+    while (listening.load() == 0) {
+      std::this_thread::yield();
+    }
+    return listening.load() == 1;
+  }
+
+  // return cpu seconds used by the server threads
+  double Stop() {
+    base_.Stop();
+    for (auto& w : workers_) {
+      w.Stop();
+    }
+    for (auto& t : threads_) {
+      t.join();
+    }
+    return static_cast<double>(cpu_.load()) / 1e6;
+  }
+
+ private:
+  const Options opt_;
+  EventLoop base_;
+  std::vector<EventLoop> workers_;
+  std::vector<std::thread> threads_;
+  size_t next_ = 0;
+  std::atomic<int64_t> cpu_{0};
+};
+
+// closed loop load: every connection keeps opt.pipeline requests in flight
+static uint64_t RunClient(const Options& opt, int conns, std::atomic<int>& ready, const std::atomic<bool>& stop) {
+  int epfd = epoll_create1(0);
+  std::vector<int> fds;
+  std::vector<size_t> partial(conns, 0);
+  const std::string batch = [&opt]() {
+    std::string s;
+    for (int i = 0; i < opt.pipeline; ++i) {
+      s.append(kPing, kPingLen);
+    }
+    return s;
+  }();
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(static_cast<uint16_t>(opt.port));
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  for (int i = 0; i < conns; ++i) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) {
+      perror("connect");
+      exit(1);
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u32 = static_cast<uint32_t>(i);
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    fds.push_back(fd);
+  }
+
+  // start together, connection setup is not measured
+  ++ready;
+  while (ready.load() < kClientThreads) {
+    std::this_thread::yield();
+  }
+  for (auto fd : fds) {
+    if (write(fd, batch.data(), batch.size()) != static_cast<ssize_t>(batch.size())) {
+      perror("write");
+      exit(1);
+    }
+  }
+
+  uint64_t replies = 0;
+  char buf[64 * 1024];
+  std::vector<struct epoll_event> events(conns);
+  while (!stop.load(std::memory_order_relaxed)) {
+    int n = epoll_wait(epfd, events.data(), conns, 100);
+    for (int i = 0; i < n; ++i) {
+      auto idx = events[i].data.u32;
+      ssize_t bytes = read(fds[idx], buf, sizeof buf);
+      if (bytes <= 0) {
+        fprintf(stderr, "connection lost\n");
+        exit(1);
+      }
+
+      size_t total = partial[idx] + static_cast<size_t>(bytes);
+      size_t done = total / kPongLen;
+      partial[idx] = total % kPongLen;
+      replies += done;
+
+      std::string more;
+      for (size_t k = 0; k < done; ++k) {
+        more.append(kPing, kPingLen);
+      }
+      if (!more.empty() && write(fds[idx], more.data(), more.size()) != static_cast<ssize_t>(more.size())) {
+        perror("write");
+        exit(1);
+      }
+    }
+  }
+
+  for (auto fd : fds) {
+    close(fd);
+  }
+  close(epfd);
+  return replies;
+}
+
+static void RunOne(const char* name, ReactorType type, const Options& opt) {
+  if (EventLoop::SetReactorType(type) != type) {
+    printf("%-9s unavailable\n", name);
+    return;
+  }
+
+  Server server(opt);
+  if (!server.Start()) {
+    printf("%-9s listen on port %d failed\n", name, opt.port);
+    return;
+  }
+
+  std::atomic<int> ready{0};
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> replies{0};
+  std::vector<std::thread> clients;
+  for (int i = 0; i < kClientThreads; ++i) {
+    int conns = opt.connections / kClientThreads + (i < opt.connections % kClientThreads ? 1 : 0);
+    clients.emplace_back([&, conns]() { replies += RunClient(opt, conns, ready, stop); });
+  }
+  while (ready.load() < kClientThreads) {
+    std::this_thread::yield();
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::seconds(opt.seconds));
+  stop = true;
+  for (auto& t : clients) {
+    t.join();
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double cpu = server.Stop();
+
+  auto total = static_cast<double>(replies.load());
+  printf("%-9s conns %d pipeline %d: %.0f req/s, server cpu %.2f us/req\n", name, opt.connections, opt.pipeline,
+         total / elapsed, cpu * 1e6 / total);
+}
+
+int main(int ac, char* av[]) {
+  logger::Init("logs/reactor_bench.log");
+  spdlog::set_level(spdlog::level::warn);  // no log per connection
+
+  std::string backend = ac > 1 ? av[1] : "both";
+  Options opt;
+  if (ac > 2) {
+    opt.connections = std::max(1, atoi(av[2]));
+  }
+  if (ac > 3) {
+    opt.pipeline = std::max(1, atoi(av[3]));
+  }
+  if (ac > 4) {
+    opt.seconds = std::max(1, atoi(av[4]));
+  }
+  if (ac > 5) {
+    opt.server_threads = std::max(1, atoi(av[5]));
+  }
+
+  if (backend == "libevent" || backend == "both") {
+    RunOne("libevent", ReactorType::kLibevent, opt);
+  }
+  if (backend == "io_uring" || backend == "both") {
+    ++opt.port;  // the previous listener may linger in TIME_WAIT
+    RunOne("io_uring", ReactorType::kIoUring, opt);
+  }
+
+  return 0;
+}
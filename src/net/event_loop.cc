@@ -12,6 +12,7 @@
 #endif
 #include <unistd.h>
 
+#include "io_uring_reactor.h"
 #include "libevent_reactor.h"
 #include "log.h"
 #include "util.h"
@@ -22,6 +23,29 @@ static thread_local EventLoop* g_this_loop = nullptr;
 
 std::atomic<int> EventLoop::obj_id_generator_{0};
 std::atomic<TimerId> EventLoop::timerid_generator_{0};
+ReactorType EventLoop::reactor_type_ = ReactorType::kLibevent;
+
+static std::unique_ptr<Reactor> CreateReactor(ReactorType type) {
+  if (type == ReactorType::kIoUring) {
+    if (auto reactor = internal::IoUringReactor::Create(); reactor) {
+      return reactor;
+    }
+    ERROR("create io_uring reactor failed, use libevent");
+  }
+
+  return std::make_unique<internal::LibeventReactor>();
+}
+
+ReactorType EventLoop::SetReactorType(ReactorType type) {
+  // probe once, so that all loops share one backend
+  if (type == ReactorType::kIoUring && !internal::IoUringReactor::Create()) {
+    WARN("io_uring is not available, use libevent instead");
+    type = ReactorType::kLibevent;
+  }
+
+  reactor_type_ = type;
+  return type;
+}
 
 void EventLoop::Init() {
   if (g_this_loop) {
@@ -30,7 +54,7 @@ void EventLoop::Init() {
   }
   g_this_loop = this;
 
-  reactor_.reset(new internal::LibeventReactor());
+  reactor_ = CreateReactor(reactor_type_);
   notifier_ = std::make_shared<internal::PipeObject>();
 }
 
@@ -43,15 +67,7 @@ void EventLoop::Run() {
 
   Register(notifier_, kEventRead);
   while (running_) {
-    if (task_mutex_.try_lock()) {
-      decltype(tasks_) funcs;
-      funcs.swap(tasks_);
-      task_mutex_.unlock();
-
-      for (const auto& f : funcs) {
-        f();
-      }
-    }
+    RunTasks();
 
     if (!reactor_->Poll()) {
       ERROR("Reactor poll failed");
@@ -71,6 +87,22 @@ void EventLoop::Stop() {
   notifier_->Notify();
 }
 
+void EventLoop::Wakeup() {
+  // the push is visible to the loop once it has reset notified_
+  if (!notified_.exchange(true, std::memory_order_acq_rel)) {
+    notifier_->Notify();
+  }
+}
+
+void EventLoop::RunTasks() {
+  notified_.exchange(false, std::memory_order_acq_rel);
+
+  std::function<void()> f;
+  while (tasks_.TryPop(f)) {
+    f();
+  }
+}
+
 std::future<bool> EventLoop::Cancel(TimerId id) {
   if (InThisLoop()) {
     bool ok = reactor_ ? reactor_->Cancel(id) : false;
@@ -85,7 +117,7 @@ std::future<bool> EventLoop::Cancel(TimerId id) {
         return false;
       }
       bool ok = reactor_->Cancel(id);
-      INFO("cancell timer {} {}", id, ok ? "succ" : "fail");
+      DEBUG("cancel timer {} {}", id, ok ? "succ" : "fail");
       return ok;
     });
     return fut;
@@ -158,10 +190,12 @@ void EventLoop::Unregister(std::shared_ptr<EventObject> obj) {
   objects_.erase(id);
 }
 
-bool EventLoop::Listen(const char* ip, int port, NewTcpConnectionCallback ccb, EventLoopSelector selector) {
+bool EventLoop::Listen(const char* ip, int port, NewTcpConnectionCallback ccb, EventLoopSelector selector,
+                       bool reuse_port) {
   auto s = std::make_shared<TcpListener>(this);
   s->SetNewConnCallback(ccb);
   s->SetEventLoopSelector(selector);
+  s->SetReusePort(reuse_port);
 
   return s->Bind(ip, port);
 }
@@ -211,11 +245,13 @@ void EventLoop::Reset() {
   objects_.clear();
 
   {
-    std::unique_lock<std::mutex> guard(task_mutex_);
-    tasks_.clear();
+    std::function<void()> f;
+    while (tasks_.TryPop(f)) {
+    }
+    notified_ = false;
   }
 
-  reactor_.reset(new internal::LibeventReactor());
+  reactor_ = CreateReactor(reactor_type_);
   notifier_ = std::make_shared<internal::PipeObject>();
 }
 
@@ -4,7 +4,6 @@
 #include <functional>
 #include <future>
 #include <memory>
-#include <mutex>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
@@ -13,6 +12,7 @@
 #include "http_client.h"
 #include "http_server.h"
 #include "pipe_obj.h"
+#include "mpsc_queue.h"
 #include "reactor.h"
 #include "tcp_connection.h"
 #include "tcp_listener.h"
@@ -39,6 +39,12 @@ class EventLoop {
   template <typename F, typename... Args>
   auto Execute(F&&, Args&&...) -> std::future<typename std::invoke_result<F, Args...>::type>;
 
+  // Queue func to run in loop thread, never inline even in the loop thread, it's thread-safe
+  void Post(std::function<void()> f) {
+    tasks_.Push(std::move(f));
+    Wakeup();
+  }
+
   // Exec func every some time, it's thread-safe
   template <typename Duration, typename F, typename... Args>
   TimerId ScheduleRepeatedly(const Duration& period, F&& f, Args&&... args);
@@ -60,8 +66,9 @@ class EventLoop {
   // the backend reactor
   Reactor* GetReactor() const { return reactor_.get(); }
 
-  // TCP server
-  bool Listen(const char* ip, int port, NewTcpConnectionCallback ccb, EventLoopSelector selector);
+  // TCP server, with reuse_port several loops can listen on the same address
+  bool Listen(const char* ip, int port, NewTcpConnectionCallback ccb, EventLoopSelector selector,
+              bool reuse_port = false);
 
   // TCP client
   std::shared_ptr<TcpConnection> Connect(const char* ip, int port, NewTcpConnectionCallback ccb,
@@ -81,28 +88,44 @@ class EventLoop {
   void SetName(std::string name) { name_ = std::move(name); }
   const std::string& GetName() const { return name_; }
 
+  // connections accepted by the listeners of this loop
+  void AddAcceptCount() { accept_count_.fetch_add(1, std::memory_order_relaxed); }
+  uint64_t GetAcceptCount() const { return accept_count_.load(std::memory_order_relaxed); }
+
   static EventLoop* Self();
 
+  // backend of the loops initialized from now on, all loops must use the same one.
+  // Falls back to libevent if io_uring is unavailable, returns the type in effect.
+  static ReactorType SetReactorType(ReactorType type);
+  static ReactorType GetReactorType() { return reactor_type_; }
+
   // for unittest only
   void Reset();
 
   std::shared_ptr<EventObject> GetEventObject(int id) const;
 
  private:
+  // wake up the loop for new tasks, at most one notification is pending
+  void Wakeup();
+  void RunTasks();
+
   std::unique_ptr<Reactor> reactor_;
 
   std::unordered_map<int, std::shared_ptr<EventObject>> objects_;
 
   std::shared_ptr<internal::PipeObject> notifier_;
 
-  std::mutex task_mutex_;
-  std::vector<std::function<void()>> tasks_;
+  // tasks from other threads
+  pstd::MPSCQueue<std::function<void()>> tasks_;
+  std::atomic<bool> notified_{false};
 
   std::string name_;  // for top command
   std::atomic<bool> running_{true};
+  std::atomic<uint64_t> accept_count_{0};
 
   static std::atomic<int> obj_id_generator_;
   static std::atomic<TimerId> timerid_generator_;
+  static ReactorType reactor_type_;
 };
 
 template <typename F, typename... Args>
@@ -116,9 +139,8 @@ auto EventLoop::Execute(F&& f, Args&&... args) -> std::future<typename std::invo
   if (InThisLoop()) {
     (*task)();
   } else {
-    std::unique_lock<std::mutex> guard(task_mutex_);
-    tasks_.emplace_back([task]() { (*task)(); });
-    notifier_->Notify();
+    tasks_.Push([task]() { (*task)(); });
+    Wakeup();
   }
 
   return fut;
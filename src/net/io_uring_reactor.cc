@@ -0,0 +1,749 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "io_uring_reactor.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#  define PIKIWIDB_HAVE_IO_URING 1
+#endif
+
+#ifdef PIKIWIDB_HAVE_IO_URING
+
+#  include <linux/io_uring.h>
+#  include <poll.h>
+#  include <signal.h>
+#  include <sys/mman.h>
+#  include <sys/socket.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+
+#  include <atomic>
+#  include <cassert>
+#  include <cerrno>
+#  include <chrono>
+#  include <cstring>
+
+#  include "event_obj.h"
+#  include "log.h"
+
+namespace pikiwidb {
+namespace internal {
+
+static constexpr unsigned kRingEntries = 1024;
+static constexpr uint16_t kRecvBufferGroup = 0;
+static constexpr unsigned kRecvBufferCount = 128;  // power of 2
+static constexpr unsigned kRecvBufferSize = 16 * 1024;
+// to wakeup loop atmost every 10 ms, as LibeventReactor
+static constexpr int kMaxWaitMs = 10;
+
+static inline uint64_t MakeUserData(uint64_t id, uint8_t op) { return (id << 8) | op; }
+static inline uint64_t UserDataId(uint64_t user_data) { return user_data >> 8; }
+static inline uint8_t UserDataOp(uint64_t user_data) { return static_cast<uint8_t>(user_data & 0xff); }
+
+static int64_t NowMs() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename T>
+static inline T LoadAcquire(const T* p) {
+  return std::atomic_ref<const T>(*p).load(std::memory_order_acquire);
+}
+
+template <typename T>
+static inline void StoreRelease(T* p, T v) {
+  std::atomic_ref<T>(*p).store(v, std::memory_order_release);
+}
+
+std::unique_ptr<IoUringReactor> IoUringReactor::Create() {
+  std::unique_ptr<IoUringReactor> reactor(new IoUringReactor());
+  if (!reactor->setup()) {
+    return nullptr;
+  }
+  return reactor;
+}
+
+bool IoUringReactor::setup() {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof params);
+  params.flags = IORING_SETUP_CLAMP;
+
+  ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, kRingEntries, &params));
+  if (ring_fd_ < 0) {
+    WARN("io_uring_setup failed, errno {}", errno);
+    return false;
+  }
+
+  const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+  if ((params.features & required) != required) {
+    WARN("io_uring lacks required features {:x}, has {:x}", required, params.features);
+    return false;
+  }
+
+  sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+  sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ptr_ == MAP_FAILED) {
+    sq_ptr_ = nullptr;
+    return false;
+  }
+  cq_ptr_ = sq_ptr_;
+
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  auto sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = reinterpret_cast<struct io_uring_sqe*>(sqes);
+
+  auto sq = reinterpret_cast<char*>(sq_ptr_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  sq_entries_ = params.sq_entries;
+  sqe_tail_ = *sq_tail_;
+
+  auto cq = reinterpret_cast<char*>(cq_ptr_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+  // register the recv buffers as a provided buffer ring
+  buf_ring_size_ = kRecvBufferCount * sizeof(struct io_uring_buf);
+  auto ring = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (ring == MAP_FAILED) {
+    return false;
+  }
+  buf_ring_ = reinterpret_cast<struct io_uring_buf_ring*>(ring);
+
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof reg);
+  reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+  reg.ring_entries = kRecvBufferCount;
+  reg.bgid = kRecvBufferGroup;
+  if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    WARN("io_uring register buffer ring failed, errno {}", errno);
+    return false;
+  }
+
+  buf_base_ = new char[static_cast<size_t>(kRecvBufferCount) * kRecvBufferSize];
+  for (unsigned i = 0; i < kRecvBufferCount; ++i) {
+    recycleBuffer(static_cast<uint16_t>(i));
+  }
+
+  return true;
+}
+
+IoUringReactor::~IoUringReactor() {
+  for (auto& [id, s] : sockets_) {
+    if (s.fd >= 0 && !s.on_detached) {
+      close(s.fd);
+    }
+  }
+
+  if (sqes_) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (sq_ptr_) {
+    munmap(sq_ptr_, sq_size_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+  if (buf_ring_) {
+    munmap(buf_ring_, buf_ring_size_);
+  }
+  delete[] buf_base_;
+}
+
+struct io_uring_sqe* IoUringReactor::getSqe() {
+  if (sqe_tail_ - LoadAcquire(sq_head_) >= sq_entries_) {
+    // full, hand the queued requests to the kernel first
+    submitAndWait(0, 0);
+    if (sqe_tail_ - LoadAcquire(sq_head_) >= sq_entries_) {
+      ERROR("io_uring submission queue is full");
+      return nullptr;
+    }
+  }
+
+  unsigned index = sqe_tail_ & *sq_mask_;
+  struct io_uring_sqe* sqe = &sqes_[index];
+  memset(sqe, 0, sizeof *sqe);
+  sq_array_[index] = index;
+  ++sqe_tail_;
+  return sqe;
+}
+
+int IoUringReactor::submitAndWait(unsigned wait_nr, int timeout_ms) {
+  const unsigned to_submit = sqe_tail_ - *sq_tail_;
+  StoreRelease(sq_tail_, sqe_tail_);
+
+  unsigned flags = 0;
+  struct io_uring_getevents_arg arg;
+  struct __kernel_timespec ts;
+  memset(&arg, 0, sizeof arg);
+  if (wait_nr > 0) {
+    flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000 * 1000;
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+    arg.sigmask_sz = _NSIG / 8;
+  } else if (to_submit == 0) {
+    return 0;
+  }
+
+  int ret;
+  do {
+    ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, wait_nr, flags,
+                                   wait_nr > 0 ? &arg : nullptr, wait_nr > 0 ? sizeof arg : 0));
+  } while (ret < 0 && errno == EINTR);
+
+  if (ret < 0 && errno != ETIME && errno != EBUSY) {
+    ERROR("io_uring_enter failed, errno {}", errno);
+  }
+  return ret;
+}
+
+void IoUringReactor::recycleBuffer(uint16_t bid) {
+  const unsigned mask = kRecvBufferCount - 1;
+  // not &buf_ring_->bufs[i], the flex array of the uapi header is misplaced in C++
+  struct io_uring_buf* buf = reinterpret_cast<struct io_uring_buf*>(buf_ring_) + (buf_tail_ & mask);
+  buf->addr = reinterpret_cast<uint64_t>(buf_base_ + static_cast<size_t>(bid) * kRecvBufferSize);
+  buf->len = kRecvBufferSize;
+  buf->bid = bid;
+  ++buf_tail_;
+  StoreRelease(&buf_ring_->tail, buf_tail_);
+}
+
+bool IoUringReactor::Register(EventObject* obj, int events) {
+  if (!obj) {
+    return false;
+  }
+
+  if (events == 0) {
+    return true;  // evobj can manage events by itself
+  }
+
+  int id = obj->GetUniqueId();
+  assert(id >= 0);
+  if (!objects_.insert({id, obj}).second) {
+    return false;
+  }
+
+  armPoll(obj, events);
+  return true;
+}
+
+void IoUringReactor::Unregister(EventObject* obj) {
+  if (!obj) {
+    return;
+  }
+
+  int id = obj->GetUniqueId();
+  if (objects_.erase(id) == 0) {
+    return;
+  }
+  cancel(MakeUserData(static_cast<uint64_t>(id), kOpPoll));
+}
+
+bool IoUringReactor::Modify(EventObject* obj, int events) {
+  if (!obj || objects_.count(obj->GetUniqueId()) == 0) {
+    return false;
+  }
+
+  cancel(MakeUserData(static_cast<uint64_t>(obj->GetUniqueId()), kOpPoll));
+  if (events != 0) {
+    armPoll(obj, events);
+  }
+  return true;
+}
+
+void IoUringReactor::armPoll(EventObject* obj, int events) {
+  auto sqe = getSqe();
+  if (!sqe) {
+    return;
+  }
+
+  uint32_t mask = 0;
+  if (events & kEventRead) {
+    mask |= POLLIN;
+  }
+  if (events & kEventWrite) {
+    mask |= POLLOUT;
+  }
+
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = obj->Fd();
+  sqe->poll32_events = mask;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->user_data = MakeUserData(static_cast<uint64_t>(obj->GetUniqueId()), kOpPoll);
+}
+
+void IoUringReactor::cancel(uint64_t user_data) {
+  auto sqe = getSqe();
+  if (!sqe) {
+    return;
+  }
+
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = user_data;
+  sqe->user_data = MakeUserData(0, kOpCancel);
+}
+
+uint64_t IoUringReactor::AddSocket(int fd, UringSocketHandler* handler) {
+  auto id = next_socket_id_++;
+  auto& s = sockets_[id];
+  s.fd = fd;
+  s.handler = handler;
+  armRecv(id, s);
+  return id;
+}
+
+uint64_t IoUringReactor::AsyncConnect(int fd, const sockaddr_in& addr, UringSocketHandler* handler) {
+  auto sqe = getSqe();
+  if (!sqe) {
+    return 0;
+  }
+
+  auto id = next_socket_id_++;
+  auto& s = sockets_[id];
+  s.fd = fd;
+  s.handler = handler;
+  s.peer = addr;
+  ++s.inflight;
+
+  sqe->opcode = IORING_OP_CONNECT;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(&s.peer);
+  sqe->off = sizeof(s.peer);
+  sqe->user_data = MakeUserData(id, kOpConnect);
+  return id;
+}
+
+uint64_t IoUringReactor::AddAcceptor(int fd, std::function<void(int)> on_accept) {
+  auto id = next_socket_id_++;
+  auto& s = sockets_[id];
+  s.fd = fd;
+  s.on_accept = std::move(on_accept);
+  armAccept(id, s);
+  return id;
+}
+
+void IoUringReactor::armRecv(uint64_t id, Socket& s) {
+  auto sqe = getSqe();
+  if (!sqe) {
+    return;
+  }
+
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = s.fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kRecvBufferGroup;
+  sqe->user_data = MakeUserData(id, kOpRecv);
+  s.recv_armed = true;
+  ++s.inflight;
+}
+
+void IoUringReactor::armAccept(uint64_t id, Socket& s) {
+  auto sqe = getSqe();
+  if (!sqe) {
+    return;
+  }
+
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = s.fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+  sqe->user_data = MakeUserData(id, kOpAccept);
+  s.recv_armed = true;
+  ++s.inflight;
+}
+
+void IoUringReactor::Send(uint64_t id, const void* data, size_t len) {
+  auto it = sockets_.find(id);
+  if (it == sockets_.end() || it->second.removed || len == 0) {
+    return;
+  }
+
+  auto& s = it->second;
+  if (s.out.empty()) {
+    dirty_.push_back(id);
+  }
+  s.out.append(static_cast<const char*>(data), len);
+}
+
+size_t IoUringReactor::Unsent(uint64_t id) const {
+  auto it = sockets_.find(id);
+  if (it == sockets_.end()) {
+    return 0;
+  }
+  const auto& s = it->second;
+  return s.out.size() + s.sending.size() - s.sent;
+}
+
+void IoUringReactor::flushSends() {
+  for (auto id : dirty_) {
+    auto it = sockets_.find(id);
+    if (it != sockets_.end() && it->second.sending.empty()) {
+      submitSend(id, it->second);
+    }
+  }
+  dirty_.clear();
+}
+
+void IoUringReactor::submitSend(uint64_t id, Socket& s) {
+  if (s.sending.empty()) {
+    if (s.out.empty()) {
+      return;
+    }
+    s.sending.swap(s.out);
+    s.sent = 0;
+  }
+
+  auto sqe = getSqe();
+  if (!sqe) {
+    return;
+  }
+
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = s.fd;
+  sqe->addr = reinterpret_cast<uint64_t>(s.sending.data() + s.sent);
+  sqe->len = static_cast<uint32_t>(std::min<size_t>(s.sending.size() - s.sent, UINT32_MAX));
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = MakeUserData(id, kOpSend);
+  ++s.inflight;
+}
+
+void IoUringReactor::RemoveSocket(uint64_t id) {
+  auto it = sockets_.find(id);
+  if (it == sockets_.end() || it->second.removed) {
+    return;
+  }
+
+  auto& s = it->second;
+  if (s.recv_armed) {
+    cancel(MakeUserData(id, s.on_accept ? kOpAccept : kOpRecv));
+  }
+  s.removed = true;
+  s.handler = nullptr;
+  s.on_accept = nullptr;
+  s.out.clear();
+  tryRelease(id);
+}
+
+void IoUringReactor::DetachSocket(uint64_t id, std::function<void(std::string)> on_detached) {
+  auto it = sockets_.find(id);
+  if (it == sockets_.end() || it->second.removed) {
+    return;
+  }
+
+  auto& s = it->second;
+  s.removed = true;
+  s.handler = nullptr;
+  s.on_detached = std::move(on_detached);
+  if (s.recv_armed) {
+    cancel(MakeUserData(id, kOpRecv));
+  }
+  // queued output is still sent before the socket is handed over
+  if (!s.out.empty() && s.sending.empty()) {
+    submitSend(id, s);
+  }
+  tryRelease(id);
+}
+
+void IoUringReactor::tryRelease(uint64_t id) {
+  auto it = sockets_.find(id);
+  if (it == sockets_.end()) {
+    return;
+  }
+
+  auto& s = it->second;
+  if (!s.removed || s.inflight > 0 || !s.sending.empty() || (s.on_detached && !s.out.empty())) {
+    return;
+  }
+
+  if (s.on_detached) {
+    auto cb = std::move(s.on_detached);
+    auto leftover = std::move(s.leftover);
+    sockets_.erase(it);
+    cb(std::move(leftover));
+  } else {
+    close(s.fd);
+    sockets_.erase(it);
+  }
+}
+
+bool IoUringReactor::Poll() {
+  flushSends();
+
+  int wait_ms = kMaxWaitMs;
+  if (!timer_queue_.empty()) {
+    auto delta = timer_queue_.begin()->first - NowMs();
+    wait_ms = static_cast<int>(std::clamp<int64_t>(delta, 0, kMaxWaitMs));
+  }
+
+  if (submitAndWait(1, wait_ms) < 0 && errno != ETIME && errno != EBUSY && errno != EINTR) {
+    return false;
+  }
+
+  // copy out first, handlers may queue new requests
+  completions_.clear();
+  unsigned head = *cq_head_;
+  const unsigned tail = LoadAcquire(cq_tail_);
+  for (; head != tail; ++head) {
+    completions_.push_back(cqes_[head & *cq_mask_]);
+  }
+  StoreRelease(cq_head_, head);
+
+  for (const auto& cqe : completions_) {
+    handleCqe(cqe.user_data, cqe.res, cqe.flags);
+  }
+
+  for (auto id : rearm_) {
+    auto it = sockets_.find(id);
+    if (it != sockets_.end() && !it->second.removed && !it->second.recv_armed) {
+      armRecv(id, it->second);
+    }
+  }
+  rearm_.clear();
+
+  runTimers();
+  return true;
+}
+
+void IoUringReactor::handleCqe(uint64_t user_data, int32_t res, uint32_t flags) {
+  const uint64_t id = UserDataId(user_data);
+  switch (UserDataOp(user_data)) {
+    case kOpPoll: {
+      auto it = objects_.find(static_cast<int>(id));
+      if (it == objects_.end()) {
+        return;
+      }
+      auto obj = it->second;
+      if (res < 0) {
+        if (res != -ECANCELED) {
+          obj->HandleErrorEvent();
+        }
+        return;
+      }
+      if ((res & (POLLIN | POLLHUP | POLLERR)) && !obj->HandleReadEvent()) {
+        obj->HandleErrorEvent();
+        return;
+      }
+      if ((res & POLLOUT) && objects_.count(static_cast<int>(id)) && !obj->HandleWriteEvent()) {
+        obj->HandleErrorEvent();
+        return;
+      }
+      if (!(flags & IORING_CQE_F_MORE) && objects_.count(static_cast<int>(id))) {
+        armPoll(obj, kEventRead);
+      }
+      return;
+    }
+
+    case kOpAccept: {
+      auto it = sockets_.find(id);
+      if (it == sockets_.end()) {
+        if (res >= 0) {
+          close(res);
+        }
+        return;
+      }
+      if (!(flags & IORING_CQE_F_MORE)) {
+        it->second.recv_armed = false;
+        --it->second.inflight;
+      }
+      if (res >= 0) {
+        if (it->second.on_accept) {
+          it->second.on_accept(res);
+        } else {
+          close(res);
+        }
+      } else if (res != -ECANCELED) {
+        WARN("io_uring accept on fd {} failed, errno {}", it->second.fd, -res);
+      }
+
+      it = sockets_.find(id);
+      if (it == sockets_.end()) {
+        return;
+      }
+      if (!it->second.removed && !it->second.recv_armed) {
+        armAccept(id, it->second);
+      }
+      tryRelease(id);
+      return;
+    }
+
+    case kOpRecv:
+      handleRecv(id, res, flags);
+      return;
+
+    case kOpSend:
+      handleSend(id, res);
+      return;
+
+    case kOpConnect: {
+      auto it = sockets_.find(id);
+      if (it == sockets_.end()) {
+        return;
+      }
+      --it->second.inflight;
+      if (!it->second.removed) {
+        if (res == 0) {
+          armRecv(id, it->second);
+        }
+        if (auto handler = it->second.handler; handler) {
+          handler->OnUringConnect(-res);
+        }
+      }
+      tryRelease(id);
+      return;
+    }
+
+    default:
+      return;
+  }
+}
+
+void IoUringReactor::handleRecv(uint64_t id, int32_t res, uint32_t flags) {
+  const bool has_buffer = flags & IORING_CQE_F_BUFFER;
+  const auto bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+  const char* data = has_buffer ? buf_base_ + static_cast<size_t>(bid) * kRecvBufferSize : nullptr;
+
+  auto it = sockets_.find(id);
+  if (it == sockets_.end()) {
+    if (has_buffer) {
+      recycleBuffer(bid);
+    }
+    return;
+  }
+
+  auto& s = it->second;
+  const bool more = flags & IORING_CQE_F_MORE;
+  if (!more) {
+    s.recv_armed = false;
+    --s.inflight;
+  }
+
+  if (res > 0) {
+    if (s.handler) {
+      s.handler->OnUringRecv(data, static_cast<size_t>(res));
+    } else if (s.on_detached) {
+      s.leftover.append(data, static_cast<size_t>(res));
+    }
+  }
+  if (has_buffer) {
+    recycleBuffer(bid);
+  }
+
+  it = sockets_.find(id);
+  if (it == sockets_.end()) {
+    return;
+  }
+  auto& sock = it->second;
+  if (sock.removed) {
+    tryRelease(id);
+    return;
+  }
+
+  if (res == -ENOBUFS) {
+    // all buffers were in use, try again once they are recycled
+    rearm_.push_back(id);
+  } else if (res == 0 || (res < 0 && res != -ECANCELED)) {
+    if (auto handler = sock.handler; handler) {
+      handler->OnUringClose(res == 0 ? 0 : -res);
+    }
+  } else if (!more) {
+    armRecv(id, sock);
+  }
+}
+
+void IoUringReactor::handleSend(uint64_t id, int32_t res) {
+  auto it = sockets_.find(id);
+  if (it == sockets_.end()) {
+    return;
+  }
+
+  auto& s = it->second;
+  --s.inflight;
+  if (res < 0) {
+    s.sending.clear();
+    s.out.clear();
+    if (!s.removed && s.handler) {
+      s.handler->OnUringClose(-res);
+    }
+    tryRelease(id);
+    return;
+  }
+
+  s.sent += static_cast<size_t>(res);
+  if (s.sent >= s.sending.size()) {
+    s.sending.clear();
+    s.sent = 0;
+  }
+
+  // partial send or data queued while this one was in flight
+  if (!s.sending.empty() || !s.out.empty()) {
+    submitSend(id, s);
+  }
+  tryRelease(id);
+}
+
+void IoUringReactor::ScheduleRepeatedly(TimerId id, int period_ms, std::function<void()> f) {
+  timers_[id] = Timer{id, period_ms, true, std::move(f)};
+  timer_queue_.emplace(NowMs() + period_ms, id);
+}
+
+void IoUringReactor::ScheduleLater(TimerId id, int delay_ms, std::function<void()> f) {
+  timers_[id] = Timer{id, delay_ms, false, std::move(f)};
+  timer_queue_.emplace(NowMs() + delay_ms, id);
+}
+
+bool IoUringReactor::Cancel(TimerId id) {
+  // the queue entry is dropped lazily
+  return timers_.erase(id) > 0;
+}
+
+void IoUringReactor::runTimers() {
+  const auto now = NowMs();
+  while (!timer_queue_.empty() && timer_queue_.begin()->first <= now) {
+    auto id = timer_queue_.begin()->second;
+    timer_queue_.erase(timer_queue_.begin());
+
+    auto it = timers_.find(id);
+    if (it == timers_.end()) {
+      continue;
+    }
+
+    auto callback = it->second.callback;
+    if (it->second.repeat) {
+      timer_queue_.emplace(now + it->second.period_ms, id);
+    } else {
+      timers_.erase(it);
+    }
+    callback();
+  }
+}
+
+}  // namespace internal
+}  // namespace pikiwidb
+
+#else  // PIKIWIDB_HAVE_IO_URING
+
+namespace pikiwidb {
+namespace internal {
+
+std::unique_ptr<IoUringReactor> IoUringReactor::Create() { return nullptr; }
+
+}  // namespace internal
+}  // namespace pikiwidb
+
+#endif  // PIKIWIDB_HAVE_IO_URING
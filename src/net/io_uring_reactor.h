@@ -0,0 +1,173 @@
+#pragma once
+
+#include <netinet/in.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "reactor.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+namespace pikiwidb {
+class EventObject;
+namespace internal {
+
+// Receiver of the socket events driven by IoUringReactor, called in the loop thread.
+class UringSocketHandler {
+ public:
+  virtual ~UringSocketHandler() = default;
+
+  // data received from the socket
+  virtual void OnUringRecv(const char* data, size_t len) = 0;
+  // peer closed (err == 0) or socket error (err is errno), no more recv after this
+  virtual void OnUringClose(int err) = 0;
+  // result of AsyncConnect, err is errno or 0
+  virtual void OnUringConnect(int err) {}
+};
+
+// io_uring Reactor, Linux only.
+// Sockets are not polled for readiness: accept and recv are multishot requests, received
+// data lands in a provided buffer ring (io_uring_buf_ring, not fixed buffers), and all sends queued during one
+// loop iteration are submitted together with the wait for completions, in one syscall.
+class IoUringReactor : public Reactor {
+ public:
+  // nullptr if io_uring or one of the needed features is unavailable
+  static std::unique_ptr<IoUringReactor> Create();
+
+  ~IoUringReactor() override;
+
+  ReactorType Type() const override { return ReactorType::kIoUring; }
+  void* Backend() override { return this; }
+
+  bool Register(EventObject* obj, int events) override;
+  void Unregister(EventObject* obj) override;
+  bool Modify(EventObject* obj, int events) override;
+  bool Poll() override;
+
+  void ScheduleRepeatedly(TimerId id, int period_ms, std::function<void()> f) override;
+  void ScheduleLater(TimerId id, int delay_ms, std::function<void()> f) override;
+  bool Cancel(TimerId id) override;
+
+  // Sockets, return the socket id used by the other calls, 0 on failure.
+  // The reactor owns fd from now on and closes it in RemoveSocket.
+  uint64_t AddSocket(int fd, UringSocketHandler* handler);
+  // like AddSocket, but issue an async connect first, recv starts once connected
+  uint64_t AsyncConnect(int fd, const sockaddr_in& addr, UringSocketHandler* handler);
+  // queue data, it's copied and sent with the next submission
+  void Send(uint64_t id, const void* data, size_t len);
+  // bytes queued by Send and not written to the socket yet
+  size_t Unsent(uint64_t id) const;
+  // stop delivering events to the handler and close fd once the kernel released it
+  void RemoveSocket(uint64_t id);
+  // hand the socket over to another loop: stop recv, finish the queued sends, then call
+  // on_detached in this loop with data received meanwhile, fd is not closed
+  void DetachSocket(uint64_t id, std::function<void(std::string leftover)> on_detached);
+
+  // multishot accept on a listening socket, on_accept gets each new fd
+  uint64_t AddAcceptor(int fd, std::function<void(int fd)> on_accept);
+
+ private:
+  IoUringReactor() = default;
+
+  enum Op : uint8_t {
+    kOpPoll = 1,
+    kOpAccept,
+    kOpRecv,
+    kOpSend,
+    kOpConnect,
+    kOpCancel,
+  };
+
+  struct Socket {
+    int fd = -1;
+    UringSocketHandler* handler = nullptr;
+    std::function<void(int)> on_accept;  // for acceptors
+    sockaddr_in peer{};                  // for connect, must live until completion
+
+    bool recv_armed = false;
+    bool removed = false;
+    int inflight = 0;  // requests the kernel still references this socket for
+
+    std::string out;  // queued, not yet submitted
+    std::string sending;
+    size_t sent = 0;
+
+    std::function<void(std::string)> on_detached;
+    std::string leftover;
+  };
+
+  struct Timer {
+    TimerId id;
+    int period_ms;
+    bool repeat;
+    std::function<void()> callback;
+  };
+
+  bool setup();
+  struct io_uring_sqe* getSqe();
+  int submitAndWait(unsigned wait_nr, int timeout_ms);
+
+  void armRecv(uint64_t id, Socket& s);
+  void armAccept(uint64_t id, Socket& s);
+  void armPoll(EventObject* obj, int events);
+  void cancel(uint64_t user_data);
+  void flushSends();
+  void submitSend(uint64_t id, Socket& s);
+  void recycleBuffer(uint16_t bid);
+  void tryRelease(uint64_t id);
+
+  void handleCqe(uint64_t user_data, int32_t res, uint32_t flags);
+  void handleRecv(uint64_t id, int32_t res, uint32_t flags);
+  void handleSend(uint64_t id, int32_t res);
+  void runTimers();
+
+  int ring_fd_ = -1;
+
+  // rings shared with the kernel
+  void* sq_ptr_ = nullptr;
+  size_t sq_size_ = 0;
+  void* cq_ptr_ = nullptr;
+  size_t cq_size_ = 0;
+  struct io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_mask_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned sq_entries_ = 0;
+  unsigned sqe_tail_ = 0;  // local tail, published on submit
+
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned* cq_mask_ = nullptr;
+  struct io_uring_cqe* cqes_ = nullptr;
+  std::vector<struct io_uring_cqe> completions_;  // reaped by Poll, reused across iterations
+
+  // provided buffers for multishot recv
+  struct io_uring_buf_ring* buf_ring_ = nullptr;
+  size_t buf_ring_size_ = 0;
+  char* buf_base_ = nullptr;
+  uint16_t buf_tail_ = 0;
+
+  uint64_t next_socket_id_ = 1;
+  std::unordered_map<uint64_t, Socket> sockets_;
+  std::vector<uint64_t> dirty_;  // sockets with queued sends
+  std::vector<uint64_t> rearm_;  // sockets whose recv ran out of buffers
+
+  std::unordered_map<int, EventObject*> objects_;  // by unique id, for Register
+
+  std::unordered_map<TimerId, Timer> timers_;
+  std::multimap<int64_t, TimerId> timer_queue_;  // deadline in ms -> timer
+};
+
+}  // end namespace internal
+}  // namespace pikiwidb
@@ -19,6 +19,8 @@ class LibeventReactor : public Reactor {
   LibeventReactor();
   virtual ~LibeventReactor() {}
 
+  ReactorType Type() const override { return ReactorType::kLibevent; }
+
   bool Register(EventObject* obj, int events) override;
   void Unregister(EventObject* obj) override;
   bool Modify(EventObject* obj, int events) override;
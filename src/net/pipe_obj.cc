@@ -28,9 +28,10 @@ PipeObject::~PipeObject() {
 int PipeObject::Fd() const { return read_fd_; }
 
 bool PipeObject::HandleReadEvent() {
-  char ch;
-  auto n = ::read(read_fd_, &ch, sizeof ch);
-  return n == 1;
+  // notifications are coalesced, but Stop may add one more
+  char buf[64];
+  auto n = ::read(read_fd_, buf, sizeof buf);
+  return n > 0;
 }
 
 bool PipeObject::HandleWriteEvent() {
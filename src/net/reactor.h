@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 
+#include <functional>
 #include <memory>
 
 // #include "util.h"
@@ -9,6 +10,11 @@
 namespace pikiwidb {
 typedef int64_t TimerId;
 
+enum class ReactorType {
+  kLibevent,
+  kIoUring,  // Linux only
+};
+
 class EventObject;
 /// Reactor interface
 class Reactor {
@@ -19,6 +25,8 @@ class Reactor {
   Reactor(const Reactor&) = delete;
   void operator=(const Reactor&) = delete;
 
+  virtual ReactorType Type() const = 0;
+
   // backend
   virtual void* Backend() = 0;
 
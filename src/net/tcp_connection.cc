@@ -8,7 +8,9 @@
 #include "tcp_connection.h"
 
 #include <netinet/tcp.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
 #include <memory>
 
@@ -19,6 +21,11 @@
 #include "util.h"
 
 namespace pikiwidb {
+// upper bound of the space reserved ahead for one incomplete message
+static constexpr size_t kMaxReadReserve = 64 * 1024 * 1024;
+// read while the input is paused, so a close is still seen
+static constexpr size_t kPausedReadAhead = 64 * 1024;
+
 TcpConnection::TcpConnection(EventLoop* loop) : loop_(loop) {
   memset(&peer_addr_, 0, sizeof peer_addr_);
   last_active_ = std::chrono::steady_clock::now();
@@ -33,6 +40,13 @@ TcpConnection::~TcpConnection() {
     INFO("close tcp fd {}", Fd());
     bufferevent_disable(bev_, EV_READ | EV_WRITE);
     bufferevent_free(bev_);
+  } else if (fd_ != -1) {
+    INFO("close tcp fd {}", fd_);
+    if (uring_id_ == 0) {
+      close(fd_);  // not owned by any reactor, it was being moved
+    } else if (auto reactor = UringReactor(); reactor) {
+      reactor->RemoveSocket(uring_id_);
+    }
   }
 }
 
@@ -46,6 +60,13 @@ void TcpConnection::OnAccept(int fd, const std::string& peer_ip, int peer_port)
   evutil_make_socket_nonblocking(fd);
   evutil_make_socket_closeonexec(fd);
 
+  if (auto reactor = UringReactor(); reactor) {
+    fd_ = fd;
+    uring_id_ = reactor->AddSocket(fd, this);
+    HandleConnect();
+    return;
+  }
+
   auto base = reinterpret_cast<struct event_base*>(loop_->GetReactor()->Backend());
   bev_ = bufferevent_socket_new(base, fd, BEV_OPT_CLOSE_ON_FREE);
   assert(bev_);
@@ -61,6 +82,29 @@ bool TcpConnection::Connect(const char* ip, int port) {
     return false;
   }
 
+  if (auto reactor = UringReactor(); reactor) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      ERROR("can't create socket, errno {}", errno);
+      return false;
+    }
+
+    if (!loop_->Register(shared_from_this(), 0)) {
+      ERROR("add tcp obj to loop failed, fd {}", fd);
+      close(fd);
+      return false;
+    }
+
+    INFO("in loop {}, trying connect to {}:{}", loop_->GetName(), ip, port);
+    fd_ = fd;
+    peer_ip_ = ip;
+    peer_port_ = port;
+    peer_addr_ = MakeSockaddr(ip, port);
+    state_ = State::kConnecting;
+    uring_id_ = reactor->AsyncConnect(fd, peer_addr_, this);
+    return true;
+  }
+
   // new bufferevent then connect
   auto base = reinterpret_cast<struct event_base*>(loop_->GetReactor()->Backend());
   auto bev = bufferevent_socket_new(base, -1, BEV_OPT_CLOSE_ON_FREE);
@@ -101,7 +145,7 @@ int TcpConnection::Fd() const {
     return bufferevent_getfd(bev_);
   }
 
-  return -1;
+  return fd_;
 }
 
 bool TcpConnection::SendPacket(const void* data, size_t size) {
@@ -115,20 +159,35 @@ bool TcpConnection::SendPacket(const void* data, size_t size) {
   }
 
   if (loop_->InThisLoop()) {
-    auto output = bufferevent_get_output(bev_);
-    evbuffer_add(output, data, size);
+    AppendOutput(data, size);
+    return true;
+  }
+
+  return SendPacket(std::make_shared<const std::string>(static_cast<const char*>(data), size));
+}
+
+bool TcpConnection::SendPacket(std::shared_ptr<const std::string> buf) {
+  if (state_ != State::kConnected) {
+    ERROR("send tcp data in wrong state {}", static_cast<int>(state_));
+    return false;
+  }
+
+  if (!buf || buf->empty()) {
+    return true;
+  }
+
+  if (loop_->InThisLoop()) {
+    AppendOutput(buf->data(), buf->size());
   } else {
     auto w_obj(weak_from_this());
-    auto tmp = std::string(static_cast<const char*>(data), size);
-    loop_->Execute([w_obj, tmp = std::move(tmp)]() {
+    loop_->Execute([w_obj, buf = std::move(buf)]() {
       auto c = w_obj.lock();
       if (!c) {
         return;  // connection already lost
       }
 
       auto tcp_conn = std::static_pointer_cast<TcpConnection>(c);
-      auto output = bufferevent_get_output(tcp_conn->bev_);
-      evbuffer_add(output, tmp.data(), tmp.size());
+      tcp_conn->AppendOutput(buf->data(), buf->size());
     });
   }
   return true;
@@ -145,6 +204,12 @@ bool TcpConnection::SendPacket(const evbuffer_iovec* iovecs, size_t nvecs) {
   }
 
   if (loop_->InThisLoop()) {
+    if (!bev_) {
+      for (size_t i = 0; i < nvecs; ++i) {
+        AppendOutput(iovecs[i].iov_base, iovecs[i].iov_len);
+      }
+      return true;
+    }
     auto output = bufferevent_get_output(bev_);
     evbuffer_add_iovec(output, const_cast<evbuffer_iovec*>(iovecs), nvecs);
   } else {
@@ -166,6 +231,12 @@ bool TcpConnection::SendPacket(const evbuffer_iovec* iovecs, size_t nvecs) {
       }
 
       auto tcp_conn = std::static_pointer_cast<TcpConnection>(c);
+      if (!tcp_conn->bev_) {
+        for (const auto& buffer : buffers) {
+          tcp_conn->AppendOutput(buffer.data(), buffer.size());
+        }
+        return;
+      }
       auto output = bufferevent_get_output(tcp_conn->bev_);
       evbuffer_add_iovec(output, const_cast<evbuffer_iovec*>(buffersSlices.data()), buffersSlices.size());
     });
@@ -174,14 +245,59 @@ bool TcpConnection::SendPacket(const evbuffer_iovec* iovecs, size_t nvecs) {
   return true;
 }
 
+size_t TcpConnection::OutputBytes() const {
+  assert(loop_->InThisLoop());
+  if (bev_) {
+    return evbuffer_get_length(bufferevent_get_output(bev_));
+  }
+  if (uring_id_ != 0) {
+    return UringReactor()->Unsent(uring_id_) + pending_output_.size();
+  }
+  return pending_output_.size();
+}
+
+void TcpConnection::PauseInput() {
+  assert(loop_->InThisLoop());
+  input_paused_ = true;
+  if (bev_) {
+    bufferevent_setwatermark(bev_, EV_READ, 0, evbuffer_get_length(bufferevent_get_input(bev_)) + kPausedReadAhead);
+  }
+}
+
+void TcpConnection::ProcessInput() {
+  assert(loop_->InThisLoop());
+  input_paused_ = false;
+  if (state_ != State::kConnected) {
+    return;
+  }
+  if (bev_) {
+    bufferevent_setwatermark(bev_, EV_READ, 0, 0);
+    OnRecvData(bev_, this);
+  } else if (!input_.empty()) {
+    OnUringRecv("", 0);
+  }
+}
+
+void TcpConnection::AppendOutput(const void* data, size_t size) {
+  if (bev_) {
+    evbuffer_add(bufferevent_get_output(bev_), data, size);
+  } else if (uring_id_ != 0) {
+    UringReactor()->Send(uring_id_, data, size);
+  } else {
+    pending_output_.append(static_cast<const char*>(data), size);
+  }
+}
+
 void TcpConnection::HandleConnect() {
   assert(loop_->InThisLoop());
   assert(state_ == State::kNone || state_ == State::kConnecting);
   INFO("HandleConnect success with {}:{}", peer_ip_, peer_port_);
 
   state_ = State::kConnected;
-  bufferevent_setcb(bev_, &TcpConnection::OnRecvData, nullptr, &TcpConnection::OnEvent, this);
-  bufferevent_enable(bev_, EV_READ);
+  if (bev_) {
+    bufferevent_setcb(bev_, &TcpConnection::OnRecvData, nullptr, &TcpConnection::OnEvent, this);
+    bufferevent_enable(bev_, EV_READ);
+  }
 
   if (on_new_conn_) {
     on_new_conn_(this);
@@ -240,8 +356,7 @@ void TcpConnection::SetIdleTimeout(int timeout_ms) {
 }
 
 void TcpConnection::SetNodelay(bool enable) {
-  if (bev_) {
-    int fd = bufferevent_getfd(bev_);
+  if (int fd = Fd(); fd != -1) {
     int nodelay = enable ? 1 : 0;
     ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&nodelay, sizeof(int));
   }
@@ -271,40 +386,150 @@ void TcpConnection::OnRecvData(struct bufferevent* bev, void* obj) {
   }
 
   auto input = bufferevent_get_input(bev);
-  evbuffer_pullup(input, -1);
+  bool error = false;
+  while (!error && me->state_ == State::kConnected && !me->input_paused_) {
+    const size_t total = evbuffer_get_length(input);
+    if (total == 0) {
+      break;
+    }
 
-  struct evbuffer_iovec data[1];
-  int nvecs = evbuffer_peek(input, -1, nullptr, data, 1);
-  if (nvecs != 1) {
-    return;
-  }
+    // feed the first contiguous segment as is, only a message straddling
+    // segments needs to be linearized
+    struct evbuffer_iovec data[1];
+    int nvecs = evbuffer_peek(input, -1, nullptr, data, 1);
+    if (nvecs != 1) {
+      break;
+    }
+
+    const char* start = reinterpret_cast<const char*>(data[0].iov_base);
+    const size_t len = data[0].iov_len;
+    int consumed = me->on_message_(me.get(), start, static_cast<int>(len));
+    if (consumed < 0) {
+      error = true;
+      break;
+    }
 
-  const char* start = reinterpret_cast<const char*>(data[0].iov_base);
-  const int len = static_cast<int>(data[0].iov_len);
-  int total_consumed = 0;
-  bool error = false;
-  while (!error && total_consumed < len) {
-    int consumed = me->on_message_(me.get(), start + total_consumed, len - total_consumed);
     if (consumed > 0) {
-      total_consumed += consumed;
-    } else {
-      if (consumed < 0) {
-        error = true;
-      }
+      evbuffer_drain(input, consumed);
+      continue;
+    }
 
+    // no progress: pull up just the pending message once it is complete,
+    // or everything buffered when its size is unknown
+    const size_t need = me->read_hint_;
+    if (need > total) {
+      break;
+    }
+
+    const size_t want = need > len ? need : total;
+    if (want <= len) {
       break;
     }
-  }
 
-  if (total_consumed > 0) {
-    evbuffer_drain(input, total_consumed);
+    evbuffer_pullup(input, static_cast<ev_ssize_t>(want));
   }
 
   if (error) {
     me->HandleDisconnect();
+    return;
+  }
+  // the input is kept as it is, up to the high watermark PauseInput set
+  if (me->input_paused_) {
+    return;
+  }
+
+  // while a large message is incomplete, reserve room for it in one chunk
+  // and stay asleep until it has fully arrived
+  const size_t buffered = evbuffer_get_length(input);
+  size_t low_water = 0;
+  if (me->read_hint_ > buffered) {
+    low_water = me->read_hint_;
+    evbuffer_expand(input, std::min(low_water - buffered, kMaxReadReserve));
+  }
+
+  bufferevent_setwatermark(bev, EV_READ, low_water, 0);
+}
+
+void TcpConnection::OnUringRecv(const char* data, size_t len) {
+  auto me = std::static_pointer_cast<TcpConnection>(shared_from_this());
+
+  assert(loop_->InThisLoop());
+
+  if (idle_timer_ != -1) {
+    last_active_ = std::chrono::steady_clock::now();
+  }
+
+  // data is only valid during this call, keep what is not consumed
+  if (input_paused_) {
+    input_.append(data, len);
+    return;
+  }
+  if (!input_.empty()) {
+    input_.append(data, len);
+    if (read_hint_ > input_.size()) {
+      return;  // the pending message is still incomplete
+    }
+    data = input_.data();
+    len = input_.size();
+  }
+
+  size_t offset = 0;
+  // stop if the message callback moved this connection to another loop
+  while (state_ == State::kConnected && loop_->InThisLoop() && offset < len) {
+    int consumed = on_message_(this, data + offset, static_cast<int>(len - offset));
+    if (consumed < 0) {
+      HandleDisconnect();
+      return;
+    }
+    if (consumed == 0) {
+      break;
+    }
+    offset += consumed;
+  }
+
+  if (data == input_.data()) {
+    input_.erase(0, offset);
+  } else {
+    input_.assign(data + offset, len - offset);
+  }
+
+  if (read_hint_ > input_.size()) {
+    input_.reserve(std::min(read_hint_, kMaxReadReserve));
+  }
+}
+
+void TcpConnection::OnUringClose(int err) {
+  auto me = std::static_pointer_cast<TcpConnection>(shared_from_this());
+
+  INFO("TcpConnection::OnUringClose fd {}, errno {}, state {}", fd_, err, static_cast<int>(state_));
+  if (state_ == State::kConnected) {
+    HandleDisconnect();
   }
 }
 
+void TcpConnection::OnUringConnect(int err) {
+  auto me = std::static_pointer_cast<TcpConnection>(shared_from_this());
+
+  if (state_ != State::kConnecting) {
+    return;
+  }
+
+  if (err == 0) {
+    HandleConnect();
+  } else {
+    HandleConnectFailed();
+  }
+}
+
+internal::IoUringReactor* TcpConnection::UringReactor() const {
+  auto reactor = loop_->GetReactor();
+  if (reactor && reactor->Type() == ReactorType::kIoUring) {
+    return static_cast<internal::IoUringReactor*>(reactor);
+  }
+
+  return nullptr;
+}
+
 void TcpConnection::OnEvent(struct bufferevent* bev, short events, void* obj) {
   auto me = std::static_pointer_cast<TcpConnection>(reinterpret_cast<TcpConnection*>(obj)->shared_from_this());
 
@@ -338,6 +563,33 @@ void TcpConnection::SetContext(std::shared_ptr<void> ctx) { context_ = std::move
 void TcpConnection::ResetEventLoop(EventLoop* new_loop) {
   assert(loop_->InThisLoop());
 
+  if (auto reactor = UringReactor(); reactor) {
+    // the old reactor finishes the sends in flight, then the fd is attached to new_loop,
+    // output produced meanwhile is kept in pending_output_
+    auto id = uring_id_;
+    uring_id_ = 0;
+    loop_ = new_loop;
+
+    auto me = std::static_pointer_cast<TcpConnection>(shared_from_this());
+    reactor->DetachSocket(id, [me, new_loop](std::string leftover) {
+      new_loop->Execute([me, leftover = std::move(leftover)]() {
+        if (me->state_ != State::kConnected) {
+          return;  // the fd is closed by the destructor
+        }
+
+        me->uring_id_ = me->UringReactor()->AddSocket(me->fd_, me.get());
+        if (!me->pending_output_.empty()) {
+          me->AppendOutput(me->pending_output_.data(), me->pending_output_.size());
+          me->pending_output_.clear();
+        }
+        if (!leftover.empty() || !me->input_.empty()) {
+          me->OnUringRecv(leftover.data(), leftover.size());
+        }
+      });
+    });
+    return;
+  }
+
   // disable event
   bufferevent_disable(bev_, EV_READ | EV_WRITE);
 
@@ -8,6 +8,7 @@
 #include "event2/buffer.h"
 #include "event2/bufferevent.h"
 #include "event_obj.h"
+#include "io_uring_reactor.h"
 #include "reactor.h"
 #include "unbounded_buffer.h"
 
@@ -26,7 +27,8 @@ using TcpDisconnectCallback = std::function<void(TcpConnection*)>;
 
 // After client connects the server or the server accepts a new client,
 // the pikiwidb will create a TcpConnection to handle the connection.
-class TcpConnection : public EventObject {
+// With the io_uring reactor, the socket is driven by IoUringReactor instead of a bufferevent.
+class TcpConnection : public EventObject, public internal::UringSocketHandler {
  public:
   explicit TcpConnection(EventLoop* loop);
   ~TcpConnection();
@@ -42,6 +44,8 @@ class TcpConnection : public EventObject {
   bool SendPacket(const void*, size_t);
   bool SendPacket(UnboundedBuffer& data) { return SendPacket(data.ReadAddr(), data.ReadableSize()); }
   bool SendPacket(const evbuffer_iovec* iovecs, size_t nvecs);
+  // sent from another thread, buf is shared instead of copied, e.g. one message to many connections
+  bool SendPacket(std::shared_ptr<const std::string> buf);
 
   void SetNewConnCallback(NewTcpConnectionCallback cb) { on_new_conn_ = std::move(cb); }
   void SetOnDisconnect(TcpDisconnectCallback cb) { on_disconnect_ = std::move(cb); }
@@ -71,6 +75,24 @@ class TcpConnection : public EventObject {
   // Nagle algorithm
   void SetNodelay(bool enable);
 
+  // set by the message callback: bytes it needs at the head of the input
+  // before it can make progress, 0 if unknown. A large message is then
+  // buffered without waking up on every read and linearized only once.
+  void SetReadHint(size_t bytes) { read_hint_ = bytes; }
+
+  // bytes sent but not written to the socket yet, must be called in the connection's loop
+  size_t OutputBytes() const;
+
+  // the message callback waits for something else before it consumes again:
+  // the input is neither fed to it nor linearized, and the socket is read only
+  // a little further, so a close is still seen, until ProcessInput.
+  // Must be called in the connection's loop
+  void PauseInput();
+
+  // feed the buffered input to the message callback again, after it stopped
+  // consuming for a while. Must be called in the connection's loop
+  void ProcessInput();
+
  private:
   // check if idle timeout
   bool CheckIdleTimeout() const;
@@ -78,6 +100,13 @@ class TcpConnection : public EventObject {
   static void OnRecvData(struct bufferevent* bev, void* ctx);
   static void OnEvent(struct bufferevent* bev, short what, void* ctx);
 
+  // io_uring reactor
+  void OnUringRecv(const char* data, size_t len) override;
+  void OnUringClose(int err) override;
+  void OnUringConnect(int err) override;
+  internal::IoUringReactor* UringReactor() const;
+  void AppendOutput(const void* data, size_t size);
+
   void HandleConnect();
   void HandleConnectFailed();
   void HandleDisconnect();
@@ -95,6 +124,12 @@ class TcpConnection : public EventObject {
   EventLoop* loop_;
   struct bufferevent* bev_ = nullptr;
 
+  // io_uring reactor only
+  int fd_ = -1;
+  uint64_t uring_id_ = 0;       // 0 while moving to another loop
+  std::string input_;           // incomplete message
+  std::string pending_output_;  // sent while moving to another loop
+
   std::string peer_ip_;
   int peer_port_ = -1;
   struct sockaddr_in peer_addr_;
@@ -108,6 +143,9 @@ class TcpConnection : public EventObject {
   int idle_timeout_ms_ = 0;
   std::chrono::steady_clock::time_point last_active_;
 
+  size_t read_hint_ = 0;
+  bool input_paused_ = false;
+
   std::shared_ptr<void> context_;
 };
 
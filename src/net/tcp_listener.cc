@@ -8,6 +8,7 @@
 #include "tcp_listener.h"
 
 #include <errno.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 #include <string>
@@ -23,21 +24,32 @@ TcpListener::~TcpListener() {
   if (listener_) {
     INFO("close tcp listener fd {}", Fd());
     evconnlistener_free(listener_);
+  } else if (acceptor_id_ != 0) {
+    INFO("close tcp listener fd {}", fd_);
+    if (auto reactor = loop_->GetReactor(); reactor) {
+      static_cast<internal::IoUringReactor*>(reactor)->RemoveSocket(acceptor_id_);
+    }
   }
 }
 
 bool TcpListener::Bind(const char* ip, int port) {
-  if (listener_) {
+  if (listener_ || fd_ != -1) {
     ERROR("repeat bind tcp socket to port {}", port);
     return false;
   }
 
+  if (loop_->GetReactor()->Type() == ReactorType::kIoUring) {
+    return BindUring(ip, port);
+  }
+
   sockaddr_in addr = MakeSockaddr(ip, port);
   auto base = reinterpret_cast<struct event_base*>(loop_->GetReactor()->Backend());
-  auto listener =
-      evconnlistener_new_bind(base, &TcpListener::OnNewConnection, this,
-                              LEV_OPT_CLOSE_ON_EXEC | LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE | LEV_OPT_DISABLED, -1,
-                              (const struct sockaddr*)&addr, int(sizeof(addr)));
+  unsigned flags = LEV_OPT_CLOSE_ON_EXEC | LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE | LEV_OPT_DISABLED;
+  if (reuse_port_) {
+    flags |= LEV_OPT_REUSEABLE_PORT;
+  }
+  auto listener = evconnlistener_new_bind(base, &TcpListener::OnNewConnection, this, flags, -1,
+                                          (const struct sockaddr*)&addr, int(sizeof(addr)));
   if (!listener) {
     ERROR("failed listen tcp port {}:{}", ip, port);
     return false;
@@ -50,18 +62,61 @@ bool TcpListener::Bind(const char* ip, int port) {
     return false;
   }
 
-  INFO("tcp listen on port {}:{}", ip, port);
+  INFO("tcp listen on port {}:{}{}", ip, port, reuse_port_ ? " with SO_REUSEPORT" : "");
   listener_ = listener;
   evconnlistener_enable(listener_);
   return true;
 }
 
+bool TcpListener::BindUring(const char* ip, int port) {
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    ERROR("can't create socket, errno {}", errno);
+    return false;
+  }
+
+  int on = 1;
+  ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+  if (reuse_port_) {
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on);
+  }
+
+  sockaddr_in addr = MakeSockaddr(ip, port);
+  if (::bind(fd, (const struct sockaddr*)&addr, sizeof addr) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+    ERROR("failed listen tcp port {}:{}, errno {}", ip, port, errno);
+    close(fd);
+    return false;
+  }
+
+  fd_ = fd;
+  if (!loop_->Register(shared_from_this(), 0)) {
+    ERROR("add tcp listener to loop failed, socket {}", fd);
+    close(fd);
+    fd_ = -1;
+    return false;
+  }
+
+  INFO("tcp listen on port {}:{} with io_uring", ip, port);
+  auto reactor = static_cast<internal::IoUringReactor*>(loop_->GetReactor());
+  acceptor_id_ = reactor->AddAcceptor(fd, [this](int conn_fd) {
+    sockaddr_in peer;
+    socklen_t len = sizeof peer;
+    if (::getpeername(conn_fd, (struct sockaddr*)&peer, &len) != 0) {
+      WARN("getpeername for tcp fd {} failed, errno {}", conn_fd, errno);
+      close(conn_fd);
+      return;
+    }
+    OnNewConnection(nullptr, conn_fd, (struct sockaddr*)&peer, static_cast<int>(len), this);
+  });
+  return true;
+}
+
 int TcpListener::Fd() const {
   if (listener_) {
     return static_cast<int>(evconnlistener_get_fd(listener_));
   }
 
-  return -1;
+  return fd_;
 }
 
 EventLoop* TcpListener::SelectEventLoop() {
@@ -74,6 +129,7 @@ EventLoop* TcpListener::SelectEventLoop() {
 
 void TcpListener::OnNewConnection(struct evconnlistener*, evutil_socket_t fd, struct sockaddr* peer, int, void* obj) {
   auto acceptor = reinterpret_cast<TcpListener*>(obj);
+  acceptor->loop_->AddAcceptCount();
   if (acceptor->on_new_conn_) {
     // convert address
     std::string ipstr = GetSockaddrIp(peer);
@@ -16,16 +16,25 @@ class TcpListener : public EventObject {
   int Fd() const override;
 
   void SetNewConnCallback(NewTcpConnectionCallback cb) { on_new_conn_ = std::move(cb); }
+  // SO_REUSEPORT, let the kernel spread connections over listeners of the same address
+  void SetReusePort(bool reuse_port) { reuse_port_ = reuse_port; }
   EventLoop* SelectEventLoop();
 
  private:
   static void OnNewConnection(struct evconnlistener*, evutil_socket_t, struct sockaddr*, int, void*);
   static void OnError(struct evconnlistener*, void*);
 
+  bool BindUring(const char* ip, int port);
+
   EventLoop* const loop_;
   struct evconnlistener* listener_{nullptr};
 
+  // io_uring reactor only
+  int fd_{-1};
+  uint64_t acceptor_id_{0};
+
   NewTcpConnectionCallback on_new_conn_;
+  bool reuse_port_{false};
 };
 
 }  // namespace pikiwidb
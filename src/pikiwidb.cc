@@ -20,7 +20,9 @@
 #include "client.h"
 #include "store.h"
 
+#include "async_cmd.h"
 #include "config.h"
+#include "instance_executor.h"
 #include "slow_log.h"
 
 #include "helper.h"
@@ -200,9 +202,9 @@ bool PikiwiDB::Init() {
     g_config.masterPort = master_port_;
   }
 
-  NewTcpConnectionCallback cb = std::bind(&PikiwiDB::OnNewConnection, this, std::placeholders::_1);
-  if (!worker_threads_.Init(g_config.ip.c_str(), g_config.port, cb)) {
-    return false;
+  // before any loop is initialized
+  if (g_config.reactor_type == "io_uring") {
+    EventLoop::SetReactorType(ReactorType::kIoUring);
   }
 
   auto num = g_config.worker_threads_num + g_config.slave_threads_num;
@@ -211,11 +213,30 @@ bool PikiwiDB::Init() {
     ERROR("number of threads can't exceeds {}, now is {}", kMaxWorkerNum, num);
     return false;
   }
+  // the workers listen themselves with reuse-port, they are known before Init
   worker_threads_.SetWorkerNum(static_cast<size_t>(g_config.worker_threads_num));
   slave_threads_.SetWorkerNum(static_cast<size_t>(g_config.slave_threads_num));
 
+  NewTcpConnectionCallback cb = std::bind(&PikiwiDB::OnNewConnection, this, std::placeholders::_1);
+  worker_threads_.SetReusePort(g_config.reuse_port);
+  if (!worker_threads_.Init(g_config.ip.c_str(), g_config.port, cb)) {
+    return false;
+  }
+
   PSTORE.Init(g_config.databases);
 
+  if (g_config.shared_nothing && g_config.backend != kBackEndNone) {
+    InstanceExecutor::Instance().Start(static_cast<size_t>(g_config.db_instance_num), [](size_t inst_id) {
+      for (int db = 0; db < g_config.databases; ++db) {
+        PSTORE.GetBackend(db)->GetStorage()->OwnInstance(inst_id);
+      }
+    });
+  }
+
+  if (g_config.async_read_threads > 0) {
+    AsyncCmdPool::Instance().Start(static_cast<size_t>(g_config.async_read_threads));
+  }
+
   // Only if there is no backend, load rdb
   if (g_config.backend == pikiwidb::kBackEndNone) {
     LoadDBFromDisk();
@@ -223,6 +244,7 @@ bool PikiwiDB::Init() {
 
   PSlowLog::Instance().SetThreshold(g_config.slowlogtime);
   PSlowLog::Instance().SetLogLimit(static_cast<std::size_t>(g_config.slowlogmaxlen));
+  PSlowLog::Instance().SetPerfSample(static_cast<uint32_t>(g_config.slowlogperfsample));
 
   // init base loop
   auto loop = worker_threads_.BaseLoop();
@@ -252,6 +274,8 @@ void PikiwiDB::Run() {
   worker_threads_.Run(0, nullptr);
 
   t.join();  // wait for slave thread exit
+  pikiwidb::AsyncCmdPool::Instance().Stop();
+  pikiwidb::InstanceExecutor::Instance().Stop();
   INFO("server exit running");
 }
 
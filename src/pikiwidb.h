@@ -29,6 +29,7 @@ class PikiwiDB final {
   void OnNewConnection(pikiwidb::TcpConnection* obj);
 
   pikiwidb::CmdTableManager& GetCmdTableManager();
+  const pikiwidb::IOThreadPool& GetWorkerThreads() const { return worker_threads_; }
 
  public:
   PString cfg_file_;
@@ -25,6 +25,10 @@ class PProtoParser {
 
   bool IsInitialState() const { return multi_ == -1; }
 
+  // bytes still needed to finish the bulk string being parsed, counted from
+  // the end of the consumed input; 0 if unknown
+  size_t PendingBytes() const { return paramLen_ >= 0 ? static_cast<size_t>(paramLen_) + 2 : 0; }
+
  private:
   PParseResult parseMulti(const char*& ptr, const char* end, int& result);
   PParseResult parseStrlist(const char*& ptr, const char* end, std::vector<std::string>& results);
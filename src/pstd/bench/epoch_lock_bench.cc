@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+// Read side throughput of the DB storage lock, shared locks/s with 1 to 64 reader threads
+// while a writer takes the exclusive lock every few milliseconds, like FLUSHALL would.
+// EpochLock is measured against the std::shared_mutex it replaced.
+//
+// usage: epoch_lock_bench [milliseconds per run] [writer interval in milliseconds, 0 disables]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "pstd/epoch_lock.h"
+
+static const int kReaders[] = {1, 2, 4, 8, 16, 32, 64};
+
+template <typename Lock>
+static double BenchLock(int readers, int millis, int writer_interval) {
+  Lock lock;
+  uint64_t value = 0;  // the "storage pointer"
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> total{0};
+  std::atomic<uint64_t> sink{0};  // keeps the reads
+
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; ++r) {
+    threads.emplace_back([&]() {
+      uint64_t n = 0;
+      uint64_t sum = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        lock.lock_shared();
+        sum += value;
+        lock.unlock_shared();
+        ++n;
+      }
+      total.fetch_add(n, std::memory_order_relaxed);
+      sink.fetch_add(sum, std::memory_order_relaxed);
+    });
+  }
+
+  std::thread writer;
+  if (writer_interval > 0) {
+    writer = std::thread([&]() {
+      while (!stop.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(writer_interval));
+        lock.lock();
+        ++value;
+        lock.unlock();
+      }
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+  stop = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (writer.joinable()) {
+    writer.join();
+  }
+  return static_cast<double>(total.load()) / elapsed;
+}
+
+int main(int ac, char* av[]) {
+  const int millis = ac > 1 ? std::max(10, atoi(av[1])) : 1000;
+  const int writer_interval = ac > 2 ? std::max(0, atoi(av[2])) : 10;
+
+  printf("%7s %18s %18s\n", "readers", "shared_mutex/s", "EpochLock/s");
+  for (auto readers : kReaders) {
+    auto shared = BenchLock<std::shared_mutex>(readers, millis, writer_interval);
+    auto epoch = BenchLock<pstd::EpochLock>(readers, millis, writer_interval);
+    printf("%7d %18.0f %18.0f\n", readers, shared, epoch);
+  }
+  return 0;
+}
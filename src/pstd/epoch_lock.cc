@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "pstd/epoch_lock.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace pstd {
+
+namespace {
+
+class ThreadIndexes {
+ public:
+  size_t Acquire() {
+    std::lock_guard guard(mutex_);
+    if (!free_.empty()) {
+      auto idx = free_.back();
+      free_.pop_back();
+      return idx;
+    }
+    auto idx = next_.load(std::memory_order_relaxed);
+    if (idx == EpochLock::kMaxThreads) {
+      fprintf(stderr, "EpochLock: more than %zu threads\n", EpochLock::kMaxThreads);
+      abort();
+    }
+    // seq_cst, a writer which counted the indexes before is seen by the first read of the thread
+    next_.store(idx + 1, std::memory_order_seq_cst);
+    return idx;
+  }
+
+  void Release(size_t idx) {
+    std::lock_guard guard(mutex_);
+    free_.push_back(idx);
+  }
+
+  size_t Count() const { return next_.load(std::memory_order_seq_cst); }
+
+ private:
+  std::mutex mutex_;
+  std::vector<size_t> free_;
+  std::atomic<size_t> next_{0};
+};
+
+// never destroyed, threads may exit after static destruction started
+ThreadIndexes& Indexes() {
+  static auto indexes = new ThreadIndexes;
+  return *indexes;
+}
+
+struct ThreadIndex {
+  ThreadIndex() : idx(Indexes().Acquire()) {}
+  ~ThreadIndex() { Indexes().Release(idx); }
+
+  const size_t idx;
+};
+
+}  // namespace
+
+size_t EpochLock::ThreadIndex() {
+  thread_local struct ThreadIndex index;
+  return index.idx;
+}
+
+size_t EpochLock::ThreadCount() { return Indexes().Count(); }
+
+EpochLock::EpochLock() = default;
+
+EpochLock::~EpochLock() {
+  for (auto& group : groups_) {
+    delete group.load(std::memory_order_relaxed);
+  }
+}
+
+EpochLock::Group* EpochLock::newGroup(size_t group) {
+  // the threads of the group may race here, and a writer may be scanning
+  auto fresh = new Group;
+  Group* current = nullptr;
+  if (!groups_[group].compare_exchange_strong(current, fresh, std::memory_order_seq_cst)) {
+    delete fresh;
+    return current;
+  }
+  return fresh;
+}
+
+void EpochLock::slowLockShared(Slot& slot) {
+  while (true) {
+    // step aside so the writer's grace period can end
+    slot.depth.store(0, std::memory_order_seq_cst);
+    while (writer_.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+
+    slot.depth.store(1, std::memory_order_seq_cst);
+    if (!writer_.load(std::memory_order_seq_cst)) {
+      return;
+    }
+  }
+}
+
+void EpochLock::lock() {
+  writer_mutex_.lock();
+  writer_.store(true, std::memory_order_seq_cst);
+
+  // a thread given its index after this count sees the flag on its first read
+  const auto threads = ThreadCount();
+  for (size_t first = 0; first < threads; first += kGroupSlots) {
+    auto group = groups_[first / kGroupSlots].load(std::memory_order_seq_cst);
+    if (!group) {
+      continue;
+    }
+    for (size_t i = 0; i < kGroupSlots && first + i < threads; ++i) {
+      while (group->slots[i].depth.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+      }
+    }
+  }
+}
+
+void EpochLock::unlock() {
+  writer_.store(false, std::memory_order_release);
+  writer_mutex_.unlock();
+}
+
+}  // namespace pstd
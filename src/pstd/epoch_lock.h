@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace pstd {
+
+/**
+ * @brief Reader-writer lock in the style of RCU, for data read on every request and
+ * replaced almost never.
+ * Every thread owns a cache line per lock holding its read nesting count, a reader only
+ * stores to that line and loads the writer flag, so readers on different threads share
+ * nothing. A writer raises the flag, which holds back new readers, and waits for a grace
+ * period: until every thread has left its read section.
+ * The lines are allocated kGroupSlots at a time, the first time a thread of the group
+ * reads, and the writer scans those of the threads alive, so both follow the real thread
+ * count rather than kMaxThreads.
+ * Read sections may nest, and a thread holding a read lock must not take the write lock.
+ * Meets the SharedMutex requirements, so std::shared_lock and std::unique_lock work.
+ */
+class EpochLock {
+ public:
+  EpochLock();
+  ~EpochLock();
+
+  EpochLock(const EpochLock&) = delete;
+  void operator=(const EpochLock&) = delete;
+
+  void lock_shared() {
+    auto& slot = localSlot();
+    const auto depth = slot.depth.load(std::memory_order_relaxed);
+    if (depth > 0) {
+      // a writer waits for this thread, so a nested reader must not wait for it
+      slot.depth.store(depth + 1, std::memory_order_relaxed);
+      return;
+    }
+
+    // ordered before the flag load, the writer does the opposite
+    slot.depth.store(1, std::memory_order_seq_cst);
+    if (writer_.load(std::memory_order_seq_cst)) {
+      slowLockShared(slot);
+    }
+  }
+
+  void unlock_shared() {
+    auto& slot = localSlot();
+    slot.depth.store(slot.depth.load(std::memory_order_relaxed) - 1, std::memory_order_release);
+  }
+
+  // wait for the grace period, readers are held back until unlock
+  void lock();
+  void unlock();
+
+  // live threads using any EpochLock at the same time
+  static constexpr size_t kMaxThreads = 4096;
+  // slots allocated at once
+  static constexpr size_t kGroupSlots = 32;
+
+ private:
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> depth{0};
+  };
+
+  struct Group {
+    Slot slots[kGroupSlots];
+  };
+
+  // a small per thread index, reused once the thread exits
+  static size_t ThreadIndex();
+  // the indexes handed out so far, every live thread has one below it
+  static size_t ThreadCount();
+
+  Slot& localSlot() {
+    const auto idx = ThreadIndex();
+    auto group = groups_[idx / kGroupSlots].load(std::memory_order_acquire);
+    return (group ? group : newGroup(idx / kGroupSlots))->slots[idx % kGroupSlots];
+  }
+
+  Group* newGroup(size_t group);
+  void slowLockShared(Slot& slot);
+
+  // allocated the first time a thread index of the group uses this lock
+  std::atomic<Group*> groups_[kMaxThreads / kGroupSlots] = {};
+  alignas(64) std::atomic<bool> writer_{false};
+  std::mutex writer_mutex_;
+};
+
+}  // namespace pstd
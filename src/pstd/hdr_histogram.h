@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+namespace pstd {
+
+// Log-linear buckets in the spirit of HdrHistogram: values below 2^kSubBits get a bucket each,
+// every power of two above that is split into 2^kSubBits linear sub buckets, so a recorded
+// value is known within 1/2^kSubBits of itself. Values are capped at 2^kMaxBits - 1.
+struct HistogramBuckets {
+  static constexpr int kSubBits = 3;
+  static constexpr int kSubCount = 1 << kSubBits;
+  static constexpr int kMaxBits = 40;
+  static constexpr int kCount = (kMaxBits - kSubBits + 1) * kSubCount;
+
+  static int Index(uint64_t value) {
+    value = std::min<uint64_t>(value, (uint64_t{1} << kMaxBits) - 1);
+    if (value < kSubCount) {
+      return static_cast<int>(value);
+    }
+    const int msb = 63 - std::countl_zero(value);
+    const int group = msb - kSubBits + 1;
+    return group * kSubCount + static_cast<int>((value >> (msb - kSubBits)) & (kSubCount - 1));
+  }
+
+  // smallest value of the bucket
+  static uint64_t LowerBound(int index) {
+    if (index < kSubCount) {
+      return static_cast<uint64_t>(index);
+    }
+    const int group = index / kSubCount;
+    const uint64_t sub = index % kSubCount;
+    return (kSubCount + sub) << (group - 1);
+  }
+
+  // largest value of the bucket
+  static uint64_t UpperBound(int index) { return index + 1 < kCount ? LowerBound(index + 1) - 1 : LowerBound(index); }
+};
+
+// A merged, plain copy of one or more Histograms.
+class HistogramSnapshot {
+ public:
+  void Add(int index, uint64_t count) { counts_[index] += count; }
+  void AddSum(uint64_t count, uint64_t sum, uint64_t max) {
+    count_ += count;
+    sum_ += sum;
+    max_ = std::max(max_, max);
+  }
+
+  uint64_t Count() const { return count_; }
+  uint64_t Sum() const { return sum_; }
+  uint64_t Max() const { return max_; }
+  uint64_t BucketCount(int index) const { return counts_[index]; }
+  double Mean() const { return count_ == 0 ? 0 : static_cast<double>(sum_) / static_cast<double>(count_); }
+
+  // upper bound of the bucket holding the p-th percentile, p in [0, 100]
+  uint64_t Percentile(double p) const {
+    uint64_t total = 0;
+    for (auto c : counts_) {
+      total += c;
+    }
+    if (total == 0) {
+      return 0;
+    }
+
+    auto rank = static_cast<uint64_t>(static_cast<double>(total) * p / 100.0);
+    rank = std::clamp<uint64_t>(rank, 1, total);
+    uint64_t seen = 0;
+    for (int i = 0; i < HistogramBuckets::kCount; ++i) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        return std::min(HistogramBuckets::UpperBound(i), max_);
+      }
+    }
+    return max_;
+  }
+
+ private:
+  std::array<uint64_t, HistogramBuckets::kCount> counts_{};
+  uint64_t count_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t max_ = 0;
+};
+
+// Single writer histogram. Record must only be called by the owning thread, so it needs no
+// read-modify-write instruction; any thread may merge it into a snapshot at any time.
+// A snapshot taken while recording may miss the value being recorded, never more.
+class Histogram {
+ public:
+  void Record(uint64_t value) {
+    Bump(counts_[HistogramBuckets::Index(value)], 1);
+    Bump(count_, 1);
+    Bump(sum_, value);
+    if (value > max_.load(std::memory_order_relaxed)) {
+      max_.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  void MergeTo(HistogramSnapshot* snapshot) const {
+    for (int i = 0; i < HistogramBuckets::kCount; ++i) {
+      if (auto c = counts_[i].load(std::memory_order_relaxed); c != 0) {
+        snapshot->Add(i, c);
+      }
+    }
+    snapshot->AddSum(count_.load(std::memory_order_relaxed), sum_.load(std::memory_order_relaxed),
+                     max_.load(std::memory_order_relaxed));
+  }
+
+  uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+
+ private:
+  static void Bump(std::atomic<uint64_t>& v, uint64_t n) {
+    v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic<uint64_t>, HistogramBuckets::kCount> counts_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+};
+
+}  // namespace pstd
@@ -5,175 +5,248 @@
  * of patent rights can be found in the PATENTS file in the same directory.
  */
 
-#ifndef __STDC_FORMAT_MACROS
-#  define __STDC_FORMAT_MACROS
-#endif
-
 #include "lock_mgr.h"
 
-#include <atomic>
+#include <algorithm>
+#include <bit>
+#include <chrono>
 #include <functional>
-#include <memory>
-#include <unordered_set>
-#include <vector>
+#include <mutex>
+#include <thread>
 
-#include "mutex.h"
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#endif
 
 namespace pstd::lock {
 
-struct LockMapStripe {
-  explicit LockMapStripe(const std::shared_ptr<MutexFactory>& factory) {
-    stripe_mutex = factory->AllocateMutex();
-    stripe_cv = factory->AllocateCondVar();
-    assert(stripe_mutex);
-    assert(stripe_cv);
-  }
+namespace {
 
-  // Mutex must be held before modifying keys map
-  std::shared_ptr<Mutex> stripe_mutex;
+// spins before parking, a few hundred ns, about a short command's hold time
+constexpr int kSpins = 128;
+// one in kHoldSample acquisitions measures its hold time
+constexpr uint32_t kHoldSample = 64;
 
-  // Condition Variable per stripe for waiting on a lock
-  std::shared_ptr<CondVar> stripe_cv;
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
 
-  // Locked keys
-  std::unordered_set<std::string> keys;
+inline uint64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// written by one thread, read by GetStats
+struct ThreadStats {
+  std::atomic<uint64_t> locks{0};
+  std::atomic<uint64_t> contended{0};
+  std::atomic<uint64_t> parked{0};
+  std::atomic<uint64_t> wait_ns{0};
+  std::atomic<uint64_t> hold_samples{0};
+  std::atomic<uint64_t> hold_ns{0};
+  std::atomic<uint64_t> max_hold_ns{0};
+  uint32_t countdown = kHoldSample;
 };
 
-// Map of #num_stripes LockMapStripes
-struct LockMap {
-  explicit LockMap(size_t num_stripes, const std::shared_ptr<MutexFactory>& factory) : num_stripes_(num_stripes) {
-    lock_map_stripes_.reserve(num_stripes);
-    for (size_t i = 0; i < num_stripes; i++) {
-      auto stripe = std::make_shared<LockMapStripe>(factory);
-      lock_map_stripes_.push_back(stripe);
-    }
-  }
+inline void Add(std::atomic<uint64_t>& counter, uint64_t n) {
+  counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
 
-  ~LockMap() = default;
+class StatsRegistry {
+ public:
+  ThreadStats* Register() {
+    auto stats = std::make_unique<ThreadStats>();
+    auto p = stats.get();
+    std::lock_guard guard(mutex_);
+    stats_.push_back(std::move(stats));
+    return p;
+  }
 
-  // Number of sepearate LockMapStripes to create, each with their own Mutex
-  const size_t num_stripes_;
+  LockStats Collect() {
+    LockStats total;
+    std::lock_guard guard(mutex_);
+    for (const auto& s : stats_) {
+      total.locks += s->locks.load(std::memory_order_relaxed);
+      total.contended += s->contended.load(std::memory_order_relaxed);
+      total.parked += s->parked.load(std::memory_order_relaxed);
+      total.wait_ns += s->wait_ns.load(std::memory_order_relaxed);
+      total.hold_samples += s->hold_samples.load(std::memory_order_relaxed);
+      total.hold_ns += s->hold_ns.load(std::memory_order_relaxed);
+      total.max_hold_ns = std::max(total.max_hold_ns, s->max_hold_ns.load(std::memory_order_relaxed));
+    }
+    return total;
+  }
 
-  // Count of keys that are currently locked.
-  // (Only maintained if LockMgr::max_num_locks_ is positive.)
-  std::atomic<int64_t> lock_cnt{0};
+ private:
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<ThreadStats>> stats_;  // kept after the thread exits
+};
 
-  std::vector<std::shared_ptr<LockMapStripe>> lock_map_stripes_;
+// never destroyed, threads may exit after static destruction started
+StatsRegistry& Registry() {
+  static auto registry = new StatsRegistry;
+  return *registry;
+}
 
-  size_t GetStripe(const std::string& key) const;
-};
+ThreadStats& LocalStats() {
+  thread_local ThreadStats* stats = Registry().Register();
+  return *stats;
+}
 
-size_t LockMap::GetStripe(const std::string& key) const {
-  assert(num_stripes_ > 0);
-  size_t stripe = std::hash<std::string>{}(key) % num_stripes_;
-  return stripe;
+uint64_t ThreadId() {
+  static std::atomic<uint64_t> next{1};
+  thread_local uint64_t id = next.fetch_add(1, std::memory_order_relaxed);
+  return id;
 }
 
-LockMgr::LockMgr(size_t default_num_stripes, int64_t max_num_locks, const std::shared_ptr<MutexFactory>& mutex_factory)
-    : default_num_stripes_(default_num_stripes),
-      max_num_locks_(max_num_locks),
-      mutex_factory_(mutex_factory),
-      lock_map_(std::make_shared<LockMap>(default_num_stripes, mutex_factory)) {}
+}  // namespace
 
-LockMgr::~LockMgr() = default;
+LockMgr::LockMgr(size_t num_latches)
+    : latches_(std::make_unique<Latch[]>(std::bit_ceil(std::max<size_t>(num_latches, 1)))),
+      mask_(std::bit_ceil(std::max<size_t>(num_latches, 1)) - 1) {}
 
-Status LockMgr::TryLock(const std::string& key) {
-#ifdef LOCKLESS
-  return Status::OK();
-#else
-  size_t stripe_num = lock_map_->GetStripe(key);
-  assert(lock_map_->lock_map_stripes_.size() > stripe_num);
-  auto stripe = lock_map_->lock_map_stripes_.at(stripe_num);
+LockMgr::~LockMgr() = default;
 
-  return Acquire(stripe, key);
+uint64_t LockMgr::Hash(std::string_view key) { return std::hash<std::string_view>{}(key); }
+
+void LockMgr::SetOwner() { owner_.store(ThreadId(), std::memory_order_release); }
+
+void LockMgr::Lock(size_t latch) {
+#ifndef LOCKLESS
+  const auto self = ThreadId();
+  if (self == owner_.load(std::memory_order_relaxed)) {
+    if (owner_depth_++ == 0) {
+      // the owner announces itself and then looks for guests, a guest does the reverse,
+      // so at least one of them sees the other
+      owner_busy_.store(true);
+      owner_free_ = guests_.load() == 0;
+      if (owner_free_) {
+        Add(LocalStats().locks, 1);
+        return;
+      }
+      owner_busy_.store(false, std::memory_order_release);
+    } else if (owner_free_) {
+      return;
+    }
+  } else {
+    guests_.fetch_add(1);
+    for (int i = 0; owner_busy_.load(); ++i) {
+      if (i < kSpins) {
+        CpuRelax();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+  lockLatch(latches_[latch], self);
 #endif
 }
 
-// Helper function for TryLock().
-Status LockMgr::Acquire(const std::shared_ptr<LockMapStripe>& stripe, const std::string& key) {
-  Status result;
+void LockMgr::lockLatch(Latch& l, uint64_t self) {
+  if (l.owner.load(std::memory_order_relaxed) == self) {
+    ++l.depth;
+    return;
+  }
 
-  // we wait indefinitely to acquire the lock
-  result = stripe->stripe_mutex->Lock();
+  uint32_t expected = 0;
+  if (!l.state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+    lockSlow(l);
+  }
+  l.owner.store(self, std::memory_order_relaxed);
+  l.depth = 1;
+
+  auto& stats = LocalStats();
+  Add(stats.locks, 1);
+  if (--stats.countdown == 0) {
+    stats.countdown = kHoldSample;
+    l.since_ns = NowNanos();
+  } else {
+    l.since_ns = 0;
+  }
+}
 
-  if (!result.ok()) {
-    // failed to acquire mutex
-    return result;
+void LockMgr::lockSlow(Latch& l) {
+  auto& stats = LocalStats();
+  const auto start = NowNanos();
+  Add(stats.contended, 1);
+
+  for (int i = 0; i < kSpins; ++i) {
+    CpuRelax();
+    uint32_t expected = 0;
+    if (l.state.load(std::memory_order_relaxed) == 0 &&
+        l.state.compare_exchange_weak(expected, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+      Add(stats.wait_ns, NowNanos() - start);
+      return;
+    }
   }
 
-  // Acquire lock if we are able to
-  result = AcquireLocked(stripe, key);
+  // from here on the latch is left in state 2, so the unlock wakes a waiter
+  Add(stats.parked, 1);
+  while (l.state.exchange(2, std::memory_order_acquire) != 0) {
+    l.state.wait(2, std::memory_order_relaxed);
+  }
+  Add(stats.wait_ns, NowNanos() - start);
+}
 
-  if (!result.ok()) {
-    // If we weren't able to acquire the lock, we will keep retrying
-    do {
-      result = stripe->stripe_cv->Wait(stripe->stripe_mutex);
-      if (result.ok()) {
-        result = AcquireLocked(stripe, key);
+void LockMgr::UnLock(size_t latch) {
+#ifndef LOCKLESS
+  const bool owner = ThreadId() == owner_.load(std::memory_order_relaxed);
+  if (owner) {
+    --owner_depth_;
+    if (owner_free_) {
+      if (owner_depth_ == 0) {
+        owner_free_ = false;
+        owner_busy_.store(false, std::memory_order_release);
       }
-    } while (!result.ok());
+      return;
+    }
   }
-
-  stripe->stripe_mutex->UnLock();
-
-  return result;
+  unlockLatch(latches_[latch]);
+  if (!owner) {
+    guests_.fetch_sub(1, std::memory_order_release);
+  }
+#endif
 }
 
-// Try to lock this key after we have acquired the mutex.
-// REQUIRED:  Stripe mutex must be held.
-Status LockMgr::AcquireLocked(const std::shared_ptr<LockMapStripe>& stripe, const std::string& key) {
-  Status result;
-  // Check if this key is already locked
-  if (stripe->keys.find(key) != stripe->keys.end()) {
-    // Lock already held
-    result = Status::Busy("LockTimeout");
-  } else {  // Lock not held.
-    // Check lock limit
-    if (max_num_locks_ > 0 && lock_map_->lock_cnt.load(std::memory_order_acquire) >= max_num_locks_) {
-      result = Status::Busy("LockLimit");
-    } else {
-      // acquire lock
-      stripe->keys.insert(key);
-
-      // Maintain lock count if there is a limit on the number of locks
-      if (max_num_locks_ != 0) {
-        lock_map_->lock_cnt++;
-      }
+void LockMgr::unlockLatch(Latch& l) {
+  if (--l.depth > 0) {
+    return;
+  }
+
+  if (l.since_ns != 0) {
+    auto& stats = LocalStats();
+    const auto held = NowNanos() - l.since_ns;
+    Add(stats.hold_samples, 1);
+    Add(stats.hold_ns, held);
+    if (held > stats.max_hold_ns.load(std::memory_order_relaxed)) {
+      stats.max_hold_ns.store(held, std::memory_order_relaxed);
     }
   }
 
-  return result;
+  l.owner.store(0, std::memory_order_relaxed);
+  if (l.state.exchange(0, std::memory_order_release) == 2) {
+    l.state.notify_one();
+  }
 }
 
-void LockMgr::UnLockKey(const std::string& key, const std::shared_ptr<LockMapStripe>& stripe) {
-#ifdef LOCKLESS
-#else
-  auto stripe_iter = stripe->keys.find(key);
-  if (stripe_iter != stripe->keys.end()) {
-    // Found the key locked.  unlock it.
-    stripe->keys.erase(stripe_iter);
-    if (max_num_locks_ > 0) {
-      // Maintain lock count if there is a limit on the number of locks.
-      assert(lock_map_->lock_cnt.load(std::memory_order_relaxed) > 0);
-      lock_map_->lock_cnt--;
-    }
-  } else {
-    // This key is either not locked or locked by someone else.
+void LockMgr::LockBatch(std::vector<size_t>* latches) {
+  std::sort(latches->begin(), latches->end());
+  latches->erase(std::unique(latches->begin(), latches->end()), latches->end());
+  for (auto latch : *latches) {
+    Lock(latch);
   }
-#endif
 }
 
-void LockMgr::UnLock(const std::string& key) {
-  // Lock the mutex for the stripe that this key hashes to
-  size_t stripe_num = lock_map_->GetStripe(key);
-  assert(lock_map_->lock_map_stripes_.size() > stripe_num);
-  auto stripe = lock_map_->lock_map_stripes_.at(stripe_num);
+void LockMgr::UnLockBatch(const std::vector<size_t>& latches) {
+  for (auto it = latches.rbegin(); it != latches.rend(); ++it) {
+    UnLock(*it);
+  }
+}
 
-  stripe->stripe_mutex->Lock();
-  UnLockKey(key, stripe);
-  stripe->stripe_mutex->UnLock();
+LockStats LockMgr::GetStats() { return Registry().Collect(); }
 
-  // Signal waiting threads to retry locking
-  stripe->stripe_cv->NotifyAll();
-}
 }  // namespace pstd::lock
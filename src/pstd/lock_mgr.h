@@ -7,49 +7,91 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
-#include <string>
+#include <string_view>
+#include <vector>
 
-#include "mutex.h"
 #include "noncopyable.h"
 
 namespace pstd {
 
 namespace lock {
-struct LockMap;
-struct LockMapStripe;
 
+// counters of every LockMgr, summed over all threads
+struct LockStats {
+  uint64_t locks = 0;         // outermost acquisitions
+  uint64_t contended = 0;     // acquisitions that found the latch taken
+  uint64_t parked = 0;        // contended acquisitions that had to sleep after spinning
+  uint64_t wait_ns = 0;       // time spent in contended acquisitions
+  uint64_t hold_samples = 0;  // acquisitions whose hold time was measured
+  uint64_t hold_ns = 0;       // total hold time of the sampled acquisitions
+  uint64_t max_hold_ns = 0;
+};
+
+/**
+ * @brief Key lock table
+ * A fixed number of cache line sized latches, a key locks the latch its hash maps to.
+ * Callers hash the key once and keep the latch index, so locking allocates nothing.
+ * A waiter spins for a while and then parks on the latch word.
+ * Latches are reentrant for the thread holding them, so a batch taken around several
+ * calls doesn't deadlock with the single key locks inside them. Batches are locked in
+ * ascending latch order; keys of different LockMgr must be batched in one fixed order
+ * of the managers as well.
+ * A thread may own the table, see SetOwner: while no other thread locks, it locks no
+ * latch at all, as if it held them all for the call at hand. Another thread announces
+ * itself and waits for that call to end, then both use the latches until it is done.
+ */
 class LockMgr : public pstd::noncopyable {
  public:
-  LockMgr(size_t default_num_stripes, int64_t max_num_locks, const std::shared_ptr<MutexFactory>& factory);
+  // num_latches is rounded up to a power of 2
+  explicit LockMgr(size_t num_latches);
 
   ~LockMgr();
 
-  // Attempt to lock key.  If OK status is returned, the caller is responsible
-  // for calling UnLock() on this key.
-  Status TryLock(const std::string& key);
+  static uint64_t Hash(std::string_view key);
 
-  // Unlock a key locked by TryLock().
-  void UnLock(const std::string& key);
+  size_t LatchOf(uint64_t hash) const { return hash & mask_; }
+  size_t LatchOf(std::string_view key) const { return LatchOf(Hash(key)); }
 
- private:
-  // Default number of lock map stripes
-  const size_t default_num_stripes_ [[maybe_unused]];
+  void Lock(size_t latch);
+  void UnLock(size_t latch);
 
-  // Limit on number of keys locked per column family
-  const int64_t max_num_locks_;
+  // the calling thread owns the table from now on, it must hold no latch of it
+  void SetOwner();
 
-  // Used to allocate mutexes/condvars to use when locking keys
-  std::shared_ptr<MutexFactory> mutex_factory_;
+  // sorts and dedups latches, then locks them in that order
+  void LockBatch(std::vector<size_t>* latches);
+  // latches as left by LockBatch
+  void UnLockBatch(const std::vector<size_t>& latches);
 
-  // Map to locked key info
-  std::shared_ptr<LockMap> lock_map_;
+  static LockStats GetStats();
 
-  Status Acquire(const std::shared_ptr<LockMapStripe>& stripe, const std::string& key);
-
-  Status AcquireLocked(const std::shared_ptr<LockMapStripe>& stripe, const std::string& key);
-
-  void UnLockKey(const std::string& key, const std::shared_ptr<LockMapStripe>& stripe);
+ private:
+  struct alignas(64) Latch {
+    std::atomic<uint32_t> state{0};  // 0 free, 1 locked, 2 locked and a waiter may be parked
+    // id of the holding thread, only ever equal to the id of the reader while it holds the latch
+    std::atomic<uint64_t> owner{0};
+    uint32_t depth = 0;     // touched by the holder only
+    uint64_t since_ns = 0;  // lock time when sampled, touched by the holder only
+  };
+
+  void lockLatch(Latch& latch, uint64_t self);
+  void lockSlow(Latch& latch);
+  void unlockLatch(Latch& latch);
+
+  std::unique_ptr<Latch[]> latches_;
+  const size_t mask_;
+
+  std::atomic<uint64_t> owner_{0};  // id of the owning thread, 0 for none
+  // locks taken by the other threads and not released yet
+  alignas(64) std::atomic<uint32_t> guests_{0};
+  // the owner is in a call without the latches
+  alignas(64) std::atomic<bool> owner_busy_{false};
+  // touched by the owner only: its nested locks, and whether the outermost one skipped the latches
+  uint32_t owner_depth_ = 0;
+  bool owner_free_ = false;
 };
 
 }  //  namespace lock
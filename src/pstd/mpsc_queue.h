@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace pstd {
+
+// Unbounded lock-free multi-producer single-consumer queue, after Dmitry Vyukov's
+// intrusive MPSC node-based queue. Push is wait-free and may be called from any
+// thread, TryPop/Empty must only be called by the single consumer.
+template <typename T>
+class MPSCQueue final {
+ public:
+  MPSCQueue() : head_(new Node), tail_(head_.load(std::memory_order_relaxed)) {}
+
+  ~MPSCQueue() {
+    while (tail_) {
+      Node* next = tail_->next.load(std::memory_order_relaxed);
+      delete tail_;
+      tail_ = next;
+    }
+  }
+
+  MPSCQueue(const MPSCQueue&) = delete;
+  void operator=(const MPSCQueue&) = delete;
+
+  void Push(T value) {
+    auto node = new Node(std::move(value));
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  bool TryPop(T& value) {
+    Node* next = tail_->next.load(std::memory_order_acquire);
+    if (!next) {
+      return false;
+    }
+
+    value = std::move(*next->value);
+    next->value.reset();
+    delete tail_;
+    tail_ = next;
+    return true;
+  }
+
+  // a push in progress may not be visible yet
+  bool Empty() const { return tail_->next.load(std::memory_order_acquire) == nullptr; }
+
+ private:
+  struct Node {
+    Node() = default;
+    explicit Node(T v) : value(std::move(v)) {}
+
+    std::atomic<Node*> next{nullptr};
+    std::optional<T> value;
+  };
+
+  // producers and the consumer work on different ends, keep them apart
+  alignas(64) std::atomic<Node*> head_;
+  alignas(64) Node* tail_;
+};
+
+}  // namespace pstd
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace pstd {
+
+// Immutable map from short names to values, keys compare ignoring ASCII case.
+// Build picks a hash seed and a power of two table size under which no two keys share a slot,
+// so Find is one hash over the bytes plus one comparison: no probing, no lock, no allocation.
+// The keys aren't copied, they must outlive the map.
+// Build is not thread safe, Find may be called from any thread once Build returned.
+template <typename T>
+class PerfectHashMap {
+ public:
+  // return false if two keys are equal ignoring case
+  bool Build(const std::vector<std::pair<std::string_view, T>>& entries) {
+    for (size_t size = MinSize(entries.size()); size <= kMaxSize; size <<= 1) {
+      for (uint64_t seed = 1; seed <= kMaxSeeds; ++seed) {
+        if (TryBuild(entries, size, seed)) {
+          return true;
+        }
+        if (duplicated_) {
+          return false;
+        }
+      }
+    }
+    return false;
+  }
+
+  // return nullptr if not found
+  const T* Find(std::string_view name) const {
+    if (slots_.empty()) {
+      return nullptr;
+    }
+    const auto& slot = slots_[Hash(name, seed_) & mask_];
+    if (!slot.used || !EqualsIgnoreCase(slot.name, name)) {
+      return nullptr;
+    }
+    return &slot.value;
+  }
+
+  size_t Size() const { return size_; }
+  size_t Capacity() const { return slots_.size(); }
+
+  static char ToLower(char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c; }
+
+  // FNV-1a over the lowercased bytes
+  static uint64_t Hash(std::string_view name, uint64_t seed) {
+    uint64_t h = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+    for (auto c : name) {
+      h ^= static_cast<unsigned char>(ToLower(c));
+      h *= 1099511628211ULL;
+    }
+    return h ^ (h >> 29);
+  }
+
+  static bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+      if (ToLower(a[i]) != ToLower(b[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  struct Slot {
+    std::string_view name;
+    T value{};
+    bool used = false;
+  };
+
+  static constexpr size_t kMaxSize = 1 << 20;
+  static constexpr uint64_t kMaxSeeds = 256;
+
+  static size_t MinSize(size_t n) {
+    size_t size = 8;
+    while (size < n * 2) {
+      size <<= 1;
+    }
+    return size;
+  }
+
+  bool TryBuild(const std::vector<std::pair<std::string_view, T>>& entries, size_t size, uint64_t seed) {
+    std::vector<Slot> slots(size);
+    for (const auto& [name, value] : entries) {
+      auto& slot = slots[Hash(name, seed) & (size - 1)];
+      if (slot.used) {
+        duplicated_ = EqualsIgnoreCase(slot.name, name);
+        return false;
+      }
+      slot.used = true;
+      slot.name = name;
+      slot.value = value;
+    }
+
+    slots_ = std::move(slots);
+    mask_ = size - 1;
+    seed_ = seed;
+    size_ = entries.size();
+    return true;
+  }
+
+  std::vector<Slot> slots_;
+  size_t mask_ = 0;
+  uint64_t seed_ = 0;
+  size_t size_ = 0;
+  bool duplicated_ = false;
+};
+
+}  // namespace pstd
@@ -11,69 +11,32 @@
 
 namespace pstd::lock {
 
-MultiScopeRecordLock::MultiScopeRecordLock(const std::shared_ptr<LockMgr>& lock_mgr,
-                                           const std::vector<std::string>& keys)
-    : lock_mgr_(lock_mgr), keys_(keys) {
-  std::string pre_key;
-  std::sort(keys_.begin(), keys_.end());
-  if (!keys_.empty() && keys_[0].empty()) {
-    lock_mgr_->TryLock(pre_key);
-  }
-
-  for (const auto& key : keys_) {
-    if (pre_key != key) {
-      lock_mgr_->TryLock(key);
-      pre_key = key;
-    }
+static std::vector<size_t> LatchesOf(const LockMgr& lock_mgr, const std::vector<std::string>& keys) {
+  std::vector<size_t> latches;
+  latches.reserve(keys.size());
+  for (const auto& key : keys) {
+    latches.push_back(lock_mgr.LatchOf(key));
   }
+  return latches;
 }
-MultiScopeRecordLock::~MultiScopeRecordLock() {
-  std::string pre_key;
-  if (!keys_.empty() && keys_[0].empty()) {
-    lock_mgr_->UnLock(pre_key);
-  }
 
-  for (const auto& key : keys_) {
-    if (pre_key != key) {
-      lock_mgr_->UnLock(key);
-      pre_key = key;
-    }
-  }
+MultiScopeRecordLock::MultiScopeRecordLock(const std::shared_ptr<LockMgr>& lock_mgr,
+                                           const std::vector<std::string>& keys)
+    : lock_mgr_(lock_mgr), latches_(LatchesOf(*lock_mgr, keys)) {
+  lock_mgr_->LockBatch(&latches_);
 }
 
-void MultiRecordLock::Lock(const std::vector<std::string>& keys) {
-  std::vector<std::string> internal_keys = keys;
-  std::sort(internal_keys.begin(), internal_keys.end());
-  // init to be ""
-  std::string pre_key;
-  // consider internal_keys "" "" "a"
-  if (!internal_keys.empty()) {
-    lock_mgr_->TryLock(internal_keys.front());
-    pre_key = internal_keys.front();
-  }
+MultiScopeRecordLock::~MultiScopeRecordLock() { lock_mgr_->UnLockBatch(latches_); }
 
-  for (const auto& key : internal_keys) {
-    if (pre_key != key) {
-      lock_mgr_->TryLock(key);
-      pre_key = key;
-    }
-  }
+void MultiRecordLock::Lock(const std::vector<std::string>& keys) {
+  auto latches = LatchesOf(*lock_mgr_, keys);
+  lock_mgr_->LockBatch(&latches);
 }
 
 void MultiRecordLock::Unlock(const std::vector<std::string>& keys) {
-  std::vector<std::string> internal_keys = keys;
-  std::sort(internal_keys.begin(), internal_keys.end());
-  std::string pre_key;
-  if (!internal_keys.empty()) {
-    lock_mgr_->UnLock(internal_keys.front());
-    pre_key = internal_keys.front();
-  }
-
-  for (const auto& key : internal_keys) {
-    if (pre_key != key) {
-      lock_mgr_->UnLock(key);
-      pre_key = key;
-    }
-  }
+  auto latches = LatchesOf(*lock_mgr_, keys);
+  std::sort(latches.begin(), latches.end());
+  latches.erase(std::unique(latches.begin(), latches.end()), latches.end());
+  lock_mgr_->UnLockBatch(latches);
 }
 }  // namespace pstd::lock
@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -22,16 +23,18 @@ using Slice = rocksdb::Slice;
 
 class ScopeRecordLock final : public pstd::noncopyable {
  public:
-  ScopeRecordLock(const std::shared_ptr<LockMgr>& lock_mgr, const Slice& key) : lock_mgr_(lock_mgr), key_(key) {
-    lock_mgr_->TryLock(key_.ToString());
+  ScopeRecordLock(const std::shared_ptr<LockMgr>& lock_mgr, const Slice& key)
+      : lock_mgr_(lock_mgr), latch_(lock_mgr->LatchOf(std::string_view(key.data(), key.size()))) {
+    lock_mgr_->Lock(latch_);
   }
-  ~ScopeRecordLock() { lock_mgr_->UnLock(key_.ToString()); }
+  ~ScopeRecordLock() { lock_mgr_->UnLock(latch_); }
 
  private:
   std::shared_ptr<LockMgr> const lock_mgr_;
-  Slice key_;
+  const size_t latch_;
 };
 
+// locks the latches of all keys in ascending order
 class MultiScopeRecordLock final : public pstd::noncopyable {
  public:
   MultiScopeRecordLock(const std::shared_ptr<LockMgr>& lock_mgr, const std::vector<std::string>& keys);
@@ -39,7 +42,7 @@ class MultiScopeRecordLock final : public pstd::noncopyable {
 
  private:
   std::shared_ptr<LockMgr> const lock_mgr_;
-  std::vector<std::string> keys_;
+  std::vector<size_t> latches_;
 };
 
 class MultiRecordLock : public noncopyable {
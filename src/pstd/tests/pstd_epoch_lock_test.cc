@@ -0,0 +1,129 @@
+// Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "pstd/epoch_lock.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+TEST(EpochLockTest, NestedRead) {
+  pstd::EpochLock lock;
+  lock.lock_shared();
+  lock.lock_shared();
+  lock.unlock_shared();
+  lock.unlock_shared();
+
+  // no reader left, the writer doesn't wait
+  lock.lock();
+  lock.unlock();
+}
+
+TEST(EpochLockTest, WriterWaitsForReaders) {
+  pstd::EpochLock lock;
+  std::atomic<bool> locked{false};
+
+  lock.lock_shared();
+  std::thread writer([&]() {
+    std::unique_lock guard(lock);
+    locked = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(locked);
+  lock.unlock_shared();
+  writer.join();
+  ASSERT_TRUE(locked);
+}
+
+TEST(EpochLockTest, WriterWaitsForEveryGroup) {
+  pstd::EpochLock lock;
+  std::atomic<size_t> reading{0};
+  std::atomic<bool> release{false};
+  std::atomic<bool> locked{false};
+
+  // readers in several slot groups, the last one alone in its group
+  std::vector<std::thread> readers;
+  for (size_t i = 0; i < pstd::EpochLock::kGroupSlots * 2 + 1; ++i) {
+    readers.emplace_back([&]() {
+      std::shared_lock guard(lock);
+      reading.fetch_add(1);
+      while (!release) {
+        std::this_thread::yield();
+      }
+    });
+  }
+  while (reading < readers.size()) {
+    std::this_thread::yield();
+  }
+
+  std::thread writer([&]() {
+    std::unique_lock guard(lock);
+    locked = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(locked);
+  release = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+  writer.join();
+  ASSERT_TRUE(locked);
+}
+
+TEST(EpochLockTest, ReadersExcludeWriter) {
+  pstd::EpochLock lock;
+  uint64_t a = 0;
+  uint64_t b = 0;
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> torn{0};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&]() {
+      while (!stop.load(std::memory_order_relaxed)) {
+        std::shared_lock guard(lock);
+        if (a != b) {
+          torn.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+
+  for (int i = 0; i < 1000; ++i) {
+    std::unique_lock guard(lock);
+    ++a;
+    std::this_thread::yield();
+    ++b;
+  }
+  stop = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+  ASSERT_EQ(torn.load(), 0);
+  ASSERT_EQ(a, 1000);
+}
+
+TEST(EpochLockTest, ThreadIndexReuse) {
+  pstd::EpochLock lock;
+  // more threads over time than kMaxThreads, only a few alive at once
+  for (size_t round = 0; round < pstd::EpochLock::kMaxThreads / 8 + 16; ++round) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 16; ++i) {
+      threads.emplace_back([&lock]() {
+        std::shared_lock guard(lock);
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+  lock.lock();
+  lock.unlock();
+}
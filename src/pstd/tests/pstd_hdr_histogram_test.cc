@@ -0,0 +1,75 @@
+// Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "pstd/hdr_histogram.h"
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using pstd::HistogramBuckets;
+
+TEST(HdrHistogramTest, Buckets) {
+  for (int i = 0; i < HistogramBuckets::kCount; ++i) {
+    auto low = HistogramBuckets::LowerBound(i);
+    ASSERT_EQ(HistogramBuckets::Index(low), i);
+    ASSERT_EQ(HistogramBuckets::Index(HistogramBuckets::UpperBound(i)), i);
+    // relative error bounded by the sub bucket count
+    ASSERT_LE(HistogramBuckets::UpperBound(i) - low, low / HistogramBuckets::kSubCount);
+  }
+  ASSERT_EQ(HistogramBuckets::Index(UINT64_MAX), HistogramBuckets::kCount - 1);
+}
+
+TEST(HdrHistogramTest, Percentile) {
+  pstd::Histogram hist;
+  for (uint64_t v = 1; v <= 1000; ++v) {
+    hist.Record(v * 1000);
+  }
+
+  pstd::HistogramSnapshot snapshot;
+  hist.MergeTo(&snapshot);
+  ASSERT_EQ(snapshot.Count(), 1000);
+  ASSERT_EQ(snapshot.Sum(), 500500 * 1000);
+  ASSERT_EQ(snapshot.Max(), 1000000);
+  ASSERT_NEAR(snapshot.Percentile(50), 500000, 500000 / HistogramBuckets::kSubCount);
+  ASSERT_NEAR(snapshot.Percentile(99), 990000, 990000 / HistogramBuckets::kSubCount);
+  ASSERT_EQ(snapshot.Percentile(100), 1000000);
+}
+
+TEST(HdrHistogramTest, MergeWhileRecording) {
+  constexpr int kThreads = 4;
+  constexpr uint64_t kPerThread = 200000;
+  pstd::Histogram hists[kThreads];
+
+  std::vector<std::thread> threads;
+  for (auto& hist : hists) {
+    threads.emplace_back([&hist]() {
+      for (uint64_t i = 0; i < kPerThread; ++i) {
+        hist.Record(i % 100);
+      }
+    });
+  }
+
+  uint64_t last = 0;
+  for (int round = 0; round < 100; ++round) {
+    pstd::HistogramSnapshot snapshot;
+    for (const auto& hist : hists) {
+      hist.MergeTo(&snapshot);
+    }
+    ASSERT_GE(snapshot.Count(), last);
+    last = snapshot.Count();
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  pstd::HistogramSnapshot snapshot;
+  for (const auto& hist : hists) {
+    hist.MergeTo(&snapshot);
+  }
+  ASSERT_EQ(snapshot.Count(), kThreads * kPerThread);
+  ASSERT_EQ(snapshot.Max(), 99);
+}
@@ -0,0 +1,172 @@
+// Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "pstd/lock_mgr.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using pstd::lock::LockMgr;
+
+TEST(LockMgrTest, LatchOf) {
+  LockMgr mgr(1000);  // rounded up to 1024
+  for (int i = 0; i < 10000; ++i) {
+    auto key = "key" + std::to_string(i);
+    ASSERT_LT(mgr.LatchOf(key), 1024);
+    ASSERT_EQ(mgr.LatchOf(key), mgr.LatchOf(LockMgr::Hash(key)));
+  }
+}
+
+TEST(LockMgrTest, Reentrant) {
+  LockMgr mgr(16);
+  std::atomic<bool> locked{false};
+
+  mgr.Lock(3);
+  mgr.Lock(3);
+  mgr.UnLock(3);
+
+  std::thread other([&]() {
+    mgr.Lock(3);
+    locked = true;
+    mgr.UnLock(3);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(locked);  // still held once
+
+  mgr.UnLock(3);
+  other.join();
+  ASSERT_TRUE(locked);
+}
+
+TEST(LockMgrTest, MutualExclusion) {
+  LockMgr mgr(4);
+  uint64_t counter = 0;
+  const int kThreads = 8;
+  const int kLoops = 20000;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < kLoops; ++i) {
+        mgr.Lock(1);
+        ++counter;
+        mgr.UnLock(1);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(counter, kThreads * kLoops);
+}
+
+TEST(LockMgrTest, BatchSortedAndDeduped) {
+  LockMgr mgr(64);
+  std::vector<size_t> latches{9, 2, 9, 40, 2};
+  mgr.LockBatch(&latches);
+  ASSERT_EQ(latches, (std::vector<size_t>{2, 9, 40}));
+  mgr.UnLockBatch(latches);
+
+  // batches in opposite key order don't deadlock
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&mgr, t]() {
+      for (int i = 0; i < 5000; ++i) {
+        std::vector<size_t> batch = t % 2 ? std::vector<size_t>{1, 2, 3} : std::vector<size_t>{3, 2, 1};
+        mgr.LockBatch(&batch);
+        mgr.UnLockBatch(batch);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+TEST(LockMgrTest, Stats) {
+  auto before = LockMgr::GetStats();
+  LockMgr mgr(8);
+  for (int i = 0; i < 100; ++i) {
+    mgr.Lock(0);
+    mgr.Lock(0);  // nested, not counted
+    mgr.UnLock(0);
+    mgr.UnLock(0);
+  }
+  auto after = LockMgr::GetStats();
+  ASSERT_EQ(after.locks - before.locks, 100);
+  ASSERT_GE(after.hold_samples, before.hold_samples + 1);
+}
+
+TEST(LockMgrTest, OwnerExcludesGuests) {
+  LockMgr mgr(4);
+  uint64_t counter = 0;
+  const int kGuests = 4;
+  const int kLoops = 20000;
+
+  std::thread owner([&]() {
+    mgr.SetOwner();
+    for (int i = 0; i < kLoops; ++i) {
+      mgr.Lock(1);
+      mgr.Lock(1);  // nested, as a batch around single key locks
+      ++counter;
+      mgr.UnLock(1);
+      mgr.UnLock(1);
+    }
+  });
+  std::vector<std::thread> guests;
+  for (int t = 0; t < kGuests; ++t) {
+    guests.emplace_back([&]() {
+      for (int i = 0; i < kLoops; ++i) {
+        mgr.Lock(1);
+        ++counter;
+        mgr.UnLock(1);
+      }
+    });
+  }
+  owner.join();
+  for (auto& t : guests) {
+    t.join();
+  }
+  ASSERT_EQ(counter, (kGuests + 1) * kLoops);
+}
+
+TEST(LockMgrTest, GuestWaitsForOwner) {
+  LockMgr mgr(4);
+  std::atomic<bool> held{false};
+  std::atomic<bool> release{false};
+  std::atomic<bool> locked{false};
+
+  std::thread owner([&]() {
+    mgr.SetOwner();
+    mgr.Lock(0);  // no guest yet, no latch taken
+    held = true;
+    while (!release) {
+      std::this_thread::yield();
+    }
+    mgr.UnLock(0);
+  });
+  while (!held) {
+    std::this_thread::yield();
+  }
+
+  // another latch, still excluded while the owner is in its call
+  std::thread guest([&]() {
+    mgr.Lock(2);
+    locked = true;
+    mgr.UnLock(2);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(locked);
+
+  release = true;
+  owner.join();
+  guest.join();
+  ASSERT_TRUE(locked);
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "pstd/mpsc_queue.h"
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(MPSCQueueTest, PushPop) {
+  pstd::MPSCQueue<std::unique_ptr<int>> queue;
+  std::unique_ptr<int> out;
+  int expected = 0;
+  ASSERT_TRUE(queue.Empty());
+  ASSERT_FALSE(queue.TryPop(out));
+
+  for (int i = 0; i < 10; ++i) {
+    queue.Push(std::make_unique<int>(i));
+  }
+  ASSERT_FALSE(queue.Empty());
+  while (queue.TryPop(out)) {
+    ASSERT_EQ(*out, expected++);
+  }
+  ASSERT_EQ(expected, 10);
+  ASSERT_TRUE(queue.Empty());
+
+  // left over elements are released by the destructor
+  queue.Push(std::make_unique<int>(0));
+}
+
+TEST(MPSCQueueTest, MultiProducer) {
+  constexpr int kProducers = 8;
+  constexpr int kPerProducer = 100000;
+  pstd::MPSCQueue<std::pair<int, int>> queue;
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&queue, p]() {
+      for (int i = 0; i < kPerProducer; ++i) {
+        queue.Push({p, i});
+      }
+    });
+  }
+
+  // elements of one producer come out in the order they were pushed
+  std::vector<int> next(kProducers, 0);
+  int total = 0;
+  std::pair<int, int> item;
+  while (total < kProducers * kPerProducer) {
+    if (!queue.TryPop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(item.second, next[item.first]);
+    ++next[item.first];
+    ++total;
+  }
+
+  for (auto& t : producers) {
+    t.join();
+  }
+  ASSERT_TRUE(queue.Empty());
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "pstd/perfect_hash_map.h"
+#include <gtest/gtest.h>
+
+#include <cctype>
+#include <string>
+#include <utility>
+#include <vector>
+
+TEST(PerfectHashMapTest, FindIgnoreCase) {
+  pstd::PerfectHashMap<int> map;
+  ASSERT_EQ(map.Find("get"), nullptr);
+
+  std::vector<std::pair<std::string_view, int>> entries = {{"get", 1}, {"set", 2}, {"config", 3}, {"zrevrangebylex", 4}};
+  ASSERT_TRUE(map.Build(entries));
+  ASSERT_EQ(map.Size(), entries.size());
+
+  for (const auto& [name, value] : entries) {
+    auto found = map.Find(name);
+    ASSERT_NE(found, nullptr);
+    ASSERT_EQ(*found, value);
+  }
+  ASSERT_EQ(*map.Find("GET"), 1);
+  ASSERT_EQ(*map.Find("SeT"), 2);
+  ASSERT_EQ(*map.Find("CONFIG"), 3);
+
+  ASSERT_EQ(map.Find(""), nullptr);
+  ASSERT_EQ(map.Find("ge"), nullptr);
+  ASSERT_EQ(map.Find("gett"), nullptr);
+  ASSERT_EQ(map.Find("mget"), nullptr);
+  ASSERT_EQ(map.Find("g\x05t"), nullptr);
+}
+
+TEST(PerfectHashMapTest, Duplicated) {
+  pstd::PerfectHashMap<int> map;
+  ASSERT_FALSE(map.Build({{"get", 1}, {"GET", 2}}));
+}
+
+TEST(PerfectHashMapTest, KeysAsGiven) {
+  // the keys are compared ignoring case whatever their own case
+  pstd::PerfectHashMap<int> map;
+  ASSERT_TRUE(map.Build({{"Get", 1}, {"SET", 2}}));
+  ASSERT_EQ(*map.Find("get"), 1);
+  ASSERT_EQ(*map.Find("gEt"), 1);
+  ASSERT_EQ(*map.Find("set"), 2);
+  ASSERT_EQ(map.Find("Gets"), nullptr);
+}
+
+TEST(PerfectHashMapTest, ManyKeys) {
+  std::vector<std::string> names;
+  std::vector<std::pair<std::string_view, int>> entries;
+  for (int i = 0; i < 500; ++i) {
+    names.push_back("cmd" + std::to_string(i));
+  }
+  for (int i = 0; i < 500; ++i) {
+    entries.emplace_back(names[i], i);
+  }
+
+  pstd::PerfectHashMap<int> map;
+  ASSERT_TRUE(map.Build(entries));
+  for (const auto& [name, value] : entries) {
+    std::string upper(name);
+    for (auto& c : upper) {
+      c = static_cast<char>(toupper(c));
+    }
+    ASSERT_EQ(*map.Find(upper), value);
+  }
+  ASSERT_EQ(map.Find("cmd500"), nullptr);
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "pstd/work_stealing_pool.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+TEST(WorkStealingPoolTest, RunsEveryTask) {
+  std::atomic<int> done{0};
+  {
+    pstd::WorkStealingPool pool(4);
+    ASSERT_EQ(pool.Size(), 4);
+    std::vector<std::thread> submitters;
+    for (int t = 0; t < 4; ++t) {
+      submitters.emplace_back([&pool, &done]() {
+        for (int i = 0; i < 10000; ++i) {
+          ASSERT_TRUE(pool.Submit([&done]() { done.fetch_add(1, std::memory_order_relaxed); }));
+        }
+      });
+    }
+    for (auto& t : submitters) {
+      t.join();
+    }
+    // the destructor runs the tasks left
+  }
+  ASSERT_EQ(done.load(), 40000);
+}
+
+TEST(WorkStealingPoolTest, SubmitAfterStop) {
+  pstd::WorkStealingPool pool(2);
+  pool.Stop();
+  ASSERT_FALSE(pool.Submit([]() {}));
+  ASSERT_EQ(pool.Pending(), 0);
+}
+
+TEST(WorkStealingPoolTest, IdleWorkerSteals) {
+  pstd::WorkStealingPool pool(2);
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  std::promise<void> stolen;
+
+  // the tasks submitted by a task go to its own worker, blocked here, so the other one must steal
+  ASSERT_TRUE(pool.Submit([&pool, released, &stolen]() {
+    pool.Submit([&stolen]() { stolen.set_value(); });
+    released.wait();
+  }));
+  auto result = stolen.get_future().wait_for(std::chrono::seconds(10));
+  release.set_value();
+  ASSERT_EQ(result, std::future_status::ready);
+  ASSERT_GE(pool.Steals(), 1U);
+}
+
+TEST(WorkStealingPoolTest, TasksSubmittedByTasks) {
+  std::atomic<int> done{0};
+  {
+    pstd::WorkStealingPool pool(3);
+    for (int i = 0; i < 100; ++i) {
+      pool.Submit([&pool, &done]() {
+        for (int j = 0; j < 100; ++j) {
+          pool.Submit([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+        }
+      });
+    }
+    // a task still submitting when the pool stops would have its tasks dropped
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (done.load() < 10000 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  ASSERT_EQ(done.load(), 10000);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+
+namespace pstd {
+
+thread_local const WorkStealingPool* WorkStealingPool::current_pool_ = nullptr;
+thread_local size_t WorkStealingPool::current_index_ = 0;
+
+WorkStealingPool::WorkStealingPool(size_t threads) {
+  threads = std::max<size_t>(threads, 1);
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back([this, i]() { run(i); });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() { Stop(); }
+
+bool WorkStealingPool::Submit(Task task) {
+  // counted before it is queued, so the workers don't stop with a task left
+  {
+    std::lock_guard guard(sleep_mutex_);
+    if (stop_) {
+      return false;
+    }
+    pending_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  size_t index = current_pool_ == this ? current_index_ : next_.fetch_add(1, std::memory_order_relaxed);
+  auto& worker = *workers_[index % workers_.size()];
+  {
+    std::lock_guard guard(worker.mutex);
+    worker.tasks.push_back(std::move(task));
+  }
+  cond_.notify_one();
+  return true;
+}
+
+void WorkStealingPool::Stop() {
+  {
+    std::lock_guard guard(sleep_mutex_);
+    if (stop_) {
+      return;
+    }
+    stop_ = true;
+  }
+  cond_.notify_all();
+  for (auto& t : threads_) {
+    if (t.joinable()) {
+      t.join();
+    }
+  }
+}
+
+void WorkStealingPool::run(size_t self) {
+  current_pool_ = this;
+  current_index_ = self;
+
+  Task task;
+  while (true) {
+    if (take(self, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock guard(sleep_mutex_);
+    cond_.wait(guard, [this]() { return stop_ || pending_.load(std::memory_order_relaxed) > 0; });
+    if (stop_ && pending_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+  }
+}
+
+bool WorkStealingPool::take(size_t self, Task& task) {
+  if (pop(*workers_[self], task)) {
+    return true;
+  }
+  for (size_t i = 1; i < workers_.size(); ++i) {
+    if (pop(*workers_[(self + i) % workers_.size()], task)) {
+      steals_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool WorkStealingPool::pop(Worker& worker, Task& task) {
+  std::lock_guard guard(worker.mutex);
+  if (worker.tasks.empty()) {
+    return false;
+  }
+  task = std::move(worker.tasks.front());
+  worker.tasks.pop_front();
+  pending_.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+}  // namespace pstd
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pstd {
+
+// Fixed size pool with a task queue per worker. A task submitted from a worker goes to
+// its own queue, one from outside to the queues in turn. A worker runs its queue in
+// FIFO order and once empty takes the oldest task of another queue, so a long task
+// delays only the tasks queued behind it on its own worker until they are stolen.
+class WorkStealingPool final {
+ public:
+  using Task = std::function<void()>;
+
+  explicit WorkStealingPool(size_t threads);
+  // runs the tasks left, then joins the workers
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  void operator=(const WorkStealingPool&) = delete;
+
+  // false once stopped, the task is dropped then
+  bool Submit(Task task);
+  void Stop();
+
+  size_t Size() const { return workers_.size(); }
+  // submitted and not yet started
+  int64_t Pending() const { return pending_.load(std::memory_order_relaxed); }
+  uint64_t Steals() const { return steals_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void run(size_t self);
+  bool take(size_t self, Task& task);
+  bool pop(Worker& worker, Task& task);
+
+  static thread_local const WorkStealingPool* current_pool_;
+  static thread_local size_t current_index_;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> next_{0};
+  std::atomic<int64_t> pending_{0};
+  std::atomic<uint64_t> steals_{0};
+
+  std::mutex sleep_mutex_;  // only for idle workers to wait on cond_
+  std::condition_variable cond_;
+  bool stop_ = false;
+};
+
+}  // namespace pstd
@@ -126,6 +126,7 @@ std::size_t PPubsub::PublishMsg(const PString& channel, const PString& msg) {
   auto it(channels_.find(channel));
   if (it != channels_.end()) {
     Clients& clientSet = it->second;
+    std::shared_ptr<const std::string> shared_reply;  // formatted once for all subscribers
     for (auto itCli(clientSet.begin()); itCli != clientSet.end();) {
       auto cli = itCli->lock();
       if (!cli) {
@@ -133,12 +134,15 @@ std::size_t PPubsub::PublishMsg(const PString& channel, const PString& msg) {
       } else {
         INFO("Publish msg:{} to {}:{}", msg, cli->PeerIP(), cli->PeerPort());
 
-        UnboundedBuffer reply;
-        PreFormatMultiBulk(3, &reply);
-        FormatBulk("message", 7, &reply);
-        FormatBulk(channel, &reply);
-        FormatBulk(msg, &reply);
-        cli->SendPacket(reply);
+        if (!shared_reply) {
+          UnboundedBuffer reply;
+          PreFormatMultiBulk(3, &reply);
+          FormatBulk("message", 7, &reply);
+          FormatBulk(channel, &reply);
+          FormatBulk(msg, &reply);
+          shared_reply = std::make_shared<const std::string>(reply.ReadAddr(), reply.ReadableSize());
+        }
+        cli->SendPacket(shared_reply);
 
         ++itCli;
         ++n;
@@ -151,6 +155,7 @@ std::size_t PPubsub::PublishMsg(const PString& channel, const PString& msg) {
     if (fnmatch(pattern.first.c_str(), channel.c_str(), FNM_NOESCAPE) == 0) {
       INFO("{} match {}", channel, pattern.first);
       Clients& clientSet = pattern.second;
+      std::shared_ptr<const std::string> shared_reply;
       for (auto itCli(clientSet.begin()); itCli != clientSet.end();) {
         auto cli = itCli->lock();
         if (!cli) {
@@ -158,13 +163,16 @@ std::size_t PPubsub::PublishMsg(const PString& channel, const PString& msg) {
         } else {
           INFO("Publish msg:{} to {}:{}", msg, cli->PeerIP(), cli->PeerPort());
 
-          UnboundedBuffer reply;
-          PreFormatMultiBulk(4, &reply);
-          FormatBulk("pmessage", 8, &reply);
-          FormatBulk(pattern.first, &reply);
-          FormatBulk(channel, &reply);
-          FormatBulk(msg, &reply);
-          cli->SendPacket(reply);
+          if (!shared_reply) {
+            UnboundedBuffer reply;
+            PreFormatMultiBulk(4, &reply);
+            FormatBulk("pmessage", 8, &reply);
+            FormatBulk(pattern.first, &reply);
+            FormatBulk(channel, &reply);
+            FormatBulk(msg, &reply);
+            shared_reply = std::make_shared<const std::string>(reply.ReadAddr(), reply.ReadableSize());
+          }
+          cli->SendPacket(shared_reply);
 
           ++itCli;
           ++n;
@@ -137,7 +137,8 @@ void PReplication::SendToSlaves(const std::vector<PString>& params) {
     return;
   }
 
-  UnboundedBuffer ub;
+  // formatted once and shared by the slaves, which live in other threads
+  std::shared_ptr<const std::string> cmd;
 
   for (const auto& wptr : slaves_) {
     auto cli = wptr.lock();
@@ -145,11 +146,13 @@ void PReplication::SendToSlaves(const std::vector<PString>& params) {
       continue;
     }
 
-    if (ub.IsEmpty()) {
+    if (!cmd) {
+      UnboundedBuffer ub;
       SaveCommand(params, ub);
+      cmd = std::make_shared<const std::string>(ub.ReadAddr(), ub.ReadableSize());
     }
 
-    cli->SendPacket(ub);
+    cli->SendPacket(cmd);
   }
 }
 
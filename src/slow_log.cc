@@ -5,10 +5,11 @@
  * of patent rights can be found in the PATENTS file in the same directory.
  */
 
-#include <sys/time.h>
-#include <fstream>
+#include <algorithm>
+
+#include "rocksdb/perf_context.h"
+#include "rocksdb/perf_level.h"
 
-#include "log.h"
 #include "slow_log.h"
 
 namespace pikiwidb {
@@ -19,53 +20,109 @@ PSlowLog& PSlowLog::Instance() {
   return slog;
 }
 
-PSlowLog::PSlowLog() : threshold_(0), logger_(nullptr) {}
-
-PSlowLog::~PSlowLog() {}
+void PSlowLog::SetThreshold(int threshold) {
+  threshold_ns_.store(threshold < 0 ? -1 : static_cast<int64_t>(threshold) * 1000, std::memory_order_relaxed);
+}
 
-void PSlowLog::SetThreshold(unsigned int v) { threshold_ = v; }
+void PSlowLog::SetLogLimit(std::size_t maxCount) { logMaxCount_.store(maxCount, std::memory_order_relaxed); }
 
-void PSlowLog::SetLogLimit(std::size_t maxCount) { logMaxCount_ = maxCount; }
+void PSlowLog::SetPerfSample(uint32_t every) { perfSample_.store(every, std::memory_order_relaxed); }
 
-void PSlowLog::Begin() {
-  if (!threshold_) {
-    return;
+bool PSlowLog::SamplePerf() {
+  thread_local uint32_t countdown = 0;
+  auto every = perfSample_.load(std::memory_order_relaxed);
+  if (every == 0 || threshold_ns_.load(std::memory_order_relaxed) < 0) {
+    return false;
   }
-
-  timeval begin;
-  gettimeofday(&begin, 0);
-  beginUs_ = begin.tv_sec * 1000000 + begin.tv_usec;
+  if (countdown == 0) {
+    countdown = every;
+  }
+  return --countdown == 0;
 }
 
-void PSlowLog::EndAndStat(const std::vector<PString>& cmds) {
-  if (!threshold_ || beginUs_ == 0) {
-    return;
+PSlowLog::ThreadLog* PSlowLog::local() {
+  thread_local ThreadLog* log = nullptr;
+  if (!log) {
+    auto owned = std::make_unique<ThreadLog>();
+    log = owned.get();
+    std::lock_guard guard(mutex_);
+    logs_.push_back(std::move(owned));
   }
+  return log;
+}
 
-  timeval end;
-  gettimeofday(&end, 0);
-  auto used = end.tv_sec * 1000000 + end.tv_usec - beginUs_;
+void PSlowLog::Record(SlowLogItem item) {
+  const auto limit = logMaxCount_.load(std::memory_order_relaxed);
+  auto log = local();
+  item.id = nextId_.fetch_add(1, std::memory_order_relaxed);
 
-  if (used >= threshold_) {
-    INFO("+ Used:(us) {}", used);
+  std::lock_guard guard(log->mutex);
+  log->items.push_front(std::move(item));
+  while (log->items.size() > limit) {
+    log->items.pop_back();
+  }
+}
 
-    for (const auto& param : cmds) {
-      INFO("{}", param);
+std::vector<SlowLogItem> PSlowLog::GetLogs(std::size_t count) const {
+  count = std::min(count, logMaxCount_.load(std::memory_order_relaxed));
+
+  std::vector<SlowLogItem> items;
+  {
+    std::lock_guard guard(mutex_);
+    for (const auto& log : logs_) {
+      std::lock_guard logGuard(log->mutex);
+      // every thread log is newest first, older ones can't be in the result
+      auto n = std::min(count, log->items.size());
+      items.insert(items.end(), log->items.begin(), log->items.begin() + static_cast<std::ptrdiff_t>(n));
     }
+  }
 
-    if (cmds[0] == "slowlog") {
-      return;
-    }
+  std::sort(items.begin(), items.end(), [](const auto& a, const auto& b) { return a.id > b.id; });
+  if (items.size() > count) {
+    items.resize(count);
+  }
+  return items;
+}
 
-    SlowLogItem item;
-    item.used = static_cast<unsigned>(used);
-    item.cmds = cmds;
+std::size_t PSlowLog::GetLogsCount() const {
+  std::size_t count = 0;
+  std::lock_guard guard(mutex_);
+  for (const auto& log : logs_) {
+    std::lock_guard logGuard(log->mutex);
+    count += log->items.size();
+  }
+  return std::min(count, logMaxCount_.load(std::memory_order_relaxed));
+}
 
-    logs_.emplace_front(std::move(item));
-    if (logs_.size() > logMaxCount_) {
-      logs_.pop_back();
-    }
+void PSlowLog::ClearLogs() {
+  std::lock_guard guard(mutex_);
+  for (const auto& log : logs_) {
+    std::lock_guard logGuard(log->mutex);
+    log->items.clear();
+  }
+}
+
+PSlowLog::PerfScope::PerfScope(bool sampled, SlowLogPerf* perf) : perf_(sampled ? perf : nullptr) {
+  if (perf_) {
+    rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableCount);
+    rocksdb::get_perf_context()->Reset();
+  }
+}
+
+PSlowLog::PerfScope::~PerfScope() {
+  if (!perf_) {
+    return;
   }
+
+  const auto* ctx = rocksdb::get_perf_context();
+  perf_->valid = true;
+  perf_->block_cache_hit_count = ctx->block_cache_hit_count;
+  perf_->block_read_count = ctx->block_read_count;
+  perf_->block_read_byte = ctx->block_read_byte;
+  perf_->get_from_memtable_count = ctx->get_from_memtable_count;
+  perf_->internal_key_skipped_count = ctx->internal_key_skipped_count;
+  perf_->internal_delete_skipped_count = ctx->internal_delete_skipped_count;
+  rocksdb::SetPerfLevel(rocksdb::PerfLevel::kDisable);
 }
 
 }  // namespace pikiwidb
@@ -7,24 +7,48 @@
 
 #pragma once
 
+#include <atomic>
 #include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #include "common.h"
 
-class Logger;
-
 namespace pikiwidb {
 
+// RocksDB perf counters of one command, only filled for sampled commands
+struct SlowLogPerf {
+  bool valid = false;
+  uint64_t block_cache_hit_count = 0;
+  uint64_t block_read_count = 0;
+  uint64_t block_read_byte = 0;
+  uint64_t get_from_memtable_count = 0;
+  uint64_t internal_key_skipped_count = 0;
+  uint64_t internal_delete_skipped_count = 0;
+};
+
 struct SlowLogItem {
-  unsigned used;
+  uint64_t id = 0;
+  int64_t timestamp = 0;  // unix time in seconds
+  uint64_t used = 0;      // microseconds
   std::vector<PString> cmds;
-
-  SlowLogItem() : used(0) {}
-
-  SlowLogItem(SlowLogItem&& item) : used(item.used), cmds(std::move(item.cmds)) {}
+  std::string client_addr;  // ip:port
+  std::string client_name;
+  int db = 0;
+  int instance = -1;  // storage instance of the key, -1 if the command has no single key
+  SlowLogPerf perf;
 };
 
+/**
+ * @brief Slow log of all worker threads
+ * Every thread appends to its own bounded log, guarded by a mutex only that thread and
+ * SLOWLOG readers take, so recording never contends with other workers. Entries get a
+ * global increasing id, readers merge the per thread logs by it.
+ * The hot path only compares the elapsed time with the threshold, entries are built
+ * when it is exceeded.
+ */
 class PSlowLog {
  public:
   static PSlowLog& Instance();
@@ -32,26 +56,56 @@ class PSlowLog {
   PSlowLog(const PSlowLog&) = delete;
   void operator=(const PSlowLog&) = delete;
 
-  void Begin();
-  void EndAndStat(const std::vector<PString>& cmds);
-
-  void SetThreshold(unsigned int);
+  // microseconds, negative disables the slow log and zero logs every command
+  void SetThreshold(int threshold);
   void SetLogLimit(std::size_t maxCount);
+  // one in `every` commands collects RocksDB perf counters, zero disables
+  void SetPerfSample(uint32_t every);
 
-  void ClearLogs() { logs_.clear(); }
-  std::size_t GetLogsCount() const { return logs_.size(); }
-  const std::deque<SlowLogItem>& GetLogs() const { return logs_; }
+  bool IsSlow(uint64_t used_ns) const {
+    auto threshold = threshold_ns_.load(std::memory_order_relaxed);
+    return threshold >= 0 && used_ns >= static_cast<uint64_t>(threshold);
+  }
+
+  // whether the command about to run on this thread should collect perf counters
+  bool SamplePerf();
+
+  // append to the log of the calling thread
+  void Record(SlowLogItem item);
+
+  // newest first, at most count entries
+  std::vector<SlowLogItem> GetLogs(std::size_t count) const;
+  std::size_t GetLogsCount() const;
+  void ClearLogs();
+
+  // enables RocksDB perf counting on the current thread while alive, when sampled
+  class PerfScope {
+   public:
+    PerfScope(bool sampled, SlowLogPerf* perf);
+    ~PerfScope();
+
+   private:
+    SlowLogPerf* perf_;
+  };
 
  private:
-  PSlowLog();
-  ~PSlowLog();
+  PSlowLog() = default;
+
+  struct ThreadLog {
+    std::mutex mutex;
+    std::deque<SlowLogItem> items;  // newest first
+  };
+
+  ThreadLog* local();
 
-  unsigned int threshold_;
-  long long beginUs_;
-  Logger* logger_;
+  std::atomic<int64_t> threshold_ns_{-1};
+  std::atomic<std::size_t> logMaxCount_{128};
+  std::atomic<uint32_t> perfSample_{0};
+  std::atomic<uint64_t> nextId_{0};
 
-  std::size_t logMaxCount_;
-  std::deque<SlowLogItem> logs_;
+  // guards the list only, never taken by Record once a thread is registered
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<ThreadLog>> logs_;
 };
 
 }  // namespace pikiwidb
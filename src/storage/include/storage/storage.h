@@ -7,6 +7,7 @@
 #define INCLUDE_STORAGE_STORAGE_H_
 
 #include <unistd.h>
+#include <functional>
 #include <list>
 #include <map>
 #include <queue>
@@ -23,6 +24,7 @@
 #include "rocksdb/table.h"
 
 #include "pstd/pstd_mutex.h"
+#include "pstd/work_stealing_pool.h"
 #include "storage/slot_indexer.h"
 
 namespace storage {
@@ -57,10 +59,40 @@ struct StorageOptions {
   size_t small_compaction_threshold = 5000;
   size_t small_compaction_duration_threshold = 10000;
   size_t db_instance_num = 3;  // default = 3
+  // bytes of decoded hot values cached in front of the instances, shared among them, 0 disables it
+  size_t value_cache_size = 0;
+  // bytes of collection meta values cached in front of the meta column families, shared alike, 0 disables it
+  size_t meta_cache_size = 0;
   int db_id;
   Status ResetOptions(const OptionType& option_type, const std::unordered_map<std::string, std::string>& options_map);
 };
 
+// counters of the value caches in front of the instances, summed
+struct ValueCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t inserts = 0;
+  uint64_t rejects = 0;  // by the admission filter or too large
+  uint64_t evictions = 0;
+  uint64_t invalidations = 0;
+  uint64_t entries = 0;
+  uint64_t used_memory = 0;
+  uint64_t capacity = 0;
+
+  ValueCacheStats& operator+=(const ValueCacheStats& other) {
+    hits += other.hits;
+    misses += other.misses;
+    inserts += other.inserts;
+    rejects += other.rejects;
+    evictions += other.evictions;
+    invalidations += other.invalidations;
+    entries += other.entries;
+    used_memory += other.used_memory;
+    capacity += other.capacity;
+    return *this;
+  }
+};
+
 struct KeyValue {
   std::string key;
   std::string value;
@@ -172,6 +204,23 @@ class Storage {
 
   std::unique_ptr<Redis>& GetDBInstance(const std::string& key);
 
+  // Index of the instance which owns the key, used to group multi-key
+  // operations so each instance is visited once
+  size_t GetDBInstanceID(const std::string& key) const;
+
+  // the calling thread owns the key locks of the instance, see LockMgr::SetOwner
+  void OwnInstance(size_t inst_id);
+
+  // Transaction of the calling thread, for EXEC.
+  // Until Commit or Rollback the calls of the thread read a snapshot and see their own
+  // writes, which are buffered and written with one batch per instance on Commit.
+  // keys must hold every key the calls may touch, they stay locked until the end.
+  // A transaction writing several instances puts their batches in an intent first, so an
+  // instance failing or a stop in between is completed from it when the storage opens.
+  void BeginTransaction(const std::vector<std::string>& keys);
+  Status CommitTransaction();
+  void RollbackTransaction();
+
   // Strings Commands
 
   // Set key to hold the string value. if key
@@ -201,11 +250,14 @@ class Storage {
 
   // Sets the given keys to their respective values
   // MSET replaces existing values with new values
-  Status MSet(const std::vector<KeyValue>& kvs);
+  // Each instance commits its keys on its own: with statuses, every instance is written and the status of the write
+  // of each key is put there
+  Status MSet(const std::vector<KeyValue>& kvs, std::vector<Status>* statuses = nullptr);
 
   // Returns the values of all specified keys. For every key
   // that does not hold a string value or does not exist, the
   // special value nil is returned
+  // Every instance is read, the keys of an instance failing get its error in their status, the first one returned
   Status MGet(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss);
 
   // Returns the values of all specified keyswithTTL. For every key
@@ -614,6 +666,10 @@ class Storage {
   // command.
   Status RPoplpush(const Slice& source, const Slice& destination, std::string* element);
 
+  // Like RPoplpush, but pops from the head of source if from_left and pushes
+  // to the head of destination if to_left.
+  Status LMove(const Slice& source, const Slice& destination, bool from_left, bool to_left, std::string* element);
+
   // Zsets Commands
 
   // Pop the maximum count score_members which have greater score in the sorted set.
@@ -1070,6 +1126,12 @@ class Storage {
   Status GetUsage(const std::string& property, uint64_t* result);
   Status GetUsage(const std::string& property, std::map<int, uint64_t>* type_result);
   uint64_t GetProperty(const std::string& property);
+  // summed over the instances, zeros unless StorageOptions::value_cache_size is set
+  ValueCacheStats GetValueCacheStats();
+  // zeros unless StorageOptions::meta_cache_size is set
+  ValueCacheStats GetMetaCacheStats();
+  // elements of the collection of type at key as the meta cache has it, -1 if it hasn't. It reads nothing else
+  int64_t CachedLen(DataType type, const Slice& key);
 
   Status GetKeyNum(std::vector<KeyInfo>* key_infos);
   Status StopScanKeyNum();
@@ -1080,9 +1142,23 @@ class Storage {
   void GetRocksDBInfo(std::string& info);
 
  private:
+  // bits (1 << DataType) of the types of key, by one lookup of the type index
+  Status typesOf(const std::unique_ptr<Redis>& inst, const Slice& key, uint8_t* types);
+
+  // calls fn with each instance owning some of the keys and the positions of its keys,
+  // the instances in parallel once there are enough keys. Returns the first error
+  using InstanceFn = std::function<Status(size_t, const std::vector<size_t>&)>;
+  Status forEachInstance(const std::vector<std::string>& keys, const InstanceFn& fn);
+  // writes the instances missing from the intents of the transactions which didn't finish
+  Status recoverTransactions();
+
   std::vector<std::unique_ptr<Redis>> insts_;
+  // runs the groups of a multi-key read but the caller's own, one thread per other instance
+  std::unique_ptr<pstd::WorkStealingPool> fanout_pool_;
   std::unique_ptr<SlotIndexer> slot_indexer_;
   std::atomic<bool> is_opened_ = false;
+  // ids of the transactions writing several instances, from the time of Open so they aren't taken twice
+  std::atomic<uint64_t> txn_id_ = 0;
 
   std::unique_ptr<LRUCache<std::string, std::string>> cursors_store_;
 
@@ -42,6 +42,8 @@ enum ColumnFamilyIndex {
   kZsetsMetaCF = 7,
   kZsetsDataCF = 8,
   kZsetsScoreCF = 9,
+  kTypeIndexCF = 10,
+  kZsetsRankCF = 11,
 };
 
 const static char kNeedTransformCharacter = '\u0000';
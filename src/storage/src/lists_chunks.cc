@@ -0,0 +1,797 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "src/lists_chunks.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "src/base_data_value_format.h"
+#include "src/coding.h"
+#include "src/lists_data_key_format.h"
+#include "src/lists_meta_value_format.h"
+
+namespace storage {
+
+static constexpr size_t kEntryLength = sizeof(uint64_t) + sizeof(uint32_t);
+static constexpr size_t kPageRefLength = 2 * sizeof(uint64_t);
+// flags a run of records in the size of a page entry, and a page without a record in the meta value
+static constexpr uint32_t kLegacyRun = 1U << 31;
+static constexpr uint64_t kLegacyPage = 1ULL << 63;
+
+static size_t BytesOf(const Slice& element) { return sizeof(uint32_t) + element.size(); }
+
+ListsChunks::ListsChunks(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* meta_cf, rocksdb::ColumnFamilyHandle* data_cf,
+                         const rocksdb::ReadOptions& read_options, const Slice& key)
+    : db_(db), meta_cf_(meta_cf), data_cf_(data_cf), read_options_(read_options), key_(key.ToString()) {}
+
+void ListsChunks::Create() {
+  char str[sizeof(uint64_t)];
+  EncodeFixed64(str, 0);
+  ListsMetaValue lists_meta_value(Slice(str, sizeof(uint64_t)));
+  version_ = lists_meta_value.UpdateVersion();
+  Slice meta_value = lists_meta_value.Encode();
+  suffix_.assign(meta_value.data() + sizeof(uint64_t), meta_value.size() - sizeof(uint64_t));
+  left_index_ = lists_meta_value.LeftIndex();
+  right_index_ = lists_meta_value.RightIndex();
+  count_ = 0;
+  chunks_.clear();
+  dropped_.clear();
+  pages_.clear();
+  dirty_pages_.clear();
+}
+
+Status ListsChunks::Load(const std::string& meta_value) {
+  std::string value(meta_value);
+  ParsedListsMetaValue parsed_lists_meta_value(&value);
+  chunks_.clear();
+  dropped_.clear();
+  pages_.clear();
+  dirty_pages_.clear();
+  if (parsed_lists_meta_value.IsStale() || parsed_lists_meta_value.Count() == 0) {
+    // the pages left in the user value belong to the old version
+    parsed_lists_meta_value.InitialMetaValue();
+  } else if (!IsChunked(parsed_lists_meta_value.UserValue())) {
+    // an element per data record, they stay where they are until they change
+    uint64_t first = parsed_lists_meta_value.LeftIndex() + 1;
+    uint64_t count = parsed_lists_meta_value.Count();
+    if (parsed_lists_meta_value.RightIndex() - first != count) {
+      return Status::Corruption("list indexes don't match the count");
+    }
+    for (uint64_t rest = count; rest > 0;) {
+      uint64_t size = std::min<uint64_t>(rest, kPageEntries * kChunkSize);
+      addStub(first, size, true);
+      first += size;
+      rest -= size;
+    }
+  } else {
+    Slice refs = parsed_lists_meta_value.UserValue();
+    refs.remove_prefix(sizeof(uint64_t));
+    if (refs.size() % kPageRefLength != 0) {
+      return Status::Corruption("invalid list page directory");
+    }
+    uint64_t total = 0;
+    for (; !refs.empty(); refs.remove_prefix(kPageRefLength)) {
+      uint64_t id = DecodeFixed64(refs.data());
+      uint64_t size = DecodeFixed64(refs.data() + sizeof(uint64_t));
+      bool legacy = (size & kLegacyPage) != 0;
+      size &= ~kLegacyPage;
+      if (size == 0 || size > kPageEntries * kChunkSize) {
+        return Status::Corruption("invalid list page size");
+      }
+      addStub(id, size, legacy);
+      if (!legacy) {
+        pages_.push_back(id);
+      }
+      total += size;
+    }
+    if (total != parsed_lists_meta_value.Count()) {
+      return Status::Corruption("list page directory doesn't match the count");
+    }
+  }
+
+  size_t usize = parsed_lists_meta_value.UserValue().size();
+  suffix_.assign(value.data() + usize, value.size() - usize);
+  version_ = parsed_lists_meta_value.Version();
+  left_index_ = parsed_lists_meta_value.LeftIndex();
+  right_index_ = parsed_lists_meta_value.RightIndex();
+  count_ = parsed_lists_meta_value.Count();
+  return Status::OK();
+}
+
+std::string ListsChunks::dataKeyOf(uint64_t id) const {
+  ListsDataKey lists_data_key(key_, version_, id);
+  return lists_data_key.Encode().ToString();
+}
+
+void ListsChunks::addStub(uint64_t id, uint64_t size, bool legacy) {
+  Chunk stub;
+  stub.id = id;
+  stub.size = static_cast<uint32_t>(size);
+  stub.legacy = legacy ? stub.size : 0;
+  stub.page = id;
+  stub.stub = true;
+  chunks_.push_back(std::move(stub));
+}
+
+Status ListsChunks::expand(size_t pos) {
+  const Chunk stub = chunks_[pos];
+  std::vector<Chunk> entries;
+  if (stub.legacy != 0) {
+    for (uint32_t offset = 0; offset < stub.size; offset += kChunkSize) {
+      Chunk run;
+      run.id = stub.id + offset;
+      run.size = std::min(kChunkSize, stub.size - offset);
+      run.legacy = run.size;
+      run.page = stub.page;
+      entries.push_back(std::move(run));
+    }
+  } else {
+    std::string value;
+    Status s = db_->Get(read_options_, data_cf_, dataKeyOf(stub.id), &value);
+    if (s.IsNotFound()) {
+      return Status::Corruption("list page missing");
+    } else if (!s.ok()) {
+      return s;
+    }
+    ParsedBaseDataValue parsed_value(&value);
+    Slice payload = parsed_value.UserValue();
+    if (payload.empty() || payload.size() % kEntryLength != 0) {
+      return Status::Corruption("invalid list page");
+    }
+    uint64_t total = 0;
+    for (; !payload.empty(); payload.remove_prefix(kEntryLength)) {
+      Chunk chunk;
+      chunk.id = DecodeFixed64(payload.data());
+      uint32_t size = DecodeFixed32(payload.data() + sizeof(uint64_t));
+      chunk.size = size & ~kLegacyRun;
+      chunk.legacy = (size & kLegacyRun) != 0 ? chunk.size : 0;
+      chunk.page = stub.page;
+      total += chunk.size;
+      entries.push_back(std::move(chunk));
+    }
+    if (total != stub.size) {
+      return Status::Corruption("list page doesn't match the meta value");
+    }
+  }
+  chunks_[pos] = std::move(entries[0]);
+  chunks_.insert(chunks_.begin() + static_cast<std::ptrdiff_t>(pos) + 1, std::make_move_iterator(entries.begin() + 1),
+                 std::make_move_iterator(entries.end()));
+  return Status::OK();
+}
+
+Status ListsChunks::resolve(size_t i, bool back, size_t* pos) {
+  *pos = back ? chunks_.size() - 1 - i : i;
+  if (chunks_[*pos].stub) {
+    Status s = expand(*pos);
+    if (!s.ok()) {
+      return s;
+    }
+    // the entries after the page are as many as before
+    *pos = back ? chunks_.size() - 1 - i : i;
+  }
+  return Status::OK();
+}
+
+Status ListsChunks::locate(uint64_t index, size_t* pos, uint32_t* offset) {
+  for (size_t i = 0; i < chunks_.size();) {
+    if (index >= chunks_[i].size) {
+      index -= chunks_[i].size;
+      ++i;
+    } else if (chunks_[i].stub) {
+      Status s = expand(i);
+      if (!s.ok()) {
+        return s;
+      }
+    } else {
+      *pos = i;
+      *offset = static_cast<uint32_t>(index);
+      return Status::OK();
+    }
+  }
+  // past the last element
+  *pos = 0;
+  *offset = 0;
+  if (!chunks_.empty()) {
+    Status s = resolve(0, true, pos);
+    if (!s.ok()) {
+      return s;
+    }
+    *offset = chunks_[*pos].size;
+  }
+  return Status::OK();
+}
+
+Status ListsChunks::load(size_t first, size_t last) {
+  // the chunks and the records of the runs, in one MultiGet
+  std::vector<size_t> positions;
+  std::vector<std::string> keys;
+  for (size_t pos = first; pos < last && pos < chunks_.size(); ++pos) {
+    const Chunk& chunk = chunks_[pos];
+    if (chunk.stub || chunk.loaded) {
+      continue;
+    }
+    positions.push_back(pos);
+    if (chunk.legacy != 0) {
+      for (uint32_t i = 0; i < chunk.size; ++i) {
+        keys.push_back(dataKeyOf(chunk.id + i));
+      }
+    } else {
+      keys.push_back(dataKeyOf(chunk.id));
+    }
+  }
+  if (positions.empty()) {
+    return Status::OK();
+  }
+  std::vector<Slice> key_slices(keys.begin(), keys.end());
+  std::vector<rocksdb::PinnableSlice> values(keys.size());
+  std::vector<Status> statuses(keys.size());
+  db_->MultiGet(read_options_, data_cf_, keys.size(), key_slices.data(), values.data(), statuses.data());
+  for (size_t i = 0, k = 0; i < positions.size(); ++i) {
+    Chunk& chunk = chunks_[positions[i]];
+    chunk.elements.clear();
+    chunk.elements.reserve(chunk.size);
+    chunk.bytes = 0;
+    if (chunk.legacy != 0) {
+      for (uint32_t j = 0; j < chunk.size; ++j, ++k) {
+        if (statuses[k].IsNotFound()) {
+          chunk.elements.clear();
+          return Status::Corruption("list element missing");
+        } else if (!statuses[k].ok()) {
+          chunk.elements.clear();
+          return statuses[k];
+        }
+        ParsedBaseDataValue parsed_value(values[k]);
+        chunk.elements.push_back(parsed_value.UserValue().ToString());
+        chunk.bytes += BytesOf(chunk.elements.back());
+      }
+      chunk.loaded = true;
+      continue;
+    }
+    if (statuses[k].IsNotFound()) {
+      return Status::Corruption("list chunk missing");
+    } else if (!statuses[k].ok()) {
+      return statuses[k];
+    }
+    ParsedBaseDataValue parsed_value(values[k++]);
+    Slice payload = parsed_value.UserValue();
+    chunk.bytes = payload.size();
+    while (payload.size() >= sizeof(uint32_t)) {
+      uint32_t len = DecodeFixed32(payload.data());
+      payload.remove_prefix(sizeof(uint32_t));
+      if (payload.size() < len) {
+        break;
+      }
+      chunk.elements.emplace_back(payload.data(), len);
+      payload.remove_prefix(len);
+    }
+    if (!payload.empty() || chunk.elements.size() != chunk.size) {
+      chunk.elements.clear();
+      return Status::Corruption("invalid list chunk");
+    }
+    chunk.loaded = true;
+  }
+  return Status::OK();
+}
+
+void ListsChunks::release(size_t pos) {
+  Chunk& chunk = chunks_[pos];
+  if (!chunk.dirty) {
+    chunk.elements.clear();
+    chunk.elements.shrink_to_fit();
+    chunk.loaded = false;
+  }
+}
+
+bool ListsChunks::full(const Chunk& chunk, const Slice& element) const {
+  return chunk.size >= kChunkSize || (chunk.size != 0 && chunk.bytes + BytesOf(element) > kChunkBytes);
+}
+
+Status ListsChunks::fits(size_t pos, const Slice& element, bool* fits) {
+  *fits = false;
+  if (chunks_[pos].stub || chunks_[pos].size >= kChunkSize) {
+    return Status::OK();
+  }
+  Status s = load(pos);
+  if (s.ok()) {
+    *fits = !full(chunks_[pos], element);
+  }
+  return s;
+}
+
+void ListsChunks::add(size_t pos, const Slice& element) {
+  Chunk chunk;
+  chunk.id = pos == 0 ? left_index_-- : right_index_++;
+  // joins the page of a neighbour read already
+  if (pos > 0 && !chunks_[pos - 1].stub) {
+    chunk.page = chunks_[pos - 1].page;
+  } else if (pos < chunks_.size() && !chunks_[pos].stub) {
+    chunk.page = chunks_[pos].page;
+  }
+  chunk.loaded = true;
+  chunk.dirty = true;
+  chunks_.insert(chunks_.begin() + static_cast<std::ptrdiff_t>(pos), std::move(chunk));
+  insertAt(pos, 0, element);
+}
+
+void ListsChunks::insertAt(size_t pos, uint32_t offset, const Slice& element) {
+  Chunk& chunk = chunks_[pos];
+  chunk.elements.insert(chunk.elements.begin() + offset, element.ToString());
+  chunk.size++;
+  chunk.bytes += BytesOf(element);
+  chunk.dirty = true;
+  count_++;
+}
+
+void ListsChunks::eraseAt(size_t pos, uint32_t offset) {
+  Chunk& chunk = chunks_[pos];
+  chunk.bytes -= BytesOf(chunk.elements[offset]);
+  chunk.elements.erase(chunk.elements.begin() + offset);
+  chunk.size--;
+  chunk.dirty = true;
+  count_--;
+}
+
+void ListsChunks::split(size_t pos, uint32_t offset) {
+  Chunk tail;
+  tail.id = right_index_++;
+  tail.page = chunks_[pos].page;
+  tail.loaded = true;
+  tail.dirty = true;
+  Chunk& chunk = chunks_[pos];
+  tail.elements.assign(std::make_move_iterator(chunk.elements.begin() + offset),
+                       std::make_move_iterator(chunk.elements.end()));
+  chunk.elements.resize(offset);
+  for (const auto& element : tail.elements) {
+    tail.bytes += BytesOf(element);
+  }
+  tail.size = chunk.size - offset;
+  chunk.size = offset;
+  chunk.bytes -= tail.bytes;
+  chunk.dirty = true;
+  chunks_.insert(chunks_.begin() + static_cast<std::ptrdiff_t>(pos) + 1, std::move(tail));
+}
+
+void ListsChunks::drop(size_t pos) {
+  const Chunk& chunk = chunks_[pos];
+  if (chunk.legacy != 0) {
+    for (uint32_t i = 0; i < chunk.legacy; ++i) {
+      dropped_.push_back(chunk.id + i);
+    }
+  } else {
+    dropped_.push_back(chunk.id);
+  }
+  dirty_pages_.push_back(chunk.page);
+  chunks_.erase(chunks_.begin() + static_cast<std::ptrdiff_t>(pos));
+}
+
+Status ListsChunks::Get(uint64_t index, std::string* element) {
+  size_t pos;
+  uint32_t offset;
+  Status s = locate(index, &pos, &offset);
+  if (s.ok()) {
+    s = load(pos);
+  }
+  if (s.ok()) {
+    *element = chunks_[pos].elements[offset];
+  }
+  return s;
+}
+
+Status ListsChunks::Set(uint64_t index, const Slice& element) {
+  size_t pos;
+  uint32_t offset;
+  Status s = locate(index, &pos, &offset);
+  if (s.ok()) {
+    s = load(pos);
+  }
+  if (s.ok()) {
+    Chunk& chunk = chunks_[pos];
+    chunk.bytes = chunk.bytes - BytesOf(chunk.elements[offset]) + BytesOf(element);
+    chunk.elements[offset] = element.ToString();
+    chunk.dirty = true;
+  }
+  return s;
+}
+
+Status ListsChunks::Range(uint64_t start, uint64_t stop, std::vector<std::string>* elements) {
+  size_t pos;
+  uint32_t offset;
+  Status s = locate(start, &pos, &offset);
+  if (!s.ok()) {
+    return s;
+  }
+  uint64_t rest = stop - start + 1;
+  for (; rest > 0 && pos < chunks_.size(); ++pos, offset = 0) {
+    if (chunks_[pos].stub) {
+      s = expand(pos);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    if (!chunks_[pos].loaded) {
+      // the chunks of the page the rest of the range spans, up to kReadAhead
+      size_t last = pos;
+      uint64_t covered = chunks_[pos].size - offset;
+      while (covered < rest && last + 1 < chunks_.size() && !chunks_[last + 1].stub && last + 1 - pos < kReadAhead) {
+        covered += chunks_[++last].size;
+      }
+      s = load(pos, last + 1);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    const Chunk& chunk = chunks_[pos];
+    for (; offset < chunk.size && rest > 0; ++offset, --rest) {
+      elements->push_back(chunk.elements[offset]);
+    }
+  }
+  return Status::OK();
+}
+
+Status ListsChunks::Find(const Slice& value, uint64_t* index) {
+  uint64_t base = 0;
+  for (size_t i = 0; i < chunks_.size(); ++i) {
+    size_t pos;
+    Status s = resolve(i, false, &pos);
+    if (s.ok()) {
+      s = load(pos, pos + kReadAhead);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+    const Chunk& chunk = chunks_[pos];
+    for (uint32_t offset = 0; offset < chunk.size; ++offset) {
+      if (value.compare(chunk.elements[offset]) == 0) {
+        *index = base + offset;
+        return Status::OK();
+      }
+    }
+    base += chunk.size;
+    release(pos);
+  }
+  *index = count_;
+  return Status::OK();
+}
+
+Status ListsChunks::Insert(uint64_t index, const Slice& element) {
+  if (chunks_.empty()) {
+    add(0, element);
+    return Status::OK();
+  }
+  size_t pos;
+  uint32_t offset;
+  Status s = locate(index, &pos, &offset);
+  if (!s.ok()) {
+    return s;
+  }
+  const bool end = offset == 0 || offset == chunks_[pos].size;
+  bool room = false;
+  s = end ? fits(pos, element, &room) : load(pos);
+  if (!s.ok()) {
+    return s;
+  }
+  if (room || (!end && !full(chunks_[pos], element))) {
+    insertAt(pos, offset, element);
+    return Status::OK();
+  }
+
+  // like a quicklist, a full chunk spills to a neighbour at its ends and splits in the middle
+  if (offset == 0) {
+    if (pos > 0) {
+      s = fits(pos - 1, element, &room);
+      if (!s.ok()) {
+        return s;
+      }
+      if (room) {
+        insertAt(pos - 1, chunks_[pos - 1].size, element);
+        return Status::OK();
+      }
+    }
+    add(pos, element);
+  } else if (offset == chunks_[pos].size) {
+    if (pos + 1 < chunks_.size()) {
+      s = fits(pos + 1, element, &room);
+      if (!s.ok()) {
+        return s;
+      }
+      if (room) {
+        insertAt(pos + 1, 0, element);
+        return Status::OK();
+      }
+    }
+    add(pos + 1, element);
+  } else {
+    split(pos, offset);
+    insertAt(pos, offset, element);
+  }
+  return Status::OK();
+}
+
+Status ListsChunks::Pop(uint64_t n, bool back, std::vector<std::string>* elements) {
+  for (size_t i = 0; n > 0 && i < chunks_.size(); ++i) {
+    size_t pos;
+    Status s = resolve(i, back, &pos);
+    if (s.ok()) {
+      s = load(pos);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+    Chunk& chunk = chunks_[pos];
+    for (; n > 0 && chunk.size > 0; --n) {
+      uint32_t offset = back ? chunk.size - 1 : 0;
+      elements->push_back(chunk.elements[offset]);
+      eraseAt(pos, offset);
+    }
+  }
+  return Status::OK();
+}
+
+Status ListsChunks::Trim(uint64_t start, uint64_t stop) {
+  uint64_t base = 0;
+  for (size_t pos = 0; pos < chunks_.size();) {
+    uint64_t first = base;
+    uint64_t last = base + chunks_[pos].size;
+    const bool out = last <= start || first > stop;
+    auto head = static_cast<uint32_t>(first < start ? start - first : 0);
+    auto tail = static_cast<uint32_t>(last > stop + 1 ? last - stop - 1 : 0);
+    if (!out && head == 0 && tail == 0) {
+      base = last;
+      ++pos;
+      continue;
+    }
+    if (chunks_[pos].stub) {
+      // its entries are trimmed one by one, a page without a record is expanded without reading
+      Status s = expand(pos);
+      if (!s.ok()) {
+        return s;
+      }
+      continue;
+    }
+    base = last;
+    Chunk& chunk = chunks_[pos];
+    if (out) {
+      // out of the range whole, dropped by Flush without reading it
+      count_ -= chunk.size;
+      chunk.size = 0;
+      chunk.bytes = 0;
+      chunk.elements.clear();
+      chunk.loaded = true;
+      ++pos;
+      continue;
+    }
+    Status s = load(pos);
+    if (!s.ok()) {
+      return s;
+    }
+    for (; tail > 0; --tail) {
+      eraseAt(pos, chunk.size - 1);
+    }
+    chunk.elements.erase(chunk.elements.begin(), chunk.elements.begin() + head);
+    chunk.bytes = 0;
+    for (const auto& element : chunk.elements) {
+      chunk.bytes += BytesOf(element);
+    }
+    chunk.size -= head;
+    chunk.dirty = true;
+    count_ -= head;
+    ++pos;
+  }
+  return Status::OK();
+}
+
+Status ListsChunks::Remove(const Slice& value, uint64_t count, bool reverse, uint64_t* removed) {
+  *removed = 0;
+  for (size_t i = 0; i < chunks_.size() && (count == 0 || *removed < count); ++i) {
+    size_t pos;
+    Status s = resolve(i, reverse, &pos);
+    if (s.ok()) {
+      s = reverse ? load(pos + 1 > kReadAhead ? pos + 1 - kReadAhead : 0, pos + 1) : load(pos, pos + kReadAhead);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+    Chunk& chunk = chunks_[pos];
+    // an erased element brings the next one to check at the same j
+    for (uint32_t j = 0; j < chunk.size && (count == 0 || *removed < count);) {
+      uint32_t offset = reverse ? chunk.size - 1 - j : j;
+      if (value.compare(chunk.elements[offset]) == 0) {
+        eraseAt(pos, offset);
+        (*removed)++;
+      } else {
+        j++;
+      }
+    }
+    release(pos);
+  }
+  return Status::OK();
+}
+
+std::vector<ListsChunks::Page> ListsChunks::paginate() {
+  auto has_record = [this](uint64_t id) { return std::find(pages_.begin(), pages_.end(), id) != pages_.end(); };
+
+  // the entries of a page are consecutive, a stub is a page by itself
+  std::vector<Page> pages;
+  for (size_t pos = 0; pos < chunks_.size(); ++pos) {
+    const Chunk& chunk = chunks_[pos];
+    if (pos == 0 || chunk.stub || chunks_[pos - 1].stub || chunk.page != chunks_[pos - 1].page) {
+      Page page;
+      page.begin = pos;
+      page.id = chunk.page;
+      page.dirty = !chunk.stub && (chunk.page == 0 || std::find(dirty_pages_.begin(), dirty_pages_.end(),
+                                                                 chunk.page) != dirty_pages_.end());
+      pages.push_back(page);
+    }
+    pages.back().end = pos + 1;
+    pages.back().dirty = pages.back().dirty || chunk.dirty;
+  }
+
+  // a small changed page merges into its neighbour when they fit in one, a large one is cut
+  std::vector<Page> result;
+  for (const auto& page : pages) {
+    if (!result.empty()) {
+      Page& prev = result.back();
+      size_t n = prev.end - prev.begin;
+      size_t m = page.end - page.begin;
+      if ((prev.dirty || page.dirty) && !chunks_[prev.begin].stub && !chunks_[page.begin].stub &&
+          std::min(n, m) < kPageEntries / 4 && n + m <= kPageEntries) {
+        prev.end = page.end;
+        prev.dirty = true;
+        if (!has_record(prev.id)) {
+          prev.id = page.id;
+        }
+        continue;
+      }
+    }
+    // cut in even pieces, so pushes at either end fill a page from half of it
+    size_t n = page.end - page.begin;
+    size_t pieces = (n + kPageEntries - 1) / kPageEntries;
+    size_t step = (n + pieces - 1) / pieces;
+    for (size_t begin = page.begin; begin < page.end; begin += step) {
+      Page piece = page;
+      piece.begin = begin;
+      piece.end = std::min(page.end, begin + step);
+      if (pieces > 1) {
+        piece.dirty = true;
+        piece.id = begin == page.begin ? page.id : 0;
+      }
+      result.push_back(piece);
+    }
+  }
+
+  // a changed page without a record, or whose record another page kept, gets a new one
+  std::vector<uint64_t> used;
+  for (auto& page : result) {
+    if (page.dirty && (!has_record(page.id) || std::find(used.begin(), used.end(), page.id) != used.end())) {
+      page.id = right_index_++;
+    }
+    used.push_back(page.id);
+  }
+  return result;
+}
+
+Status ListsChunks::Flush(const Slice& meta_key, rocksdb::WriteBatch* batch) {
+  written_ = 0;
+  for (size_t pos = 0; pos < chunks_.size();) {
+    if (!chunks_[pos].stub && chunks_[pos].size == 0) {
+      drop(pos);
+    } else if (chunks_[pos].dirty && chunks_[pos].size > 1 && chunks_[pos].bytes > kChunkBytes) {
+      // grown by Set
+      split(pos, chunks_[pos].size / 2);
+    } else {
+      pos++;
+    }
+  }
+  // a small changed chunk merges into its neighbour when they fit in one
+  for (size_t pos = 0; pos + 1 < chunks_.size();) {
+    if (!chunks_[pos].stub && !chunks_[pos + 1].stub && (chunks_[pos].dirty || chunks_[pos + 1].dirty) &&
+        std::min(chunks_[pos].size, chunks_[pos + 1].size) < kChunkSize / 4 &&
+        chunks_[pos].size + chunks_[pos + 1].size <= kChunkSize) {
+      Status s = load(pos, pos + 2);
+      if (!s.ok()) {
+        return s;
+      }
+      Chunk& chunk = chunks_[pos];
+      Chunk& next = chunks_[pos + 1];
+      if (chunk.bytes + next.bytes <= kChunkBytes) {
+        std::move(next.elements.begin(), next.elements.end(), std::back_inserter(chunk.elements));
+        chunk.size += next.size;
+        chunk.bytes += next.bytes;
+        chunk.dirty = true;
+        drop(pos + 1);
+        continue;
+      }
+    }
+    pos++;
+  }
+  // a changed run becomes a chunk, its records are deleted
+  for (auto& chunk : chunks_) {
+    if (chunk.dirty && chunk.legacy != 0) {
+      for (uint32_t i = 0; i < chunk.legacy; ++i) {
+        dropped_.push_back(chunk.id + i);
+      }
+      chunk.id = right_index_++;
+      chunk.legacy = 0;
+    }
+  }
+
+  std::string user_value(sizeof(uint64_t), '\0');
+  EncodeFixed64(user_value.data(), count_);
+  std::vector<uint64_t> kept;
+  for (const auto& page : paginate()) {
+    const Chunk& first = chunks_[page.begin];
+    uint64_t size = 0;
+    std::string entries;
+    for (size_t pos = page.begin; pos < page.end; ++pos) {
+      Chunk& chunk = chunks_[pos];
+      size += chunk.size;
+      if (!page.dirty) {
+        continue;
+      }
+      char entry[kEntryLength];
+      EncodeFixed64(entry, chunk.id);
+      EncodeFixed32(entry + sizeof(uint64_t), chunk.legacy != 0 ? chunk.size | kLegacyRun : chunk.size);
+      entries.append(entry, sizeof(entry));
+      chunk.page = page.id;
+    }
+
+    char ref[kPageRefLength];
+    if (!page.dirty && first.legacy != 0 && (first.stub || first.page == first.id)) {
+      // a page without a record left as it is, its runs are still consecutive
+      EncodeFixed64(ref, first.id);
+      EncodeFixed64(ref + sizeof(uint64_t), size | kLegacyPage);
+    } else {
+      if (page.dirty) {
+        BaseDataValue page_value(entries);
+        batch->Put(data_cf_, dataKeyOf(page.id), page_value.Encode());
+        written_++;
+      }
+      EncodeFixed64(ref, page.id);
+      EncodeFixed64(ref + sizeof(uint64_t), size);
+      kept.push_back(page.id);
+    }
+    user_value.append(ref, sizeof(ref));
+  }
+
+  for (auto& chunk : chunks_) {
+    if (chunk.dirty) {
+      std::string payload;
+      payload.reserve(chunk.bytes);
+      char len[sizeof(uint32_t)];
+      for (const auto& element : chunk.elements) {
+        EncodeFixed32(len, static_cast<uint32_t>(element.size()));
+        payload.append(len, sizeof(len));
+        payload.append(element);
+      }
+      BaseDataValue chunk_value(payload);
+      batch->Put(data_cf_, dataKeyOf(chunk.id), chunk_value.Encode());
+      chunk.dirty = false;
+      written_++;
+    }
+  }
+  for (uint64_t id : dropped_) {
+    batch->Delete(data_cf_, dataKeyOf(id));
+    written_++;
+  }
+  for (uint64_t id : pages_) {
+    if (std::find(kept.begin(), kept.end(), id) == kept.end()) {
+      batch->Delete(data_cf_, dataKeyOf(id));
+      written_++;
+    }
+  }
+  dropped_.clear();
+  dirty_pages_.clear();
+  pages_ = std::move(kept);
+
+  std::string meta_value = user_value + suffix_;
+  ParsedListsMetaValue parsed_lists_meta_value(&meta_value);
+  parsed_lists_meta_value.set_left_index(left_index_);
+  parsed_lists_meta_value.set_right_index(right_index_);
+  batch->Put(meta_cf_, meta_key, meta_value);
+  return Status::OK();
+}
+
+}  // namespace storage
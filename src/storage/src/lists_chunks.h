@@ -0,0 +1,158 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/write_batch.h"
+
+#include "storage/storage_define.h"
+
+namespace storage {
+
+using Status = rocksdb::Status;
+
+/**
+ * A list cut into chunks of consecutive elements, a data record each, like the nodes of a quicklist.
+ * The directory of the chunks, | id 8B | size 4B | each in list order, is cut into pages of kPageEntries entries at
+ * most, a data record each as well, so an index is found from the sizes without reading any element and a push or a
+ * pop rewrites its chunk and its page alone. The meta value keeps after the count | page id 8B | elements 8B | for
+ * each page.
+ * The data key of a chunk or a page has its id as index, the value of a chunk is a BaseDataValue of the elements,
+ * each after its fixed32 length. Ids are taken from the left index for a chunk put first and from the right index
+ * for the others, they aren't reused within a version.
+ * The lists written before have an element per data record and the count alone in their meta value, see IsChunked.
+ * They are read as they are until their first write, which keeps the records and refers to them from the meta value
+ * as pages without a record, flagged in their size, whose entries are runs of kChunkSize records. A run is rewritten
+ * as a chunk the first time one of its elements changes, the others are left as they are.
+ * Usage: Load, the edits, then Flush writes the changed chunks and pages and the meta value to a batch.
+ */
+class ListsChunks {
+ public:
+  // elements a chunk holds at most
+  static constexpr uint32_t kChunkSize = 128;
+  // bytes a chunk holds at most, unless it has a single element
+  static constexpr size_t kChunkBytes = 8 << 10;
+  // directory entries a page holds at most
+  static constexpr size_t kPageEntries = 256;
+
+  // whether the user value of the meta value of a non empty list has the directory
+  static bool IsChunked(const Slice& meta_user_value) { return meta_user_value.size() > sizeof(uint64_t); }
+
+  ListsChunks(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* meta_cf, rocksdb::ColumnFamilyHandle* data_cf,
+              const rocksdb::ReadOptions& read_options, const Slice& key);
+
+  // starts a list the key has no meta value for
+  void Create();
+  // starts from the meta value of the list, a new version of it when it is stale or empty
+  Status Load(const std::string& meta_value);
+
+  uint64_t Count() const { return count_; }
+  uint64_t Version() const { return version_; }
+
+  // index < Count() for the accessors below
+  Status Get(uint64_t index, std::string* element);
+  Status Set(uint64_t index, const Slice& element);
+  // the elements in [start, stop], appended
+  Status Range(uint64_t start, uint64_t stop, std::vector<std::string>* elements);
+  // the index of the first element equal to value, Count() when none is
+  Status Find(const Slice& value, uint64_t* index);
+
+  // inserts element before the one at index, after the last one when index is Count()
+  Status Insert(uint64_t index, const Slice& element);
+  // removes the n first elements, or the n last ones when back, appending them in the order removed
+  Status Pop(uint64_t n, bool back, std::vector<std::string>* elements);
+  // keeps the elements in [start, stop] alone
+  Status Trim(uint64_t start, uint64_t stop);
+  // removes the elements equal to value, the count first ones or from the tail when reverse, all when count is 0
+  Status Remove(const Slice& value, uint64_t count, bool reverse, uint64_t* removed);
+
+  // puts the changed chunks and pages, deletes the dropped ones and puts the meta value, merging small chunks and
+  // pages with a neighbour
+  Status Flush(const Slice& meta_key, rocksdb::WriteBatch* batch);
+  // the data records the last Flush wrote
+  uint64_t Written() const { return written_; }
+
+ private:
+  // an entry of the directory: a chunk, a run of the records of a list written before, or a page not read yet
+  struct Chunk {
+    uint64_t id = 0;
+    uint32_t size = 0;
+    // the records at consecutive indexes from id it is read from, 0 for a chunk
+    uint32_t legacy = 0;
+    // the id of its page, 0 for a page to create
+    uint64_t page = 0;
+    // stands for its whole page, a page without a record when legacy is set
+    bool stub = false;
+    bool loaded = false;
+    bool dirty = false;
+    size_t bytes = 0;
+    std::vector<std::string> elements;
+  };
+
+  // the entries [begin, end) of chunks_ written as one page
+  struct Page {
+    size_t begin = 0;
+    size_t end = 0;
+    uint64_t id = 0;
+    bool dirty = false;
+  };
+
+  // chunks read ahead by a scan, in one MultiGet
+  static constexpr size_t kReadAhead = 16;
+
+  std::string dataKeyOf(uint64_t id) const;
+  void addStub(uint64_t id, uint64_t size, bool legacy);
+  // replaces the stub at pos by the entries of its page
+  Status expand(size_t pos);
+  // the i-th entry from the front or from the back, its page read first
+  Status resolve(size_t i, bool back, size_t* pos);
+  // the entry holding index, and the offset of index in it
+  Status locate(uint64_t index, size_t* pos, uint32_t* offset);
+  // reads the elements of the entries in [first, last), stubs are skipped
+  Status load(size_t first, size_t last);
+  Status load(size_t pos) { return load(pos, pos + 1); }
+  // forgets the elements of a chunk left unchanged, once scanned
+  void release(size_t pos);
+  bool full(const Chunk& chunk, const Slice& element) const;
+  // whether element can be added to the entry at pos, a stub or a chunk of kChunkSize elements isn't read for it
+  Status fits(size_t pos, const Slice& element, bool* fits);
+  // a new chunk at pos holding element
+  void add(size_t pos, const Slice& element);
+  void insertAt(size_t pos, uint32_t offset, const Slice& element);
+  void eraseAt(size_t pos, uint32_t offset);
+  // moves the elements from offset on into a new chunk after pos
+  void split(size_t pos, uint32_t offset);
+  // drops the chunk at pos, whole
+  void drop(size_t pos);
+  // the entries grouped by page, merging the small changed pages and cutting the large ones
+  std::vector<Page> paginate();
+
+  rocksdb::DB* db_;
+  rocksdb::ColumnFamilyHandle* meta_cf_;
+  rocksdb::ColumnFamilyHandle* data_cf_;
+  rocksdb::ReadOptions read_options_;
+  std::string key_;
+
+  // the meta value after the user value: version, indexes, reserve and timestamps
+  std::string suffix_;
+  uint64_t version_ = 0;
+  uint64_t left_index_ = 0;
+  uint64_t right_index_ = 0;
+  uint64_t count_ = 0;
+  std::vector<Chunk> chunks_;
+  // the records to delete, of the dropped chunks and of the rewritten runs
+  std::vector<uint64_t> dropped_;
+  // the pages with a record the meta value refers to, and those which lost an entry
+  std::vector<uint64_t> pages_;
+  std::vector<uint64_t> dirty_pages_;
+  uint64_t written_ = 0;
+};
+
+}  // namespace storage
@@ -17,8 +17,9 @@ const uint64_t InitalLeftIndex = 9223372036854775807;
 const uint64_t InitalRightIndex = 9223372036854775808U;
 
 /*
- *| list_size | version | left index | right index | reserve |  cdate | timestamp |
- *|     8B    |    8B   |     8B     |      8B     |   16B   |    8B  |     8B    |
+ *| list_size | pages | version | left index | right index | reserve |  cdate | timestamp |
+ *|     8B    |       |    8B   |     8B     |      8B     |   16B   |    8B  |     8B    |
+ * pages: | page id 8B | elements 8B | for each page of the directory of the chunks, see ListsChunks
  */
 class ListsMetaValue : public InternalValue {
  public:
@@ -3,15 +3,29 @@
 //  LICENSE file in the root directory of this source tree. An additional grant
 //  of patent rights can be found in the PATENTS file in the same directory.
 
+#include <iterator>
 #include <sstream>
+#include <string_view>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
 
 #include "rocksdb/env.h"
 
 #include "config.h"
+#include "pstd/log.h"
+#include "src/base_data_key_format.h"
 #include "src/base_filter.h"
+#include "src/base_key_format.h"
+#include "src/base_meta_value_format.h"
+#include "src/coding.h"
 #include "src/lists_filter.h"
+#include "src/lists_meta_value_format.h"
 #include "src/redis.h"
+#include "src/scope_record_lock.h"
 #include "src/strings_filter.h"
+#include "src/strings_value_format.h"
+#include "src/type_index.h"
 #include "src/zsets_filter.h"
 
 namespace storage {
@@ -28,7 +42,7 @@ rocksdb::Comparator* ZSetsScoreKeyComparator() {
 Redis::Redis(Storage* const s, int32_t index)
     : storage_(s),
       index_(index),
-      lock_mgr_(std::make_shared<LockMgr>(1000, 0, std::make_shared<MutexFactoryImpl>())),
+      lock_mgr_(std::make_shared<LockMgr>(kKeyLatches)),
       small_compaction_threshold_(5000),
       small_compaction_duration_threshold_(10000) {
   statistics_store_ = std::make_unique<LRUCache<std::string, KeyStatistics>>();
@@ -151,7 +165,430 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
   column_families.emplace_back("zset_meta_cf", zset_meta_cf_ops);
   column_families.emplace_back("zset_data_cf", zset_data_cf_ops);
   column_families.emplace_back("zset_score_cf", zset_score_cf_ops);
-  return rocksdb::DB::Open(db_ops, db_path, column_families, &handles_, &db_);
+
+  // type index CF, at kTypeIndexCF
+  rocksdb::ColumnFamilyOptions type_index_cf_ops(storage_options.options);
+  type_index_cf_ops.merge_operator = std::make_shared<TypeIndexMergeOperator>();
+  type_index_cf_ops.compaction_filter_factory = std::make_shared<TypeIndexFilterFactory>();
+  // a key rewritten often piles up operands in the memtable, they get merged on write past this
+  type_index_cf_ops.max_successive_merges = 16;
+  type_index_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_ops));
+  column_families.emplace_back(TypeIndex::kColumnFamilyName, type_index_cf_ops);
+
+  // zset rank index CF, at kZsetsRankCF, its keys laid out like the zset data keys
+  rocksdb::ColumnFamilyOptions zset_rank_cf_ops(storage_options.options);
+  zset_rank_cf_ops.compaction_filter_factory = std::make_shared<BaseDataFilterFactory>(&db_, &handles_, kZsetsMetaCF);
+  zset_rank_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_ops));
+  column_families.emplace_back(ZSetsRankIndex::kColumnFamilyName, zset_rank_cf_ops);
+
+  auto s = rocksdb::DB::Open(db_ops, db_path, column_families, &handles_, &db_);
+  if (s.ok()) {
+    txn_db_ = new TxnDB(db_, &handles_);
+    db_ = txn_db_;
+    if (storage_options.value_cache_size > 0) {
+      value_cache_ = std::make_unique<ValueCache>(storage_options.value_cache_size / storage_options.db_instance_num);
+    }
+    if (storage_options.meta_cache_size > 0) {
+      meta_cache_ = std::make_unique<ValueCache>(storage_options.meta_cache_size / storage_options.db_instance_num);
+    }
+    if (value_cache_ || meta_cache_) {
+      txn_db_->SetWriteListener([this](ColumnFamilyIndex cf, const Slice& key) { invalidateCached(cf, key); });
+    }
+    s = buildTypeIndex();
+  }
+  return s;
+}
+
+// the meta column family of each type, every type encodes its meta key alike
+static constexpr std::pair<DataType, ColumnFamilyIndex> kMetaTypeCFs[] = {
+    {kStrings, kStringsCF}, {kHashes, kHashesMetaCF}, {kSets, kSetsMetaCF},
+    {kLists, kListsMetaCF}, {kZSets, kZsetsMetaCF},
+};
+static constexpr size_t kMetaTypes = std::size(kMetaTypeCFs);
+
+static ColumnFamilyIndex MetaCFOf(DataType type) {
+  for (const auto& [meta_type, cf] : kMetaTypeCFs) {
+    if (meta_type == type) {
+      return cf;
+    }
+  }
+  return kStringsCF;
+}
+
+void Redis::invalidateCached(ColumnFamilyIndex cf, const Slice& key) {
+  for (const auto& [type, meta_cf] : kMetaTypeCFs) {
+    if (cf != meta_cf) {
+      continue;
+    }
+    const auto cache_key = ValueCache::KeyOf(type, ParsedBaseMetaKey(key).Key());
+    if (meta_cache_ && type != DataType::kStrings) {
+      meta_cache_->Invalidate(cache_key);
+    }
+    if (value_cache_ && (type == DataType::kStrings || type == DataType::kHashes)) {
+      value_cache_->Invalidate(cache_key);
+    }
+    return;
+  }
+  if (value_cache_ && cf == kHashesDataCF) {
+    value_cache_->Invalidate(ValueCache::KeyOf(DataType::kHashes, ParsedHashesDataKey(key).Key()));
+  }
+}
+
+ValueCacheStats Redis::GetValueCacheStats() const { return value_cache_ ? value_cache_->GetStats() : ValueCacheStats{}; }
+
+ValueCacheStats Redis::GetMetaCacheStats() const { return meta_cache_ ? meta_cache_->GetStats() : ValueCacheStats{}; }
+
+int64_t Redis::CachedLen(DataType type, const Slice& key) const {
+  int64_t len = -1;
+  if (meta_cache_) {
+    meta_cache_->Peek(ValueCache::KeyOf(type, key), [type, &len](const CachedValue& cached_value) {
+      len = type == DataType::kLists ? static_cast<int64_t>(ParsedListsMetaValue(cached_value.value).Count())
+                                     : static_cast<int64_t>(ParsedBaseMetaValue(cached_value.value).Count());
+    });
+  }
+  return len;
+}
+
+Status Redis::getMeta(DataType type, const Slice& key, std::string* meta_value) {
+  const bool cached = meta_cache_ && !txn_db_->InTransaction();
+  std::string cache_key;
+  uint64_t ticket = 0;
+  if (cached) {
+    cache_key = ValueCache::KeyOf(type, key);
+    if (meta_cache_->Lookup(
+            cache_key, [meta_value](const CachedValue& cached_value) { *meta_value = cached_value.value; }, &ticket)) {
+      return Status::OK();
+    }
+  }
+
+  BaseMetaKey base_meta_key(key);
+  Status s = db_->Get(default_read_options_, handles_[MetaCFOf(type)], base_meta_key.Encode(), meta_value);
+  if (s.ok() && cached) {
+    // a stale meta is dropped by the next lookup anyway
+    const uint64_t etime =
+        type == DataType::kLists ? ParsedListsMetaValue(*meta_value).Etime() : ParsedBaseMetaValue(*meta_value).Etime();
+    meta_cache_->Insert(cache_key, {*meta_value, {}, etime}, ticket);
+  }
+  return s;
+}
+
+Status Redis::buildTypeIndex() {
+  std::string built;
+  Status s = db_->Get(default_read_options_, handles_[kTypeIndexCF], TypeIndex::kBuiltKey, &built);
+  if (!s.IsNotFound()) {
+    return s;
+  }
+
+  // a data directory of an older release, nothing is served until every key is indexed
+  INFO("rocksdb instance {} builds its type index", index_);
+  uint64_t indexed = 0;
+  rocksdb::WriteBatch batch;
+  for (const auto& [type, cf] : kMetaTypeCFs) {
+    std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(default_read_options_, handles_[cf]));
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      const auto value = iter->value();
+      std::string operand;
+      // an empty meta has no type to clear yet
+      if (!TypeIndex::OperandOf(cf, &value, &operand) || operand.size() == 1) {
+        continue;
+      }
+      batch.Merge(handles_[kTypeIndexCF], iter->key(), operand);
+      ++indexed;
+      if (batch.Count() >= 1024) {
+        s = db_->Write(default_write_options_, &batch);
+        if (!s.ok()) {
+          return s;
+        }
+        batch.Clear();
+      }
+    }
+    if (!iter->status().ok()) {
+      return iter->status();
+    }
+  }
+  // a restart before this point builds it again, the operands only set types
+  batch.Put(handles_[kTypeIndexCF], TypeIndex::kBuiltKey, "");
+  s = db_->Write(default_write_options_, &batch);
+  INFO("rocksdb instance {} indexed the types of {} keys", index_, indexed);
+  return s;
+}
+
+static const std::string kTxnIntentPrefix = std::string(TypeIndex::kReservedPrefix) + "txn_intent:";
+static const std::string kTxnMarkPrefix = std::string(TypeIndex::kReservedPrefix) + "txn_mark:";
+
+static std::string TxnKeyOf(const std::string& prefix, uint64_t id) {
+  std::string key(prefix);
+  char buf[sizeof(uint64_t)];
+  EncodeFixed64(buf, id);
+  key.append(buf, sizeof(buf));
+  return key;
+}
+
+// the records are written to the base DB, out of the transaction of the thread
+Status Redis::PutTransactionIntent(uint64_t id, const std::string& intent) {
+  return txn_db_->GetBaseDB()->Put(default_write_options_, handles_[kTypeIndexCF], TxnKeyOf(kTxnIntentPrefix, id),
+                                   intent);
+}
+
+Status Redis::MarkTransaction(uint64_t id) {
+  return db_->Put(default_write_options_, handles_[kTypeIndexCF], TxnKeyOf(kTxnMarkPrefix, id), "");
+}
+
+Status Redis::TransactionMarked(uint64_t id, bool* marked) {
+  std::string value;
+  Status s = txn_db_->GetBaseDB()->Get(default_read_options_, handles_[kTypeIndexCF], TxnKeyOf(kTxnMarkPrefix, id),
+                                       &value);
+  *marked = s.ok();
+  return s.IsNotFound() ? Status::OK() : s;
+}
+
+Status Redis::TransactionIntents(std::vector<std::pair<uint64_t, std::string>>* intents) {
+  std::unique_ptr<rocksdb::Iterator> iter(txn_db_->GetBaseDB()->NewIterator(default_read_options_,
+                                                                            handles_[kTypeIndexCF]));
+  for (iter->Seek(kTxnIntentPrefix); iter->Valid() && iter->key().starts_with(kTxnIntentPrefix); iter->Next()) {
+    if (iter->key().size() != kTxnIntentPrefix.size() + sizeof(uint64_t)) {
+      return Status::Corruption("transaction intent key");
+    }
+    intents->emplace_back(DecodeFixed64(iter->key().data() + kTxnIntentPrefix.size()), iter->value().ToString());
+  }
+  return iter->status();
+}
+
+Status Redis::ApplyTransaction(uint64_t id, const Slice& writes) {
+  // the writes carry their type index operands already, they skip the tagging of TxnDB
+  rocksdb::WriteBatch batch(writes.ToString());
+  Status s = batch.Put(handles_[kTypeIndexCF], TxnKeyOf(kTxnMarkPrefix, id), "");
+  if (s.ok()) {
+    s = txn_db_->GetBaseDB()->Write(default_write_options_, &batch);
+  }
+  return s;
+}
+
+Status Redis::ForgetTransaction(uint64_t id) {
+  rocksdb::WriteBatch batch;
+  batch.Delete(handles_[kTypeIndexCF], TxnKeyOf(kTxnIntentPrefix, id));
+  batch.Delete(handles_[kTypeIndexCF], TxnKeyOf(kTxnMarkPrefix, id));
+  return txn_db_->GetBaseDB()->Write(default_write_options_, &batch);
+}
+
+Status Redis::DropTransactionMarks() {
+  std::unique_ptr<rocksdb::Iterator> iter(txn_db_->GetBaseDB()->NewIterator(default_read_options_,
+                                                                            handles_[kTypeIndexCF]));
+  rocksdb::WriteBatch batch;
+  for (iter->Seek(kTxnMarkPrefix); iter->Valid() && iter->key().starts_with(kTxnMarkPrefix); iter->Next()) {
+    batch.Delete(handles_[kTypeIndexCF], iter->key());
+  }
+  if (!iter->status().ok()) {
+    return iter->status();
+  }
+  return batch.Count() > 0 ? txn_db_->GetBaseDB()->Write(default_write_options_, &batch) : Status::OK();
+}
+
+Status Redis::multiGetMetas(const std::vector<std::string>& keys, std::vector<std::string>* metas,
+                            std::vector<uint8_t>* types) {
+  // only the metas the type index has are read
+  std::vector<uint8_t> indexed;
+  Status s = ExistingTypes(keys, &indexed);
+  if (!s.ok()) {
+    return s;
+  }
+
+  std::vector<std::string> encoded_keys;
+  encoded_keys.reserve(keys.size());
+  for (const auto& key : keys) {
+    BaseMetaKey base_meta_key(key);
+    encoded_keys.push_back(base_meta_key.Encode().ToString());
+  }
+
+  std::vector<size_t> slots;
+  std::vector<rocksdb::ColumnFamilyHandle*> cfs;
+  std::vector<Slice> key_slices;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    for (size_t t = 0; t < kMetaTypes; ++t) {
+      if (indexed[i] & (1 << kMetaTypeCFs[t].first)) {
+        slots.push_back(i * kMetaTypes + t);
+        cfs.push_back(handles_[kMetaTypeCFs[t].second]);
+        key_slices.push_back(encoded_keys[i]);
+      }
+    }
+  }
+  const size_t n = slots.size();
+  std::vector<rocksdb::PinnableSlice> values(n);
+  std::vector<Status> statuses(n);
+  if (n > 0) {
+    db_->MultiGet(default_read_options_, n, cfs.data(), key_slices.data(), values.data(), statuses.data());
+  }
+
+  metas->assign(keys.size() * kMetaTypes, std::string());
+  types->assign(keys.size(), 0);
+  for (size_t j = 0; j < n; ++j) {
+    if (statuses[j].IsNotFound()) {
+      continue;
+    }
+    if (!statuses[j].ok()) {
+      return statuses[j];
+    }
+    const auto slot = slots[j];
+    const auto type = kMetaTypeCFs[slot % kMetaTypes].first;
+    auto& meta = (*metas)[slot];
+    meta = values[j].ToString();
+    bool valid = false;
+    if (type == kStrings) {
+      valid = !ParsedStringsValue(&meta).IsStale();
+    } else if (type == kLists) {
+      valid = ParsedListsMetaValue(&meta).IsValid();
+    } else {
+      valid = ParsedBaseMetaValue(&meta).IsValid();
+    }
+    if (valid) {
+      (*types)[slot / kMetaTypes] |= static_cast<uint8_t>(1 << type);
+    }
+  }
+  return Status::OK();
+}
+
+Status Redis::ExistingTypes(const std::vector<std::string>& keys, std::vector<uint8_t>* types) {
+  std::vector<std::string> encoded_keys;
+  encoded_keys.reserve(keys.size());
+  for (const auto& key : keys) {
+    BaseMetaKey base_meta_key(key);
+    encoded_keys.push_back(base_meta_key.Encode().ToString());
+  }
+  std::vector<Slice> key_slices(encoded_keys.begin(), encoded_keys.end());
+  std::vector<rocksdb::PinnableSlice> values(keys.size());
+  std::vector<Status> statuses(keys.size());
+  db_->MultiGet(default_read_options_, handles_[kTypeIndexCF], keys.size(), key_slices.data(), values.data(),
+                statuses.data());
+
+  const auto now = TypeIndex::Now();
+  types->assign(keys.size(), 0);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (statuses[i].ok()) {
+      (*types)[i] = TypeIndex::LiveTypes(values[i], now);
+    } else if (!statuses[i].IsNotFound()) {
+      return statuses[i];
+    }
+  }
+  return Status::OK();
+}
+
+Status Redis::MultiDel(const std::vector<std::string>& keys, std::vector<int32_t>* deleted) {
+  deleted->assign(keys.size(), 0);
+  MultiScopeRecordLock ml(lock_mgr_, keys);
+
+  std::vector<std::string> metas;
+  std::vector<uint8_t> types;
+  Status s = multiGetMetas(keys, &metas, &types);
+  if (!s.ok()) {
+    return s;
+  }
+
+  rocksdb::WriteBatch batch;
+  std::vector<std::tuple<DataType, size_t, uint64_t>> statistics;
+  std::unordered_set<std::string_view> seen;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    // a key given twice is deleted once
+    if (types[i] == 0 || !seen.insert(keys[i]).second) {
+      continue;
+    }
+    BaseMetaKey base_meta_key(keys[i]);
+    for (size_t t = 0; t < kMetaTypes; ++t) {
+      const auto [type, cf] = kMetaTypeCFs[t];
+      if (!(types[i] & (1 << type))) {
+        continue;
+      }
+      auto& meta = metas[i * kMetaTypes + t];
+      if (type == kStrings) {
+        batch.Delete(handles_[cf], base_meta_key.Encode());
+      } else if (type == kLists) {
+        ParsedListsMetaValue parsed_lists_meta_value(&meta);
+        statistics.emplace_back(type, i, parsed_lists_meta_value.Count());
+        parsed_lists_meta_value.InitialMetaValue();
+        batch.Put(handles_[cf], base_meta_key.Encode(), meta);
+      } else {
+        ParsedBaseMetaValue parsed_meta_value(&meta);
+        statistics.emplace_back(type, i, parsed_meta_value.Count());
+        parsed_meta_value.InitialMetaValue();
+        batch.Put(handles_[cf], base_meta_key.Encode(), meta);
+      }
+      ++(*deleted)[i];
+    }
+  }
+  if (batch.Count() == 0) {
+    return Status::OK();
+  }
+
+  s = db_->Write(default_write_options_, &batch);
+  if (!s.ok()) {
+    deleted->assign(keys.size(), 0);
+    return s;
+  }
+  for (const auto& [type, i, count] : statistics) {
+    UpdateSpecificKeyStatistics(type, keys[i], count);
+  }
+  return s;
+}
+
+Status Redis::MultiExpire(const std::vector<std::string>& keys, uint64_t ttl, std::vector<int32_t>* expired) {
+  expired->assign(keys.size(), 0);
+  MultiScopeRecordLock ml(lock_mgr_, keys);
+
+  std::vector<std::string> metas;
+  std::vector<uint8_t> types;
+  Status s = multiGetMetas(keys, &metas, &types);
+  if (!s.ok()) {
+    return s;
+  }
+
+  rocksdb::WriteBatch batch;
+  std::unordered_set<std::string_view> seen;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (types[i] == 0 || !seen.insert(keys[i]).second) {
+      continue;
+    }
+    BaseMetaKey base_meta_key(keys[i]);
+    for (size_t t = 0; t < kMetaTypes; ++t) {
+      const auto [type, cf] = kMetaTypeCFs[t];
+      if (!(types[i] & (1 << type))) {
+        continue;
+      }
+      auto& meta = metas[i * kMetaTypes + t];
+      if (type == kStrings) {
+        if (ttl > 0) {
+          ParsedStringsValue(&meta).SetRelativeTimestamp(ttl);
+          batch.Put(handles_[cf], base_meta_key.Encode(), meta);
+        } else {
+          batch.Delete(handles_[cf], base_meta_key.Encode());
+        }
+      } else if (type == kLists) {
+        ParsedListsMetaValue parsed_lists_meta_value(&meta);
+        if (ttl > 0) {
+          parsed_lists_meta_value.SetRelativeTimestamp(ttl);
+        } else {
+          parsed_lists_meta_value.InitialMetaValue();
+        }
+        batch.Put(handles_[cf], base_meta_key.Encode(), meta);
+      } else {
+        ParsedBaseMetaValue parsed_meta_value(&meta);
+        if (ttl > 0) {
+          parsed_meta_value.SetRelativeTimestamp(ttl);
+        } else {
+          parsed_meta_value.InitialMetaValue();
+        }
+        batch.Put(handles_[cf], base_meta_key.Encode(), meta);
+      }
+      ++(*expired)[i];
+    }
+  }
+  if (batch.Count() == 0) {
+    return Status::OK();
+  }
+
+  s = db_->Write(default_write_options_, &batch);
+  if (!s.ok()) {
+    expired->assign(keys.size(), 0);
+  }
+  return s;
 }
 
 Status Redis::GetScanStartPoint(const DataType& type, const Slice& key, const Slice& pattern, int64_t cursor,
@@ -223,6 +660,7 @@ Status Redis::CompactRange(const DataType& dtype, const rocksdb::Slice* begin, c
       if (s.ok() && (type == kData || type == kMetaAndData)) {
         db_->CompactRange(default_compact_range_options_, handles_[kZsetsDataCF], begin, end);
         db_->CompactRange(default_compact_range_options_, handles_[kZsetsScoreCF], begin, end);
+        db_->CompactRange(default_compact_range_options_, handles_[kZsetsRankCF], begin, end);
       }
       break;
     default:
@@ -21,7 +21,10 @@
 #include "src/lock_mgr.h"
 #include "src/lru_cache.h"
 #include "src/mutex_impl.h"
+#include "src/txn_db.h"
 #include "src/type_iterator.h"
+#include "src/value_cache.h"
+#include "src/zsets_rank_index.h"
 #include "storage/storage.h"
 #include "storage/storage_define.h"
 
@@ -38,6 +41,7 @@ class Redis {
   virtual ~Redis();
 
   rocksdb::DB* GetDB() { return db_; }
+  rocksdb::ColumnFamilyHandle* GetColumnFamilyHandle(ColumnFamilyIndex cf) { return handles_[cf]; }
 
   struct KeyStatistics {
     size_t window_size;
@@ -92,6 +96,36 @@ class Redis {
   };
 
   int GetIndex() const { return index_; }
+  // for locks taken across instances, see MultiInstanceRecordLock
+  const std::shared_ptr<LockMgr>& GetLockMgr() const { return lock_mgr_; }
+
+  // transaction of the calling thread, see TxnDB
+  void BeginTransaction() { txn_db_->Begin(); }
+  Status CommitTransaction() { return txn_db_->Commit(default_write_options_); }
+  void RollbackTransaction() { txn_db_->Rollback(); }
+  // the writes of the transaction of the calling thread, nullptr if it wrote nothing
+  rocksdb::WriteBatch* TransactionWrites() { return txn_db_->Pending(); }
+
+  // records of a transaction writing several instances, see Storage::CommitTransaction. The intent holds the writes
+  // of every instance, the mark is written with the writes of its instance
+  Status PutTransactionIntent(uint64_t id, const std::string& intent);
+  // marks the transaction of the calling thread
+  Status MarkTransaction(uint64_t id);
+  Status TransactionMarked(uint64_t id, bool* marked);
+  // the intents left by transactions which didn't finish, with their ids
+  Status TransactionIntents(std::vector<std::pair<uint64_t, std::string>>* intents);
+  // writes the writes of the instance out of an intent, with the mark
+  Status ApplyTransaction(uint64_t id, const Slice& writes);
+  // drops the intent and the mark of a transaction written whole
+  Status ForgetTransaction(uint64_t id);
+  // drops the marks left behind by a stop before their transaction was forgotten
+  Status DropTransactionMarks();
+
+  // zeros if the instance has no value cache
+  ValueCacheStats GetValueCacheStats() const;
+  ValueCacheStats GetMetaCacheStats() const;
+  // see Storage::CachedLen
+  int64_t CachedLen(DataType type, const Slice& key) const;
 
   Status SetOptions(const OptionType& option_type, const std::unordered_map<std::string, std::string>& options);
   void SetWriteWalOptions(const bool is_wal_disable);
@@ -124,6 +158,14 @@ class Redis {
   virtual Status ZsetsExpire(const Slice& key, uint64_t ttl);
   virtual Status SetsExpire(const Slice& key, uint64_t ttl);
 
+  // bit (1 << DataType) of (*types)[i] is set for each type keys[i] exists with,
+  // read by one MultiGet of the type index
+  Status ExistingTypes(const std::vector<std::string>& keys, std::vector<uint8_t>* types);
+  // every type of each key is deleted in one WriteBatch, (*deleted)[i] is how many keys[i] had
+  Status MultiDel(const std::vector<std::string>& keys, std::vector<int32_t>* deleted);
+  // the *Expire of every type for all the keys in one WriteBatch, (*expired)[i] counts the types of keys[i]
+  Status MultiExpire(const std::vector<std::string>& keys, uint64_t ttl, std::vector<int32_t>* expired);
+
   virtual Status StringsDel(const Slice& key);
   virtual Status HashesDel(const Slice& key);
   virtual Status ListsDel(const Slice& key);
@@ -163,6 +205,8 @@ class Redis {
   Status GetSet(const Slice& key, const Slice& value, std::string* old_value);
   Status Incrby(const Slice& key, int64_t value, int64_t* ret);
   Status Incrbyfloat(const Slice& key, const Slice& value, std::string* ret);
+  Status MGet(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss);
+  Status MGetWithTTL(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss);
   Status MSet(const std::vector<KeyValue>& kvs);
   Status MSetnx(const std::vector<KeyValue>& kvs, int32_t* ret);
   Status Set(const Slice& key, const Slice& value);
@@ -221,6 +265,8 @@ class Redis {
   Status SInterstore(const Slice& destination, const std::vector<std::string>& keys,
                      std::vector<std::string>& value_to_dest, int32_t* ret);
   Status SIsmember(const Slice& key, const Slice& member, int32_t* ret);
+  // (*found)[i] tells whether members[i] is in the set, NotFound when the set doesn't exist
+  Status SMIsmember(const Slice& key, const std::vector<std::string>& members, std::vector<char>* found);
   Status SMembers(const Slice& key, std::vector<std::string>* members);
   Status SMembersWithTTL(const Slice& key, std::vector<std::string>* members, uint64_t* ttl);
   Status SMove(const Slice& source, const Slice& destination, const Slice& member, int32_t* ret);
@@ -330,10 +376,14 @@ class Redis {
   }
 
  private:
+  // latches of the key lock table, 256KB per instance
+  static constexpr size_t kKeyLatches = 4096;
+
   int32_t index_ = 0;
   Storage* const storage_;
   std::shared_ptr<LockMgr> lock_mgr_;
   rocksdb::DB* db_ = nullptr;
+  TxnDB* txn_db_ = nullptr;  // db_ itself, wrapping the DB opened
 
   std::vector<rocksdb::ColumnFamilyHandle*> handles_;
   rocksdb::WriteOptions default_write_options_;
@@ -349,6 +399,34 @@ class Redis {
   Status StoreScanNextPoint(const DataType& type, const Slice& key, const Slice& pattern, int64_t cursor,
                             const std::string& next_point);
 
+  // indexes the types of the keys of a data directory written before the type index
+  Status buildTypeIndex();
+  // (*metas)[i * 5 + t] is the meta value of keys[i] for the t-th type, by one MultiGet
+  Status multiGetMetas(const std::vector<std::string>& keys, std::vector<std::string>* metas,
+                       std::vector<uint8_t>* types);
+
+  // hot values, null unless StorageOptions::value_cache_size is set, see ValueCache
+  std::unique_ptr<ValueCache> value_cache_;
+  // a transaction reads its own writes, it bypasses the cache
+  bool valueCached() const { return value_cache_ && !txn_db_->InTransaction(); }
+  // the meta values of the collections, null unless StorageOptions::meta_cache_size is set
+  std::unique_ptr<ValueCache> meta_cache_;
+  void invalidateCached(ColumnFamilyIndex cf, const Slice& key);
+  // the meta value of a collection, from the meta cache if it has it, else as of now.
+  // A caller reading data after it takes its snapshot after, so the data is no older than the meta
+  Status getMeta(DataType type, const Slice& key, std::string* meta_value);
+  // the values of string keys, with their expire time in ttl, hits from the cache and one MultiGet for the rest
+  Status multiGetStrings(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss);
+  // reads the hash at version from the snapshot of read_options into the cache
+  Status cacheHash(const Slice& key, const rocksdb::ReadOptions& read_options, uint64_t version, uint64_t etime,
+                   uint64_t ticket);
+
+  // writes a batch of zset keys, with the counts of their rank index, see ZSetsRankIndex
+  Status writeZsets(rocksdb::WriteBatch* batch);
+  // the rank index of a zset version of count members as of read_options, null if it has none matching
+  std::unique_ptr<ZSetsRankIndex> rankIndexOf(const Slice& key, uint64_t version, int32_t count,
+                                              const rocksdb::ReadOptions& read_options);
+
   // For Statistics
   std::atomic_uint64_t small_compaction_threshold_;
   std::atomic_uint64_t small_compaction_duration_threshold_;
@@ -6,6 +6,7 @@
 #include "src/base_key_format.h"
 #include "src/redis.h"
 
+#include <algorithm>
 #include <memory>
 #include <numeric>
 #include <random>
@@ -175,16 +176,65 @@ Status Redis::HExists(const Slice& key, const Slice& field) {
   return HGet(key, field, &value);
 }
 
+// the field in the fields of a cached hash, ordered by field
+static const FieldValue* FindField(const std::vector<FieldValue>& fvs, const Slice& field) {
+  auto it = std::lower_bound(fvs.begin(), fvs.end(), field,
+                             [](const FieldValue& fv, const Slice& f) { return Slice(fv.field).compare(f) < 0; });
+  return it != fvs.end() && Slice(it->field) == field ? &*it : nullptr;
+}
+
+static void SortFields(std::vector<FieldValue>* fvs) {
+  std::sort(fvs->begin(), fvs->end(),
+            [](const FieldValue& a, const FieldValue& b) { return Slice(a.field).compare(b.field) < 0; });
+}
+
+Status Redis::cacheHash(const Slice& key, const rocksdb::ReadOptions& read_options, uint64_t version, uint64_t etime,
+                        uint64_t ticket) {
+  CachedValue cached_value;
+  cached_value.etime = etime;
+  HashesDataKey hashes_data_key(key, version, "");
+  Slice prefix = hashes_data_key.EncodeSeekKey();
+  std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(read_options, handles_[kHashesDataCF]));
+  for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
+    ParsedHashesDataKey parsed_hashes_data_key(iter->key());
+    ParsedBaseDataValue parsed_internal_value(iter->value());
+    cached_value.fields.push_back(
+        {parsed_hashes_data_key.field().ToString(), parsed_internal_value.UserValue().ToString()});
+  }
+  if (!iter->status().ok()) {
+    return iter->status();
+  }
+  SortFields(&cached_value.fields);
+  value_cache_->Insert(ValueCache::KeyOf(DataType::kHashes, key), std::move(cached_value), ticket);
+  return Status::OK();
+}
+
 Status Redis::HGet(const Slice& key, const Slice& field, std::string* value) {
+  const bool cached = valueCached();
+  std::string cache_key;
+  uint64_t ticket = 0;
+  if (cached) {
+    cache_key = ValueCache::KeyOf(DataType::kHashes, key);
+    Status hit;
+    auto read = [&](const CachedValue& cached_value) {
+      const auto* fv = FindField(cached_value.fields, field);
+      hit = fv ? Status::OK() : Status::NotFound();
+      if (fv) {
+        *value = fv->value;
+      }
+    };
+    if (value_cache_->Lookup(cache_key, read, &ticket)) {
+      return hit;
+    }
+  }
+
   std::string meta_value;
   uint64_t version = 0;
+  Status s = getMeta(DataType::kHashes, key, &meta_value);
   rocksdb::ReadOptions read_options;
   const rocksdb::Snapshot* snapshot;
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-
-  BaseMetaKey base_meta_key(key);
-  Status s = db_->Get(read_options, handles_[kHashesMetaCF], base_meta_key.Encode(), &meta_value);
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale()) {
@@ -199,12 +249,30 @@ Status Redis::HGet(const Slice& key, const Slice& field, std::string* value) {
         ParsedBaseDataValue parsed_internal_value(value);
         parsed_internal_value.StripSuffix();
       }
+      // a small hash read often is cached whole
+      if ((s.ok() || s.IsNotFound()) && cached && parsed_hashes_meta_value.Count() <= ValueCache::kMaxFields &&
+          value_cache_->Frequent(cache_key)) {
+        cacheHash(key, read_options, version, parsed_hashes_meta_value.Etime(), ticket);
+      }
     }
   }
   return s;
 }
 
 Status Redis::HGetall(const Slice& key, std::vector<FieldValue>* fvs) {
+  const bool cached = valueCached();
+  std::string cache_key;
+  uint64_t ticket = 0;
+  if (cached) {
+    cache_key = ValueCache::KeyOf(DataType::kHashes, key);
+    auto read = [fvs](const CachedValue& cached_value) {
+      fvs->insert(fvs->end(), cached_value.fields.begin(), cached_value.fields.end());
+    };
+    if (value_cache_->Lookup(cache_key, read, &ticket)) {
+      return Status::OK();
+    }
+  }
+
   rocksdb::ReadOptions read_options;
   const rocksdb::Snapshot* snapshot;
 
@@ -233,6 +301,11 @@ Status Redis::HGetall(const Slice& key, std::vector<FieldValue>* fvs) {
         fvs->push_back({parsed_hashes_data_key.field().ToString(), parsed_internal_value.UserValue().ToString()});
       }
       delete iter;
+      if (cached && parsed_hashes_meta_value.Count() <= ValueCache::kMaxFields) {
+        CachedValue cached_value{std::string(), *fvs, parsed_hashes_meta_value.Etime()};
+        SortFields(&cached_value.fields);
+        value_cache_->Insert(cache_key, std::move(cached_value), ticket);
+      }
     }
   }
   return s;
@@ -475,9 +548,7 @@ Status Redis::HKeys(const Slice& key, std::vector<std::string>* fields) {
 Status Redis::HLen(const Slice& key, int32_t* ret) {
   *ret = 0;
   std::string meta_value;
-
-  BaseMetaKey base_meta_key(key);
-  Status s = db_->Get(default_read_options_, handles_[kHashesMetaCF], base_meta_key.Encode(), &meta_value);
+  Status s = getMeta(DataType::kHashes, key, &meta_value);
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale()) {
@@ -496,17 +567,31 @@ Status Redis::HLen(const Slice& key, int32_t* ret) {
 
 Status Redis::HMGet(const Slice& key, const std::vector<std::string>& fields, std::vector<ValueStatus>* vss) {
   vss->clear();
+  const bool cached = valueCached();
+  std::string cache_key;
+  uint64_t ticket = 0;
+  if (cached) {
+    cache_key = ValueCache::KeyOf(DataType::kHashes, key);
+    auto read = [&](const CachedValue& cached_value) {
+      for (const auto& field : fields) {
+        const auto* fv = FindField(cached_value.fields, field);
+        vss->push_back(fv ? ValueStatus{fv->value, Status::OK()} : ValueStatus{std::string(), Status::NotFound()});
+      }
+    };
+    if (value_cache_->Lookup(cache_key, read, &ticket)) {
+      return Status::OK();
+    }
+  }
 
   uint64_t version = 0;
   bool is_stale = false;
   std::string value;
   std::string meta_value;
+  Status s = getMeta(DataType::kHashes, key, &meta_value);
   rocksdb::ReadOptions read_options;
   const rocksdb::Snapshot* snapshot;
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-  BaseMetaKey base_meta_key(key);
-  Status s = db_->Get(read_options, handles_[kHashesMetaCF], base_meta_key.Encode(), &meta_value);
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if ((is_stale = parsed_hashes_meta_value.IsStale()) || parsed_hashes_meta_value.Count() == 0) {
@@ -530,6 +615,9 @@ Status Redis::HMGet(const Slice& key, const std::vector<std::string>& fields, st
           return s;
         }
       }
+      if (cached && parsed_hashes_meta_value.Count() <= ValueCache::kMaxFields && value_cache_->Frequent(cache_key)) {
+        cacheHash(key, read_options, version, parsed_hashes_meta_value.Etime(), ticket);
+      }
     }
     return Status::OK();
   } else if (s.IsNotFound()) {
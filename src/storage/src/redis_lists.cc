@@ -3,11 +3,13 @@
 //  LICENSE file in the root directory of this source tree. An additional grant
 //  of patent rights can be found in the PATENTS file in the same directory.
 
+#include <algorithm>
 #include <memory>
 
 #include <fmt/core.h>
 #include "pstd/log.h"
 #include "src/base_data_value_format.h"
+#include "src/lists_chunks.h"
 #include "src/lists_filter.h"
 #include "src/redis.h"
 #include "src/scope_record_lock.h"
@@ -100,36 +102,94 @@ Status Redis::ListsPKPatternMatchDel(const std::string& pattern, int32_t* ret) {
   return s;
 }
 
+namespace {
+
+// the elements in [start, stop] of a list of count, negative ones from the tail, false if none is
+bool SublistOf(uint64_t count, int64_t start, int64_t stop, uint64_t* first, uint64_t* last) {
+  auto size = static_cast<int64_t>(count);
+  int64_t sublist_start = start >= 0 ? start : size + start;
+  int64_t sublist_stop = stop >= 0 ? stop : size + stop;
+  if (sublist_start > sublist_stop || sublist_start >= size || sublist_stop < 0) {
+    return false;
+  }
+  *first = std::max<int64_t>(sublist_start, 0);
+  *last = std::min<int64_t>(sublist_stop, size - 1);
+  return true;
+}
+
+// the position of index, negative from the tail, false out of the list
+bool PositionOf(uint64_t count, int64_t index, uint64_t* pos) {
+  auto size = static_cast<int64_t>(count);
+  int64_t target = index >= 0 ? index : size + index;
+  if (target < 0 || target >= size) {
+    return false;
+  }
+  *pos = target;
+  return true;
+}
+
+Status ChunkedIndex(ListsChunks* chunks, const std::string& meta_value, int64_t index, std::string* element) {
+  Status s = chunks->Load(meta_value);
+  if (!s.ok()) {
+    return s;
+  }
+  uint64_t pos;
+  if (!PositionOf(chunks->Count(), index, &pos)) {
+    return Status::NotFound();
+  }
+  return chunks->Get(pos, element);
+}
+
+}  // namespace
+
 Status Redis::LIndex(const Slice& key, int64_t index, std::string* element) {
+  std::string meta_value;
+  Status s = getMeta(DataType::kLists, key, &meta_value);
+  if (!s.ok()) {
+    return s;
+  }
+
   rocksdb::ReadOptions read_options;
   const rocksdb::Snapshot* snapshot;
-
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-  std::string meta_value;
-
-  BaseMetaKey base_meta_key(key);
-  Status s = db_->Get(read_options, handles_[kListsMetaCF], base_meta_key.Encode(), &meta_value);
-  if (s.ok()) {
-    ParsedListsMetaValue parsed_lists_meta_value(&meta_value);
-    uint64_t version = parsed_lists_meta_value.Version();
+  // missing is set when the data the meta value names isn't in the snapshot
+  auto indexIn = [&](std::string* meta, bool* missing) {
+    *missing = false;
+    ParsedListsMetaValue parsed_lists_meta_value(meta);
     if (parsed_lists_meta_value.IsStale()) {
       return Status::NotFound("Stale");
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
-    } else {
-      uint64_t target_index =
-          index >= 0 ? parsed_lists_meta_value.LeftIndex() + index + 1 : parsed_lists_meta_value.RightIndex() + index;
-      if (parsed_lists_meta_value.LeftIndex() < target_index && target_index < parsed_lists_meta_value.RightIndex()) {
-        ListsDataKey lists_data_key(key, version, target_index);
-        s = db_->Get(read_options, handles_[kListsDataCF], lists_data_key.Encode(), element);
-        if (s.ok()) {
-          ParsedBaseDataValue parsed_value(element);
-          parsed_value.StripSuffix();
-        }
-      } else {
-        return Status::NotFound();
-      }
+    } else if (ListsChunks::IsChunked(parsed_lists_meta_value.UserValue())) {
+      ListsChunks chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], read_options, key);
+      Status s = ChunkedIndex(&chunks, *meta, index, element);
+      *missing = s.IsCorruption();
+      return s;
+    }
+    uint64_t target_index =
+        index >= 0 ? parsed_lists_meta_value.LeftIndex() + index + 1 : parsed_lists_meta_value.RightIndex() + index;
+    if (parsed_lists_meta_value.LeftIndex() >= target_index || target_index >= parsed_lists_meta_value.RightIndex()) {
+      return Status::NotFound();
+    }
+    ListsDataKey lists_data_key(key, parsed_lists_meta_value.Version(), target_index);
+    Status s = db_->Get(read_options, handles_[kListsDataCF], lists_data_key.Encode(), element);
+    if (s.ok()) {
+      ParsedBaseDataValue parsed_value(element);
+      parsed_value.StripSuffix();
+    }
+    *missing = s.IsNotFound();
+    return s;
+  };
+
+  bool missing = false;
+  s = indexIn(&meta_value, &missing);
+  if (missing) {
+    // the meta value was read before the snapshot, a write in between may have rewritten the records it names
+    BaseMetaKey base_meta_key(key);
+    s = db_->Get(read_options, handles_[kListsMetaCF], base_meta_key.Encode(), &meta_value);
+    if (s.ok()) {
+      s = indexIn(&meta_value, &missing);
     }
   }
   return s;
@@ -151,87 +211,29 @@ Status Redis::LInsert(const Slice& key, const BeforeOrAfter& before_or_after, co
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
-      bool find_pivot = false;
+      ListsChunks chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], default_read_options_, key);
       uint64_t pivot_index = 0;
-      uint64_t version = parsed_lists_meta_value.Version();
-      uint64_t current_index = parsed_lists_meta_value.LeftIndex() + 1;
-      rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-      ListsDataKey start_data_key(key, version, current_index);
-      for (iter->Seek(start_data_key.Encode()); iter->Valid() && current_index < parsed_lists_meta_value.RightIndex();
-           iter->Next(), current_index++) {
-        ParsedBaseDataValue parsed_value(iter->value());
-        if (pivot.compare(parsed_value.UserValue().ToString()) == 0) {
-          find_pivot = true;
-          pivot_index = current_index;
-          break;
-        }
+      s = chunks.Load(meta_value);
+      if (s.ok()) {
+        s = chunks.Find(pivot, &pivot_index);
+      }
+      if (!s.ok()) {
+        return s;
       }
-      delete iter;
-      if (!find_pivot) {
+      if (pivot_index == chunks.Count()) {
         *ret = -1;
         return Status::NotFound();
-      } else {
-        uint64_t target_index;
-        std::vector<std::string> list_nodes;
-        uint64_t mid_index = parsed_lists_meta_value.LeftIndex() +
-                             (parsed_lists_meta_value.RightIndex() - parsed_lists_meta_value.LeftIndex()) / 2;
-        if (pivot_index <= mid_index) {
-          target_index = (before_or_after == Before) ? pivot_index - 1 : pivot_index;
-          current_index = parsed_lists_meta_value.LeftIndex() + 1;
-          rocksdb::Iterator* first_half_iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-          ListsDataKey start_data_key(key, version, current_index);
-          for (first_half_iter->Seek(start_data_key.Encode()); first_half_iter->Valid() && current_index <= pivot_index;
-               first_half_iter->Next(), current_index++) {
-            ParsedBaseDataValue parsed_value(first_half_iter->value());
-            if (current_index == pivot_index) {
-              if (before_or_after == After) {
-                list_nodes.push_back(parsed_value.UserValue().ToString());
-              }
-              break;
-            }
-            list_nodes.push_back(parsed_value.UserValue().ToString());
-          }
-          delete first_half_iter;
-
-          current_index = parsed_lists_meta_value.LeftIndex();
-          for (const auto& node : list_nodes) {
-            ListsDataKey lists_data_key(key, version, current_index++);
-            BaseDataValue i_val(node);
-            batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
-          }
-          parsed_lists_meta_value.ModifyLeftIndex(1);
-        } else {
-          target_index = (before_or_after == Before) ? pivot_index : pivot_index + 1;
-          current_index = pivot_index;
-          rocksdb::Iterator* after_half_iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-          ListsDataKey start_data_key(key, version, current_index);
-          for (after_half_iter->Seek(start_data_key.Encode());
-               after_half_iter->Valid() && current_index < parsed_lists_meta_value.RightIndex();
-               after_half_iter->Next(), current_index++) {
-            if (current_index == pivot_index && before_or_after == BeforeOrAfter::After) {
-              continue;
-            }
-            ParsedBaseDataValue parsed_value(after_half_iter->value());
-            list_nodes.push_back(parsed_value.UserValue().ToString());
-          }
-          delete after_half_iter;
-
-          current_index = target_index + 1;
-          for (const auto& node : list_nodes) {
-            ListsDataKey lists_data_key(key, version, current_index++);
-            BaseDataValue i_val(node);
-            batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
-          }
-          parsed_lists_meta_value.ModifyRightIndex(1);
-        }
-        parsed_lists_meta_value.ModifyCount(1);
-        batch.Put(handles_[kListsMetaCF], base_meta_key.Encode(), meta_value);
-        ListsDataKey lists_target_key(key, version, target_index);
-        BaseDataValue i_val(value);
-        batch.Put(handles_[kListsDataCF], lists_target_key.Encode(), i_val.Encode());
-        *ret = static_cast<int32_t>(parsed_lists_meta_value.Count());
-        return db_->Write(default_write_options_, &batch);
       }
+      // the chunk of the pivot is rewritten alone, or split in two when it is full
+      s = chunks.Insert(before_or_after == Before ? pivot_index : pivot_index + 1, value);
+      if (s.ok()) {
+        s = chunks.Flush(base_meta_key.Encode(), &batch);
+      }
+      if (!s.ok()) {
+        return s;
+      }
+      *ret = static_cast<int64_t>(chunks.Count());
+      return db_->Write(default_write_options_, &batch);
     }
   } else if (s.IsNotFound()) {
     *ret = 0;
@@ -242,9 +244,7 @@ Status Redis::LInsert(const Slice& key, const BeforeOrAfter& before_or_after, co
 Status Redis::LLen(const Slice& key, uint64_t* len) {
   *len = 0;
   std::string meta_value;
-
-  BaseMetaKey base_meta_key(key);
-  Status s = db_->Get(default_read_options_, handles_[kListsMetaCF], base_meta_key.Encode(), &meta_value);
+  Status s = getMeta(DataType::kLists, key, &meta_value);
   if (s.ok()) {
     ParsedListsMetaValue parsed_lists_meta_value(&meta_value);
     if (parsed_lists_meta_value.IsStale()) {
@@ -260,7 +260,6 @@ Status Redis::LLen(const Slice& key, uint64_t* len) {
 }
 
 Status Redis::LPop(const Slice& key, int64_t count, std::vector<std::string>* elements) {
-  uint32_t statistic = 0;
   elements->clear();
 
   rocksdb::WriteBatch batch;
@@ -277,32 +276,21 @@ Status Redis::LPop(const Slice& key, int64_t count, std::vector<std::string>* el
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
-      auto size = static_cast<int64_t>(parsed_lists_meta_value.Count());
-      uint64_t version = parsed_lists_meta_value.Version();
-      int32_t start_index = 0;
-      auto stop_index = static_cast<int32_t>(count <= size ? count - 1 : size - 1);
-      int32_t cur_index = 0;
-      ListsDataKey lists_data_key(key, version, parsed_lists_meta_value.LeftIndex() + 1);
-      rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-      for (iter->Seek(lists_data_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
-        statistic++;
-        ParsedBaseDataValue parsed_base_data_value(iter->value());
-        elements->push_back(parsed_base_data_value.UserValue().ToString());
-        batch.Delete(handles_[kListsDataCF], iter->key());
-
-        parsed_lists_meta_value.ModifyCount(-1);
-        parsed_lists_meta_value.ModifyLeftIndex(-1);
+      ListsChunks chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], default_read_options_, key);
+      s = chunks.Load(meta_value);
+      if (s.ok()) {
+        s = chunks.Pop(std::max<int64_t>(count, 0), false, elements);
       }
-      batch.Put(handles_[kListsMetaCF], base_meta_key.Encode(), meta_value);
-      delete iter;
-    }
-  }
-  if (batch.Count() != 0U) {
-    s = db_->Write(default_write_options_, &batch);
-    if (s.ok()) {
-      batch.Clear();
+      if (s.ok()) {
+        s = chunks.Flush(base_meta_key.Encode(), &batch);
+      }
+      if (!s.ok()) {
+        elements->clear();
+        return s;
+      }
+      s = db_->Write(default_write_options_, &batch);
+      UpdateSpecificKeyStatistics(DataType::kLists, key.ToString(), chunks.Written());
     }
-    UpdateSpecificKeyStatistics(DataType::kLists, key.ToString(), statistic);
   }
   return s;
 }
@@ -312,46 +300,27 @@ Status Redis::LPush(const Slice& key, const std::vector<std::string>& values, ui
   rocksdb::WriteBatch batch;
   ScopeRecordLock l(lock_mgr_, key);
 
-  uint64_t index = 0;
-  uint64_t version = 0;
   std::string meta_value;
+  ListsChunks chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], default_read_options_, key);
 
   BaseMetaKey base_meta_key(key);
   Status s = db_->Get(default_read_options_, handles_[kListsMetaCF], base_meta_key.Encode(), &meta_value);
   if (s.ok()) {
-    ParsedListsMetaValue parsed_lists_meta_value(&meta_value);
-    if (parsed_lists_meta_value.IsStale() || parsed_lists_meta_value.Count() == 0) {
-      version = parsed_lists_meta_value.InitialMetaValue();
-    } else {
-      version = parsed_lists_meta_value.Version();
-    }
-    for (const auto& value : values) {
-      index = parsed_lists_meta_value.LeftIndex();
-      parsed_lists_meta_value.ModifyLeftIndex(1);
-      parsed_lists_meta_value.ModifyCount(1);
-      ListsDataKey lists_data_key(key, version, index);
-      BaseDataValue i_val(value);
-      batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
-    }
-    batch.Put(handles_[kListsMetaCF], base_meta_key.Encode(), meta_value);
-    *ret = parsed_lists_meta_value.Count();
+    s = chunks.Load(meta_value);
   } else if (s.IsNotFound()) {
-    char str[8];
-    EncodeFixed64(str, values.size());
-    ListsMetaValue lists_meta_value(Slice(str, sizeof(uint64_t)));
-    version = lists_meta_value.UpdateVersion();
-    for (const auto& value : values) {
-      index = lists_meta_value.LeftIndex();
-      lists_meta_value.ModifyLeftIndex(1);
-      ListsDataKey lists_data_key(key, version, index);
-      BaseDataValue i_val(value);
-      batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
-    }
-    batch.Put(handles_[kListsMetaCF], base_meta_key.Encode(), lists_meta_value.Encode());
-    *ret = lists_meta_value.RightIndex() - lists_meta_value.LeftIndex() - 1;
-  } else {
+    chunks.Create();
+    s = Status::OK();
+  }
+  for (size_t i = 0; s.ok() && i < values.size(); ++i) {
+    s = chunks.Insert(0, values[i]);
+  }
+  if (s.ok()) {
+    s = chunks.Flush(base_meta_key.Encode(), &batch);
+  }
+  if (!s.ok()) {
     return s;
   }
+  *ret = chunks.Count();
   return db_->Write(default_write_options_, &batch);
 }
 
@@ -371,17 +340,18 @@ Status Redis::LPushx(const Slice& key, const std::vector<std::string>& values, u
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
-      uint64_t version = parsed_lists_meta_value.Version();
-      for (const auto& value : values) {
-        uint64_t index = parsed_lists_meta_value.LeftIndex();
-        parsed_lists_meta_value.ModifyCount(1);
-        parsed_lists_meta_value.ModifyLeftIndex(1);
-        ListsDataKey lists_data_key(key, version, index);
-        BaseDataValue i_val(value);
-        batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
+      ListsChunks chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], default_read_options_, key);
+      s = chunks.Load(meta_value);
+      for (size_t i = 0; s.ok() && i < values.size(); ++i) {
+        s = chunks.Insert(0, values[i]);
       }
-      batch.Put(handles_[kListsMetaCF], base_meta_key.Encode(), meta_value);
-      *len = parsed_lists_meta_value.Count();
+      if (s.ok()) {
+        s = chunks.Flush(base_meta_key.Encode(), &batch);
+      }
+      if (!s.ok()) {
+        return s;
+      }
+      *len = chunks.Count();
       return db_->Write(default_write_options_, &batch);
     }
   }
@@ -404,6 +374,18 @@ Status Redis::LRange(const Slice& key, int64_t start, int64_t stop, std::vector<
       return Status::NotFound("Stale");
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
+    } else if (ListsChunks::IsChunked(parsed_lists_meta_value.UserValue())) {
+      uint64_t first = 0;
+      uint64_t last = 0;
+      if (!SublistOf(parsed_lists_meta_value.Count(), start, stop, &first, &last)) {
+        return Status::OK();
+      }
+      ListsChunks chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], read_options, key);
+      s = chunks.Load(meta_value);
+      if (s.ok()) {
+        s = chunks.Range(first, last, ret);
+      }
+      return s;
     } else {
       uint64_t version = parsed_lists_meta_value.Version();
       uint64_t origin_left_index = parsed_lists_meta_value.LeftIndex() + 1;
@@ -466,6 +448,20 @@ Status Redis::LRangeWithTTL(const Slice& key, int64_t start, int64_t stop, std::
         *ttl = *ttl - curtime >= 0 ? *ttl - curtime : -2;
       }
 
+      if (ListsChunks::IsChunked(parsed_lists_meta_value.UserValue())) {
+        uint64_t first = 0;
+        uint64_t last = 0;
+        if (!SublistOf(parsed_lists_meta_value.Count(), start, stop, &first, &last)) {
+          return Status::OK();
+        }
+        ListsChunks chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], read_options, key);
+        s = chunks.Load(meta_value);
+        if (s.ok()) {
+          s = chunks.Range(first, last, ret);
+        }
+        return s;
+      }
+
       uint64_t version = parsed_lists_meta_value.Version();
       uint64_t origin_left_index = parsed_lists_meta_value.LeftIndex() + 1;
       uint64_t origin_right_index = parsed_lists_meta_value.RightIndex() - 1;
@@ -514,107 +510,25 @@ Status Redis::LRem(const Slice& key, int64_t count, const Slice& value, uint64_t
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
-      uint64_t current_index;
-      std::vector<uint64_t> target_index;
-      std::vector<uint64_t> delete_index;
-      uint64_t rest = (count < 0) ? -count : count;
-      uint64_t version = parsed_lists_meta_value.Version();
-      uint64_t start_index = parsed_lists_meta_value.LeftIndex() + 1;
-      uint64_t stop_index = parsed_lists_meta_value.RightIndex() - 1;
-      ListsDataKey start_data_key(key, version, start_index);
-      ListsDataKey stop_data_key(key, version, stop_index);
-      if (count >= 0) {
-        current_index = start_index;
-        rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-        for (iter->Seek(start_data_key.Encode());
-             iter->Valid() && current_index <= stop_index && ((count == 0) || rest != 0);
-             iter->Next(), current_index++) {
-          ParsedBaseDataValue parsed_value(iter->value());
-          if (value.compare(parsed_value.UserValue()) == 0) {
-            target_index.push_back(current_index);
-            if (count != 0) {
-              rest--;
-            }
-          }
-        }
-        delete iter;
-      } else {
-        current_index = stop_index;
-        rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-        for (iter->Seek(stop_data_key.Encode());
-             iter->Valid() && current_index >= start_index && ((count == 0) || rest != 0);
-             iter->Prev(), current_index--) {
-          ParsedBaseDataValue parsed_value(iter->value());
-          if (value.compare(parsed_value.UserValue()) == 0) {
-            target_index.push_back(current_index);
-            if (count != 0) {
-              rest--;
-            }
-          }
-        }
-        delete iter;
+      // the chunks holding a match are rewritten alone
+      ListsChunks chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], default_read_options_, key);
+      uint64_t removed = 0;
+      s = chunks.Load(meta_value);
+      if (s.ok()) {
+        s = chunks.Remove(value, count < 0 ? -count : count, count < 0, &removed);
       }
-      if (target_index.empty()) {
-        *ret = 0;
+      if (!s.ok()) {
+        return s;
+      }
+      if (removed == 0) {
         return Status::NotFound();
-      } else {
-        rest = target_index.size();
-        uint64_t sublist_left_index = (count >= 0) ? target_index[0] : target_index[target_index.size() - 1];
-        uint64_t sublist_right_index = (count >= 0) ? target_index[target_index.size() - 1] : target_index[0];
-        uint64_t left_part_len = sublist_right_index - start_index;
-        uint64_t right_part_len = stop_index - sublist_left_index;
-        if (left_part_len <= right_part_len) {
-          uint64_t left = sublist_right_index;
-          current_index = sublist_right_index;
-          ListsDataKey sublist_right_key(key, version, sublist_right_index);
-          rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-          for (iter->Seek(sublist_right_key.Encode()); iter->Valid() && current_index >= start_index;
-               iter->Prev(), current_index--) {
-            ParsedBaseDataValue parsed_value(iter->value());
-            if (value.compare(parsed_value.UserValue()) == 0 && rest > 0) {
-              rest--;
-            } else {
-              ListsDataKey lists_data_key(key, version, left--);
-              batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), iter->value());
-            }
-          }
-          delete iter;
-          uint64_t left_index = parsed_lists_meta_value.LeftIndex();
-          for (uint64_t idx = 0; idx < target_index.size(); ++idx) {
-            delete_index.push_back(left_index + idx + 1);
-          }
-          parsed_lists_meta_value.ModifyLeftIndex(-target_index.size());
-        } else {
-          uint64_t right = sublist_left_index;
-          current_index = sublist_left_index;
-          ListsDataKey sublist_left_key(key, version, sublist_left_index);
-          rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-          for (iter->Seek(sublist_left_key.Encode()); iter->Valid() && current_index <= stop_index;
-               iter->Next(), current_index++) {
-            ParsedBaseDataValue parsed_value(iter->value());
-            if ((value.compare(parsed_value.UserValue()) == 0) && rest > 0) {
-              rest--;
-            } else {
-              ListsDataKey lists_data_key(key, version, right++);
-              batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), iter->value());
-            }
-          }
-          delete iter;
-          uint64_t right_index = parsed_lists_meta_value.RightIndex();
-          for (uint64_t idx = 0; idx < target_index.size(); ++idx) {
-            delete_index.push_back(right_index - idx - 1);
-          }
-          parsed_lists_meta_value.ModifyRightIndex(-target_index.size());
-        }
-        parsed_lists_meta_value.ModifyCount(-target_index.size());
-        batch.Put(handles_[kListsMetaCF], base_meta_key.Encode(), meta_value);
-        for (const auto& idx : delete_index) {
-          ListsDataKey lists_data_key(key, version, idx);
-          batch.Delete(handles_[kListsDataCF], lists_data_key.Encode());
-        }
-        *ret = target_index.size();
-        return db_->Write(default_write_options_, &batch);
       }
+      s = chunks.Flush(base_meta_key.Encode(), &batch);
+      if (!s.ok()) {
+        return s;
+      }
+      *ret = removed;
+      return db_->Write(default_write_options_, &batch);
     }
   } else if (s.IsNotFound()) {
     *ret = 0;
@@ -623,7 +537,7 @@ Status Redis::LRem(const Slice& key, int64_t count, const Slice& value, uint64_t
 }
 
 Status Redis::LSet(const Slice& key, int64_t index, const Slice& value) {
-  uint32_t statistic = 0;
+  rocksdb::WriteBatch batch;
   ScopeRecordLock l(lock_mgr_, key);
   std::string meta_value;
 
@@ -636,17 +550,23 @@ Status Redis::LSet(const Slice& key, int64_t index, const Slice& value) {
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
-      uint64_t version = parsed_lists_meta_value.Version();
-      uint64_t target_index =
-          index >= 0 ? parsed_lists_meta_value.LeftIndex() + index + 1 : parsed_lists_meta_value.RightIndex() + index;
-      if (target_index <= parsed_lists_meta_value.LeftIndex() || target_index >= parsed_lists_meta_value.RightIndex()) {
+      uint64_t pos = 0;
+      if (!PositionOf(parsed_lists_meta_value.Count(), index, &pos)) {
         return Status::Corruption("index out of range");
       }
-      ListsDataKey lists_data_key(key, version, target_index);
-      BaseDataValue i_val(value);
-      s = db_->Put(default_write_options_, handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
-      statistic++;
-      UpdateSpecificKeyStatistics(DataType::kLists, key.ToString(), statistic);
+      ListsChunks chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], default_read_options_, key);
+      s = chunks.Load(meta_value);
+      if (s.ok()) {
+        s = chunks.Set(pos, value);
+      }
+      if (s.ok()) {
+        s = chunks.Flush(base_meta_key.Encode(), &batch);
+      }
+      if (!s.ok()) {
+        return s;
+      }
+      s = db_->Write(default_write_options_, &batch);
+      UpdateSpecificKeyStatistics(DataType::kLists, key.ToString(), chunks.Written());
       return s;
     }
   }
@@ -657,53 +577,37 @@ Status Redis::LTrim(const Slice& key, int64_t start, int64_t stop) {
   rocksdb::WriteBatch batch;
   ScopeRecordLock l(lock_mgr_, key);
 
-  uint32_t statistic = 0;
+  uint64_t statistic = 0;
   std::string meta_value;
 
   BaseMetaKey base_meta_key(key);
   Status s = db_->Get(default_read_options_, handles_[kListsMetaCF], base_meta_key.Encode(), &meta_value);
   if (s.ok()) {
     ParsedListsMetaValue parsed_lists_meta_value(&meta_value);
-    uint64_t version = parsed_lists_meta_value.Version();
     if (parsed_lists_meta_value.IsStale()) {
       return Status::NotFound("Stale");
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
-      uint64_t origin_left_index = parsed_lists_meta_value.LeftIndex() + 1;
-      uint64_t origin_right_index = parsed_lists_meta_value.RightIndex() - 1;
-      uint64_t sublist_left_index = start >= 0 ? origin_left_index + start : origin_right_index + start + 1;
-      uint64_t sublist_right_index = stop >= 0 ? origin_left_index + stop : origin_right_index + stop + 1;
-
-      if (sublist_left_index > sublist_right_index || sublist_left_index > origin_right_index ||
-          sublist_right_index < origin_left_index) {
+      uint64_t first = 0;
+      uint64_t last = 0;
+      if (!SublistOf(parsed_lists_meta_value.Count(), start, stop, &first, &last)) {
         parsed_lists_meta_value.InitialMetaValue();
         batch.Put(handles_[kListsMetaCF], base_meta_key.Encode(), meta_value);
       } else {
-        if (sublist_left_index < origin_left_index) {
-          sublist_left_index = origin_left_index;
-        }
-
-        if (sublist_right_index > origin_right_index) {
-          sublist_right_index = origin_right_index;
+        // the chunks out of the range are deleted without reading them
+        ListsChunks chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], default_read_options_, key);
+        s = chunks.Load(meta_value);
+        if (s.ok()) {
+          s = chunks.Trim(first, last);
         }
-
-        uint64_t delete_node_num =
-            (sublist_left_index - origin_left_index) + (origin_right_index - sublist_right_index);
-        parsed_lists_meta_value.ModifyLeftIndex(-(sublist_left_index - origin_left_index));
-        parsed_lists_meta_value.ModifyRightIndex(-(origin_right_index - sublist_right_index));
-        parsed_lists_meta_value.ModifyCount(-delete_node_num);
-        batch.Put(handles_[kListsMetaCF], base_meta_key.Encode(), meta_value);
-        for (uint64_t idx = origin_left_index; idx < sublist_left_index; ++idx) {
-          statistic++;
-          ListsDataKey lists_data_key(key, version, idx);
-          batch.Delete(handles_[kListsDataCF], lists_data_key.Encode());
+        if (s.ok()) {
+          s = chunks.Flush(base_meta_key.Encode(), &batch);
         }
-        for (uint64_t idx = origin_right_index; idx > sublist_right_index; --idx) {
-          statistic++;
-          ListsDataKey lists_data_key(key, version, idx);
-          batch.Delete(handles_[kListsDataCF], lists_data_key.Encode());
+        if (!s.ok()) {
+          return s;
         }
+        statistic = chunks.Written();
       }
     }
   } else {
@@ -715,7 +619,6 @@ Status Redis::LTrim(const Slice& key, int64_t start, int64_t stop) {
 }
 
 Status Redis::RPop(const Slice& key, int64_t count, std::vector<std::string>* elements) {
-  uint32_t statistic = 0;
   elements->clear();
 
   rocksdb::WriteBatch batch;
@@ -732,91 +635,34 @@ Status Redis::RPop(const Slice& key, int64_t count, std::vector<std::string>* el
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
-      auto size = static_cast<int64_t>(parsed_lists_meta_value.Count());
-      uint64_t version = parsed_lists_meta_value.Version();
-      int32_t start_index = 0;
-      auto stop_index = static_cast<int32_t>(count <= size ? count - 1 : size - 1);
-      int32_t cur_index = 0;
-      ListsDataKey lists_data_key(key, version, parsed_lists_meta_value.RightIndex() - 1);
-      rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-      for (iter->SeekForPrev(lists_data_key.Encode()); iter->Valid() && cur_index <= stop_index;
-           iter->Prev(), ++cur_index) {
-        statistic++;
-        ParsedBaseDataValue parsed_value(iter->value());
-        elements->push_back(parsed_value.UserValue().ToString());
-        batch.Delete(handles_[kListsDataCF], iter->key());
-
-        parsed_lists_meta_value.ModifyCount(-1);
-        parsed_lists_meta_value.ModifyRightIndex(-1);
+      ListsChunks chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], default_read_options_, key);
+      s = chunks.Load(meta_value);
+      if (s.ok()) {
+        s = chunks.Pop(std::max<int64_t>(count, 0), true, elements);
       }
-      batch.Put(handles_[kListsMetaCF], base_meta_key.Encode(), meta_value);
-      delete iter;
-    }
-  }
-  if (batch.Count() != 0U) {
-    s = db_->Write(default_write_options_, &batch);
-    if (s.ok()) {
-      batch.Clear();
+      if (s.ok()) {
+        s = chunks.Flush(base_meta_key.Encode(), &batch);
+      }
+      if (!s.ok()) {
+        elements->clear();
+        return s;
+      }
+      s = db_->Write(default_write_options_, &batch);
+      UpdateSpecificKeyStatistics(DataType::kLists, key.ToString(), chunks.Written());
     }
-    UpdateSpecificKeyStatistics(DataType::kLists, key.ToString(), statistic);
   }
   return s;
 }
 
 Status Redis::RPoplpush(const Slice& source, const Slice& destination, std::string* element) {
   element->clear();
-  uint32_t statistic = 0;
   Status s;
   rocksdb::WriteBatch batch;
   MultiScopeRecordLock l(lock_mgr_, {source.ToString(), destination.ToString()});
-  if (source.compare(destination) == 0) {
-    std::string meta_value;
-    BaseMetaKey base_source(source);
-    s = db_->Get(default_read_options_, handles_[kListsMetaCF], base_source.Encode(), &meta_value);
-    if (s.ok()) {
-      ParsedListsMetaValue parsed_lists_meta_value(&meta_value);
-      if (parsed_lists_meta_value.IsStale()) {
-        return Status::NotFound("Stale");
-      } else if (parsed_lists_meta_value.Count() == 0) {
-        return Status::NotFound();
-      } else {
-        std::string target;
-        uint64_t version = parsed_lists_meta_value.Version();
-        uint64_t last_node_index = parsed_lists_meta_value.RightIndex() - 1;
-        ListsDataKey lists_data_key(source, version, last_node_index);
-        s = db_->Get(default_read_options_, handles_[kListsDataCF], lists_data_key.Encode(), &target);
-        if (s.ok()) {
-          *element = target;
-          ParsedBaseDataValue parsed_value(element);
-          parsed_value.StripSuffix();
-          if (parsed_lists_meta_value.Count() == 1) {
-            return Status::OK();
-          } else {
-            uint64_t target_index = parsed_lists_meta_value.LeftIndex();
-            ListsDataKey lists_target_key(source, version, target_index);
-            batch.Delete(handles_[kListsDataCF], lists_data_key.Encode());
-            batch.Put(handles_[kListsDataCF], lists_target_key.Encode(), target);
-            statistic++;
-            parsed_lists_meta_value.ModifyRightIndex(-1);
-            parsed_lists_meta_value.ModifyLeftIndex(1);
-            batch.Put(handles_[kListsMetaCF], base_source.Encode(), meta_value);
-            s = db_->Write(default_write_options_, &batch);
-            UpdateSpecificKeyStatistics(DataType::kLists, source.ToString(), statistic);
-            return s;
-          }
-        } else {
-          return s;
-        }
-      }
-    } else {
-      return s;
-    }
-  }
 
-  uint64_t version = 0;
-  std::string target;
   std::string source_meta_value;
   BaseMetaKey base_source(source);
+  ListsChunks source_chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], default_read_options_, source);
   s = db_->Get(default_read_options_, handles_[kListsMetaCF], base_source.Encode(), &source_meta_value);
   if (s.ok()) {
     ParsedListsMetaValue parsed_lists_meta_value(&source_meta_value);
@@ -824,61 +670,57 @@ Status Redis::RPoplpush(const Slice& source, const Slice& destination, std::stri
       return Status::NotFound("Stale");
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
-    } else {
-      version = parsed_lists_meta_value.Version();
-      uint64_t last_node_index = parsed_lists_meta_value.RightIndex() - 1;
-      ListsDataKey lists_data_key(source, version, last_node_index);
-      s = db_->Get(default_read_options_, handles_[kListsDataCF], lists_data_key.Encode(), &target);
-      if (s.ok()) {
-        batch.Delete(handles_[kListsDataCF], lists_data_key.Encode());
-        statistic++;
-        parsed_lists_meta_value.ModifyCount(-1);
-        parsed_lists_meta_value.ModifyRightIndex(-1);
-        batch.Put(handles_[kListsMetaCF], base_source.Encode(), source_meta_value);
-      } else {
-        return s;
-      }
     }
-  } else {
+    s = source_chunks.Load(source_meta_value);
+  }
+  std::vector<std::string> elements;
+  if (s.ok()) {
+    s = source_chunks.Pop(1, true, &elements);
+  }
+  if (!s.ok()) {
     return s;
   }
 
-  std::string destination_meta_value;
-  BaseMetaKey base_destination(destination);
-  s = db_->Get(default_read_options_, handles_[kListsMetaCF], base_destination.Encode(), &destination_meta_value);
-  if (s.ok()) {
-    ParsedListsMetaValue parsed_lists_meta_value(&destination_meta_value);
-    if (parsed_lists_meta_value.IsStale() || parsed_lists_meta_value.Count() == 0) {
-      version = parsed_lists_meta_value.InitialMetaValue();
-    } else {
-      version = parsed_lists_meta_value.Version();
+  if (source.compare(destination) == 0) {
+    if (source_chunks.Count() == 0) {
+      // a single element, rotated in place
+      *element = elements[0];
+      return Status::OK();
+    }
+    s = source_chunks.Insert(0, elements[0]);
+    if (s.ok()) {
+      s = source_chunks.Flush(base_source.Encode(), &batch);
     }
-    uint64_t target_index = parsed_lists_meta_value.LeftIndex();
-    ListsDataKey lists_data_key(destination, version, target_index);
-    batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), target);
-    parsed_lists_meta_value.ModifyCount(1);
-    parsed_lists_meta_value.ModifyLeftIndex(1);
-    batch.Put(handles_[kListsMetaCF], base_destination.Encode(), destination_meta_value);
-  } else if (s.IsNotFound()) {
-    char str[8];
-    EncodeFixed64(str, 1);
-    ListsMetaValue lists_meta_value(Slice(str, sizeof(uint64_t)));
-    version = lists_meta_value.UpdateVersion();
-    uint64_t target_index = lists_meta_value.LeftIndex();
-    ListsDataKey lists_data_key(destination, version, target_index);
-    batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), target);
-    lists_meta_value.ModifyLeftIndex(1);
-    batch.Put(handles_[kListsMetaCF], base_destination.Encode(), lists_meta_value.Encode());
   } else {
+    std::string destination_meta_value;
+    BaseMetaKey base_destination(destination);
+    ListsChunks destination_chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], default_read_options_,
+                                   destination);
+    s = db_->Get(default_read_options_, handles_[kListsMetaCF], base_destination.Encode(), &destination_meta_value);
+    if (s.ok()) {
+      s = destination_chunks.Load(destination_meta_value);
+    } else if (s.IsNotFound()) {
+      destination_chunks.Create();
+      s = Status::OK();
+    }
+    if (s.ok()) {
+      s = destination_chunks.Insert(0, elements[0]);
+    }
+    if (s.ok()) {
+      s = source_chunks.Flush(base_source.Encode(), &batch);
+    }
+    if (s.ok()) {
+      s = destination_chunks.Flush(base_destination.Encode(), &batch);
+    }
+  }
+  if (!s.ok()) {
     return s;
   }
 
   s = db_->Write(default_write_options_, &batch);
-  UpdateSpecificKeyStatistics(DataType::kLists, source.ToString(), statistic);
+  UpdateSpecificKeyStatistics(DataType::kLists, source.ToString(), source_chunks.Written());
   if (s.ok()) {
-    ParsedBaseDataValue parsed_value(&target);
-    parsed_value.StripSuffix();
-    *element = target;
+    *element = elements[0];
   }
   return s;
 }
@@ -886,47 +728,29 @@ Status Redis::RPoplpush(const Slice& source, const Slice& destination, std::stri
 Status Redis::RPush(const Slice& key, const std::vector<std::string>& values, uint64_t* ret) {
   *ret = 0;
   rocksdb::WriteBatch batch;
+  ScopeRecordLock l(lock_mgr_, key);
 
-  uint64_t index = 0;
-  uint64_t version = 0;
   std::string meta_value;
+  ListsChunks chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], default_read_options_, key);
 
   BaseMetaKey base_meta_key(key);
   Status s = db_->Get(default_read_options_, handles_[kListsMetaCF], base_meta_key.Encode(), &meta_value);
   if (s.ok()) {
-    ParsedListsMetaValue parsed_lists_meta_value(&meta_value);
-    if (parsed_lists_meta_value.IsStale() || parsed_lists_meta_value.Count() == 0) {
-      version = parsed_lists_meta_value.InitialMetaValue();
-    } else {
-      version = parsed_lists_meta_value.Version();
-    }
-    for (const auto& value : values) {
-      index = parsed_lists_meta_value.RightIndex();
-      parsed_lists_meta_value.ModifyRightIndex(1);
-      parsed_lists_meta_value.ModifyCount(1);
-      ListsDataKey lists_data_key(key, version, index);
-      BaseDataValue i_val(value);
-      batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
-    }
-    batch.Put(handles_[kListsMetaCF], base_meta_key.Encode(), meta_value);
-    *ret = parsed_lists_meta_value.Count();
+    s = chunks.Load(meta_value);
   } else if (s.IsNotFound()) {
-    char str[8];
-    EncodeFixed64(str, values.size());
-    ListsMetaValue lists_meta_value(Slice(str, sizeof(uint64_t)));
-    version = lists_meta_value.UpdateVersion();
-    for (const auto& value : values) {
-      index = lists_meta_value.RightIndex();
-      lists_meta_value.ModifyRightIndex(1);
-      ListsDataKey lists_data_key(key, version, index);
-      BaseDataValue i_val(value);
-      batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
-    }
-    batch.Put(handles_[kListsMetaCF], base_meta_key.Encode(), lists_meta_value.Encode());
-    *ret = lists_meta_value.RightIndex() - lists_meta_value.LeftIndex() - 1;
-  } else {
+    chunks.Create();
+    s = Status::OK();
+  }
+  for (size_t i = 0; s.ok() && i < values.size(); ++i) {
+    s = chunks.Insert(chunks.Count(), values[i]);
+  }
+  if (s.ok()) {
+    s = chunks.Flush(base_meta_key.Encode(), &batch);
+  }
+  if (!s.ok()) {
     return s;
   }
+  *ret = chunks.Count();
   return db_->Write(default_write_options_, &batch);
 }
 
@@ -946,17 +770,18 @@ Status Redis::RPushx(const Slice& key, const std::vector<std::string>& values, u
     } else if (parsed_lists_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
-      uint64_t version = parsed_lists_meta_value.Version();
-      for (const auto& value : values) {
-        uint64_t index = parsed_lists_meta_value.RightIndex();
-        parsed_lists_meta_value.ModifyCount(1);
-        parsed_lists_meta_value.ModifyRightIndex(1);
-        ListsDataKey lists_data_key(key, version, index);
-        BaseDataValue i_val(value);
-        batch.Put(handles_[kListsDataCF], lists_data_key.Encode(), i_val.Encode());
+      ListsChunks chunks(db_, handles_[kListsMetaCF], handles_[kListsDataCF], default_read_options_, key);
+      s = chunks.Load(meta_value);
+      for (size_t i = 0; s.ok() && i < values.size(); ++i) {
+        s = chunks.Insert(chunks.Count(), values[i]);
       }
-      batch.Put(handles_[kListsMetaCF], base_meta_key.Encode(), meta_value);
-      *len = parsed_lists_meta_value.Count();
+      if (s.ok()) {
+        s = chunks.Flush(base_meta_key.Encode(), &batch);
+      }
+      if (!s.ok()) {
+        return s;
+      }
+      *len = chunks.Count();
       return db_->Write(default_write_options_, &batch);
     }
   }
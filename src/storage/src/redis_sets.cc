@@ -186,9 +186,7 @@ rocksdb::Status Redis::SAdd(const Slice& key, const std::vector<std::string>& me
 rocksdb::Status Redis::SCard(const Slice& key, int32_t* ret) {
   *ret = 0;
   std::string meta_value;
-
-  BaseMetaKey base_meta_key(key);
-  rocksdb::Status s = db_->Get(default_read_options_, handles_[kSetsMetaCF], base_meta_key.Encode(), &meta_value);
+  rocksdb::Status s = getMeta(DataType::kSets, key, &meta_value);
   if (s.ok()) {
     ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
     if (parsed_sets_meta_value.IsStale()) {
@@ -572,16 +570,14 @@ rocksdb::Status Redis::SInterstore(const Slice& destination, const std::vector<s
 
 rocksdb::Status Redis::SIsmember(const Slice& key, const Slice& member, int32_t* ret) {
   *ret = 0;
-  rocksdb::ReadOptions read_options;
-  const rocksdb::Snapshot* snapshot;
-
   std::string meta_value;
   uint64_t version = 0;
+  rocksdb::Status s = getMeta(DataType::kSets, key, &meta_value);
+
+  rocksdb::ReadOptions read_options;
+  const rocksdb::Snapshot* snapshot;
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-
-  BaseMetaKey base_meta_key(key);
-  rocksdb::Status s = db_->Get(read_options, handles_[kSetsMetaCF], base_meta_key.Encode(), &meta_value);
   if (s.ok()) {
     ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
     if (parsed_sets_meta_value.IsStale()) {
@@ -601,6 +597,48 @@ rocksdb::Status Redis::SIsmember(const Slice& key, const Slice& member, int32_t*
   return s;
 }
 
+rocksdb::Status Redis::SMIsmember(const Slice& key, const std::vector<std::string>& members,
+                                  std::vector<char>* found) {
+  found->assign(members.size(), 0);
+  std::string meta_value;
+  rocksdb::Status s = getMeta(DataType::kSets, key, &meta_value);
+  if (!s.ok()) {
+    return s;
+  }
+  ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
+  if (parsed_sets_meta_value.IsStale()) {
+    return rocksdb::Status::NotFound("Stale");
+  } else if (parsed_sets_meta_value.Count() == 0) {
+    return rocksdb::Status::NotFound();
+  }
+
+  // the member keys of one set share their prefix, one MultiGet reads them block by block
+  const uint64_t version = parsed_sets_meta_value.Version();
+  rocksdb::ReadOptions read_options;
+  const rocksdb::Snapshot* snapshot;
+  ScopeSnapshot ss(db_, &snapshot);
+  read_options.snapshot = snapshot;
+  std::vector<std::string> member_keys;
+  member_keys.reserve(members.size());
+  for (const auto& member : members) {
+    SetsMemberKey sets_member_key(key, version, member);
+    member_keys.push_back(sets_member_key.Encode().ToString());
+  }
+  std::vector<Slice> key_slices(member_keys.begin(), member_keys.end());
+  std::vector<rocksdb::PinnableSlice> values(members.size());
+  std::vector<rocksdb::Status> statuses(members.size());
+  db_->MultiGet(read_options, handles_[kSetsDataCF], members.size(), key_slices.data(), values.data(),
+                statuses.data());
+  for (size_t i = 0; i < members.size(); ++i) {
+    if (statuses[i].ok()) {
+      (*found)[i] = 1;
+    } else if (!statuses[i].IsNotFound()) {
+      return statuses[i];
+    }
+  }
+  return rocksdb::Status::OK();
+}
+
 rocksdb::Status Redis::SMembers(const Slice& key, std::vector<std::string>* members) {
   rocksdb::ReadOptions read_options;
   const rocksdb::Snapshot* snapshot;
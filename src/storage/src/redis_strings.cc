@@ -324,48 +324,27 @@ Status Redis::Decrby(const Slice& key, int64_t value, int64_t* ret) {
 }
 
 Status Redis::Get(const Slice& key, std::string* value) {
-  value->clear();
-
-  BaseKey base_key(key);
-  Status s = db_->Get(default_read_options_, base_key.Encode(), value);
+  std::vector<ValueStatus> vss;
+  Status s = multiGetStrings({key.ToString()}, &vss);
   if (s.ok()) {
-    ParsedStringsValue parsed_strings_value(value);
-    if (parsed_strings_value.IsStale()) {
-      value->clear();
-      return Status::NotFound("Stale");
-    } else {
-      parsed_strings_value.StripSuffix();
-    }
+    *value = std::move(vss[0].value);
+    s = vss[0].status;
+  } else {
+    value->clear();
   }
   return s;
 }
 
 Status Redis::GetWithTTL(const Slice& key, std::string* value, uint64_t* ttl) {
-  value->clear();
-  BaseKey base_key(key);
-  Status s = db_->Get(default_read_options_, base_key.Encode(), value);
+  std::vector<ValueStatus> vss;
+  Status s = MGetWithTTL({key.ToString()}, &vss);
   if (s.ok()) {
-    ParsedStringsValue parsed_strings_value(value);
-    if (parsed_strings_value.IsStale()) {
-      value->clear();
-      *ttl = -2;
-      return Status::NotFound("Stale");
-    } else {
-      parsed_strings_value.StripSuffix();
-      *ttl = parsed_strings_value.Etime();
-      if (*ttl == 0) {
-        *ttl = -1;
-      } else {
-        int64_t curtime;
-        rocksdb::Env::Default()->GetCurrentTime(&curtime);
-        *ttl = *ttl - curtime >= 0 ? *ttl - curtime : -2;
-      }
-    }
-  } else if (s.IsNotFound()) {
+    *value = std::move(vss[0].value);
+    *ttl = vss[0].ttl;
+    s = vss[0].status;
+  } else {
     value->clear();
-    *ttl = -2;
   }
-
   return s;
 }
 
@@ -586,6 +565,83 @@ Status Redis::Incrbyfloat(const Slice& key, const Slice& value, std::string* ret
   }
 }
 
+Status Redis::multiGetStrings(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss) {
+  vss->assign(keys.size(), {std::string(), Status::NotFound(), 0});
+  const bool cached = valueCached();
+  std::vector<std::string> cache_keys;
+  std::vector<uint64_t> tickets(keys.size());
+  std::vector<size_t> misses;
+  std::vector<std::string> encoded_keys;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (cached) {
+      cache_keys.push_back(ValueCache::KeyOf(DataType::kStrings, keys[i]));
+      auto& vs = (*vss)[i];
+      auto read = [&vs](const CachedValue& cached_value) {
+        vs = {cached_value.value, Status::OK(), cached_value.etime};
+      };
+      if (value_cache_->Lookup(cache_keys[i], read, &tickets[i])) {
+        continue;
+      }
+    }
+    misses.push_back(i);
+    BaseKey base_key(keys[i]);
+    encoded_keys.push_back(base_key.Encode().ToString());
+  }
+  if (misses.empty()) {
+    return Status::OK();
+  }
+
+  std::vector<Slice> key_slices(encoded_keys.begin(), encoded_keys.end());
+  std::vector<rocksdb::PinnableSlice> values(misses.size());
+  std::vector<Status> statuses(misses.size());
+  db_->MultiGet(default_read_options_, handles_[kStringsCF], misses.size(), key_slices.data(), values.data(),
+                statuses.data());
+  for (size_t j = 0; j < misses.size(); ++j) {
+    auto& vs = (*vss)[misses[j]];
+    if (statuses[j].ok()) {
+      std::string value = values[j].ToString();
+      ParsedStringsValue parsed_strings_value(&value);
+      if (parsed_strings_value.IsStale()) {
+        vs.status = Status::NotFound("Stale");
+        continue;
+      }
+      parsed_strings_value.StripSuffix();
+      vs = {std::move(value), Status::OK(), parsed_strings_value.Etime()};
+      if (cached) {
+        value_cache_->Insert(cache_keys[misses[j]], {vs.value, {}, vs.ttl}, tickets[misses[j]]);
+      }
+    } else if (!statuses[j].IsNotFound()) {
+      vss->clear();
+      return statuses[j];
+    }
+  }
+  return Status::OK();
+}
+
+Status Redis::MGet(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss) {
+  Status s = multiGetStrings(keys, vss);
+  for (auto& vs : *vss) {
+    vs.ttl = 0;
+  }
+  return s;
+}
+
+Status Redis::MGetWithTTL(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss) {
+  Status s = multiGetStrings(keys, vss);
+  int64_t curtime;
+  rocksdb::Env::Default()->GetCurrentTime(&curtime);
+  for (auto& vs : *vss) {
+    if (!vs.status.ok()) {
+      vs.ttl = -2;
+    } else if (vs.ttl == 0) {
+      vs.ttl = -1;
+    } else {
+      vs.ttl = static_cast<int64_t>(vs.ttl) - curtime >= 0 ? vs.ttl - curtime : -2;
+    }
+  }
+  return s;
+}
+
 Status Redis::MSet(const std::vector<KeyValue>& kvs) {
   std::vector<std::string> keys;
   keys.reserve(kvs.size());
@@ -18,9 +18,121 @@
 #include "src/scope_record_lock.h"
 #include "src/scope_snapshot.h"
 #include "src/zsets_filter.h"
+#include "src/zsets_rank_index.h"
 #include "storage/util.h"
 
 namespace storage {
+
+namespace {
+
+// the members a batch puts (+1) and deletes (-1) score keys of, by zset version. The zset writes
+// only put the score key of a member they add, and delete the one of a member they had
+class ScoreKeyDeltas : public rocksdb::WriteBatch::Handler {
+ public:
+  explicit ScoreKeyDeltas(uint32_t score_cf_id) : score_cf_id_(score_cf_id) {}
+
+  Status PutCF(uint32_t column_family_id, const Slice& key, const Slice&) override {
+    add(column_family_id, key, 1);
+    return Status::OK();
+  }
+  Status DeleteCF(uint32_t column_family_id, const Slice& key) override {
+    add(column_family_id, key, -1);
+    return Status::OK();
+  }
+  Status SingleDeleteCF(uint32_t column_family_id, const Slice& key) override {
+    add(column_family_id, key, -1);
+    return Status::OK();
+  }
+  Status MergeCF(uint32_t, const Slice&, const Slice&) override { return Status::OK(); }
+  Status DeleteRangeCF(uint32_t, const Slice&, const Slice&) override { return Status::OK(); }
+
+  std::map<std::pair<std::string, uint64_t>, std::vector<std::pair<std::string, int64_t>>> versions;
+
+ private:
+  void add(uint32_t column_family_id, const Slice& key, int64_t delta) {
+    if (column_family_id != score_cf_id_) {
+      return;
+    }
+    ParsedZSetsScoreKey parsed_zsets_score_key(key);
+    versions[{parsed_zsets_score_key.key().ToString(), parsed_zsets_score_key.Version()}].emplace_back(
+        ZSetsRankIndex::PosOf(parsed_zsets_score_key.score(), parsed_zsets_score_key.member()), delta);
+  }
+
+  uint32_t score_cf_id_;
+};
+
+// the number of members sorting before member, NotFound if the zset doesn't have it
+Status MemberRank(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* data_cf, const rocksdb::ReadOptions& read_options,
+                  ZSetsRankIndex* rank_index, const Slice& key, uint64_t version, const Slice& member,
+                  uint64_t* rank) {
+  std::string data_value;
+  ZSetsMemberKey zsets_member_key(key, version, member);
+  Status s = db->Get(read_options, data_cf, zsets_member_key.Encode(), &data_value);
+  if (!s.ok()) {
+    return s;
+  }
+  ParsedBaseDataValue parsed_value(&data_value);
+  parsed_value.StripSuffix();
+  uint64_t tmp = DecodeFixed64(data_value.data());
+  const void* ptr_tmp = reinterpret_cast<const void*>(&tmp);
+  double score = *reinterpret_cast<const double*>(ptr_tmp);
+  return rank_index->Rank(ZSetsRankIndex::PosOf(score, member), rank);
+}
+
+}  // namespace
+
+Status Redis::writeZsets(rocksdb::WriteBatch* batch) {
+  ScoreKeyDeltas deltas(handles_[kZsetsScoreCF]->GetID());
+  Status s = batch->Iterate(&deltas);
+  if (!s.ok()) {
+    return s;
+  }
+
+  std::vector<std::pair<std::unique_ptr<ZSetsRankIndex>, std::vector<std::string>>> indexes;
+  for (const auto& [key_version, members] : deltas.versions) {
+    auto index = std::make_unique<ZSetsRankIndex>(db_, handles_[kZsetsScoreCF], handles_[kZsetsRankCF],
+                                                  default_read_options_, key_version.first, key_version.second);
+    s = index->Load();
+    if (s.IsNotFound()) {
+      // a zset version written first, or written before the index, gets indexed as it is
+      rocksdb::WriteBatch build;
+      s = index->Build(&build);
+      if (s.ok()) {
+        s = db_->Write(default_write_options_, &build);
+      }
+    }
+    std::vector<std::string> touched;
+    if (s.ok()) {
+      s = index->Apply(members, batch, &touched);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+    indexes.emplace_back(std::move(index), std::move(touched));
+  }
+
+  s = db_->Write(default_write_options_, batch);
+  if (!s.ok()) {
+    return s;
+  }
+  for (const auto& [index, touched] : indexes) {
+    // the counts are right already, a block left unbalanced is only slower to walk
+    if (Status rs = index->Rebalance(touched, default_write_options_); !rs.ok()) {
+      WARN("rocksdb instance {} failed to rebalance a zset rank index: {}", index_, rs.ToString());
+    }
+  }
+  return s;
+}
+
+std::unique_ptr<ZSetsRankIndex> Redis::rankIndexOf(const Slice& key, uint64_t version, int32_t count,
+                                                   const rocksdb::ReadOptions& read_options) {
+  auto index = std::make_unique<ZSetsRankIndex>(db_, handles_[kZsetsScoreCF], handles_[kZsetsRankCF], read_options,
+                                                key, version);
+  if (!index->Load().ok() || index->Count() != static_cast<uint64_t>(count)) {
+    return nullptr;
+  }
+  return index;
+}
 Status Redis::ScanZsetsKeyNum(KeyInfo* key_info) {
   uint64_t keys = 0;
   uint64_t expires = 0;
@@ -144,7 +256,7 @@ Status Redis::ZPopMax(const Slice& key, const int64_t count, std::vector<ScoreMe
       }
       parsed_zsets_meta_value.ModifyCount(-del_cnt);
       batch.Put(handles_[kZsetsMetaCF], base_meta_key.Encode(), meta_value);
-      s = db_->Write(default_write_options_, &batch);
+      s = writeZsets(&batch);
       UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
       return s;
     }
@@ -192,7 +304,7 @@ Status Redis::ZPopMin(const Slice& key, const int64_t count, std::vector<ScoreMe
       }
       parsed_zsets_meta_value.ModifyCount(-del_cnt);
       batch.Put(handles_[kZsetsMetaCF], base_meta_key.Encode(), meta_value);
-      s = db_->Write(default_write_options_, &batch);
+      s = writeZsets(&batch);
       UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
       return s;
     }
@@ -299,7 +411,7 @@ Status Redis::ZAdd(const Slice& key, const std::vector<ScoreMember>& score_membe
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = writeZsets(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
   return s;
 }
@@ -307,9 +419,7 @@ Status Redis::ZAdd(const Slice& key, const std::vector<ScoreMember>& score_membe
 Status Redis::ZCard(const Slice& key, int32_t* card) {
   *card = 0;
   std::string meta_value;
-
-  BaseMetaKey base_meta_key(key);
-  Status s = db_->Get(default_read_options_, handles_[kZsetsMetaCF], base_meta_key.Encode(), &meta_value);
+  Status s = getMeta(DataType::kZSets, key, &meta_value);
   if (s.ok()) {
     ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
     if (parsed_zsets_meta_value.IsStale()) {
@@ -350,6 +460,18 @@ Status Redis::ZCount(const Slice& key, double min, double max, bool left_close,
       ScoreMember score_member;
       ZSetsScoreKey zsets_score_key(key, version, min, Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
+      if (auto rank_index = rankIndexOf(key, version, parsed_zsets_meta_value.Count(), read_options)) {
+        uint64_t below_min = 0;
+        uint64_t up_to_max = 0;
+        s = rank_index->Below(min, !left_close, &below_min);
+        if (s.ok()) {
+          s = rank_index->Below(max, right_close, &up_to_max);
+        }
+        if (s.ok()) {
+          *ret = up_to_max > below_min ? static_cast<int32_t>(up_to_max - below_min) : 0;
+        }
+        return s;
+      }
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
       for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         bool left_pass = false;
@@ -446,7 +568,7 @@ Status Redis::ZIncrby(const Slice& key, const Slice& member, double increment, d
   BaseDataValue zsets_score_i_val(Slice{});
   batch.Put(handles_[kZsetsScoreCF], zsets_score_key.Encode(), zsets_score_i_val.Encode());
   *ret = score;
-  s = db_->Write(default_write_options_, &batch);
+  s = writeZsets(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
   return s;
 }
@@ -482,9 +604,15 @@ Status Redis::ZRange(const Slice& key, int32_t start, int32_t stop, std::vector<
       ScoreMember score_member;
 
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
+      std::string start_key = zsets_score_key.Encode().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
+      if (auto rank_index = start_index > 0 ? rankIndexOf(key, version, count, read_options) : nullptr) {
+        if (rank_index->Select(start_index, &start_key).ok()) {
+          cur_index = start_index;
+        }
+      }
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
-      for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
+      for (iter->Seek(start_key); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         if (cur_index >= start_index) {
           ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
           score_member.score = parsed_zsets_score_key.score();
@@ -539,9 +667,15 @@ Status Redis::ZRangeWithTTL(const Slice& key, int32_t start, int32_t stop, std::
       int32_t cur_index = 0;
       ScoreMember score_member;
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
+      std::string start_key = zsets_score_key.Encode().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
+      if (auto rank_index = start_index > 0 ? rankIndexOf(key, version, count, read_options) : nullptr) {
+        if (rank_index->Select(start_index, &start_key).ok()) {
+          cur_index = start_index;
+        }
+      }
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
-      for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
+      for (iter->Seek(start_key); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         if (cur_index >= start_index) {
           ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
           score_member.score = parsed_zsets_score_key.score();
@@ -580,9 +714,23 @@ Status Redis::ZRangebyscore(const Slice& key, double min, double max, bool left_
       int64_t skipped = 0;
       ScoreMember score_member;
       ZSetsScoreKey zsets_score_key(key, version, min, Slice());
+      std::string start_key = zsets_score_key.Encode().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
+      // the offset is skipped by rank
+      if (auto rank_index = offset > 0 ? rankIndexOf(key, version, stop_index + 1, read_options) : nullptr) {
+        uint64_t rank = 0;
+        Status rs = rank_index->Below(min, !left_close, &rank);
+        if (rs.ok()) {
+          rs = rank_index->Select(rank + offset, &start_key);
+        }
+        if (rs.IsNotFound()) {
+          return s;
+        } else if (rs.ok()) {
+          skipped = offset;
+        }
+      }
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
-      for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && index <= stop_index; iter->Next(), ++index) {
+      for (iter->Seek(start_key); iter->Valid() && index <= stop_index; iter->Next(), ++index) {
         bool left_pass = false;
         bool right_pass = false;
         ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
@@ -648,6 +796,14 @@ Status Redis::ZRank(const Slice& key, const Slice& member, int32_t* rank) {
       ScoreMember score_member;
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
+      if (auto rank_index = rankIndexOf(key, version, stop_index + 1, read_options)) {
+        uint64_t member_rank = 0;
+        s = MemberRank(db_, handles_[kZsetsDataCF], read_options, rank_index.get(), key, version, member, &member_rank);
+        if (s.ok()) {
+          *rank = static_cast<int32_t>(member_rank);
+        }
+        return s;
+      }
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
       for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && index <= stop_index; iter->Next(), ++index) {
         ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
@@ -725,7 +881,7 @@ Status Redis::ZRem(const Slice& key, const std::vector<std::string>& members, in
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = writeZsets(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
   return s;
 }
@@ -759,9 +915,15 @@ Status Redis::ZRemrangebyrank(const Slice& key, int32_t start, int32_t stop, int
         return s;
       }
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
+      std::string start_key = zsets_score_key.Encode().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
+      if (auto rank_index = start_index > 0 ? rankIndexOf(key, version, count, default_read_options_) : nullptr) {
+        if (rank_index->Select(start_index, &start_key).ok()) {
+          cur_index = start_index;
+        }
+      }
       rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kZsetsScoreCF]);
-      for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
+      for (iter->Seek(start_key); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         if (cur_index >= start_index) {
           ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
           ZSetsMemberKey zsets_member_key(key, version, parsed_zsets_score_key.member());
@@ -782,7 +944,7 @@ Status Redis::ZRemrangebyrank(const Slice& key, int32_t start, int32_t stop, int
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = writeZsets(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
   return s;
 }
@@ -852,7 +1014,7 @@ Status Redis::ZRemrangebyscore(const Slice& key, double min, double max, bool le
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = writeZsets(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
   return s;
 }
@@ -887,9 +1049,15 @@ Status Redis::ZRevrange(const Slice& key, int32_t start, int32_t stop, std::vect
       int32_t cur_index = count - 1;
       ScoreMember score_member;
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::max(), Slice());
+      std::string start_key = zsets_score_key.Encode().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
+      if (auto rank_index = stop_index < count - 1 ? rankIndexOf(key, version, count, read_options) : nullptr) {
+        if (rank_index->Select(stop_index, &start_key).ok()) {
+          cur_index = stop_index;
+        }
+      }
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
-      for (iter->SeekForPrev(zsets_score_key.Encode()); iter->Valid() && cur_index >= start_index;
+      for (iter->SeekForPrev(start_key); iter->Valid() && cur_index >= start_index;
            iter->Prev(), --cur_index) {
         if (cur_index <= stop_index) {
           ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
@@ -928,9 +1096,23 @@ Status Redis::ZRevrangebyscore(const Slice& key, double min, double max, bool le
       int64_t skipped = 0;
       ScoreMember score_member;
       ZSetsScoreKey zsets_score_key(key, version, std::nextafter(max, std::numeric_limits<double>::max()), Slice());
+      std::string start_key = zsets_score_key.Encode().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
+      // the offset is skipped by rank
+      if (auto rank_index = offset > 0 ? rankIndexOf(key, version, left, read_options) : nullptr) {
+        uint64_t rank = 0;
+        Status rs = rank_index->Below(max, right_close, &rank);
+        if (rs.ok() && rank <= static_cast<uint64_t>(offset)) {
+          return s;
+        } else if (rs.ok()) {
+          rs = rank_index->Select(rank - 1 - offset, &start_key);
+        }
+        if (rs.ok()) {
+          skipped = offset;
+        }
+      }
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
-      for (iter->SeekForPrev(zsets_score_key.Encode()); iter->Valid() && left > 0; iter->Prev(), --left) {
+      for (iter->SeekForPrev(start_key); iter->Valid() && left > 0; iter->Prev(), --left) {
         bool left_pass = false;
         bool right_pass = false;
         ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
@@ -995,6 +1177,14 @@ Status Redis::ZRevrank(const Slice& key, const Slice& member, int32_t* rank) {
       uint64_t version = parsed_zsets_meta_value.Version();
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::max(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
+      if (auto rank_index = rankIndexOf(key, version, left, read_options)) {
+        uint64_t member_rank = 0;
+        s = MemberRank(db_, handles_[kZsetsDataCF], read_options, rank_index.get(), key, version, member, &member_rank);
+        if (s.ok()) {
+          *rank = left - 1 - static_cast<int32_t>(member_rank);
+        }
+        return s;
+      }
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
       for (iter->SeekForPrev(zsets_score_key.Encode()); iter->Valid() && left >= 0; iter->Prev(), --left, ++rev_index) {
         ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
@@ -1016,15 +1206,13 @@ Status Redis::ZRevrank(const Slice& key, const Slice& member, int32_t* rank) {
 
 Status Redis::ZScore(const Slice& key, const Slice& member, double* score) {
   *score = 0;
+  std::string meta_value;
+  Status s = getMeta(DataType::kZSets, key, &meta_value);
+
   rocksdb::ReadOptions read_options;
   const rocksdb::Snapshot* snapshot = nullptr;
-
-  std::string meta_value;
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-
-  BaseMetaKey base_meta_key(key);
-  Status s = db_->Get(read_options, handles_[kZsetsMetaCF], base_meta_key.Encode(), &meta_value);
   if (s.ok()) {
     ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
     uint64_t version = parsed_zsets_meta_value.Version();
@@ -1180,7 +1368,7 @@ Status Redis::ZUnionstore(const Slice& destination, const std::vector<std::strin
     batch.Put(handles_[kZsetsScoreCF], zsets_score_key.Encode(), score_i_val.Encode());
   }
   *ret = static_cast<int32_t>(member_score_map.size());
-  s = db_->Write(default_write_options_, &batch);
+  s = writeZsets(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, destination.ToString(), statistic);
   value_to_dest = std::move(member_score_map);
   return s;
@@ -1317,7 +1505,7 @@ Status Redis::ZInterstore(const Slice& destination, const std::vector<std::strin
     batch.Put(handles_[kZsetsScoreCF], zsets_score_key.Encode(), zsets_score_i_val.Encode());
   }
   *ret = static_cast<int32_t>(final_score_members.size());
-  s = db_->Write(default_write_options_, &batch);
+  s = writeZsets(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, destination.ToString(), statistic);
   value_to_dest = std::move(final_score_members);
   return s;
@@ -1375,8 +1563,43 @@ Status Redis::ZRangebylex(const Slice& key, const Slice& min, const Slice& max,
 
 Status Redis::ZLexcount(const Slice& key, const Slice& min, const Slice& max, bool left_close, bool right_close,
                         int32_t* ret) {
+  rocksdb::ReadOptions read_options;
+  const rocksdb::Snapshot* snapshot = nullptr;
+  ScopeSnapshot ss(db_, &snapshot);
+  read_options.snapshot = snapshot;
+
+  // with a single score the score keys sort by member, the rank index counts the range
+  std::string meta_value;
+  BaseMetaKey base_meta_key(key);
+  Status s = db_->Get(read_options, handles_[kZsetsMetaCF], base_meta_key.Encode(), &meta_value);
+  if (s.ok()) {
+    ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
+    int32_t count = parsed_zsets_meta_value.Count();
+    std::string first;
+    std::string last;
+    auto rank_index = parsed_zsets_meta_value.IsStale() || count == 0
+                          ? nullptr
+                          : rankIndexOf(key, parsed_zsets_meta_value.Version(), count, read_options);
+    if (rank_index && rank_index->Select(0, &first).ok() && rank_index->Select(count - 1, &last).ok() &&
+        ParsedZSetsScoreKey(first).score() == ParsedZSetsScoreKey(last).score()) {
+      double score = ParsedZSetsScoreKey(first).score();
+      uint64_t below_min = 0;
+      uint64_t up_to_max = count;
+      if (min.compare("-") != 0) {
+        s = rank_index->Rank(ZSetsRankIndex::PosOf(score, left_close ? min.ToString() : min.ToString() + '\0'),
+                             &below_min);
+      }
+      if (s.ok() && max.compare("+") != 0) {
+        s = rank_index->Rank(ZSetsRankIndex::PosOf(score, right_close ? max.ToString() + '\0' : max.ToString()),
+                             &up_to_max);
+      }
+      *ret = s.ok() && up_to_max > below_min ? static_cast<int32_t>(up_to_max - below_min) : 0;
+      return s;
+    }
+  }
+
   std::vector<std::string> members;
-  Status s = ZRangebylex(key, min, max, left_close, right_close, &members);
+  s = ZRangebylex(key, min, max, left_close, right_close, &members);
   *ret = static_cast<int32_t>(members.size());
   return s;
 }
@@ -1452,7 +1675,7 @@ Status Redis::ZRemrangebylex(const Slice& key, const Slice& min, const Slice& ma
   } else {
     return s;
   }
-  s = db_->Write(default_write_options_, &batch);
+  s = writeZsets(&batch);
   UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
   return s;
 }
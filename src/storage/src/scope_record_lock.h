@@ -19,4 +19,20 @@ namespace storage {
 using ScopeRecordLock = pstd::lock::ScopeRecordLock;
 using MultiScopeRecordLock = pstd::lock::MultiScopeRecordLock;
 
+/**
+ * Locks keys which may belong to different instances, for commands that call several
+ * instances and must not interleave with other writers of the same keys.
+ * Latches are taken by ascending instance index and then ascending latch, the instance
+ * methods called meanwhile relock the latches they need reentrantly.
+ */
+class MultiInstanceRecordLock final : public pstd::noncopyable {
+ public:
+  MultiInstanceRecordLock(Storage* storage, const std::vector<std::string>& keys);
+  ~MultiInstanceRecordLock();
+
+ private:
+  // in locking order
+  std::vector<std::pair<std::shared_ptr<LockMgr>, std::vector<size_t>>> locks_;
+};
+
 }  // namespace storage
@@ -4,17 +4,22 @@
 //  of patent rights can be found in the PATENTS file in the same directory.
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
+#include <latch>
 #include <utility>
 
 #include "config.h"
 #include "pstd/log.h"
 #include "pstd/pikiwidb_slot.h"
 #include "scope_snapshot.h"
+#include "src/coding.h"
 #include "src/lru_cache.h"
 #include "src/mutex_impl.h"
 #include "src/options_helper.h"
 #include "src/redis.h"
 #include "src/redis_hyperloglog.h"
+#include "src/scope_record_lock.h"
 #include "src/type_iterator.h"
 #include "storage/slot_indexer.h"
 #include "storage/storage.h"
@@ -63,6 +68,7 @@ Storage::Storage() {
 Storage::~Storage() {
   bg_tasks_should_exit_ = true;
   bg_tasks_cond_var_.notify_one();
+  fanout_pool_.reset();
 
   if (is_opened_) {
     for (auto& inst : insts_) {
@@ -91,8 +97,16 @@ Status Storage::Open(const StorageOptions& storage_options, const std::string& d
     }
     INFO("open RocksDB{} success!", index);
   }
+  txn_id_ = pstd::NowMicros();
+  if (Status s = recoverTransactions(); !s.ok()) {
+    ERROR("recover the transactions failed {}", s.ToString());
+    return s;
+  }
 
   slot_indexer_ = std::make_unique<SlotIndexer>(db_instance_num_);
+  if (db_instance_num_ > 1) {
+    fanout_pool_ = std::make_unique<pstd::WorkStealingPool>(db_instance_num_ - 1);
+  }
   db_id_ = storage_options.db_id;
 
   is_opened_.store(true);
@@ -126,6 +140,231 @@ std::unique_ptr<Redis>& Storage::GetDBInstance(const std::string& key) {
   return insts_[inst_index];
 }
 
+size_t Storage::GetDBInstanceID(const std::string& key) const {
+  return slot_indexer_->GetInstanceID(GetSlotID(key));
+}
+
+void Storage::OwnInstance(size_t inst_id) { insts_[inst_id]->GetLockMgr()->SetOwner(); }
+
+MultiInstanceRecordLock::MultiInstanceRecordLock(Storage* storage, const std::vector<std::string>& keys) {
+  std::vector<std::pair<Redis*, size_t>> latches;
+  latches.reserve(keys.size());
+  for (const auto& key : keys) {
+    auto inst = storage->GetDBInstance(key).get();
+    latches.emplace_back(inst, inst->GetLockMgr()->LatchOf(key));
+  }
+  std::sort(latches.begin(), latches.end(), [](const auto& a, const auto& b) {
+    return a.first->GetIndex() != b.first->GetIndex() ? a.first->GetIndex() < b.first->GetIndex()
+                                                      : a.second < b.second;
+  });
+
+  for (size_t i = 0; i < latches.size();) {
+    auto inst = latches[i].first;
+    std::vector<size_t> batch;
+    for (; i < latches.size() && latches[i].first == inst; ++i) {
+      batch.push_back(latches[i].second);
+    }
+    inst->GetLockMgr()->LockBatch(&batch);
+    locks_.emplace_back(inst->GetLockMgr(), std::move(batch));
+  }
+}
+
+MultiInstanceRecordLock::~MultiInstanceRecordLock() {
+  for (auto it = locks_.rbegin(); it != locks_.rend(); ++it) {
+    it->first->UnLockBatch(it->second);
+  }
+}
+
+// keys locked by the transaction of the thread
+static thread_local std::unique_ptr<MultiInstanceRecordLock> txn_lock;
+
+void Storage::BeginTransaction(const std::vector<std::string>& keys) {
+  txn_lock = std::make_unique<MultiInstanceRecordLock>(this, keys);
+  for (const auto& inst : insts_) {
+    inst->BeginTransaction();
+  }
+}
+
+Status Storage::CommitTransaction() {
+  std::vector<Redis*> writers;
+  for (const auto& inst : insts_) {
+    if (inst->TransactionWrites()) {
+      writers.push_back(inst.get());
+    }
+  }
+
+  // a batch is written whole or not at all, several ones are put together in an intent before any is written, and
+  // each is written with a mark, so the ones missing are known and written from the intent when the storage opens
+  uint64_t id = 0;
+  if (writers.size() > 1) {
+    id = ++txn_id_;
+    std::string intent;
+    char buf[sizeof(uint32_t)];
+    for (auto writer : writers) {
+      const auto& writes = writer->TransactionWrites()->Data();
+      EncodeFixed32(buf, static_cast<uint32_t>(writer->GetIndex()));
+      intent.append(buf, sizeof(buf));
+      EncodeFixed32(buf, static_cast<uint32_t>(writes.size()));
+      intent.append(buf, sizeof(buf));
+      intent.append(writes);
+    }
+    Status s = writers[0]->PutTransactionIntent(id, intent);
+    for (size_t i = 0; s.ok() && i < writers.size(); ++i) {
+      s = writers[i]->MarkTransaction(id);
+    }
+    if (!s.ok()) {
+      RollbackTransaction();
+      return s;
+    }
+  }
+
+  // a failed instance doesn't stop the others, the intent completes the transaction
+  Status result;
+  for (const auto& inst : insts_) {
+    auto s = inst->CommitTransaction();
+    if (!s.ok() && result.ok()) {
+      result = s;
+    }
+  }
+  txn_lock.reset();
+
+  if (id == 0) {
+    return result;
+  }
+  if (!result.ok()) {
+    ERROR("transaction {} isn't written whole, {}, the rest is written when the storage opens", id, result.ToString());
+    return result;
+  }
+  // the intent first, a mark without it is dropped when the storage opens
+  for (auto writer : writers) {
+    if (Status s = writer->ForgetTransaction(id); !s.ok()) {
+      WARN("forget transaction {} on instance {} failed {}", id, writer->GetIndex(), s.ToString());
+      break;
+    }
+  }
+  return result;
+}
+
+void Storage::RollbackTransaction() {
+  for (const auto& inst : insts_) {
+    inst->RollbackTransaction();
+  }
+  txn_lock.reset();
+}
+
+Status Storage::recoverTransactions() {
+  for (const auto& inst : insts_) {
+    std::vector<std::pair<uint64_t, std::string>> intents;
+    Status s = inst->TransactionIntents(&intents);
+    if (!s.ok()) {
+      return s;
+    }
+    for (const auto& [id, intent] : intents) {
+      std::vector<Redis*> writers;
+      for (size_t pos = 0; pos < intent.size();) {
+        if (pos + 2 * sizeof(uint32_t) > intent.size()) {
+          return Status::Corruption("transaction intent");
+        }
+        const auto index = DecodeFixed32(intent.data() + pos);
+        const auto size = DecodeFixed32(intent.data() + pos + sizeof(uint32_t));
+        pos += 2 * sizeof(uint32_t);
+        if (index >= insts_.size() || pos + size > intent.size()) {
+          return Status::Corruption("transaction intent");
+        }
+        auto writer = insts_[index].get();
+        bool marked = false;
+        s = writer->TransactionMarked(id, &marked);
+        if (s.ok() && !marked) {
+          INFO("rocksdb instance {} writes its part of transaction {}", index, id);
+          s = writer->ApplyTransaction(id, Slice(intent.data() + pos, size));
+        }
+        if (!s.ok()) {
+          return s;
+        }
+        writers.push_back(writer);
+        pos += size;
+      }
+      // the instance of the intent first
+      s = inst->ForgetTransaction(id);
+      for (size_t i = 0; s.ok() && i < writers.size(); ++i) {
+        s = writers[i]->ForgetTransaction(id);
+      }
+      if (!s.ok()) {
+        return s;
+      }
+    }
+  }
+  for (const auto& inst : insts_) {
+    if (Status s = inst->DropTransactionMarks(); !s.ok()) {
+      return s;
+    }
+  }
+  return Status::OK();
+}
+
+Status Storage::typesOf(const std::unique_ptr<Redis>& inst, const Slice& key, uint8_t* types) {
+  std::vector<uint8_t> existing;
+  Status s = inst->ExistingTypes({key.ToString()}, &existing);
+  *types = s.ok() ? existing[0] : 0;
+  return s;
+}
+
+// below this many keys handing groups to other threads costs more than the work it overlaps
+static constexpr size_t kParallelMinKeys = 32;
+
+Status Storage::forEachInstance(const std::vector<std::string>& keys, const InstanceFn& fn) {
+  std::vector<std::vector<size_t>> positions(insts_.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    positions[GetDBInstanceID(keys[i])].push_back(i);
+  }
+  std::vector<size_t> used;
+  for (size_t idx = 0; idx < positions.size(); ++idx) {
+    if (!positions[idx].empty()) {
+      used.push_back(idx);
+    }
+  }
+
+  // a transaction belongs to the calling thread, its reads can't move to another one
+  if (used.size() < 2 || keys.size() < kParallelMinKeys || !fanout_pool_ || txn_lock) {
+    for (auto idx : used) {
+      Status s = fn(idx, positions[idx]);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    return Status::OK();
+  }
+
+  std::vector<Status> statuses(insts_.size());
+  std::latch done(static_cast<std::ptrdiff_t>(used.size() - 1));
+  for (size_t i = 1; i < used.size(); ++i) {
+    const auto idx = used[i];
+    auto task = [&fn, &positions, &statuses, &done, idx]() {
+      statuses[idx] = fn(idx, positions[idx]);
+      done.count_down();
+    };
+    if (!fanout_pool_->Submit(task)) {
+      task();
+    }
+  }
+  statuses[used[0]] = fn(used[0], positions[used[0]]);
+  done.wait();
+
+  for (auto idx : used) {
+    if (!statuses[idx].ok()) {
+      return statuses[idx];
+    }
+  }
+  return Status::OK();
+}
+
+// destination and source keys of the *STORE commands
+static std::vector<std::string> StoreKeys(const Slice& destination, const std::vector<std::string>& keys) {
+  std::vector<std::string> all(keys);
+  all.push_back(destination.ToString());
+  return all;
+}
+
 // Strings Commands
 Status Storage::Set(const Slice& key, const Slice& value) {
   auto& inst = GetDBInstance(key);
@@ -162,31 +401,59 @@ Status Storage::GetBit(const Slice& key, int64_t offset, int32_t* ret) {
   return inst->GetBit(key, offset, ret);
 }
 
-Status Storage::MSet(const std::vector<KeyValue>& kvs) {
-  Status s;
+Status Storage::MSet(const std::vector<KeyValue>& kvs, std::vector<Status>* statuses) {
+  std::vector<std::string> keys;
+  keys.reserve(kvs.size());
   for (const auto& kv : kvs) {
-    auto& inst = GetDBInstance(kv.key);
-    s = inst->Set(Slice(kv.key), Slice(kv.value));
-    if (!s.ok()) {
+    keys.push_back(kv.key);
+  }
+  if (statuses) {
+    statuses->assign(kvs.size(), Status::OK());
+  }
+
+  // one WriteBatch per instance instead of one write per key
+  return forEachInstance(keys, [this, &kvs, statuses](size_t idx, const std::vector<size_t>& positions) {
+    std::vector<KeyValue> inst_kvs;
+    inst_kvs.reserve(positions.size());
+    for (auto pos : positions) {
+      inst_kvs.push_back(kvs[pos]);
+    }
+    Status s = insts_[idx]->MSet(inst_kvs);
+    if (!statuses) {
       return s;
     }
-  }
-  return s;
+    for (auto pos : positions) {
+      (*statuses)[pos] = s;
+    }
+    return Status::OK();
+  });
 }
 
 Status Storage::MGet(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss) {
   vss->clear();
-  Status s;
-  for (const auto& key : keys) {
-    auto& inst = GetDBInstance(key);
-    std::string value;
-    s = inst->Get(key, &value);
-    if (s.ok()) {
-      vss->push_back({value, Status::OK()});
-    } else if (s.IsNotFound()) {
-      vss->push_back({std::string(), Status::NotFound()});
-    } else {
-      vss->clear();
+  vss->resize(keys.size());
+
+  // one MultiGet per instance, results are put back at the position of their key
+  std::vector<Status> errors(insts_.size());
+  forEachInstance(keys, [this, &keys, vss, &errors](size_t idx, const std::vector<size_t>& positions) {
+    std::vector<std::string> inst_keys;
+    inst_keys.reserve(positions.size());
+    for (auto pos : positions) {
+      inst_keys.push_back(keys[pos]);
+    }
+    std::vector<ValueStatus> inst_vss;
+    errors[idx] = insts_[idx]->MGet(inst_keys, &inst_vss);
+    for (size_t j = 0; j < positions.size(); ++j) {
+      if (errors[idx].ok()) {
+        (*vss)[positions[j]] = std::move(inst_vss[j]);
+      } else {
+        (*vss)[positions[j]].status = errors[idx];
+      }
+    }
+    return Status::OK();
+  });
+  for (const auto& s : errors) {
+    if (!s.ok()) {
       return s;
     }
   }
@@ -195,22 +462,25 @@ Status Storage::MGet(const std::vector<std::string>& keys, std::vector<ValueStat
 
 Status Storage::MGetWithTTL(const std::vector<std::string>& keys, std::vector<ValueStatus>* vss) {
   vss->clear();
-  Status s;
-  for (const auto& key : keys) {
-    auto& inst = GetDBInstance(key);
-    std::string value;
-    uint64_t ttl;
-    s = inst->GetWithTTL(key, &value, &ttl);
-    if (s.ok()) {
-      vss->push_back({value, Status::OK(), ttl});
-    } else if (s.IsNotFound()) {
-      vss->push_back({std::string(), Status::NotFound(), ttl});
-    } else {
-      vss->clear();
-      return s;
+  vss->resize(keys.size());
+
+  Status s = forEachInstance(keys, [this, &keys, vss](size_t idx, const std::vector<size_t>& positions) {
+    std::vector<std::string> inst_keys;
+    inst_keys.reserve(positions.size());
+    for (auto pos : positions) {
+      inst_keys.push_back(keys[pos]);
     }
+    std::vector<ValueStatus> inst_vss;
+    Status s = insts_[idx]->MGetWithTTL(inst_keys, &inst_vss);
+    for (size_t j = 0; s.ok() && j < positions.size(); ++j) {
+      (*vss)[positions[j]] = std::move(inst_vss[j]);
+    }
+    return s;
+  });
+  if (!s.ok()) {
+    vss->clear();
   }
-  return Status::OK();
+  return s;
 }
 
 Status Storage::Setnx(const Slice& key, const Slice& value, int32_t* ret, const uint64_t ttl) {
@@ -507,6 +777,7 @@ Status Storage::SDiff(const std::vector<std::string>& keys, std::vector<std::str
 
 Status Storage::SDiffstore(const Slice& destination, const std::vector<std::string>& keys,
                            std::vector<std::string>& value_to_dest, int32_t* ret) {
+  MultiInstanceRecordLock ml(this, StoreKeys(destination, keys));
   Status s;
 
   s = SDiff(keys, &value_to_dest);
@@ -538,22 +809,59 @@ Status Storage::SInter(const std::vector<std::string>& keys, std::vector<std::st
     return s;
   }
 
-  for (const auto member : key0_members) {
-    int32_t exist = 1;
-    for (int idx = 1; idx < keys.size(); idx++) {
-      Slice pkey(keys[idx]);
-      auto& inst = GetDBInstance(keys[idx]);
-      s = inst->SIsmember(keys[idx], member, &exist);
-      if (s.ok() && exist > 0) {
-        continue;
-      } else if (!s.IsNotFound()) {
+  // each instance narrows the candidates down with its keys, one MultiGet per key
+  std::vector<std::string> others(keys.begin() + 1, keys.end());
+  std::vector<std::vector<char>> inst_found(insts_.size());
+  s = forEachInstance(others, [this, &others, &key0_members, &inst_found](size_t idx,
+                                                                         const std::vector<size_t>& positions) {
+    auto& found = inst_found[idx];
+    found.assign(key0_members.size(), 1);
+    std::vector<std::string> candidates = key0_members;
+    std::vector<size_t> candidate_pos(key0_members.size());
+    for (size_t i = 0; i < candidate_pos.size(); ++i) {
+      candidate_pos[i] = i;
+    }
+    std::vector<char> in_set;
+    for (auto pos : positions) {
+      if (candidates.empty()) {
+        break;
+      }
+      Status s = insts_[idx]->SMIsmember(others[pos], candidates, &in_set);
+      if (s.IsNotFound()) {
+        std::fill(found.begin(), found.end(), 0);
+        break;
+      }
+      if (!s.ok()) {
         return s;
-      } else {
+      }
+      size_t kept = 0;
+      for (size_t i = 0; i < candidates.size(); ++i) {
+        if (in_set[i]) {
+          candidates[kept] = std::move(candidates[i]);
+          candidate_pos[kept++] = candidate_pos[i];
+        } else {
+          found[candidate_pos[i]] = 0;
+        }
+      }
+      candidates.resize(kept);
+      candidate_pos.resize(kept);
+    }
+    return Status::OK();
+  });
+  if (!s.ok()) {
+    return s;
+  }
+
+  for (size_t i = 0; i < key0_members.size(); ++i) {
+    bool in_all = true;
+    for (const auto& found : inst_found) {
+      if (!found.empty() && !found[i]) {
+        in_all = false;
         break;
       }
     }
-    if (exist > 0) {
-      members->push_back(member);
+    if (in_all) {
+      members->push_back(std::move(key0_members[i]));
     }
   }
   return Status::OK();
@@ -561,6 +869,7 @@ Status Storage::SInter(const std::vector<std::string>& keys, std::vector<std::st
 
 Status Storage::SInterstore(const Slice& destination, const std::vector<std::string>& keys,
                             std::vector<std::string>& value_to_dest, int32_t* ret) {
+  MultiInstanceRecordLock ml(this, StoreKeys(destination, keys));
   Status s;
 
   s = SInter(keys, &value_to_dest);
@@ -594,6 +903,7 @@ Status Storage::SMembersWithTTL(const Slice& key, std::vector<std::string>* memb
 }
 
 Status Storage::SMove(const Slice& source, const Slice& destination, const Slice& member, int32_t* ret) {
+  MultiInstanceRecordLock ml(this, {source.ToString(), destination.ToString()});
   Status s;
 
   auto& src_inst = GetDBInstance(source);
@@ -658,6 +968,7 @@ Status Storage::SUnion(const std::vector<std::string>& keys, std::vector<std::st
 
 Status Storage::SUnionstore(const Slice& destination, const std::vector<std::string>& keys,
                             std::vector<std::string>& value_to_dest, int32_t* ret) {
+  MultiInstanceRecordLock ml(this, StoreKeys(destination, keys));
   Status s;
   value_to_dest.clear();
 
@@ -767,6 +1078,7 @@ Status Storage::RPoplpush(const Slice& source, const Slice& destination, std::st
     return s;
   }
 
+  MultiInstanceRecordLock ml(this, {source.ToString(), destination.ToString()});
   std::vector<std::string> elements;
   s = source_inst->RPop(source, 1, &elements);
   if (!s.ok()) {
@@ -779,6 +1091,26 @@ Status Storage::RPoplpush(const Slice& source, const Slice& destination, std::st
   return s;
 }
 
+Status Storage::LMove(const Slice& source, const Slice& destination, bool from_left, bool to_left,
+                      std::string* element) {
+  if (!from_left && to_left) {
+    return RPoplpush(source, destination, element);
+  }
+  element->clear();
+
+  MultiInstanceRecordLock ml(this, {source.ToString(), destination.ToString()});
+  std::vector<std::string> elements;
+  auto& source_inst = GetDBInstance(source);
+  Status s = from_left ? source_inst->LPop(source, 1, &elements) : source_inst->RPop(source, 1, &elements);
+  if (!s.ok()) {
+    return s;
+  }
+  *element = elements.front();
+  auto& dest_inst = GetDBInstance(destination);
+  uint64_t ret;
+  return to_left ? dest_inst->LPush(destination, elements, &ret) : dest_inst->RPush(destination, elements, &ret);
+}
+
 Status Storage::ZPopMax(const Slice& key, const int64_t count, std::vector<ScoreMember>* score_members) {
   score_members->clear();
   auto& inst = GetDBInstance(key);
@@ -895,6 +1227,7 @@ Status Storage::ZScore(const Slice& key, const Slice& member, double* ret) {
 Status Storage::ZUnionstore(const Slice& destination, const std::vector<std::string>& keys,
                             const std::vector<double>& weights, const AGGREGATE agg,
                             std::map<std::string, double>& value_to_dest, int32_t* ret) {
+  MultiInstanceRecordLock ml(this, StoreKeys(destination, keys));
   value_to_dest.clear();
   Status s;
 
@@ -946,6 +1279,7 @@ Status Storage::ZUnionstore(const Slice& destination, const std::vector<std::str
 Status Storage::ZInterstore(const Slice& destination, const std::vector<std::string>& keys,
                             const std::vector<double>& weights, const AGGREGATE agg,
                             std::vector<ScoreMember>& value_to_dest, int32_t* ret) {
+  MultiInstanceRecordLock ml(this, StoreKeys(destination, keys));
   Status s;
   value_to_dest.clear();
 
@@ -1031,110 +1365,30 @@ Status Storage::ZScan(const Slice& key, int64_t cursor, const std::string& patte
 }
 
 int32_t Storage::Expire(const Slice& key, uint64_t ttl) {
-  int32_t ret = 0;
-  bool is_corruption = false;
-
   auto& inst = GetDBInstance(key);
-  // Strings
-  Status s = inst->StringsExpire(key, ttl);
-  if (s.ok()) {
-    ret++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
-  }
-
-  // Hash
-  s = inst->HashesExpire(key, ttl);
-  if (s.ok()) {
-    ret++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
-  }
-
-  // Sets
-  s = inst->SetsExpire(key, ttl);
-  if (s.ok()) {
-    ret++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
-  }
-
-  // Lists
-  s = inst->ListsExpire(key, ttl);
-  if (s.ok()) {
-    ret++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
-  }
-
-  // Zsets
-  s = inst->ZsetsExpire(key, ttl);
-  if (s.ok()) {
-    ret++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
-  }
-
-  if (is_corruption) {
-    return -1;
-  } else {
-    return ret;
-  }
+  // every type of the key in one write
+  std::vector<int32_t> expired;
+  Status s = inst->MultiExpire({key.ToString()}, ttl, &expired);
+  return s.ok() ? expired[0] : -1;
 }
 
 int64_t Storage::Del(const std::vector<std::string>& keys) {
-  Status s;
-  int64_t count = 0;
-  bool is_corruption = false;
-
-  for (const auto& key : keys) {
-    auto& inst = GetDBInstance(key);
-    // Strings
-    Status s = inst->StringsDel(key);
-    if (s.ok()) {
-      count++;
-    } else if (!s.IsNotFound()) {
-      is_corruption = true;
-    }
-
-    // Hashes
-    s = inst->HashesDel(key);
-    if (s.ok()) {
-      count++;
-    } else if (!s.IsNotFound()) {
-      is_corruption = true;
-    }
-
-    // Sets
-    s = inst->SetsDel(key);
-    if (s.ok()) {
-      count++;
-    } else if (!s.IsNotFound()) {
-      is_corruption = true;
-    }
-
-    // Lists
-    s = inst->ListsDel(key);
-    if (s.ok()) {
-      count++;
-    } else if (!s.IsNotFound()) {
-      is_corruption = true;
+  std::atomic<int64_t> count = 0;
+  // one WriteBatch per instance for all the types of its keys
+  Status s = forEachInstance(keys, [this, &keys, &count](size_t idx, const std::vector<size_t>& positions) {
+    std::vector<std::string> inst_keys;
+    inst_keys.reserve(positions.size());
+    for (auto pos : positions) {
+      inst_keys.push_back(keys[pos]);
     }
-
-    // ZSets
-    s = inst->ZsetsDel(key);
-    if (s.ok()) {
-      count++;
-    } else if (!s.IsNotFound()) {
-      is_corruption = true;
+    std::vector<int32_t> deleted;
+    Status s = insts_[idx]->MultiDel(inst_keys, &deleted);
+    for (auto n : deleted) {
+      count.fetch_add(n, std::memory_order_relaxed);
     }
-  }
-
-  if (is_corruption) {
-    return -1;
-  } else {
-    return count;
-  }
+    return s;
+  });
+  return s.ok() ? count.load() : -1;
 }
 
 int64_t Storage::DelByType(const std::vector<std::string>& keys, const DataType& type) {
@@ -1209,56 +1463,21 @@ int64_t Storage::DelByType(const std::vector<std::string>& keys, const DataType&
 }
 
 int64_t Storage::Exists(const std::vector<std::string>& keys) {
-  int64_t count = 0;
-  int32_t ret;
-  uint64_t llen;
-  std::string value;
-  Status s;
-  bool is_corruption = false;
-
-  for (const auto& key : keys) {
-    auto& inst = GetDBInstance(key);
-    s = inst->Get(key, &value);
-    if (s.ok()) {
-      count++;
-    } else if (!s.IsNotFound()) {
-      is_corruption = true;
+  std::atomic<int64_t> count = 0;
+  Status s = forEachInstance(keys, [this, &keys, &count](size_t idx, const std::vector<size_t>& positions) {
+    std::vector<std::string> inst_keys;
+    inst_keys.reserve(positions.size());
+    for (auto pos : positions) {
+      inst_keys.push_back(keys[pos]);
     }
-
-    s = inst->HLen(key, &ret);
-    if (s.ok()) {
-      count++;
-    } else if (!s.IsNotFound()) {
-      is_corruption = true;
-    }
-
-    s = inst->SCard(key, &ret);
-    if (s.ok()) {
-      count++;
-    } else if (!s.IsNotFound()) {
-      is_corruption = true;
+    std::vector<uint8_t> types;
+    Status s = insts_[idx]->ExistingTypes(inst_keys, &types);
+    for (auto t : types) {
+      count.fetch_add(std::popcount(t), std::memory_order_relaxed);
     }
-
-    s = inst->LLen(key, &llen);
-    if (s.ok()) {
-      count++;
-    } else if (!s.IsNotFound()) {
-      is_corruption = true;
-    }
-
-    s = inst->ZCard(key, &ret);
-    if (s.ok()) {
-      count++;
-    } else if (!s.IsNotFound()) {
-      is_corruption = true;
-    }
-  }
-
-  if (is_corruption) {
-    return -1;
-  } else {
-    return count;
-  }
+    return s;
+  });
+  return s.ok() ? count.load() : -1;
 }
 
 int64_t Storage::Scan(const DataType& dtype, int64_t cursor, const std::string& pattern, int64_t count,
@@ -1513,208 +1732,125 @@ Status Storage::Scanx(const DataType& data_type, const std::string& start_key, c
 }
 
 int32_t Storage::Expireat(const Slice& key, uint64_t timestamp) {
-  Status s;
-  int32_t count = 0;
-  bool is_corruption = false;
-
   auto& inst = GetDBInstance(key);
-  s = inst->StringsExpireat(key, timestamp);
-  if (s.ok()) {
-    count++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
+  uint8_t types = 0;
+  if (!typesOf(inst, key, &types).ok()) {
+    return -1;
   }
 
-  s = inst->HashesExpireat(key, timestamp);
-  if (s.ok()) {
-    count++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
+  int32_t count = 0;
+  bool is_corruption = false;
+  auto tally = [&count, &is_corruption](const Status& s) {
+    if (s.ok()) {
+      count++;
+    } else if (!s.IsNotFound()) {
+      is_corruption = true;
+    }
+  };
+  if (types & (1 << kStrings)) {
+    tally(inst->StringsExpireat(key, timestamp));
   }
-
-  s = inst->SetsExpireat(key, timestamp);
-  if (s.ok()) {
-    count++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
+  if (types & (1 << kHashes)) {
+    tally(inst->HashesExpireat(key, timestamp));
   }
-
-  s = inst->ListsExpireat(key, timestamp);
-  if (s.ok()) {
-    count++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
+  if (types & (1 << kSets)) {
+    tally(inst->SetsExpireat(key, timestamp));
   }
-
-  s = inst->ZsetsExpireat(key, timestamp);
-  if (s.ok()) {
-    count++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
+  if (types & (1 << kLists)) {
+    tally(inst->ListsExpireat(key, timestamp));
   }
-
-  if (is_corruption) {
-    return -1;
+  if (types & (1 << kZSets)) {
+    tally(inst->ZsetsExpireat(key, timestamp));
   }
-  return count;
+  return is_corruption ? -1 : count;
 }
 
 int32_t Storage::Persist(const Slice& key, std::map<DataType, Status>* type_status) {
-  Status s;
-  int32_t count = 0;
-  bool is_corruption = false;
-
   auto& inst = GetDBInstance(key);
-  s = inst->StringsPersist(key);
-  if (s.ok()) {
-    count++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
-    (*type_status)[DataType::kStrings] = s;
+  uint8_t types = 0;
+  Status s = typesOf(inst, key, &types);
+  if (!s.ok()) {
+    (*type_status)[DataType::kAll] = s;
+    return -1;
   }
 
-  s = inst->HashesPersist(key);
-  if (s.ok()) {
-    count++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
-    (*type_status)[DataType::kHashes] = s;
+  int32_t count = 0;
+  bool is_corruption = false;
+  auto tally = [&count, &is_corruption, type_status](DataType type, const Status& s) {
+    if (s.ok()) {
+      count++;
+    } else if (!s.IsNotFound()) {
+      is_corruption = true;
+      (*type_status)[type] = s;
+    }
+  };
+  if (types & (1 << kStrings)) {
+    tally(kStrings, inst->StringsPersist(key));
   }
-
-  s = inst->SetsPersist(key);
-  if (s.ok()) {
-    count++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
-    (*type_status)[DataType::kSets] = s;
+  if (types & (1 << kHashes)) {
+    tally(kHashes, inst->HashesPersist(key));
   }
-
-  s = inst->ListsPersist(key);
-  if (s.ok()) {
-    count++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
-    (*type_status)[DataType::kLists] = s;
+  if (types & (1 << kSets)) {
+    tally(kSets, inst->SetsPersist(key));
   }
-
-  s = inst->ZsetsPersist(key);
-  if (s.ok()) {
-    count++;
-  } else if (!s.IsNotFound()) {
-    is_corruption = true;
-    (*type_status)[DataType::kZSets] = s;
+  if (types & (1 << kLists)) {
+    tally(kLists, inst->ListsPersist(key));
   }
-
-  if (is_corruption) {
-    return -1;
-  } else {
-    return count;
+  if (types & (1 << kZSets)) {
+    tally(kZSets, inst->ZsetsPersist(key));
   }
+  return is_corruption ? -1 : count;
 }
 
 std::map<DataType, int64_t> Storage::TTL(const Slice& key, std::map<DataType, Status>* type_status) {
-  Status s;
   std::map<DataType, int64_t> ret;
-  uint64_t timestamp = 0;
-
   auto& inst = GetDBInstance(key);
-  s = inst->StringsTTL(key, &timestamp);
-  if (s.ok() || s.IsNotFound()) {
-    ret[DataType::kStrings] = timestamp;
-  } else if (!s.IsNotFound()) {
-    ret[DataType::kStrings] = -3;
-    (*type_status)[DataType::kStrings] = s;
-  }
-
-  s = inst->HashesTTL(key, &timestamp);
-  if (s.ok() || s.IsNotFound()) {
-    ret[DataType::kHashes] = timestamp;
-  } else if (!s.IsNotFound()) {
-    ret[DataType::kHashes] = -3;
-    (*type_status)[DataType::kHashes] = s;
-  }
-
-  s = inst->ListsTTL(key, &timestamp);
-  if (s.ok() || s.IsNotFound()) {
-    ret[DataType::kLists] = timestamp;
-  } else if (!s.IsNotFound()) {
-    ret[DataType::kLists] = -3;
-    (*type_status)[DataType::kLists] = s;
-  }
-
-  s = inst->SetsTTL(key, &timestamp);
-  if (s.ok() || s.IsNotFound()) {
-    ret[DataType::kSets] = timestamp;
-  } else if (!s.IsNotFound()) {
-    ret[DataType::kSets] = -3;
-    (*type_status)[DataType::kSets] = s;
+  uint8_t types = 0;
+  Status s = typesOf(inst, key, &types);
+  if (!s.ok()) {
+    for (auto type : {kStrings, kHashes, kLists, kSets, kZSets}) {
+      ret[type] = -3;
+      (*type_status)[type] = s;
+    }
+    return ret;
   }
 
-  s = inst->ZsetsTTL(key, &timestamp);
-  if (s.ok() || s.IsNotFound()) {
-    ret[DataType::kZSets] = timestamp;
-  } else if (!s.IsNotFound()) {
-    ret[DataType::kZSets] = -3;
-    (*type_status)[DataType::kZSets] = s;
-  }
+  // the types the key hasn't are -2, as their *TTL sets on NotFound
+  auto ttl = [&ret, type_status, types](DataType type, const std::function<Status(uint64_t*)>& fn) {
+    uint64_t timestamp = -2;
+    if (types & (1 << type)) {
+      Status s = fn(&timestamp);
+      if (!s.ok() && !s.IsNotFound()) {
+        timestamp = -3;
+        (*type_status)[type] = s;
+      }
+    }
+    ret[type] = static_cast<int64_t>(timestamp);
+  };
+  ttl(kStrings, [&](uint64_t* timestamp) { return inst->StringsTTL(key, timestamp); });
+  ttl(kHashes, [&](uint64_t* timestamp) { return inst->HashesTTL(key, timestamp); });
+  ttl(kLists, [&](uint64_t* timestamp) { return inst->ListsTTL(key, timestamp); });
+  ttl(kSets, [&](uint64_t* timestamp) { return inst->SetsTTL(key, timestamp); });
+  ttl(kZSets, [&](uint64_t* timestamp) { return inst->ZsetsTTL(key, timestamp); });
   return ret;
 }
 
 Status Storage::GetType(const std::string& key, bool single, std::vector<std::string>& types) {
   types.clear();
 
-  Status s;
-  std::string value;
   auto& inst = GetDBInstance(key);
-  s = inst->Get(key, &value);
-  if (s.ok()) {
-    types.emplace_back("string");
-  } else if (!s.IsNotFound()) {
-    return s;
-  }
-  if (single && !types.empty()) {
-    return s;
-  }
-
-  int32_t hashes_len = 0;
-  s = inst->HLen(key, &hashes_len);
-  if (s.ok() && hashes_len != 0) {
-    types.emplace_back("hash");
-  } else if (!s.IsNotFound()) {
-    return s;
-  }
-  if (single && !types.empty()) {
-    return s;
-  }
-
-  uint64_t lists_len = 0;
-  s = inst->LLen(key, &lists_len);
-  if (s.ok() && lists_len != 0) {
-    types.emplace_back("list");
-  } else if (!s.IsNotFound()) {
-    return s;
-  }
-  if (single && !types.empty()) {
-    return s;
-  }
-
-  int32_t zsets_size = 0;
-  s = inst->ZCard(key, &zsets_size);
-  if (s.ok() && zsets_size != 0) {
-    types.emplace_back("zset");
-  } else if (!s.IsNotFound()) {
-    return s;
-  }
-  if (single && !types.empty()) {
+  uint8_t existing = 0;
+  Status s = typesOf(inst, key, &existing);
+  if (!s.ok()) {
     return s;
   }
-
-  int32_t sets_size = 0;
-  s = inst->SCard(key, &sets_size);
-  if (s.ok() && sets_size != 0) {
-    types.emplace_back("set");
-  } else if (!s.IsNotFound()) {
-    return s;
+  for (auto type : {kStrings, kHashes, kLists, kZSets, kSets}) {
+    if (existing & (1 << type)) {
+      types.emplace_back(DataTypeToString[type]);
+      if (single) {
+        break;
+      }
+    }
   }
   if (single && types.empty()) {
     types.emplace_back("none");
@@ -1821,30 +1957,18 @@ Status Storage::PfCount(const std::vector<std::string>& keys, int64_t* result) {
     return Status::InvalidArgument("Invalid the number of key");
   }
 
-  std::string value;
-  std::string first_registers;
-  auto& inst = GetDBInstance(keys[0]);
-  Status s = inst->Get(keys[0], &value);
-  if (s.ok()) {
-    first_registers = std::string(value.data(), value.size());
-  } else if (s.IsNotFound()) {
-    first_registers = "";
+  std::vector<ValueStatus> vss;
+  Status s = MGet(keys, &vss);
+  if (!s.ok()) {
+    return s;
   }
 
-  HyperLogLog first_log(kPrecision, first_registers);
-  for (size_t i = 1; i < keys.size(); ++i) {
-    std::string value;
-    std::string registers;
-    auto& inst = GetDBInstance(keys[i]);
-    s = inst->Get(keys[i], &value);
-    if (s.ok()) {
-      registers = value;
-    } else if (s.IsNotFound()) {
+  HyperLogLog first_log(kPrecision, vss[0].status.ok() ? vss[0].value : "");
+  for (size_t i = 1; i < vss.size(); ++i) {
+    if (!vss[i].status.ok()) {
       continue;
-    } else {
-      return s;
     }
-    HyperLogLog log(kPrecision, registers);
+    HyperLogLog log(kPrecision, vss[i].value);
     first_log.Merge(log);
   }
   *result = static_cast<int32_t>(first_log.Estimate());
@@ -2104,6 +2228,24 @@ uint64_t Storage::GetProperty(const std::string& property) {
   return result;
 }
 
+ValueCacheStats Storage::GetValueCacheStats() {
+  ValueCacheStats stats;
+  for (const auto& inst : insts_) {
+    stats += inst->GetValueCacheStats();
+  }
+  return stats;
+}
+
+ValueCacheStats Storage::GetMetaCacheStats() {
+  ValueCacheStats stats;
+  for (const auto& inst : insts_) {
+    stats += inst->GetMetaCacheStats();
+  }
+  return stats;
+}
+
+int64_t Storage::CachedLen(DataType type, const Slice& key) { return GetDBInstance(key)->CachedLen(type, key); }
+
 Status Storage::GetKeyNum(std::vector<KeyInfo>* key_infos) {
   KeyInfo key_info;
   key_infos->resize(5);
@@ -2159,36 +2301,19 @@ void Storage::GetRocksDBInfo(std::string& info) {
 }
 
 int64_t Storage::IsExist(const Slice& key, std::map<DataType, Status>* type_status) {
-  std::string value;
-  int32_t ret = 0;
-  int64_t type_count = 0;
   auto& inst = GetDBInstance(key);
-  Status s = inst->Get(key, &value);
-  (*type_status)[DataType::kStrings] = s;
-  if (s.ok()) {
-    type_count++;
-  }
-  s = inst->HLen(key, &ret);
-  (*type_status)[DataType::kHashes] = s;
-  if (s.ok()) {
-    type_count++;
-  }
-  s = inst->SCard(key, &ret);
-  (*type_status)[DataType::kSets] = s;
-  if (s.ok()) {
-    type_count++;
-  }
-  uint64_t llen = 0;
-  s = inst->LLen(key, &llen);
-  (*type_status)[DataType::kLists] = s;
-  if (s.ok()) {
-    type_count++;
-  }
-
-  s = inst->ZCard(key, &ret);
-  (*type_status)[DataType::kZSets] = s;
-  if (s.ok()) {
-    type_count++;
+  uint8_t types = 0;
+  Status s = typesOf(inst, key, &types);
+  int64_t type_count = 0;
+  for (auto type : {kStrings, kHashes, kSets, kLists, kZSets}) {
+    if (!s.ok()) {
+      (*type_status)[type] = s;
+    } else if (types & (1 << type)) {
+      (*type_status)[type] = Status::OK();
+      type_count++;
+    } else {
+      (*type_status)[type] = Status::NotFound();
+    }
   }
   return type_count;
 }
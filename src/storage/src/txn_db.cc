@@ -0,0 +1,348 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "src/txn_db.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "src/type_index.h"
+
+namespace storage {
+
+thread_local TxnDB::Txns* TxnDB::txns_ = nullptr;
+
+// replays a WriteBatch into the index of a transaction
+class TxnDB::BatchIndexer : public rocksdb::WriteBatch::Handler {
+ public:
+  BatchIndexer(const TxnDB* db, rocksdb::WriteBatchWithIndex* batch) : db_(db), batch_(batch) {}
+
+  Status PutCF(uint32_t column_family_id, const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+    return batch_->Put(db_->handleOf(column_family_id), key, value);
+  }
+  Status DeleteCF(uint32_t column_family_id, const rocksdb::Slice& key) override {
+    return batch_->Delete(db_->handleOf(column_family_id), key);
+  }
+  Status SingleDeleteCF(uint32_t column_family_id, const rocksdb::Slice& key) override {
+    return batch_->SingleDelete(db_->handleOf(column_family_id), key);
+  }
+  Status MergeCF(uint32_t column_family_id, const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+    return batch_->Merge(db_->handleOf(column_family_id), key, value);
+  }
+  Status DeleteRangeCF(uint32_t, const rocksdb::Slice&, const rocksdb::Slice&) override {
+    return Status::NotSupported("DeleteRange in a transaction");
+  }
+
+ private:
+  const TxnDB* db_;
+  rocksdb::WriteBatchWithIndex* batch_;
+};
+
+// collects the type index operands of a WriteBatch, and the keys it writes for the listener
+class TxnDB::BatchTagger : public rocksdb::WriteBatch::Handler {
+ public:
+  BatchTagger(const TxnDB* db, Written* written) : db_(db), written_(written) {}
+
+  Status PutCF(uint32_t column_family_id, const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+    add(column_family_id, key, &value);
+    return Status::OK();
+  }
+  Status DeleteCF(uint32_t column_family_id, const rocksdb::Slice& key) override {
+    add(column_family_id, key, nullptr);
+    return Status::OK();
+  }
+  Status SingleDeleteCF(uint32_t column_family_id, const rocksdb::Slice& key) override {
+    add(column_family_id, key, nullptr);
+    return Status::OK();
+  }
+  Status MergeCF(uint32_t column_family_id, const rocksdb::Slice& key, const rocksdb::Slice&) override {
+    note(db_->indexOf(db_->handleOf(column_family_id)), key);
+    return Status::OK();
+  }
+  Status DeleteRangeCF(uint32_t, const rocksdb::Slice&, const rocksdb::Slice&) override { return Status::OK(); }
+
+  std::vector<std::pair<std::string, std::string>> operands;
+
+ private:
+  void add(uint32_t column_family_id, const rocksdb::Slice& key, const rocksdb::Slice* value) {
+    const int cf = db_->indexOf(db_->handleOf(column_family_id));
+    std::string operand;
+    if (db_->typeIndexed(cf) && TypeIndex::OperandOf(static_cast<ColumnFamilyIndex>(cf), value, &operand)) {
+      operands.emplace_back(key.ToString(), std::move(operand));
+    }
+    note(cf, key);
+  }
+  void note(int cf, const rocksdb::Slice& key) {
+    // the type index itself isn't reported
+    if (written_ && cf >= 0 && cf < kTypeIndexCF) {
+      written_->emplace_back(static_cast<ColumnFamilyIndex>(cf), key.ToString());
+    }
+  }
+
+  const TxnDB* db_;
+  Written* written_;
+};
+
+TxnDB::TxnDB(rocksdb::DB* db, const std::vector<rocksdb::ColumnFamilyHandle*>* handles)
+    : rocksdb::StackableDB(db), handles_(handles) {}
+
+TxnDB::Txn* TxnDB::current() const {
+  if (!txns_) {
+    return nullptr;
+  }
+  for (const auto& [db, txn] : *txns_) {
+    if (db == this) {
+      return txn.get();
+    }
+  }
+  return nullptr;
+}
+
+std::unique_ptr<TxnDB::Txn> TxnDB::release() {
+  if (!txns_) {
+    return nullptr;
+  }
+  auto it = std::find_if(txns_->begin(), txns_->end(), [this](const auto& t) { return t.first == this; });
+  if (it == txns_->end()) {
+    return nullptr;
+  }
+  auto txn = std::move(it->second);
+  txns_->erase(it);
+  if (txns_->empty()) {
+    delete txns_;
+    txns_ = nullptr;
+  }
+  return txn;
+}
+
+rocksdb::WriteBatch* TxnDB::Pending() const {
+  auto txn = current();
+  if (!txn || txn->batch.GetWriteBatch()->Count() == 0) {
+    return nullptr;
+  }
+  return txn->batch.GetWriteBatch();
+}
+
+void TxnDB::Begin() {
+  if (current()) {
+    return;
+  }
+  auto txn = std::make_unique<Txn>();
+  txn->snapshot = db_->GetSnapshot();
+  if (!txns_) {
+    txns_ = new Txns;
+  }
+  txns_->emplace_back(this, std::move(txn));
+}
+
+Status TxnDB::Commit(const rocksdb::WriteOptions& options) {
+  auto txn = release();
+  if (!txn) {
+    return Status::OK();
+  }
+  Status s;
+  if (txn->batch.GetWriteBatch()->Count() > 0) {
+    s = db_->Write(options, txn->batch.GetWriteBatch());
+  }
+  if (s.ok()) {
+    notify(txn->written);
+  }
+  db_->ReleaseSnapshot(txn->snapshot);
+  return s;
+}
+
+void TxnDB::Rollback() {
+  if (auto txn = release(); txn) {
+    db_->ReleaseSnapshot(txn->snapshot);
+  }
+}
+
+rocksdb::ReadOptions TxnDB::withSnapshot(const rocksdb::ReadOptions& options, const Txn* txn) const {
+  rocksdb::ReadOptions read_options(options);
+  if (!read_options.snapshot) {
+    read_options.snapshot = txn->snapshot;
+  }
+  return read_options;
+}
+
+rocksdb::ColumnFamilyHandle* TxnDB::handleOf(uint32_t column_family_id) const {
+  for (auto handle : *handles_) {
+    if (handle->GetID() == column_family_id) {
+      return handle;
+    }
+  }
+  return db_->DefaultColumnFamily();
+}
+
+int TxnDB::indexOf(const rocksdb::ColumnFamilyHandle* column_family) const {
+  for (size_t i = 0; i < handles_->size(); ++i) {
+    if ((*handles_)[i] == column_family) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+bool TxnDB::typeIndexed(int cf) const {
+  return cf >= 0 && handles_->size() > kTypeIndexCF && TypeIndex::IsIndexed(static_cast<ColumnFamilyIndex>(cf));
+}
+
+bool TxnDB::batched(const rocksdb::ColumnFamilyHandle* column_family) const {
+  return listener_ || typeIndexed(indexOf(column_family));
+}
+
+Status TxnDB::tag(rocksdb::WriteBatch* updates, Written* written) const {
+  if (handles_->size() <= kTypeIndexCF && !written) {
+    return Status::OK();
+  }
+  BatchTagger tagger(this, written);
+  Status s = updates->Iterate(&tagger);
+  for (size_t i = 0; s.ok() && i < tagger.operands.size(); ++i) {
+    s = updates->Merge((*handles_)[kTypeIndexCF], tagger.operands[i].first, tagger.operands[i].second);
+  }
+  return s;
+}
+
+void TxnDB::notify(const Written& written) const {
+  for (const auto& [cf, key] : written) {
+    listener_(cf, key);
+  }
+}
+
+Status TxnDB::Get(const rocksdb::ReadOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                  const rocksdb::Slice& key, rocksdb::PinnableSlice* value) {
+  auto txn = current();
+  if (!txn) {
+    return db_->Get(options, column_family, key, value);
+  }
+  return txn->batch.GetFromBatchAndDB(db_, withSnapshot(options, txn), column_family, key, value);
+}
+
+std::vector<Status> TxnDB::MultiGet(const rocksdb::ReadOptions& options,
+                                    const std::vector<rocksdb::ColumnFamilyHandle*>& column_families,
+                                    const std::vector<rocksdb::Slice>& keys, std::vector<std::string>* values) {
+  auto txn = current();
+  if (!txn) {
+    return db_->MultiGet(options, column_families, keys, values);
+  }
+  std::vector<Status> statuses(keys.size());
+  values->resize(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    statuses[i] = Get(options, column_families[i], keys[i], &(*values)[i]);
+  }
+  return statuses;
+}
+
+void TxnDB::MultiGet(const rocksdb::ReadOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                     size_t num_keys, const rocksdb::Slice* keys, rocksdb::PinnableSlice* values, Status* statuses,
+                     bool sorted_input) {
+  if (!current()) {
+    return db_->MultiGet(options, column_family, num_keys, keys, values, statuses, sorted_input);
+  }
+  for (size_t i = 0; i < num_keys; ++i) {
+    statuses[i] = Get(options, column_family, keys[i], &values[i]);
+  }
+}
+
+void TxnDB::MultiGet(const rocksdb::ReadOptions& options, size_t num_keys,
+                     rocksdb::ColumnFamilyHandle** column_families, const rocksdb::Slice* keys,
+                     rocksdb::PinnableSlice* values, Status* statuses, bool sorted_input) {
+  if (!current()) {
+    return db_->MultiGet(options, num_keys, column_families, keys, values, statuses, sorted_input);
+  }
+  for (size_t i = 0; i < num_keys; ++i) {
+    statuses[i] = Get(options, column_families[i], keys[i], &values[i]);
+  }
+}
+
+rocksdb::Iterator* TxnDB::NewIterator(const rocksdb::ReadOptions& options,
+                                      rocksdb::ColumnFamilyHandle* column_family) {
+  auto txn = current();
+  if (!txn) {
+    return db_->NewIterator(options, column_family);
+  }
+  // the batch iterator keeps pointers to the bounds in options, they outlive the iterator like the base one's
+  auto read_options = withSnapshot(options, txn);
+  return txn->batch.NewIteratorWithBase(column_family, db_->NewIterator(read_options, column_family), &options);
+}
+
+Status TxnDB::Put(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                  const rocksdb::Slice& key, const rocksdb::Slice& value) {
+  if (batched(column_family)) {
+    rocksdb::WriteBatch batch;
+    batch.Put(column_family, key, value);
+    return Write(options, &batch);
+  }
+  auto txn = current();
+  return txn ? txn->batch.Put(column_family, key, value) : db_->Put(options, column_family, key, value);
+}
+
+Status TxnDB::Delete(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                     const rocksdb::Slice& key) {
+  if (batched(column_family)) {
+    rocksdb::WriteBatch batch;
+    batch.Delete(column_family, key);
+    return Write(options, &batch);
+  }
+  auto txn = current();
+  return txn ? txn->batch.Delete(column_family, key) : db_->Delete(options, column_family, key);
+}
+
+Status TxnDB::SingleDelete(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                           const rocksdb::Slice& key) {
+  if (batched(column_family)) {
+    rocksdb::WriteBatch batch;
+    batch.SingleDelete(column_family, key);
+    return Write(options, &batch);
+  }
+  auto txn = current();
+  return txn ? txn->batch.SingleDelete(column_family, key) : db_->SingleDelete(options, column_family, key);
+}
+
+Status TxnDB::Merge(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                    const rocksdb::Slice& key, const rocksdb::Slice& value) {
+  if (listener_) {
+    rocksdb::WriteBatch batch;
+    batch.Merge(column_family, key, value);
+    return Write(options, &batch);
+  }
+  auto txn = current();
+  return txn ? txn->batch.Merge(column_family, key, value) : db_->Merge(options, column_family, key, value);
+}
+
+Status TxnDB::Write(const rocksdb::WriteOptions& options, rocksdb::WriteBatch* updates) {
+  Written written;
+  Status s = tag(updates, listener_ ? &written : nullptr);
+  if (!s.ok()) {
+    return s;
+  }
+  auto txn = current();
+  if (!txn) {
+    s = db_->Write(options, updates);
+    if (s.ok()) {
+      notify(written);
+    }
+    return s;
+  }
+  BatchIndexer indexer(this, &txn->batch);
+  s = updates->Iterate(&indexer);
+  std::move(written.begin(), written.end(), std::back_inserter(txn->written));
+  return s;
+}
+
+const rocksdb::Snapshot* TxnDB::GetSnapshot() {
+  auto txn = current();
+  return txn ? txn->snapshot : db_->GetSnapshot();
+}
+
+void TxnDB::ReleaseSnapshot(const rocksdb::Snapshot* snapshot) {
+  auto txn = current();
+  if (txn && txn->snapshot == snapshot) {
+    return;
+  }
+  db_->ReleaseSnapshot(snapshot);
+}
+
+}  // namespace storage
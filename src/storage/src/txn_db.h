@@ -0,0 +1,127 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/utilities/stackable_db.h"
+#include "rocksdb/utilities/write_batch_with_index.h"
+
+#include "storage/storage_define.h"
+
+namespace storage {
+
+using rocksdb::Status;
+
+/**
+ * The DB of an instance, transactions of the calling thread on top of the base DB.
+ * Outside a transaction every call goes straight to the base DB. While the calling thread
+ * has one, its writes are indexed in a WriteBatchWithIndex, its reads see them on top of
+ * the snapshot taken at Begin, and Commit writes the whole batch at once.
+ * Other threads don't see the buffered writes, the caller keeps writers off the keys.
+ * Every write to the strings and meta column families carries the operand updating the
+ * type index of its key, in the same batch, see TypeIndex.
+ * The write listener is called with each key written once the write is visible to the
+ * other threads, for a transaction once it commits.
+ */
+class TxnDB : public rocksdb::StackableDB {
+ public:
+  // handles are the column families of db, filled by DB::Open
+  TxnDB(rocksdb::DB* db, const std::vector<rocksdb::ColumnFamilyHandle*>* handles);
+
+  using WriteListener = std::function<void(ColumnFamilyIndex, const rocksdb::Slice&)>;
+  // set before the DB is shared
+  void SetWriteListener(WriteListener listener) { listener_ = std::move(listener); }
+  bool InTransaction() const { return current() != nullptr; }
+  // the writes of the transaction of the calling thread, nullptr if it has none or wrote nothing
+  rocksdb::WriteBatch* Pending() const;
+
+  void Begin();
+  Status Commit(const rocksdb::WriteOptions& options);
+  void Rollback();
+
+  using rocksdb::StackableDB::Get;
+  Status Get(const rocksdb::ReadOptions& options, rocksdb::ColumnFamilyHandle* column_family, const rocksdb::Slice& key,
+             rocksdb::PinnableSlice* value) override;
+
+  using rocksdb::StackableDB::MultiGet;
+  std::vector<Status> MultiGet(const rocksdb::ReadOptions& options,
+                               const std::vector<rocksdb::ColumnFamilyHandle*>& column_families,
+                               const std::vector<rocksdb::Slice>& keys, std::vector<std::string>* values) override;
+  void MultiGet(const rocksdb::ReadOptions& options, rocksdb::ColumnFamilyHandle* column_family, size_t num_keys,
+                const rocksdb::Slice* keys, rocksdb::PinnableSlice* values, Status* statuses,
+                bool sorted_input = false) override;
+  void MultiGet(const rocksdb::ReadOptions& options, size_t num_keys, rocksdb::ColumnFamilyHandle** column_families,
+                const rocksdb::Slice* keys, rocksdb::PinnableSlice* values, Status* statuses,
+                bool sorted_input = false) override;
+
+  using rocksdb::StackableDB::NewIterator;
+  rocksdb::Iterator* NewIterator(const rocksdb::ReadOptions& options,
+                                 rocksdb::ColumnFamilyHandle* column_family) override;
+
+  using rocksdb::StackableDB::Put;
+  Status Put(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family, const rocksdb::Slice& key,
+             const rocksdb::Slice& value) override;
+
+  using rocksdb::StackableDB::Delete;
+  Status Delete(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                const rocksdb::Slice& key) override;
+
+  using rocksdb::StackableDB::SingleDelete;
+  Status SingleDelete(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                      const rocksdb::Slice& key) override;
+
+  using rocksdb::StackableDB::Merge;
+  Status Merge(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+               const rocksdb::Slice& key, const rocksdb::Slice& value) override;
+
+  Status Write(const rocksdb::WriteOptions& options, rocksdb::WriteBatch* updates) override;
+
+  // inside a transaction the snapshot of the transaction, releasing it is a no-op
+  const rocksdb::Snapshot* GetSnapshot() override;
+  void ReleaseSnapshot(const rocksdb::Snapshot* snapshot) override;
+
+ private:
+  // the keys of a write, with their column family
+  using Written = std::vector<std::pair<ColumnFamilyIndex, std::string>>;
+  struct Txn {
+    // overwrite_key, so iterators can merge the batch with the DB
+    rocksdb::WriteBatchWithIndex batch{rocksdb::BytewiseComparator(), 0, true};
+    const rocksdb::Snapshot* snapshot = nullptr;
+    // reported at commit
+    Written written;
+  };
+  using Txns = std::vector<std::pair<const TxnDB*, std::unique_ptr<Txn>>>;
+
+  // transaction of the calling thread on this DB, nullptr if none
+  Txn* current() const;
+  std::unique_ptr<Txn> release();
+  rocksdb::ReadOptions withSnapshot(const rocksdb::ReadOptions& options, const Txn* txn) const;
+  rocksdb::ColumnFamilyHandle* handleOf(uint32_t column_family_id) const;
+  // the ColumnFamilyIndex of a column family, -1 if unknown
+  int indexOf(const rocksdb::ColumnFamilyHandle* column_family) const;
+  bool typeIndexed(int cf) const;
+  // whether a single write to the column family goes through Write
+  bool batched(const rocksdb::ColumnFamilyHandle* column_family) const;
+  // appends the type index operands of the writes in updates to it, and collects the keys written
+  Status tag(rocksdb::WriteBatch* updates, Written* written) const;
+  void notify(const Written& written) const;
+
+  class BatchIndexer;
+  class BatchTagger;
+
+  const std::vector<rocksdb::ColumnFamilyHandle*>* handles_;
+  WriteListener listener_;
+  // transactions of the thread, one per TxnDB, null while it has none
+  static thread_local Txns* txns_;
+};
+
+}  // namespace storage
@@ -0,0 +1,158 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "src/type_index.h"
+
+#include <array>
+
+#include "rocksdb/env.h"
+
+#include "src/base_meta_value_format.h"
+#include "src/coding.h"
+#include "src/lists_meta_value_format.h"
+#include "src/strings_value_format.h"
+#include "storage/storage.h"
+
+namespace storage {
+
+namespace {
+
+// an operand is the type byte, followed by the expire time when it sets the type
+constexpr size_t kSetOperandSize = 1 + sizeof(uint64_t);
+
+struct IndexEntry {
+  uint8_t mask = 0;
+  std::array<uint64_t, 8> etimes{};
+
+  void Decode(const rocksdb::Slice& value) {
+    if (value.empty()) {
+      return;
+    }
+    const uint8_t types = static_cast<uint8_t>(value[0]);
+    size_t offset = 1;
+    for (int type = 0; type < 8; ++type) {
+      if (!(types & (1 << type)) || offset + sizeof(uint64_t) > value.size()) {
+        continue;
+      }
+      mask |= static_cast<uint8_t>(1 << type);
+      etimes[type] = DecodeFixed64(value.data() + offset);
+      offset += sizeof(uint64_t);
+    }
+  }
+
+  void Apply(const rocksdb::Slice& operand) {
+    if (operand.empty()) {
+      return;
+    }
+    const auto type = static_cast<uint8_t>(operand[0]) & 7;
+    if (operand.size() >= kSetOperandSize) {
+      mask |= static_cast<uint8_t>(1 << type);
+      etimes[type] = DecodeFixed64(operand.data() + 1);
+    } else {
+      mask &= static_cast<uint8_t>(~(1 << type));
+      etimes[type] = 0;
+    }
+  }
+
+  void Encode(std::string* value) const {
+    value->assign(1, static_cast<char>(mask));
+    char buf[sizeof(uint64_t)];
+    for (int type = 0; type < 8; ++type) {
+      if (mask & (1 << type)) {
+        EncodeFixed64(buf, etimes[type]);
+        value->append(buf, sizeof(buf));
+      }
+    }
+  }
+};
+
+}  // namespace
+
+bool TypeIndex::OperandOf(ColumnFamilyIndex cf, const rocksdb::Slice* value, std::string* operand) {
+  DataType type;
+  switch (cf) {
+    case kStringsCF:
+      type = kStrings;
+      break;
+    case kHashesMetaCF:
+      type = kHashes;
+      break;
+    case kSetsMetaCF:
+      type = kSets;
+      break;
+    case kListsMetaCF:
+      type = kLists;
+      break;
+    case kZsetsMetaCF:
+      type = kZSets;
+      break;
+    default:
+      return false;
+  }
+
+  operand->assign(1, static_cast<char>(type));
+  if (!value) {
+    return true;
+  }
+  uint64_t etime = 0;
+  if (type == kStrings) {
+    etime = ParsedStringsValue(*value).Etime();
+  } else if (type == kLists) {
+    ParsedListsMetaValue parsed_lists_meta_value(*value);
+    if (parsed_lists_meta_value.Count() == 0) {
+      return true;
+    }
+    etime = parsed_lists_meta_value.Etime();
+  } else {
+    ParsedBaseMetaValue parsed_meta_value(*value);
+    if (parsed_meta_value.Count() == 0) {
+      return true;
+    }
+    etime = parsed_meta_value.Etime();
+  }
+  char buf[sizeof(uint64_t)];
+  EncodeFixed64(buf, etime);
+  operand->append(buf, sizeof(buf));
+  return true;
+}
+
+uint8_t TypeIndex::LiveTypes(const rocksdb::Slice& value, uint64_t now) {
+  IndexEntry entry;
+  entry.Decode(value);
+  uint8_t live = 0;
+  for (int type = 0; type < 8; ++type) {
+    // stale like ParsedInternalValue::IsStale
+    if ((entry.mask & (1 << type)) && (entry.etimes[type] == 0 || entry.etimes[type] >= now)) {
+      live |= static_cast<uint8_t>(1 << type);
+    }
+  }
+  return live;
+}
+
+uint64_t TypeIndex::Now() {
+  int64_t unix_time;
+  rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+  return static_cast<uint64_t>(unix_time);
+}
+
+bool TypeIndexMergeOperator::FullMergeV2(const MergeOperationInput& merge_in,
+                                         MergeOperationOutput* merge_out) const {
+  IndexEntry entry;
+  if (merge_in.existing_value) {
+    entry.Decode(*merge_in.existing_value);
+  }
+  for (const auto& operand : merge_in.operand_list) {
+    entry.Apply(operand);
+  }
+  entry.Encode(&merge_out->new_value);
+  return true;
+}
+
+bool TypeIndexFilter::Filter(int level, const rocksdb::Slice& key, const rocksdb::Slice& value,
+                             std::string* new_value, bool* value_changed) const {
+  return !TypeIndex::IsReserved(key) && TypeIndex::LiveTypes(value, TypeIndex::Now()) == 0;
+}
+
+}  // namespace storage
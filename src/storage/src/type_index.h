@@ -0,0 +1,71 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "rocksdb/compaction_filter.h"
+#include "rocksdb/merge_operator.h"
+#include "rocksdb/slice.h"
+
+#include "storage/storage_define.h"
+
+namespace storage {
+
+/**
+ * The types each key of an instance has, so the keyspace commands find them with one lookup
+ * instead of probing the strings and the four meta column families.
+ * The index key is the meta key. The value is a mask of bits (1 << DataType) followed by the
+ * fixed64 expire time of each type in the mask, in ascending order, 0 if it has none.
+ * TxnDB tags every write to the indexed column families with a merge operand in the same
+ * batch: a live value sets its type with its expire time, a delete or an emptied meta
+ * clears it. A type found live may still have been dropped by the meta compaction filter,
+ * the meta read by the caller stays the authority.
+ */
+class TypeIndex {
+ public:
+  static constexpr char kColumnFamilyName[] = "type_index_cf";
+  // the records of the instance kept in the column family start with it, a meta key starts with its zeroed reserve1
+  static constexpr char kReservedPrefix[] = "\xff" "pikiwidb:";
+  static bool IsReserved(const rocksdb::Slice& key) { return key.starts_with(kReservedPrefix); }
+  // put once every key is indexed
+  static constexpr char kBuiltKey[] = "\xff" "pikiwidb:type_index_built";
+
+  static bool IsIndexed(ColumnFamilyIndex cf) {
+    return cf == kStringsCF || cf == kHashesMetaCF || cf == kSetsMetaCF || cf == kListsMetaCF || cf == kZsetsMetaCF;
+  }
+  // the operand for a write of value, nullptr for a delete, false if cf isn't indexed
+  static bool OperandOf(ColumnFamilyIndex cf, const rocksdb::Slice* value, std::string* operand);
+  // bits (1 << DataType) of the types of an index value not expired at now
+  static uint8_t LiveTypes(const rocksdb::Slice& value, uint64_t now);
+  static uint64_t Now();
+};
+
+class TypeIndexMergeOperator : public rocksdb::MergeOperator {
+ public:
+  bool FullMergeV2(const MergeOperationInput& merge_in, MergeOperationOutput* merge_out) const override;
+  const char* Name() const override { return "TypeIndexMergeOperator"; }
+};
+
+// drops the entries with no live type left
+class TypeIndexFilter : public rocksdb::CompactionFilter {
+ public:
+  bool Filter(int level, const rocksdb::Slice& key, const rocksdb::Slice& value, std::string* new_value,
+              bool* value_changed) const override;
+  const char* Name() const override { return "TypeIndexFilter"; }
+};
+
+class TypeIndexFilterFactory : public rocksdb::CompactionFilterFactory {
+ public:
+  std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
+      const rocksdb::CompactionFilter::Context& context) override {
+    return std::make_unique<TypeIndexFilter>();
+  }
+  const char* Name() const override { return "TypeIndexFilterFactory"; }
+};
+
+}  // namespace storage
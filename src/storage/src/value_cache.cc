@@ -0,0 +1,197 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "src/value_cache.h"
+
+#include <algorithm>
+
+#include "rocksdb/env.h"
+
+namespace storage {
+
+// per entry, the list node, the index slot and the value struct
+static constexpr size_t kEntryOverhead = 128;
+// a shard doesn't spend more than this part of its memory on one value
+static constexpr size_t kMaxChargeShare = 8;
+// lookups of a key in the sketch window before its whole collection is worth reading
+static constexpr uint8_t kFrequentLookups = 2;
+
+static uint64_t HashOf(std::string_view key) { return std::hash<std::string_view>()(key); }
+
+ValueCache::FrequencySketch::FrequencySketch(size_t width) : table_(width, 0), mask_(width - 1) {}
+
+size_t ValueCache::FrequencySketch::indexOf(uint64_t hash, int row) const {
+  static constexpr uint64_t kSeeds[kDepth] = {0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL,
+                                              0xd6e8feb86659fd93ULL};
+  uint64_t h = (hash + kSeeds[row]) * 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 31;
+  return h & mask_;
+}
+
+void ValueCache::FrequencySketch::Add(uint64_t hash) {
+  for (int row = 0; row < kDepth; ++row) {
+    auto& counter = table_[indexOf(hash, row)];
+    if (counter < 15) {
+      ++counter;
+    }
+  }
+  // aging, so keys hot long ago don't keep the new ones out
+  if (++additions_ >= table_.size() * 10) {
+    for (auto& counter : table_) {
+      counter >>= 1;
+    }
+    additions_ /= 2;
+  }
+}
+
+uint8_t ValueCache::FrequencySketch::Estimate(uint64_t hash) const {
+  uint8_t estimate = 15;
+  for (int row = 0; row < kDepth; ++row) {
+    estimate = std::min(estimate, table_[indexOf(hash, row)]);
+  }
+  return estimate;
+}
+
+ValueCache::ValueCache(size_t capacity, size_t shard_num) : capacity_(capacity) {
+  shards_.reserve(shard_num);
+  for (size_t i = 0; i < shard_num; ++i) {
+    shards_.emplace_back(std::make_unique<Shard>(capacity / shard_num));
+  }
+}
+
+std::string ValueCache::KeyOf(DataType type, const Slice& key) {
+  std::string cache_key;
+  cache_key.reserve(key.size() + 1);
+  cache_key.append(1, DataTypeTag[type]);
+  cache_key.append(key.data(), key.size());
+  return cache_key;
+}
+
+size_t ValueCache::chargeOf(const std::string& key, const CachedValue& value) {
+  size_t charge = kEntryOverhead + key.size() + value.value.size();
+  for (const auto& fv : value.fields) {
+    charge += fv.field.size() + fv.value.size() + sizeof(FieldValue);
+  }
+  return charge;
+}
+
+void ValueCache::erase(Shard& shard, std::list<Node>::iterator it) {
+  shard.charge -= it->charge;
+  used_memory_.fetch_sub(it->charge, std::memory_order_relaxed);
+  entries_.fetch_sub(1, std::memory_order_relaxed);
+  shard.index.erase(it->key);
+  shard.lru.erase(it);
+}
+
+bool ValueCache::Lookup(const std::string& key, const std::function<void(const CachedValue&)>& read,
+                        uint64_t* ticket) {
+  const auto hash = HashOf(key);
+  auto& shard = shardOf(hash);
+  std::lock_guard lock(shard.mutex);
+  shard.sketch.Add(hash);
+
+  auto found = shard.index.find(key);
+  if (found != shard.index.end()) {
+    auto it = found->second;
+    int64_t now;
+    rocksdb::Env::Default()->GetCurrentTime(&now);
+    // stale like ParsedInternalValue::IsStale
+    if (it->value.etime == 0 || it->value.etime >= static_cast<uint64_t>(now)) {
+      shard.lru.splice(shard.lru.begin(), shard.lru, it);
+      read(it->value);
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    erase(shard, it);
+  }
+  *ticket = shard.epoch;
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+bool ValueCache::Peek(const std::string& key, const std::function<void(const CachedValue&)>& read) {
+  auto& shard = shardOf(HashOf(key));
+  std::lock_guard lock(shard.mutex);
+  auto found = shard.index.find(key);
+  if (found == shard.index.end()) {
+    return false;
+  }
+  int64_t now;
+  rocksdb::Env::Default()->GetCurrentTime(&now);
+  const auto& value = found->second->value;
+  if (value.etime != 0 && value.etime < static_cast<uint64_t>(now)) {
+    return false;
+  }
+  read(value);
+  return true;
+}
+
+void ValueCache::Insert(const std::string& key, CachedValue value, uint64_t ticket) {
+  const auto hash = HashOf(key);
+  auto& shard = shardOf(hash);
+  const auto charge = chargeOf(key, value);
+  std::lock_guard lock(shard.mutex);
+  if (shard.epoch != ticket) {
+    return;
+  }
+  if (charge > shard.capacity / kMaxChargeShare) {
+    rejects_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  if (auto found = shard.index.find(key); found != shard.index.end()) {
+    erase(shard, found->second);
+  }
+
+  const auto frequency = shard.sketch.Estimate(hash);
+  while (shard.charge + charge > shard.capacity) {
+    auto victim = std::prev(shard.lru.end());
+    if (frequency <= shard.sketch.Estimate(HashOf(victim->key))) {
+      rejects_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    erase(shard, victim);
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  shard.lru.push_front(Node{key, std::move(value), charge});
+  shard.index.emplace(shard.lru.front().key, shard.lru.begin());
+  shard.charge += charge;
+  used_memory_.fetch_add(charge, std::memory_order_relaxed);
+  entries_.fetch_add(1, std::memory_order_relaxed);
+  inserts_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ValueCache::Invalidate(const std::string& key) {
+  auto& shard = shardOf(HashOf(key));
+  std::lock_guard lock(shard.mutex);
+  ++shard.epoch;
+  if (auto found = shard.index.find(key); found != shard.index.end()) {
+    erase(shard, found->second);
+    invalidations_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+bool ValueCache::Frequent(const std::string& key) {
+  const auto hash = HashOf(key);
+  auto& shard = shardOf(hash);
+  std::lock_guard lock(shard.mutex);
+  return shard.sketch.Estimate(hash) >= kFrequentLookups;
+}
+
+ValueCache::Stats ValueCache::GetStats() const {
+  Stats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.inserts = inserts_.load(std::memory_order_relaxed);
+  stats.rejects = rejects_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  stats.invalidations = invalidations_.load(std::memory_order_relaxed);
+  stats.entries = entries_.load(std::memory_order_relaxed);
+  stats.used_memory = used_memory_.load(std::memory_order_relaxed);
+  stats.capacity = capacity_;
+  return stats;
+}
+
+}  // namespace storage
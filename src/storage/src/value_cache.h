@@ -0,0 +1,120 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "storage/storage.h"
+
+namespace storage {
+
+// a decoded value with its absolute expire time in seconds, 0 if it has none
+struct CachedValue {
+  std::string value;               // strings, or a meta value
+  std::vector<FieldValue> fields;  // hashes, ordered by field like the data keys
+  uint64_t etime = 0;
+};
+
+/**
+ * Hot decoded values of an instance, the strings and the small hashes, in front of RocksDB.
+ * Another one holds the meta values of the collections, in value.
+ * Sharded by key, each shard an LRU bounded by its share of the memory. A new value only
+ * displaces the LRU victim when a TinyLFU sketch of the recent lookups saw its key more
+ * often, so a scan of cold keys doesn't flush the hot ones.
+ * Writes invalidate the key once they are visible. A reader filling the cache after a miss
+ * holds the ticket Lookup gave it, its fill is dropped if its shard had an invalidation since,
+ * since the value it read may be older than that write.
+ */
+class ValueCache {
+ public:
+  // hashes with more fields aren't cached
+  static constexpr size_t kMaxFields = 16;
+
+  using Stats = ValueCacheStats;
+
+  explicit ValueCache(size_t capacity, size_t shard_num = 64);
+  ValueCache(const ValueCache&) = delete;
+  void operator=(const ValueCache&) = delete;
+
+  static std::string KeyOf(DataType type, const Slice& key);
+
+  // calls read with the value of key while it is locked; on a miss sets *ticket for Insert
+  bool Lookup(const std::string& key, const std::function<void(const CachedValue&)>& read, uint64_t* ticket);
+  // calls read like Lookup on a hit, but leaves the recency, the frequency and the stats alone
+  bool Peek(const std::string& key, const std::function<void(const CachedValue&)>& read);
+  void Insert(const std::string& key, CachedValue value, uint64_t ticket);
+  void Invalidate(const std::string& key);
+  // whether key was looked up often enough lately to be worth reading a whole collection for
+  bool Frequent(const std::string& key);
+
+  Stats GetStats() const;
+
+ private:
+  // count-min sketch of 4-bit counters, halved once the additions reach 10 times its width
+  class FrequencySketch {
+   public:
+    explicit FrequencySketch(size_t width);
+    void Add(uint64_t hash);
+    uint8_t Estimate(uint64_t hash) const;
+
+   private:
+    static constexpr int kDepth = 4;
+    size_t indexOf(uint64_t hash, int row) const;
+
+    std::vector<uint8_t> table_;
+    size_t mask_;
+    size_t additions_ = 0;
+  };
+
+  struct Node {
+    std::string key;
+    CachedValue value;
+    size_t charge;
+  };
+
+  struct Shard {
+    // a counter for about each entry the shard may hold
+    explicit Shard(size_t capacity)
+        : capacity(capacity), sketch(std::bit_ceil(std::clamp<size_t>(capacity / 256, 1024, 1 << 22))) {}
+
+    std::mutex mutex;
+    std::list<Node> lru;  // most recent first
+    std::unordered_map<std::string_view, std::list<Node>::iterator> index;
+    size_t capacity;
+    size_t charge = 0;
+    uint64_t epoch = 0;  // invalidations
+    FrequencySketch sketch;
+  };
+
+  static size_t chargeOf(const std::string& key, const CachedValue& value);
+  Shard& shardOf(uint64_t hash) { return *shards_[hash % shards_.size()]; }
+  void erase(Shard& shard, std::list<Node>::iterator it);
+
+  const size_t capacity_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> inserts_{0};
+  std::atomic<uint64_t> rejects_{0};
+  std::atomic<uint64_t> evictions_{0};
+  std::atomic<uint64_t> invalidations_{0};
+  std::atomic<uint64_t> entries_{0};
+  std::atomic<uint64_t> used_memory_{0};
+};
+
+}  // namespace storage
@@ -0,0 +1,476 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "src/zsets_rank_index.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+
+#include "src/coding.h"
+#include "src/zsets_data_key_format.h"
+
+namespace storage {
+
+static constexpr uint64_t kSignBit = uint64_t(1) << 63;
+
+std::string ZSetsRankIndex::PosOf(double score, const Slice& member) {
+  // -0.0 sorts with 0.0 in the score keys
+  if (score == 0) {
+    score = 0;
+  }
+  uint64_t bits;
+  memcpy(&bits, &score, sizeof(bits));
+  bits = (bits & kSignBit) != 0 ? ~bits : bits | kSignBit;
+  std::string pos(sizeof(bits), '\0');
+  for (size_t i = 0; i < sizeof(bits); ++i) {
+    pos[i] = static_cast<char>(bits >> (56 - 8 * i));
+  }
+  pos.append(member.data(), member.size());
+  return pos;
+}
+
+std::string ZSetsRankIndex::PosOfScoreKey(const Slice& score_key) {
+  ParsedZSetsScoreKey parsed_zsets_score_key(score_key);
+  return PosOf(parsed_zsets_score_key.score(), parsed_zsets_score_key.member());
+}
+
+ZSetsRankIndex::ZSetsRankIndex(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* score_cf,
+                               rocksdb::ColumnFamilyHandle* rank_cf, const rocksdb::ReadOptions& read_options,
+                               const Slice& key, uint64_t version)
+    : db_(db),
+      score_cf_(score_cf),
+      rank_cf_(rank_cf),
+      read_options_(read_options),
+      key_(key.ToString()),
+      version_(version) {
+  size_t nzero = std::count(key.data(), key.data() + key.size(), kNeedTransformCharacter);
+  prefix_.assign(kPrefixReserveLength + key.size() + nzero + kEncodedKeyDelimSize + kVersionLength, '\0');
+  char* dst = EncodeUserKey(key, prefix_.data() + kPrefixReserveLength, nzero);
+  EncodeFixed64(dst, version);
+}
+
+std::string ZSetsRankIndex::levelPrefix(int level) const {
+  std::string prefix(prefix_);
+  prefix.append(1, static_cast<char>(level));
+  return prefix;
+}
+
+std::string ZSetsRankIndex::keyOf(int level, const std::string& pos) const {
+  std::string key = levelPrefix(level);
+  key.append(pos);
+  key.append(kSuffixReserveLength, '\0');
+  return key;
+}
+
+std::string ZSetsRankIndex::valueOf(const Block& block) const {
+  char buf[2 * sizeof(uint64_t)];
+  EncodeFixed64(buf, block.count);
+  EncodeFixed64(buf + sizeof(uint64_t), block.children);
+  return {buf, sizeof(buf)};
+}
+
+bool ZSetsRankIndex::parse(const rocksdb::Iterator* iter, int level, Block* block) const {
+  if (!iter->Valid()) {
+    return false;
+  }
+  const auto prefix = levelPrefix(level);
+  const Slice key = iter->key();
+  const Slice value = iter->value();
+  if (!key.starts_with(prefix) || key.size() < prefix.size() + kSuffixReserveLength ||
+      value.size() < 2 * sizeof(uint64_t)) {
+    return false;
+  }
+  block->pos.assign(key.data() + prefix.size(), key.size() - prefix.size() - kSuffixReserveLength);
+  block->count = DecodeFixed64(value.data());
+  block->children = DecodeFixed64(value.data() + sizeof(uint64_t));
+  return true;
+}
+
+rocksdb::Iterator* ZSetsRankIndex::newIterator(rocksdb::ColumnFamilyHandle* cf) const {
+  return db_->NewIterator(read_options_, cf);
+}
+
+std::string ZSetsRankIndex::scoreKeyOf(const std::string& pos) const {
+  if (pos.empty()) {
+    ZSetsScoreKey zsets_score_key(key_, version_, -std::numeric_limits<double>::infinity(), Slice());
+    return zsets_score_key.Encode().ToString();
+  }
+  uint64_t bits = 0;
+  for (size_t i = 0; i < sizeof(bits); ++i) {
+    bits = (bits << 8) | static_cast<uint8_t>(pos[i]);
+  }
+  bits = (bits & kSignBit) != 0 ? bits & ~kSignBit : ~bits;
+  double score;
+  memcpy(&score, &bits, sizeof(score));
+  ZSetsScoreKey zsets_score_key(key_, version_, score, Slice(pos.data() + sizeof(bits), pos.size() - sizeof(bits)));
+  return zsets_score_key.Encode().ToString();
+}
+
+Status ZSetsRankIndex::Load() {
+  std::unique_ptr<rocksdb::Iterator> iter(newIterator(rank_cf_));
+  iter->SeekForPrev(prefix_ + "\xff");
+  if (!iter->Valid() || !iter->key().starts_with(prefix_) || iter->key().size() <= prefix_.size()) {
+    return iter->status().ok() ? Status::NotFound() : iter->status();
+  }
+  top_ = static_cast<uint8_t>(iter->key()[prefix_.size()]);
+  Block root;
+  if (!parse(iter.get(), top_, &root) || !root.pos.empty()) {
+    return Status::Corruption("zset rank index without root");
+  }
+  count_ = root.count;
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::Rank(const std::string& pos, uint64_t* rank) {
+  *rank = 0;
+  // the block holding pos at each level, from the root down
+  std::string start;
+  for (int level = top_; level > 0; --level) {
+    std::unique_ptr<rocksdb::Iterator> iter(newIterator(rank_cf_));
+    iter->Seek(keyOf(level - 1, start));
+    Block cur;
+    Block next;
+    if (!parse(iter.get(), level - 1, &cur)) {
+      return iter->status().ok() ? Status::Corruption("zset rank index missing block") : iter->status();
+    }
+    for (iter->Next(); parse(iter.get(), level - 1, &next) && next.pos <= pos; iter->Next()) {
+      *rank += cur.count;
+      cur = std::move(next);
+    }
+    if (!iter->status().ok()) {
+      return iter->status();
+    }
+    start = std::move(cur.pos);
+  }
+
+  std::unique_ptr<rocksdb::Iterator> iter(newIterator(score_cf_));
+  for (iter->Seek(scoreKeyOf(start)); iter->Valid() && iter->key().starts_with(prefix_); iter->Next()) {
+    if (PosOfScoreKey(iter->key()) >= pos) {
+      break;
+    }
+    ++*rank;
+  }
+  return iter->status();
+}
+
+Status ZSetsRankIndex::Below(double score, bool inclusive, uint64_t* rank) {
+  if (inclusive) {
+    if (score == std::numeric_limits<double>::infinity()) {
+      *rank = count_;
+      return Status::OK();
+    }
+    score = std::nextafter(score, std::numeric_limits<double>::infinity());
+  }
+  return Rank(PosOf(score, Slice()), rank);
+}
+
+Status ZSetsRankIndex::Select(uint64_t rank, std::string* score_key) {
+  if (rank >= count_) {
+    return Status::NotFound();
+  }
+  std::string start;
+  for (int level = top_; level > 0; --level) {
+    std::unique_ptr<rocksdb::Iterator> iter(newIterator(rank_cf_));
+    Block block;
+    bool found = false;
+    for (iter->Seek(keyOf(level - 1, start)); parse(iter.get(), level - 1, &block); iter->Next()) {
+      if (rank < block.count) {
+        found = true;
+        break;
+      }
+      rank -= block.count;
+    }
+    if (!found) {
+      return iter->status().ok() ? Status::NotFound() : iter->status();
+    }
+    start = std::move(block.pos);
+  }
+
+  std::unique_ptr<rocksdb::Iterator> iter(newIterator(score_cf_));
+  for (iter->Seek(scoreKeyOf(start)); iter->Valid() && iter->key().starts_with(prefix_); iter->Next()) {
+    if (rank-- == 0) {
+      score_key->assign(iter->key().data(), iter->key().size());
+      return Status::OK();
+    }
+  }
+  return iter->status().ok() ? Status::NotFound() : iter->status();
+}
+
+Status ZSetsRankIndex::Build(rocksdb::WriteBatch* batch) {
+  // blocks of kFanout, so they grow a while before splitting
+  std::vector<Block> blocks(1);
+  count_ = 0;
+  std::unique_ptr<rocksdb::Iterator> iter(newIterator(score_cf_));
+  for (iter->Seek(scoreKeyOf("")); iter->Valid() && iter->key().starts_with(prefix_); iter->Next()) {
+    if (blocks.back().count == kFanout) {
+      blocks.push_back(Block{PosOfScoreKey(iter->key()), 0, 0});
+    }
+    blocks.back().children = ++blocks.back().count;
+    ++count_;
+  }
+  if (!iter->status().ok()) {
+    return iter->status();
+  }
+
+  int level = 0;
+  for (;; ++level) {
+    for (const auto& block : blocks) {
+      batch->Put(rank_cf_, keyOf(level, block.pos), valueOf(block));
+    }
+    if (blocks.size() == 1) {
+      break;
+    }
+    std::vector<Block> upper;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      if (i % kFanout == 0) {
+        upper.push_back(Block{std::move(blocks[i].pos), 0, 0});
+      }
+      upper.back().count += blocks[i].count;
+      ++upper.back().children;
+    }
+    blocks.swap(upper);
+  }
+  top_ = level;
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::blockOf(int level, const std::string& pos, Block* block) const {
+  std::unique_ptr<rocksdb::Iterator> iter(newIterator(rank_cf_));
+  iter->SeekForPrev(keyOf(level, pos));
+  if (!parse(iter.get(), level, block)) {
+    return iter->status().ok() ? Status::Corruption("zset rank index missing block") : iter->status();
+  }
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::blockBefore(int level, const std::string& pos, Block* block) const {
+  std::unique_ptr<rocksdb::Iterator> iter(newIterator(rank_cf_));
+  iter->SeekForPrev(keyOf(level, pos));
+  if (iter->Valid()) {
+    iter->Prev();
+  }
+  if (!parse(iter.get(), level, block)) {
+    return iter->status().ok() ? Status::Corruption("zset rank index missing block") : iter->status();
+  }
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::get(int level, const std::string& pos, Block* block) const {
+  std::string value;
+  Status s = db_->Get(read_options_, rank_cf_, keyOf(level, pos), &value);
+  if (!s.ok()) {
+    return s;
+  }
+  if (value.size() < 2 * sizeof(uint64_t)) {
+    return Status::Corruption("zset rank index bad block");
+  }
+  block->pos = pos;
+  block->count = DecodeFixed64(value.data());
+  block->children = DecodeFixed64(value.data() + sizeof(uint64_t));
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::nextStart(int level, const std::string& pos, std::optional<std::string>* next) const {
+  std::unique_ptr<rocksdb::Iterator> iter(newIterator(rank_cf_));
+  const auto key = keyOf(level, pos);
+  iter->Seek(key);
+  if (iter->Valid() && iter->key() == key) {
+    iter->Next();
+  }
+  Block block;
+  if (parse(iter.get(), level, &block)) {
+    *next = std::move(block.pos);
+  } else {
+    next->reset();
+  }
+  return iter->status();
+}
+
+Status ZSetsRankIndex::itemsOf(int level, const std::string& pos, const std::optional<std::string>& end,
+                               std::vector<std::pair<std::string, uint64_t>>* items) const {
+  if (level == 0) {
+    std::unique_ptr<rocksdb::Iterator> iter(newIterator(score_cf_));
+    for (iter->Seek(scoreKeyOf(pos)); iter->Valid() && iter->key().starts_with(prefix_); iter->Next()) {
+      auto member_pos = PosOfScoreKey(iter->key());
+      if (end && member_pos >= *end) {
+        break;
+      }
+      items->emplace_back(std::move(member_pos), 1);
+    }
+    return iter->status();
+  }
+
+  std::unique_ptr<rocksdb::Iterator> iter(newIterator(rank_cf_));
+  Block block;
+  for (iter->Seek(keyOf(level - 1, pos)); parse(iter.get(), level - 1, &block); iter->Next()) {
+    if (end && block.pos >= *end) {
+      break;
+    }
+    items->emplace_back(std::move(block.pos), block.count);
+  }
+  return iter->status();
+}
+
+Status ZSetsRankIndex::Apply(const std::vector<std::pair<std::string, int64_t>>& deltas, rocksdb::WriteBatch* batch,
+                             std::vector<std::string>* touched) {
+  // the blocks are only counted here, the ones already changed are counted on from there
+  std::map<std::pair<int, std::string>, Block> changed;
+  for (int level = 0; level <= top_; ++level) {
+    std::unique_ptr<rocksdb::Iterator> iter(newIterator(rank_cf_));
+    for (const auto& [pos, delta] : deltas) {
+      Block block;
+      iter->SeekForPrev(keyOf(level, pos));
+      if (!parse(iter.get(), level, &block)) {
+        return iter->status().ok() ? Status::Corruption("zset rank index missing block") : iter->status();
+      }
+      auto it = changed.find({level, block.pos});
+      if (it == changed.end()) {
+        it = changed.emplace(std::make_pair(level, block.pos), std::move(block)).first;
+      }
+      auto& counted = it->second;
+      counted.count = delta < 0 && static_cast<uint64_t>(-delta) > counted.count ? 0 : counted.count + delta;
+      if (level == 0) {
+        counted.children = counted.count;
+      }
+    }
+  }
+
+  for (const auto& [level_pos, block] : changed) {
+    batch->Put(rank_cf_, keyOf(level_pos.first, block.pos), valueOf(block));
+    if (level_pos.first == 0 && (block.count > 2 * kFanout || (block.count == 0 && !block.pos.empty()))) {
+      touched->push_back(block.pos);
+    }
+  }
+  return Status::OK();
+}
+
+Status ZSetsRankIndex::Rebalance(const std::vector<std::string>& touched, const rocksdb::WriteOptions& options) {
+  Work work;
+  for (const auto& pos : touched) {
+    work.emplace_back(0, pos);
+  }
+  while (!work.empty()) {
+    auto [level, pos] = std::move(work.back());
+    work.pop_back();
+    Block block;
+    Status s = get(level, pos, &block);
+    if (s.IsNotFound()) {
+      // merged away by an earlier step
+      continue;
+    }
+    if (s.ok() && level == 0 && block.count == 0 && !block.pos.empty()) {
+      s = remove(pos, options, &work);
+    } else if (s.ok() && block.children > 2 * kFanout) {
+      s = split(level, block, options, &work);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+  }
+
+  // a root over a single block gives way to it
+  rocksdb::WriteBatch batch;
+  while (top_ > 0) {
+    Block root;
+    Status s = get(top_, "", &root);
+    if (!s.ok()) {
+      return s;
+    }
+    if (root.children > 1) {
+      break;
+    }
+    batch.Delete(rank_cf_, keyOf(top_, ""));
+    --top_;
+  }
+  return batch.Count() == 0 ? Status::OK() : db_->Write(options, &batch);
+}
+
+Status ZSetsRankIndex::split(int level, const Block& block, const rocksdb::WriteOptions& options, Work* work) {
+  std::optional<std::string> end;
+  std::vector<std::pair<std::string, uint64_t>> items;
+  Status s = nextStart(level, block.pos, &end);
+  if (s.ok()) {
+    s = itemsOf(level, block.pos, end, &items);
+  }
+  if (!s.ok() || items.size() <= 2 * kFanout) {
+    return s;
+  }
+
+  rocksdb::WriteBatch batch;
+  const size_t pieces = items.size() / kFanout;
+  uint64_t total = 0;
+  size_t next = 0;
+  for (size_t i = 0; i < pieces; ++i) {
+    const size_t size = items.size() / pieces + (i < items.size() % pieces ? 1 : 0);
+    Block piece{i == 0 ? block.pos : items[next].first, 0, size};
+    for (size_t j = next; j < next + size; ++j) {
+      piece.count += items[j].second;
+    }
+    next += size;
+    total += piece.count;
+    batch.Put(rank_cf_, keyOf(level, piece.pos), valueOf(piece));
+  }
+
+  int top = top_;
+  if (level == top_) {
+    batch.Put(rank_cf_, keyOf(level + 1, ""), valueOf(Block{"", total, pieces}));
+    top = level + 1;
+  } else {
+    Block parent;
+    s = blockOf(level + 1, block.pos, &parent);
+    if (!s.ok()) {
+      return s;
+    }
+    parent.children += pieces - 1;
+    batch.Put(rank_cf_, keyOf(level + 1, parent.pos), valueOf(parent));
+    if (parent.children > 2 * kFanout) {
+      work->emplace_back(level + 1, parent.pos);
+    }
+  }
+  s = db_->Write(options, &batch);
+  if (s.ok()) {
+    top_ = top;
+  }
+  return s;
+}
+
+Status ZSetsRankIndex::remove(const std::string& pos, const rocksdb::WriteOptions& options, Work* work) {
+  rocksdb::WriteBatch batch;
+  // the blocks starting at pos merge into the ones before them, up to the level where pos starts none
+  for (int level = 0; level <= top_; ++level) {
+    Block block;
+    Status s = get(level, pos, &block);
+    if (s.IsNotFound()) {
+      Block parent;
+      s = blockOf(level, pos, &parent);
+      if (!s.ok()) {
+        return s;
+      }
+      parent.children -= parent.children > 0 ? 1 : 0;
+      batch.Put(rank_cf_, keyOf(level, parent.pos), valueOf(parent));
+      break;
+    }
+    Block prev;
+    if (s.ok()) {
+      s = blockBefore(level, pos, &prev);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+    prev.count += block.count;
+    prev.children += level == 0 ? block.count : block.children - 1;
+    batch.Put(rank_cf_, keyOf(level, prev.pos), valueOf(prev));
+    batch.Delete(rank_cf_, keyOf(level, pos));
+    if (prev.children > 2 * kFanout) {
+      work->emplace_back(level, prev.pos);
+    }
+  }
+  return db_->Write(options, &batch);
+}
+
+}  // namespace storage
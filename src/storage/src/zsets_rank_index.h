@@ -0,0 +1,115 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/write_batch.h"
+
+#include "storage/storage_define.h"
+
+namespace storage {
+
+using Status = rocksdb::Status;
+
+/**
+ * Order statistics of a zset version, so a rank or an offset is found without walking its
+ * score keys from the first one.
+ * The members, in score order, are cut into counted blocks. A level 0 block starts at a member
+ * and counts the members up to the next block; a block of level l + 1 starts at a block of
+ * level l and counts the members of its blocks. The first block of each level starts before
+ * every member, the top level is that block alone. A rank is found walking down from the top,
+ * reading at most 2 * kFanout blocks per level, then as many score keys.
+ * Key: | reserve1 | key | version | level | score | member | reserve2 |, with the score encoded
+ * to sort bytewise and the first block of a level without score nor member, so the data filter
+ * of the zsets drops the blocks of the old versions. Value: the fixed64 count of members, then
+ * the fixed64 count of blocks one level down, the count again at level 0.
+ * Each batch writing score keys updates the counts of the blocks over them, see
+ * Redis::writeZsets. Splitting the blocks grown past 2 * kFanout and dropping the emptied ones
+ * come after, each step in a batch of its own which keeps the counts.
+ */
+class ZSetsRankIndex {
+ public:
+  static constexpr char kColumnFamilyName[] = "zset_rank_cf";
+  static constexpr uint64_t kFanout = 64;
+
+  // where a member sorts among the members, "" before every member
+  static std::string PosOf(double score, const Slice& member);
+  static std::string PosOfScoreKey(const Slice& score_key);
+
+  ZSetsRankIndex(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* score_cf, rocksdb::ColumnFamilyHandle* rank_cf,
+                 const rocksdb::ReadOptions& read_options, const Slice& key, uint64_t version);
+
+  // NotFound if the version has no index yet
+  Status Load();
+  // the members indexed, once loaded
+  uint64_t Count() const { return count_; }
+  // the number of members sorting before pos
+  Status Rank(const std::string& pos, uint64_t* rank);
+  // the number of members scored below score, or up to it when inclusive
+  Status Below(double score, bool inclusive, uint64_t* rank);
+  // the score key of the member at rank, NotFound past the last member
+  Status Select(uint64_t rank, std::string* score_key);
+
+  // indexes the members the version has, when it has no index yet
+  Status Build(rocksdb::WriteBatch* batch);
+  // adds to the blocks over each pos the members inserted (> 0) or removed (< 0) there,
+  // and the level 0 blocks changed to touched
+  Status Apply(const std::vector<std::pair<std::string, int64_t>>& deltas, rocksdb::WriteBatch* batch,
+               std::vector<std::string>* touched);
+  // once the batch of Apply is written, splits the touched blocks grown too large and drops the empty ones
+  Status Rebalance(const std::vector<std::string>& touched, const rocksdb::WriteOptions& options);
+
+ private:
+  struct Block {
+    std::string pos;
+    uint64_t count = 0;
+    uint64_t children = 0;
+  };
+
+  std::string keyOf(int level, const std::string& pos) const;
+  std::string levelPrefix(int level) const;
+  std::string valueOf(const Block& block) const;
+  // the block of the entry the iterator is at, false past the level
+  bool parse(const rocksdb::Iterator* iter, int level, Block* block) const;
+  rocksdb::Iterator* newIterator(rocksdb::ColumnFamilyHandle* cf) const;
+  // the score key a level 0 block at pos starts its members from
+  std::string scoreKeyOf(const std::string& pos) const;
+
+  // the block of level holding pos
+  Status blockOf(int level, const std::string& pos, Block* block) const;
+  Status get(int level, const std::string& pos, Block* block) const;
+  // the block of level before the one at pos
+  Status blockBefore(int level, const std::string& pos, Block* block) const;
+  // the start of the block of level after the one at pos, none for the last
+  Status nextStart(int level, const std::string& pos, std::optional<std::string>* next) const;
+  // the members, or the blocks one level down, in [pos, end) with their counts
+  Status itemsOf(int level, const std::string& pos, const std::optional<std::string>& end,
+                 std::vector<std::pair<std::string, uint64_t>>* items) const;
+
+  // the blocks of a level to check, with their start
+  using Work = std::vector<std::pair<int, std::string>>;
+  Status split(int level, const Block& block, const rocksdb::WriteOptions& options, Work* work);
+  Status remove(const std::string& pos, const rocksdb::WriteOptions& options, Work* work);
+
+  rocksdb::DB* db_;
+  rocksdb::ColumnFamilyHandle* score_cf_;
+  rocksdb::ColumnFamilyHandle* rank_cf_;
+  rocksdb::ReadOptions read_options_;
+  std::string key_;
+  uint64_t version_;
+  // | reserve1 | key | version |, the score keys of the version start alike
+  std::string prefix_;
+  int top_ = -1;
+  uint64_t count_ = 0;
+};
+
+}  // namespace storage
@@ -0,0 +1,132 @@
+// Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/base_data_value_format.h"
+#include "src/base_key_format.h"
+#include "src/lists_data_key_format.h"
+#include "src/lists_meta_value_format.h"
+#include "src/redis.h"
+#include "storage/storage.h"
+
+using storage::BaseDataValue;
+using storage::BaseMetaKey;
+using storage::ListsDataKey;
+using storage::ListsMetaValue;
+using storage::Storage;
+using storage::StorageOptions;
+
+// the list written as the releases before chunking did: an element per data record, the count alone in the meta value
+static void PutLegacyList(Storage* db, const std::string& key, const std::vector<std::string>& values) {
+  auto& inst = db->GetDBInstance(key);
+  char str[sizeof(uint64_t)];
+  storage::EncodeFixed64(str, values.size());
+  ListsMetaValue lists_meta_value(rocksdb::Slice(str, sizeof(uint64_t)));
+  uint64_t version = lists_meta_value.UpdateVersion();
+  rocksdb::WriteBatch batch;
+  for (const auto& value : values) {
+    ListsDataKey lists_data_key(key, version, lists_meta_value.RightIndex());
+    BaseDataValue i_val(value);
+    batch.Put(inst->GetColumnFamilyHandle(storage::kListsDataCF), lists_data_key.Encode(), i_val.Encode());
+    lists_meta_value.ModifyRightIndex(1);
+  }
+  BaseMetaKey base_meta_key(key);
+  batch.Put(inst->GetColumnFamilyHandle(storage::kListsMetaCF), base_meta_key.Encode(), lists_meta_value.Encode());
+  ASSERT_TRUE(inst->GetDB()->Write(rocksdb::WriteOptions(), &batch).ok());
+}
+
+class ListsLegacyTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = std::filesystem::temp_directory_path() / ("storage_lists_legacy_" + std::to_string(::getpid()));
+    std::filesystem::remove_all(path_);
+    Open();
+  }
+  void TearDown() override {
+    db_.reset();
+    std::filesystem::remove_all(path_);
+  }
+
+  void Open() {
+    db_.reset();
+    StorageOptions storage_options;
+    storage_options.options.create_if_missing = true;
+    storage_options.db_instance_num = 3;
+    storage_options.db_id = 0;
+    db_ = std::make_unique<Storage>();
+    ASSERT_TRUE(db_->Open(storage_options, path_.string()).ok());
+  }
+
+  std::vector<std::string> Range(const std::string& key) {
+    std::vector<std::string> elements;
+    EXPECT_TRUE(db_->LRange(key, 0, -1, &elements).ok());
+    return elements;
+  }
+
+  std::filesystem::path path_;
+  std::unique_ptr<Storage> db_;
+};
+
+TEST_F(ListsLegacyTest, ConvertedAsEdited) {
+  const std::string key = "legacy_list";
+  std::vector<std::string> expected;
+  for (int i = 0; i < 300; ++i) {
+    expected.push_back("v" + std::to_string(i));
+  }
+  PutLegacyList(db_.get(), key, expected);
+
+  // read as it is
+  uint64_t len = 0;
+  ASSERT_TRUE(db_->LLen(key, &len).ok());
+  ASSERT_EQ(len, 300);
+  std::string element;
+  ASSERT_TRUE(db_->LIndex(key, 150, &element).ok());
+  ASSERT_EQ(element, "v150");
+  ASSERT_EQ(Range(key), expected);
+
+  // each edit converts the runs it changes
+  uint64_t ret = 0;
+  ASSERT_TRUE(db_->LPush(key, {"h"}, &ret).ok());
+  ASSERT_EQ(ret, 301);
+  expected.insert(expected.begin(), "h");
+  std::vector<std::string> popped;
+  ASSERT_TRUE(db_->RPop(key, 1, &popped).ok());
+  ASSERT_EQ(popped, std::vector<std::string>{"v299"});
+  expected.pop_back();
+  ASSERT_EQ(Range(key), expected);
+
+  ASSERT_TRUE(db_->LSet(key, 200, "x").ok());
+  expected[200] = "x";
+  int64_t inserted = 0;
+  ASSERT_TRUE(db_->LInsert(key, storage::Before, "v10", "y", &inserted).ok());
+  ASSERT_EQ(inserted, 301);
+  expected.insert(expected.begin() + 11, "y");
+  ASSERT_TRUE(db_->LRem(key, 0, "v20", &ret).ok());
+  ASSERT_EQ(ret, 1);
+  expected.erase(expected.begin() + 22);
+  ASSERT_EQ(Range(key), expected);
+
+  ASSERT_TRUE(db_->LTrim(key, 1, -2).ok());
+  expected = std::vector<std::string>(expected.begin() + 1, expected.end() - 1);
+  ASSERT_EQ(Range(key), expected);
+  ASSERT_TRUE(db_->LIndex(key, 130, &element).ok());
+  ASSERT_EQ(element, expected[130]);
+
+  // read back from the records written
+  Open();
+  ASSERT_TRUE(db_->LLen(key, &len).ok());
+  ASSERT_EQ(len, expected.size());
+  ASSERT_EQ(Range(key), expected);
+  std::vector<std::string> part;
+  ASSERT_TRUE(db_->LRange(key, 120, 140, &part).ok());
+  ASSERT_EQ(part, std::vector<std::string>(expected.begin() + 120, expected.begin() + 141));
+}
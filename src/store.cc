@@ -36,4 +36,16 @@ void PStore::Init(int dbNum) {
   }
 }
 
+void PStore::LockAll() {
+  for (auto& db : backends_) {
+    db->Lock();
+  }
+}
+
+void PStore::UnLockAll() {
+  for (auto db = backends_.rbegin(); db != backends_.rend(); ++db) {
+    (*db)->UnLock();
+  }
+}
+
 }  // namespace pikiwidb
@@ -34,6 +34,10 @@ class PStore {
 
   std::shared_mutex& SharedMutex() { return dbs_mutex_; }
 
+  // locks the DBs in index order, for a command which may replace the storage of any of them
+  void LockAll();
+  void UnLockAll();
+
  private:
   PStore() = default;
 
@@ -8,9 +8,13 @@
 package pikiwidb_test
 
 import (
+	"bufio"
 	"context"
 	"log"
+	"net"
 	"strconv"
+	"strings"
+	"time"
 
 	. "github.com/onsi/ginkgo/v2"
 	. "github.com/onsi/gomega"
@@ -66,6 +70,231 @@ var _ = Describe("Admin", Ordered, func() {
 	It("Cmd INFO", func() {
 		log.Println("Cmd INFO Begin")
 		Expect(client.Info(ctx).Val()).NotTo(Equal("FooBar"))
+
+		info, err := client.Info(ctx, "threads").Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(info).To(ContainSubstring("# Threads"))
+		Expect(info).To(ContainSubstring("total_connections_accepted:"))
+		Expect(info).To(ContainSubstring("thread_0:name="))
+	})
+
+	It("Cmd INFO commandstats", func() {
+		Expect(client.Set(ctx, DefaultKey, DefaultValue, 0).Err()).NotTo(HaveOccurred())
+		Expect(client.Get(ctx, DefaultKey).Err()).NotTo(HaveOccurred())
+
+		info, err := client.Info(ctx, "commandstats").Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(info).To(ContainSubstring("# Commandstats"))
+		Expect(info).To(ContainSubstring("cmdstat_get:calls="))
+		Expect(info).To(ContainSubstring("storage_usec="))
+
+		info, err = client.Info(ctx, "latencystats").Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(info).To(ContainSubstring("latency_percentiles_usec_set:p50="))
+	})
+
+	It("Cmd INFO keylock", func() {
+		Expect(client.HSet(ctx, DefaultKey+"_hash", "field", "value").Err()).NotTo(HaveOccurred())
+
+		info, err := client.Info(ctx, "keylock").Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(info).To(ContainSubstring("# Keylock"))
+		Expect(info).To(ContainSubstring("key_locks:"))
+		Expect(info).To(ContainSubstring("key_lock_hold_usec_avg:"))
+		Expect(client.Del(ctx, DefaultKey+"_hash").Err()).NotTo(HaveOccurred())
+	})
+
+	It("Cmd INFO asyncpool", func() {
+		info, err := client.Info(ctx, "asyncpool").Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(info).To(ContainSubstring("# Asyncpool"))
+		Expect(info).To(ContainSubstring("async_threads:"))
+		Expect(info).To(ContainSubstring("async_class_keyspace:queued="))
+		Expect(info).To(ContainSubstring("async_class_collection:queued="))
+	})
+
+	It("Cmd INFO scheduler", func() {
+		info, err := client.Info(ctx, "scheduler").Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(info).To(ContainSubstring("# Scheduler"))
+		Expect(info).To(ContainSubstring("slow_cmd_cpu_share:"))
+		Expect(info).To(ContainSubstring("slow_cmd_deferred:"))
+	})
+
+	It("Cmd INFO valuecache", func() {
+		info, err := client.Info(ctx, "valuecache").Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(info).To(ContainSubstring("# Valuecache"))
+		Expect(info).To(ContainSubstring("value_cache_hit_ratio:"))
+		Expect(info).To(ContainSubstring("value_cache_used_memory:"))
+		Expect(info).To(ContainSubstring("value_cache_evictions:"))
+		Expect(info).To(ContainSubstring("meta_cache_hit_ratio:"))
+	})
+
+	It("Cmd SLOWLOG", func() {
+		Expect(client.Do(ctx, "slowlog", "reset").Val()).To(Equal(OK))
+		Expect(client.Do(ctx, "slowlog", "len").Val()).To(Equal(int64(0)))
+
+		res, err := client.Do(ctx, "slowlog", "get", 5).Slice()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(res).To(BeEmpty())
+
+		Expect(client.Do(ctx, "slowlog", "get", "abc").Err()).To(HaveOccurred())
+	})
+
+	It("Cmd MONITOR", func() {
+		conn, err := net.Dial("tcp", "127.0.0.1:7777")
+		Expect(err).NotTo(HaveOccurred())
+		defer conn.Close()
+		reader := bufio.NewReader(conn)
+
+		_, err = conn.Write([]byte("MONITOR\r\n"))
+		Expect(err).NotTo(HaveOccurred())
+		line, err := reader.ReadString('\n')
+		Expect(err).NotTo(HaveOccurred())
+		Expect(line).To(Equal("+OK\r\n"))
+
+		Expect(client.Set(ctx, "monitor_key", "a b", 0).Err()).NotTo(HaveOccurred())
+
+		// the client may send handshake commands first
+		Expect(conn.SetReadDeadline(time.Now().Add(3 * time.Second))).NotTo(HaveOccurred())
+		for !strings.Contains(line, `"monitor_key"`) {
+			line, err = reader.ReadString('\n')
+			Expect(err).NotTo(HaveOccurred())
+		}
+		Expect(line).To(ContainSubstring(`"set" "monitor_key" "a b"`))
+	})
+
+	It("Cmd LATENCY HISTOGRAM", func() {
+		Expect(client.Get(ctx, DefaultKey).Err()).NotTo(HaveOccurred())
+
+		res, err := client.Do(ctx, "latency", "histogram", "GET").Slice()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(res).To(HaveLen(2))
+		Expect(res[0]).To(Equal("get"))
+		detail := res[1].([]interface{})
+		Expect(detail[0]).To(Equal("calls"))
+		Expect(detail[1].(int64)).To(BeNumerically(">", 0))
+		Expect(detail[2]).To(Equal("histogram_usec"))
+		Expect(detail[3]).NotTo(BeEmpty())
+	})
+
+	It("should not let a slow client starve the fast ones", func() {
+		members := make([]interface{}, 0, 10000)
+		for i := 0; i < cap(members); i++ {
+			members = append(members, "member_"+strconv.Itoa(i))
+		}
+		Expect(client.SAdd(ctx, "sched_set", members...).Err()).NotTo(HaveOccurred())
+		defer client.Del(ctx, "sched_set")
+
+		// connections are spread over the loops, a few of them share the loop of the slow one
+		slow := s.NewClient()
+		defer slow.Close()
+		fasts := make([]*redis.Client, 4)
+		for i := range fasts {
+			fasts[i] = s.NewClient()
+			defer fasts[i].Close()
+		}
+
+		stop := make(chan struct{})
+		latencies := make(chan time.Duration, len(fasts))
+		for _, fast := range fasts {
+			go func(fast *redis.Client) {
+				defer GinkgoRecover()
+				var worst time.Duration
+				for {
+					select {
+					case <-stop:
+						latencies <- worst
+						return
+					default:
+					}
+					start := time.Now()
+					Expect(fast.Get(ctx, "sched_key").Err()).To(Equal(redis.Nil))
+					if elapsed := time.Since(start); elapsed > worst {
+						worst = elapsed
+					}
+				}
+			}(fast)
+		}
+
+		time.Sleep(20 * time.Millisecond)
+		start := time.Now()
+		pipe := slow.Pipeline()
+		for i := 0; i < 200; i++ {
+			pipe.SMembers(ctx, "sched_set")
+		}
+		_, err := pipe.Exec(ctx)
+		Expect(err).NotTo(HaveOccurred())
+		total := time.Since(start)
+		close(stop)
+
+		// a GET waits for a slow command or two, not for the whole pipeline
+		for range fasts {
+			Expect(<-latencies).To(BeNumerically("<", total/4))
+		}
+	})
+
+	It("Cmd FLUSHDB and FLUSHALL", func() {
+		conn := client.Conn()
+		defer conn.Close()
+		Expect(conn.Set(ctx, "flush_key", "db0", 0).Err()).NotTo(HaveOccurred())
+		Expect(conn.Select(ctx, 1).Err()).NotTo(HaveOccurred())
+		Expect(conn.Set(ctx, "flush_key", "db1", 0).Err()).NotTo(HaveOccurred())
+		Expect(conn.RPush(ctx, "flush_list", "a", "b").Err()).NotTo(HaveOccurred())
+
+		// the current DB alone
+		Expect(conn.FlushDB(ctx).Val()).To(Equal(OK))
+		Expect(conn.Get(ctx, "flush_key").Err()).To(MatchError(redis.Nil))
+		Expect(conn.LLen(ctx, "flush_list").Val()).To(Equal(int64(0)))
+		Expect(conn.Set(ctx, "flush_key", "db1", 0).Err()).NotTo(HaveOccurred())
+		Expect(conn.Select(ctx, 0).Err()).NotTo(HaveOccurred())
+		Expect(conn.Get(ctx, "flush_key").Val()).To(Equal("db0"))
+
+		Expect(conn.FlushAll(ctx).Val()).To(Equal(OK))
+		Expect(conn.Get(ctx, "flush_key").Err()).To(MatchError(redis.Nil))
+		Expect(conn.Select(ctx, 1).Err()).NotTo(HaveOccurred())
+		Expect(conn.Get(ctx, "flush_key").Err()).To(MatchError(redis.Nil))
+		Expect(conn.Select(ctx, 0).Err()).NotTo(HaveOccurred())
+	})
+
+	It("should run FLUSHALL between the commands of other clients", func() {
+		// clients on every DB keep using their storage while it is replaced
+		stop := make(chan struct{})
+		done := make(chan struct{})
+		for db := 0; db < 3; db++ {
+			go func(db int) {
+				defer GinkgoRecover()
+				defer func() { done <- struct{}{} }()
+				c := s.NewClient()
+				defer c.Close()
+				conn := c.Conn()
+				defer conn.Close()
+				Expect(conn.Select(ctx, db).Err()).NotTo(HaveOccurred())
+				for i := 0; ; i++ {
+					select {
+					case <-stop:
+						return
+					default:
+					}
+					key := "flush_concurrent_" + strconv.Itoa(i%16)
+					Expect(conn.Set(ctx, key, "v", 0).Err()).NotTo(HaveOccurred())
+					Expect(conn.Get(ctx, key).Err()).To(Or(Not(HaveOccurred()), MatchError(redis.Nil)))
+					Expect(conn.RPush(ctx, key+"_list", "v").Err()).NotTo(HaveOccurred())
+				}
+			}(db)
+		}
+
+		for i := 0; i < 10; i++ {
+			Expect(client.FlushAll(ctx).Val()).To(Equal(OK))
+			time.Sleep(10 * time.Millisecond)
+		}
+		close(stop)
+		for db := 0; db < 3; db++ {
+			<-done
+		}
+		Expect(client.FlushAll(ctx).Val()).To(Equal(OK))
+		Expect(client.Get(ctx, "flush_concurrent_0").Err()).To(MatchError(redis.Nil))
 	})
 
 	It("Cmd Select", func() {
@@ -91,6 +91,19 @@ var _ = Describe("Keyspace", Ordered, func() {
 		Expect(err).NotTo(HaveOccurred())
 	})
 
+	It("Exists follows emptied and expired keys", func() {
+		Expect(client.HSet(ctx, "key1", "field", "value").Err()).NotTo(HaveOccurred())
+		Expect(client.Exists(ctx, "key1").Val()).To(Equal(int64(1)))
+		Expect(client.HDel(ctx, "key1", "field").Val()).To(Equal(int64(1)))
+		Expect(client.Exists(ctx, "key1").Val()).To(Equal(int64(0)))
+
+		Expect(client.SAdd(ctx, "key2", "member").Err()).NotTo(HaveOccurred())
+		Expect(client.Expire(ctx, "key2", 1*time.Second).Val()).To(Equal(true))
+		time.Sleep(2 * time.Second)
+		Expect(client.Exists(ctx, "key2").Val()).To(Equal(int64(0)))
+		Expect(client.Del(ctx, "key1", "key2").Val()).To(Equal(int64(0)))
+	})
+
 	It("Del", func() {
 		set := client.Set(ctx, "key1", "value1", 0)
 		Expect(set.Err()).NotTo(HaveOccurred())
@@ -109,6 +122,26 @@ var _ = Describe("Keyspace", Ordered, func() {
 		Expect(n).To(Equal(int64(0)))
 	})
 
+	It("Del many keys", func() {
+		// enough keys for several instances, written and deleted in one batch each
+		var kvs []interface{}
+		var keys []string
+		for i := 0; i < 100; i++ {
+			key := "mkey" + strconv.Itoa(i)
+			kvs = append(kvs, key, "value")
+			keys = append(keys, key)
+		}
+		Expect(client.MSet(ctx, kvs...).Err()).NotTo(HaveOccurred())
+		Expect(client.HSet(ctx, "mkey0", "field", "value").Err()).NotTo(HaveOccurred())
+		Expect(client.Exists(ctx, keys...).Val()).To(Equal(int64(101)))
+
+		// a key given twice is deleted once
+		n, err := client.Del(ctx, append(keys, "mkey1", "notExistKey")...).Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(n).To(Equal(int64(101)))
+		Expect(client.Exists(ctx, keys...).Val()).To(Equal(int64(0)))
+	})
+
 	// pikiwidb should treat numbers other than base-10 as strings
 	It("base", func() {
 		set := client.Set(ctx, "key", "0b1", 0)
@@ -313,4 +313,95 @@ var _ = Describe("List", Ordered, func() {
 		del := client.Del(ctx, DefaultKey)
 		Expect(del.Err()).NotTo(HaveOccurred())
 	})
+
+	It("should edit a large list", func() {
+		// spans many chunks, each edit checked against a copy kept here
+		var expected []string
+		var values []interface{}
+		for i := 0; i < 1000; i++ {
+			expected = append(expected, "v"+strconv.Itoa(i))
+			values = append(values, "v"+strconv.Itoa(i))
+		}
+		Expect(client.RPush(ctx, DefaultKey, values...).Val()).To(Equal(int64(1000)))
+
+		Expect(client.LInsert(ctx, DefaultKey, "BEFORE", "v500", "x").Val()).To(Equal(int64(1001)))
+		expected = append(expected[:500], append([]string{"x"}, expected[500:]...)...)
+		Expect(client.LInsert(ctx, DefaultKey, "AFTER", "v999", "y").Val()).To(Equal(int64(1002)))
+		expected = append(expected, "y")
+		Expect(client.LInsert(ctx, DefaultKey, "AFTER", "none", "z").Val()).To(Equal(int64(-1)))
+
+		Expect(client.LSet(ctx, DefaultKey, 700, "x").Err()).NotTo(HaveOccurred())
+		expected[700] = "x"
+		Expect(client.LSet(ctx, DefaultKey, -1, "x").Err()).NotTo(HaveOccurred())
+		expected[len(expected)-1] = "x"
+
+		Expect(client.LIndex(ctx, DefaultKey, 500).Val()).To(Equal("x"))
+		Expect(client.LIndex(ctx, DefaultKey, 501).Val()).To(Equal("v500"))
+		Expect(client.LIndex(ctx, DefaultKey, -2).Val()).To(Equal("v999"))
+
+		Expect(client.LRem(ctx, DefaultKey, -2, "x").Val()).To(Equal(int64(2)))
+		expected = append(expected[:700], expected[701:len(expected)-1]...)
+		Expect(client.LRange(ctx, DefaultKey, 0, -1).Val()).To(Equal(expected))
+
+		Expect(client.LPop(ctx, DefaultKey).Val()).To(Equal("v0"))
+		Expect(client.RPop(ctx, DefaultKey).Val()).To(Equal("v999"))
+		expected = expected[1 : len(expected)-1]
+		Expect(client.LTrim(ctx, DefaultKey, 100, -100).Err()).NotTo(HaveOccurred())
+		expected = expected[100 : len(expected)-99]
+		Expect(client.LLen(ctx, DefaultKey).Val()).To(Equal(int64(len(expected))))
+		Expect(client.LRange(ctx, DefaultKey, 0, -1).Val()).To(Equal(expected))
+		Expect(client.LRange(ctx, DefaultKey, 250, 260).Val()).To(Equal(expected[250:261]))
+	})
+
+	It("Cmd BLPOP & BRPOP", func() {
+		Expect(client.RPush(ctx, DefaultKey, s2s["key_1"], s2s["key_2"]).Err()).NotTo(HaveOccurred())
+		Expect(client.BLPop(ctx, time.Second, "nolist", DefaultKey).Val()).To(Equal([]string{DefaultKey, s2s["key_1"]}))
+		Expect(client.BRPop(ctx, time.Second, DefaultKey).Val()).To(Equal([]string{DefaultKey, s2s["key_2"]}))
+
+		// times out on an empty list
+		start := time.Now()
+		Expect(client.BLPop(ctx, 200*time.Millisecond, DefaultKey).Err()).To(Equal(redis.Nil))
+		Expect(time.Since(start)).To(BeNumerically(">=", 150*time.Millisecond))
+
+		Expect(client.Do(ctx, "blpop", DefaultKey, "-1").Err()).To(MatchError("ERR timeout is negative"))
+		Expect(client.Do(ctx, "blpop", DefaultKey, "abc").Err()).To(MatchError("ERR timeout is not a float or out of range"))
+	})
+
+	It("Cmd BLPOP wakeup", func() {
+		// first come first served
+		results := make(chan []string, 2)
+		for i := 0; i < 2; i++ {
+			go func() {
+				c := s.NewClient()
+				defer c.Close()
+				results <- c.BLPop(ctx, 0, DefaultKey).Val()
+			}()
+			time.Sleep(100 * time.Millisecond)
+		}
+
+		Expect(client.RPush(ctx, DefaultKey, s2s["key_1"]).Err()).NotTo(HaveOccurred())
+		Eventually(results).Should(Receive(Equal([]string{DefaultKey, s2s["key_1"]})))
+		Expect(client.RPush(ctx, DefaultKey, s2s["key_2"]).Err()).NotTo(HaveOccurred())
+		Eventually(results).Should(Receive(Equal([]string{DefaultKey, s2s["key_2"]})))
+		Expect(client.LLen(ctx, DefaultKey).Val()).To(Equal(int64(0)))
+	})
+
+	It("Cmd BRPOPLPUSH & BLMOVE", func() {
+		done := make(chan string, 1)
+		go func() {
+			c := s.NewClient()
+			defer c.Close()
+			done <- c.BRPopLPush(ctx, DefaultKey, "dst", 0).Val()
+		}()
+		time.Sleep(100 * time.Millisecond)
+
+		Expect(client.LPush(ctx, DefaultKey, s2s["key_1"]).Err()).NotTo(HaveOccurred())
+		Eventually(done).Should(Receive(Equal(s2s["key_1"])))
+		Expect(client.LRange(ctx, "dst", 0, -1).Val()).To(Equal([]string{s2s["key_1"]}))
+
+		Expect(client.BLMove(ctx, "dst", DefaultKey, "LEFT", "RIGHT", time.Second).Val()).To(Equal(s2s["key_1"]))
+		Expect(client.LRange(ctx, DefaultKey, 0, -1).Val()).To(Equal([]string{s2s["key_1"]}))
+		Expect(client.BLMove(ctx, "dst", DefaultKey, "LEFT", "RIGHT", 100*time.Millisecond).Err()).To(Equal(redis.Nil))
+		Expect(client.Do(ctx, "blmove", "dst", DefaultKey, "UP", "RIGHT", "0").Err()).To(MatchError("ERR syntax error"))
+	})
 })
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2023-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+package pikiwidb_test
+
+import (
+	"context"
+	"log"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+	"github.com/redis/go-redis/v9"
+
+	"github.com/OpenAtomFoundation/pikiwidb/tests/util"
+)
+
+var _ = Describe("Multi", Ordered, func() {
+	var (
+		ctx    = context.TODO()
+		s      *util.Server
+		client *redis.Client
+	)
+
+	BeforeAll(func() {
+		config := util.GetConfPath(false, 0)
+
+		s = util.StartServer(config, map[string]string{"port": strconv.Itoa(7777)}, true)
+		Expect(s).NotTo(Equal(nil))
+	})
+
+	AfterAll(func() {
+		err := s.Close()
+		if err != nil {
+			log.Println("Close Server fail.", err.Error())
+			return
+		}
+	})
+
+	BeforeEach(func() {
+		client = s.NewClient()
+		Expect(client.FlushDB(ctx).Err()).NotTo(HaveOccurred())
+	})
+
+	AfterEach(func() {
+		err := client.Close()
+		if err != nil {
+			log.Println("Close client conn fail.", err.Error())
+			return
+		}
+	})
+
+	It("Cmd MULTI & EXEC", func() {
+		var incr *redis.IntCmd
+		var get *redis.StringCmd
+		_, err := client.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+			pipe.Set(ctx, "mkey", "1", 0)
+			pipe.Incr(ctx, "mkey")
+			incr = pipe.Incr(ctx, "mkey")
+			pipe.SAdd(ctx, "mset", "a", "b")
+			get = pipe.Get(ctx, "mkey")
+			return nil
+		})
+		Expect(err).NotTo(HaveOccurred())
+		// the queued commands read the writes before them
+		Expect(incr.Val()).To(Equal(int64(3)))
+		Expect(get.Val()).To(Equal("3"))
+		Expect(client.Get(ctx, "mkey").Val()).To(Equal("3"))
+		Expect(client.SMembers(ctx, "mset").Val()).To(ConsistOf("a", "b"))
+	})
+
+	It("Cmd MULTI queueing", func() {
+		conn := client.Conn()
+		defer conn.Close()
+
+		Expect(conn.Do(ctx, "exec").Err()).To(MatchError("ERR EXEC without MULTI"))
+		Expect(conn.Do(ctx, "discard").Err()).To(MatchError("ERR DISCARD without MULTI"))
+
+		Expect(conn.Do(ctx, "multi").Val()).To(Equal("OK"))
+		Expect(conn.Do(ctx, "multi").Err()).To(MatchError("ERR MULTI calls can not be nested"))
+		Expect(conn.Do(ctx, "set", "qkey", "v").Val()).To(Equal("QUEUED"))
+		Expect(client.Exists(ctx, "qkey").Val()).To(Equal(int64(0)))
+		Expect(conn.Do(ctx, "discard").Val()).To(Equal("OK"))
+		Expect(client.Exists(ctx, "qkey").Val()).To(Equal(int64(0)))
+
+		Expect(conn.Do(ctx, "multi").Val()).To(Equal("OK"))
+		Expect(conn.Do(ctx, "set", "qkey", "v").Val()).To(Equal("QUEUED"))
+		Expect(conn.Do(ctx, "set", "qkey").Err()).To(HaveOccurred())
+		Expect(conn.Do(ctx, "select", "1").Err()).To(MatchError("ERR Command not allowed inside a transaction"))
+		Expect(conn.Do(ctx, "exec").Err().Error()).To(ContainSubstring("EXECABORT"))
+		Expect(client.Exists(ctx, "qkey").Val()).To(Equal(int64(0)))
+	})
+
+	It("Cmd WATCH", func() {
+		other := s.NewClient()
+		defer other.Close()
+		Expect(client.Set(ctx, "wkey", "1", 0).Err()).NotTo(HaveOccurred())
+
+		// untouched, EXEC runs
+		err := client.Watch(ctx, func(tx *redis.Tx) error {
+			_, err := tx.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+				pipe.Incr(ctx, "wkey")
+				return nil
+			})
+			return err
+		}, "wkey")
+		Expect(err).NotTo(HaveOccurred())
+		Expect(client.Get(ctx, "wkey").Val()).To(Equal("2"))
+
+		// written by another client after WATCH, EXEC fails
+		err = client.Watch(ctx, func(tx *redis.Tx) error {
+			Expect(other.Set(ctx, "wkey", "10", 0).Err()).NotTo(HaveOccurred())
+			_, err := tx.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+				pipe.Incr(ctx, "wkey")
+				return nil
+			})
+			return err
+		}, "wkey")
+		Expect(err).To(Equal(redis.TxFailedErr))
+		Expect(client.Get(ctx, "wkey").Val()).To(Equal("10"))
+
+		// UNWATCH forgets the keys
+		err = client.Watch(ctx, func(tx *redis.Tx) error {
+			Expect(other.Set(ctx, "wkey", "20", 0).Err()).NotTo(HaveOccurred())
+			Expect(tx.Unwatch(ctx).Err()).NotTo(HaveOccurred())
+			_, err := tx.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+				pipe.Incr(ctx, "wkey")
+				return nil
+			})
+			return err
+		}, "wkey")
+		Expect(err).NotTo(HaveOccurred())
+		Expect(client.Get(ctx, "wkey").Val()).To(Equal("21"))
+	})
+
+	It("Cmd WATCH with a slow write", func() {
+		const (
+			workers = 4
+			rounds  = 50
+		)
+		Expect(client.Set(ctx, "wcount", "0", 0).Err()).NotTo(HaveOccurred())
+		blob := strings.Repeat("x", 1<<20)
+
+		// the increments of the workers are checked by WATCH, the ones of the writer come with a large value
+		var wg sync.WaitGroup
+		var writes int64
+		stop := make(chan struct{})
+		wg.Add(1)
+		go func() {
+			defer GinkgoRecover()
+			defer wg.Done()
+			writer := s.NewClient()
+			defer writer.Close()
+			for {
+				select {
+				case <-stop:
+					return
+				default:
+				}
+				_, err := writer.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+					pipe.Set(ctx, "wblob", blob, 0)
+					pipe.Incr(ctx, "wcount")
+					return nil
+				})
+				Expect(err).NotTo(HaveOccurred())
+				atomic.AddInt64(&writes, 1)
+			}
+		}()
+
+		var done sync.WaitGroup
+		for i := 0; i < workers; i++ {
+			done.Add(1)
+			go func() {
+				defer GinkgoRecover()
+				defer done.Done()
+				c := s.NewClient()
+				defer c.Close()
+				for n := 0; n < rounds; {
+					err := c.Watch(ctx, func(tx *redis.Tx) error {
+						v, err := tx.Get(ctx, "wcount").Int64()
+						if err != nil {
+							return err
+						}
+						_, err = tx.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+							pipe.Set(ctx, "wcount", v+1, 0)
+							return nil
+						})
+						return err
+					}, "wcount")
+					if err == redis.TxFailedErr {
+						continue
+					}
+					Expect(err).NotTo(HaveOccurred())
+					n++
+				}
+			}()
+		}
+		done.Wait()
+		close(stop)
+		wg.Wait()
+
+		// an EXEC committing on a value read before a concurrent write would lose an increment
+		Expect(client.Get(ctx, "wcount").Int64()).To(Equal(int64(workers*rounds) + atomic.LoadInt64(&writes)))
+	})
+})
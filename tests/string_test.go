@@ -244,4 +244,52 @@ var _ = Describe("String", Ordered, func() {
 			"",
 		}))
 	})
+
+	It("Pipeline SET & GET", func() {
+		pipe := client.Pipeline()
+		for i := 0; i < 50; i++ {
+			pipe.Set(ctx, "pkey_"+strconv.Itoa(i), "pvalue_"+strconv.Itoa(i), 0)
+		}
+		pipe.Set(ctx, "pkey_0", "pvalue_last", 0)
+		pipe.Incr(ctx, "pcounter")
+		for i := 0; i < 50; i++ {
+			pipe.Get(ctx, "pkey_"+strconv.Itoa(i))
+		}
+		pipe.Get(ctx, "pkey_none")
+		cmds, err := pipe.Exec(ctx)
+		Expect(err).To(Equal(redis.Nil))
+		Expect(cmds).To(HaveLen(103))
+
+		for i := 0; i < 51; i++ {
+			Expect(cmds[i].(*redis.StatusCmd).Val()).To(Equal("OK"))
+		}
+		Expect(cmds[51].(*redis.IntCmd).Val()).To(Equal(int64(1)))
+		Expect(cmds[52].(*redis.StringCmd).Val()).To(Equal("pvalue_last"))
+		for i := 1; i < 50; i++ {
+			Expect(cmds[52+i].(*redis.StringCmd).Val()).To(Equal("pvalue_" + strconv.Itoa(i)))
+		}
+		Expect(cmds[102].(*redis.StringCmd).Err()).To(Equal(redis.Nil))
+	})
+
+	It("Pipeline SET touches watched keys", func() {
+		other := s.NewClient()
+		defer other.Close()
+
+		// the merged SETs fail the EXEC watching one of them
+		err := client.Watch(ctx, func(tx *redis.Tx) error {
+			pipe := other.Pipeline()
+			for i := 0; i < 10; i++ {
+				pipe.Set(ctx, "wkey_"+strconv.Itoa(i), "v", 0)
+			}
+			_, err := pipe.Exec(ctx)
+			Expect(err).NotTo(HaveOccurred())
+			_, err = tx.TxPipelined(ctx, func(p redis.Pipeliner) error {
+				p.Set(ctx, "wkey_5", "mine", 0)
+				return nil
+			})
+			return err
+		}, "wkey_5")
+		Expect(err).To(Equal(redis.TxFailedErr))
+		Expect(client.Get(ctx, "wkey_5").Val()).To(Equal("v"))
+	})
 })
@@ -9,6 +9,7 @@ package pikiwidb_test
 
 import (
 	"context"
+	"fmt"
 	"log"
 	"strconv"
 	"time"
@@ -409,4 +410,40 @@ var _ = Describe("Zset", Ordered, func() {
 			Member: "three",
 		}}))
 	})
+
+	It("should keep ranks of a large zset", func() {
+		members := make([]redis.Z, 1000)
+		for i := range members {
+			members[i] = redis.Z{Score: float64(i), Member: fmt.Sprintf("m%04d", i)}
+		}
+		Expect(client.ZAdd(ctx, "bigzset", members...).Val()).To(Equal(int64(1000)))
+
+		Expect(client.ZRank(ctx, "bigzset", "m0500").Val()).To(Equal(int64(500)))
+		Expect(client.ZRevRank(ctx, "bigzset", "m0500").Val()).To(Equal(int64(499)))
+		Expect(client.ZRange(ctx, "bigzset", 700, 702).Val()).To(Equal([]string{"m0700", "m0701", "m0702"}))
+		Expect(client.ZRevRange(ctx, "bigzset", 10, 11).Val()).To(Equal([]string{"m0989", "m0988"}))
+		Expect(client.ZCount(ctx, "bigzset", "(100", "200").Val()).To(Equal(int64(100)))
+		Expect(client.ZRangeByScore(ctx, "bigzset", &redis.ZRangeBy{
+			Min: "100", Max: "200", Offset: 50, Count: 2,
+		}).Val()).To(Equal([]string{"m0150", "m0151"}))
+		Expect(client.ZRevRangeByScore(ctx, "bigzset", &redis.ZRangeBy{
+			Min: "100", Max: "200", Offset: 50, Count: 2,
+		}).Val()).To(Equal([]string{"m0150", "m0149"}))
+
+		Expect(client.ZRemRangeByRank(ctx, "bigzset", 100, 899).Val()).To(Equal(int64(800)))
+		Expect(client.ZCard(ctx, "bigzset").Val()).To(Equal(int64(200)))
+		Expect(client.ZRank(ctx, "bigzset", "m0900").Val()).To(Equal(int64(100)))
+		Expect(client.ZRange(ctx, "bigzset", 150, 150).Val()).To(Equal([]string{"m0950"}))
+
+		Expect(client.ZIncrBy(ctx, "bigzset", 2000, "m0000").Val()).To(Equal(float64(2000)))
+		Expect(client.ZRank(ctx, "bigzset", "m0000").Val()).To(Equal(int64(199)))
+		Expect(client.ZRevRank(ctx, "bigzset", "m0000").Val()).To(Equal(int64(0)))
+
+		for i := range members {
+			members[i].Score = 0
+		}
+		Expect(client.ZAdd(ctx, "lexzset", members...).Val()).To(Equal(int64(1000)))
+		Expect(client.ZLexCount(ctx, "lexzset", "[m0100", "(m0200").Val()).To(Equal(int64(100)))
+		Expect(client.ZLexCount(ctx, "lexzset", "(m0100", "+").Val()).To(Equal(int64(899)))
+	})
 })